@@ -0,0 +1,357 @@
+/***************************************************************************
+                          batchmerge.cpp  -  description
+                             -------------------
+    copyright            : (C) 2002-2007 by Joachim Eibl
+    email                : joachim.eibl at gmx.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "batchmerge.h"
+#include "common.h"
+#include "diff.h"
+#include "mergeengine.h"
+#include "optiondialog.h"
+#include "fileaccess.h"
+#include "progress.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QMap>
+#include <QProcess>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+
+#include <kcmdlineargs.h>
+#include <kglobal.h>
+#include <klocale.h>
+
+#include <stdio.h>
+#include <list>
+#include <vector>
+
+int autoMergeFiles( Options* pOptions, const QString& base, const QString& a, const QString& b,
+                    const QString& output, QString& errorText )
+{
+   SourceData sd1;
+   SourceData sd2;
+   SourceData sd3;
+   sd1.setOptions( pOptions );
+   sd2.setOptions( pOptions );
+   sd3.setOptions( pOptions );
+   sd1.setFilename( base );
+   sd2.setFilename( a );
+   sd3.setFilename( b );
+
+   QStringList errors;
+   errors += sd1.readAndPreprocess( pOptions->m_pEncodingA, pOptions->m_bAutoDetectUnicodeA );
+   errors += sd2.readAndPreprocess( pOptions->m_pEncodingB, pOptions->m_bAutoDetectUnicodeB );
+   if ( !sd3.isEmpty() )
+      errors += sd3.readAndPreprocess( pOptions->m_pEncodingC, pOptions->m_bAutoDetectUnicodeC );
+   if ( !sd1.isValid() || !sd2.isValid() || !sd3.isValid() )
+      errors.append( i18n("Opening of these files failed:") );
+   if ( !errors.isEmpty() )
+   {
+      errorText = errors.join(" ");
+      return -1;
+   }
+
+   return autoMerge( pOptions, sd1, sd2, sd3, output, errorText );
+}
+
+int autoMerge( Options* pOptions, SourceData& sd1, SourceData& sd2, SourceData& sd3,
+               const QString& output, QString& errorText, MemoryReport* pMemoryReport )
+{
+   bool bTripleDiff = !sd3.isEmpty();
+
+   // Same as in the GUI: If two inputs are binary equal take the third one.
+   SourceData* pSD = 0;
+   if ( !bTripleDiff )
+   {
+      if ( sd1.isBinaryEqualWith( sd2 ) ) { pSD = &sd1; }
+   }
+   else
+   {
+      if      ( sd3.isBinaryEqualWith( sd2 ) ) { pSD = &sd3; } // B==C (assume A is old)
+      else if ( sd1.isBinaryEqualWith( sd2 ) ) { pSD = &sd3; } // assuming C has changed
+      else if ( sd1.isBinaryEqualWith( sd3 ) ) { pSD = &sd2; } // assuming B has changed
+   }
+   if ( pSD!=0 )
+   {
+      FileAccess fa( output );
+      if ( pOptions->m_bDmCreateBakFiles && fa.exists() && !fa.createBackup(".orig") )
+      {
+         errorText = fa.getStatusText() + i18n("\n\nCreating backup failed. File not saved.");
+         return -1;
+      }
+      if ( !pSD->saveNormalDataAs( output ) )
+      {
+         errorText = i18n("Saving failed.");
+         return -1;
+      }
+      return 0;
+   }
+
+   // Binary data is not part of the merge result.
+   if ( !sd1.isText() || !sd2.isText() || !sd3.isText() )
+   {
+      errorText = i18n("Some inputfiles don't seem to be pure textfiles.");
+      return -1;
+   }
+
+   ManualDiffHelpList manualDiffHelpList; // Always empty here
+   DiffList diffList12;
+   DiffList diffList23;
+   DiffList diffList13;
+   Diff3LineList diff3LineList;
+   Diff3LineVector diff3LineVector;
+   DiffBufferInfo diffBufferInfo;
+   TotalDiffStatus totalDiffStatus;
+
+   // Only the line alignment is needed. The character level differences within
+   // the lines (fineDiff()) are only needed for display.
+   if ( !bTripleDiff )
+   {
+      runDiff( sd1.getLineDataForDiff(), sd1.getSizeLines(), sd2.getLineDataForDiff(), sd2.getSizeLines(), diffList12, 1, 2,
+               &manualDiffHelpList, pOptions );
+      calcDiff3LineListUsingAB( &diffList12, diff3LineList );
+      totalDiffStatus.bTextAEqB = fineDiffFlagsOnly( diff3LineList, 1, sd1.getLineDataForDisplay(), sd2.getLineDataForDisplay() );
+   }
+   else
+   {
+      runDiff( sd1.getLineDataForDiff(), sd1.getSizeLines(), sd2.getLineDataForDiff(), sd2.getSizeLines(), diffList12, 1, 2,
+               &manualDiffHelpList, pOptions );
+      runDiff( sd2.getLineDataForDiff(), sd2.getSizeLines(), sd3.getLineDataForDiff(), sd3.getSizeLines(), diffList23, 2, 3,
+               &manualDiffHelpList, pOptions );
+      runDiff( sd1.getLineDataForDiff(), sd1.getSizeLines(), sd3.getLineDataForDiff(), sd3.getSizeLines(), diffList13, 1, 3,
+               &manualDiffHelpList, pOptions );
+
+      calcDiff3LineListUsingAB( &diffList12, diff3LineList );
+      calcDiff3LineListUsingAC( &diffList13, diff3LineList );
+      correctManualDiffAlignment( diff3LineList, &manualDiffHelpList );
+      calcDiff3LineListTrim( diff3LineList, sd1.getLineDataForDiff(), sd2.getLineDataForDiff(), sd3.getLineDataForDiff(), &manualDiffHelpList, pOptions );
+      if ( pOptions->m_bDiff3AlignBC )
+      {
+         calcDiff3LineListUsingBC( &diffList23, diff3LineList );
+         correctManualDiffAlignment( diff3LineList, &manualDiffHelpList );
+         calcDiff3LineListTrim( diff3LineList, sd1.getLineDataForDiff(), sd2.getLineDataForDiff(), sd3.getLineDataForDiff(), &manualDiffHelpList, pOptions );
+      }
+
+      totalDiffStatus.bTextAEqB = fineDiffFlagsOnly( diff3LineList, 1, sd1.getLineDataForDisplay(), sd2.getLineDataForDisplay() );
+      totalDiffStatus.bTextBEqC = fineDiffFlagsOnly( diff3LineList, 2, sd2.getLineDataForDisplay(), sd3.getLineDataForDisplay() );
+      totalDiffStatus.bTextAEqC = fineDiffFlagsOnly( diff3LineList, 3, sd3.getLineDataForDisplay(), sd1.getLineDataForDisplay() );
+   }
+
+   diffBufferInfo.init( &diff3LineList, &diff3LineVector,
+      sd1.getLineDataForDiff(), sd1.getSizeLines(),
+      sd2.getLineDataForDiff(), sd2.getSizeLines(),
+      sd3.getLineDataForDiff(), sd3.getSizeLines() );
+   calcWhiteDiff3Lines( diff3LineList, sd1.getLineDataForDiff(), sd2.getLineDataForDiff(), sd3.getLineDataForDiff() );
+   calcDiff3LineVector( diff3LineList, diff3LineVector );
+   calcMergeDetails( diff3LineList, !bTripleDiff );
+
+   MergeEngine mergeEngine( pOptions );
+   mergeEngine.init(
+      sd1.getLineDataForDisplay(), sd1.getSizeLines(),
+      sd2.getLineDataForDisplay(), sd2.getSizeLines(),
+      bTripleDiff ? sd3.getLineDataForDisplay() : 0, sd3.getSizeLines(),
+      &diff3LineList, &diffBufferInfo, &totalDiffStatus );
+   mergeEngine.merge( true, -1 );
+
+   if ( pMemoryReport!=0 )
+   {
+      sd1.reportMemory( *pMemoryReport, "A" );
+      sd2.reportMemory( *pMemoryReport, "B" );
+      sd3.reportMemory( *pMemoryReport, "C" );
+      pMemoryReport->add( "DiffList AB", getDiffListMemory( diffList12 ) );
+      pMemoryReport->add( "DiffList BC", getDiffListMemory( diffList23 ) );
+      pMemoryReport->add( "DiffList AC", getDiffListMemory( diffList13 ) );
+      diff3LineList.reportMemory( *pMemoryReport, "Diff3LineList" );
+      diff3LineVector.reportMemory( *pMemoryReport, "Diff3LineVector" );
+      mergeEngine.reportMemory( *pMemoryReport );
+   }
+
+   int nofUnsolvedConflicts = mergeEngine.getNrOfUnsolvedConflicts();
+   if ( nofUnsolvedConflicts > 0 )
+      return nofUnsolvedConflicts;
+
+   QTextCodec* pEncoding = pOptions->m_bAutoSelectOutEncoding ?
+      getDefaultOutputEncoding( sd1.getEncoding(), sd2.getEncoding(), sd3.getEncoding() ) : pOptions->m_pEncodingOut;
+   e_LineEndStyle eLineEndStyle = getDefaultLineEndStyle( pOptions, sd1.getLineEndStyle(), sd2.getLineEndStyle(), sd3.getLineEndStyle() );
+   if ( eLineEndStyle==eLineEndStyleConflict || eLineEndStyle==eLineEndStyleUndefined )
+   {
+      errorText = i18n("There is a line end style conflict. Please choose the line end style manually.\n");
+      return -1;
+   }
+
+   if ( !mergeEngine.saveDocument( output, pEncoding, eLineEndStyle, errorText ) )
+      return -1;
+
+   return 0;
+}
+
+struct BatchEntry
+{
+   int lineNr;        // in the manifest, starting with 1
+   QStringList files; // base, A, B, output
+};
+
+static bool readManifest( const QString& manifestFileName, std::list<BatchEntry>& entries, QString& errorText )
+{
+   QFile file( manifestFileName );
+   if ( !file.open( QIODevice::ReadOnly ) )
+   {
+      errorText = i18n("Reading the batch manifest %1 failed.", manifestFileName);
+      return false;
+   }
+   QTextStream ts( &file );
+   int lineNr = 0;
+   while ( !ts.atEnd() )
+   {
+      QString line = ts.readLine();
+      ++lineNr;
+      if ( line.trimmed().isEmpty() || line.startsWith('#') )
+         continue;
+      BatchEntry entry;
+      entry.lineNr = lineNr;
+      entry.files = line.split('\t');
+      entries.push_back( entry );
+   }
+   return true;
+}
+
+// One result line: manifest line, status, nr of unsolved conflicts, output (, error)
+static QString mergeBatchEntry( Options* pOptions, const BatchEntry& entry )
+{
+   QString result = QString::number( entry.lineNr ) + "\t";
+   if ( entry.files.count() != 4 )
+      return result + "error\t-1\t\t" + i18n("Expected base, A, B and output separated by tabs.");
+
+   QString errorText;
+   int nofUnsolvedConflicts = autoMergeFiles( pOptions, entry.files[0], entry.files[1], entry.files[2], entry.files[3], errorText );
+   if ( nofUnsolvedConflicts < 0 )
+      return result + "error\t-1\t" + entry.files[3] + "\t" + errorText.simplified();
+   else if ( nofUnsolvedConflicts > 0 )
+      return result + "conflicts\t" + QString::number(nofUnsolvedConflicts) + "\t" + entry.files[3];
+   else
+      return result + "merged\t0\t" + entry.files[3];
+}
+
+int runBatchMerge( KCmdLineArgs* args )
+{
+   // Needed before any file operations via FileAccess happen.
+   if (!g_pProgressDialog)
+   {
+      g_pProgressDialog = new ProgressDialog(0);
+      g_pProgressDialog->setStayHidden( true );
+   }
+
+   // Same options as for the GUI, including those given via --cs.
+   OptionDialog optionDialog( false );
+   optionDialog.readOptions( KGlobal::config() );
+   QString s = optionDialog.parseOptions( args->getOptionList("cs") );
+   if ( !s.isEmpty() )
+   {
+      fprintf(stderr, "%s\n", i18n("Config Option Error:").toLatin1().constData());
+      fprintf(stderr, "%s\n", s.toLatin1().constData());
+      return 1;
+   }
+   Options* pOptions = &optionDialog.m_options;
+
+   std::list<BatchEntry> entries;
+   QString errorText;
+   if ( !readManifest( args->getOption("batch"), entries, errorText ) )
+   {
+      fprintf(stderr, "%s\n", errorText.toLocal8Bit().constData());
+      return 1;
+   }
+
+   bool bAllMerged = true;
+   QString slice = args->getOption("batch-slice");
+   if ( !slice.isEmpty() )
+   {
+      // Worker process: Merge every n-th entry starting with the given index.
+      int sliceIdx = slice.section('/',0,0).toInt();
+      int nofSlices = max2( 1, slice.section('/',1,1).toInt() );
+      int entryIdx = 0;
+      std::list<BatchEntry>::const_iterator i;
+      for( i=entries.begin(); i!=entries.end(); ++i, ++entryIdx )
+      {
+         if ( entryIdx % nofSlices != sliceIdx )
+            continue;
+         QString result = mergeBatchEntry( pOptions, *i );
+         bAllMerged = bAllMerged && result.section('\t',1,1)=="merged";
+         fprintf(stdout, "%s\n", result.toLocal8Bit().constData());
+         fflush(stdout);
+      }
+      return bAllMerged ? 0 : 1;
+   }
+
+   // Separate processes instead of threads, because the diff and merge code uses
+   // global state (options, progress dialog).
+   int nofWorkers = min2( max2( 1, QThread::idealThreadCount() ), (int)entries.size() );
+   QStringList arguments = QCoreApplication::arguments();
+   arguments.removeFirst(); // program name
+   std::vector<QProcess*> workers;
+   for( int workerIdx=0; workerIdx<nofWorkers; ++workerIdx )
+   {
+      QProcess* pProcess = new QProcess;
+      pProcess->setProcessChannelMode( QProcess::ForwardedErrorChannel );
+      pProcess->start( QCoreApplication::applicationFilePath(),
+         QStringList(arguments) << "--batch-slice" << QString("%1/%2").arg(workerIdx).arg(nofWorkers) );
+      workers.push_back( pProcess );
+   }
+
+   // Read the output of all workers while they run. Otherwise a worker could block on
+   // a full pipe while the first one is still being waited for.
+   std::vector<QByteArray> outputs( workers.size() );
+   unsigned int nofRunning = workers.size();
+   while ( nofRunning>0 )
+   {
+      nofRunning = 0;
+      for( unsigned int workerIdx=0; workerIdx<workers.size(); ++workerIdx )
+      {
+         QProcess* pProcess = workers[workerIdx];
+         if ( pProcess->state()!=QProcess::NotRunning )
+         {
+            pProcess->waitForReadyRead( 10 );
+            ++nofRunning;
+         }
+         outputs[workerIdx] += pProcess->readAllStandardOutput();
+      }
+   }
+
+   // Print the results in the order of the manifest.
+   QMap<int,QString> results;
+   for( unsigned int workerIdx=0; workerIdx<workers.size(); ++workerIdx )
+   {
+      QProcess* pProcess = workers[workerIdx];
+      outputs[workerIdx] += pProcess->readAllStandardOutput();
+      if ( pProcess->exitStatus()!=QProcess::NormalExit || pProcess->error()==QProcess::FailedToStart )
+         bAllMerged = false;
+      QStringList lines = QString::fromLocal8Bit( outputs[workerIdx] ).split('\n', QString::SkipEmptyParts);
+      foreach( const QString& line, lines )
+         results.insert( line.section('\t',0,0).toInt(), line );
+      delete pProcess;
+   }
+
+   std::list<BatchEntry>::const_iterator i;
+   for( i=entries.begin(); i!=entries.end(); ++i )
+   {
+      QMap<int,QString>::const_iterator r = results.constFind( i->lineNr );
+      QString result = r!=results.constEnd() ? r.value() :
+         QString::number( i->lineNr ) + "\terror\t-1\t\t" + i18n("Worker process failed.");
+      bAllMerged = bAllMerged && result.section('\t',1,1)=="merged";
+      fprintf(stdout, "%s\n", result.toLocal8Bit().constData());
+   }
+
+   return bAllMerged ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+/***************************************************************************
+                          batchmerge.h  -  description
+                             -------------------
+    copyright            : (C) 2002-2007 by Joachim Eibl
+    email                : joachim.eibl at gmx.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef BATCHMERGE_H
+#define BATCHMERGE_H
+
+#include <QString>
+
+class MemoryReport;
+class Options;
+class SourceData;
+class KCmdLineArgs;
+
+/** Merges base, a and b into output without any GUI, as "kdiff3 --auto" would.
+    The output is only written if all conflicts could be solved automatically.
+    If b is empty then base and a are merged as a two way merge.
+    Returns the number of unsolved conflicts or -1 on errors (see errorText).
+*/
+int autoMergeFiles( Options* pOptions, const QString& base, const QString& a, const QString& b,
+                    const QString& output, QString& errorText );
+
+/** Same as autoMergeFiles() for already loaded inputs. (sd3 may be empty for a two way merge.)
+    Only the line alignment is calculated, no data needed for display.
+    If pMemoryReport is given, the memory used by the inputs and the merge data is added to it.
+*/
+int autoMerge( Options* pOptions, SourceData& sd1, SourceData& sd2, SourceData& sd3,
+               const QString& output, QString& errorText, MemoryReport* pMemoryReport=0 );
+
+/** Handles the option --batch: Each line of the manifest contains the tab separated
+    file names of base, A, B and the output. The lines are distributed over one
+    worker process per cpu core (restarted with --batch-slice). For every file
+    one line "manifest line, status, nr of unsolved conflicts, output" is written
+    to stdout. Returns the exit code: 0 if all files could be merged.
+*/
+int runBatchMerge( KCmdLineArgs* args );
+
+#endif
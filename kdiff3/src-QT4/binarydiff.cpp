@@ -0,0 +1,206 @@
+/***************************************************************************
+                          binarydiff.cpp  -  description
+                             -------------------
+    copyright            : (C) 2002-2007 by Joachim Eibl
+    email                : joachim.eibl at gmx.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "binarydiff.h"
+#include "common.h"
+#include "progress.h"
+
+#include <klocale.h>
+
+#include <QHash>
+#include <QTextCodec>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+bool isBinaryData( const char* pBuf, qint64 size, QTextCodec* pEncoding )
+{
+   // In UTF-16 and UTF-32 text zero bytes are normal.
+   int mib = pEncoding!=0 ? pEncoding->mibEnum() : 0;
+   if ( mib==1013 || mib==1014 || mib==1015 ||   // UTF-16BE, UTF-16LE, UTF-16
+        mib==1017 || mib==1018 || mib==1019 )    // UTF-32, UTF-32BE, UTF-32LE
+      return false;
+
+   return size>0 && memchr( pBuf, 0, size ) != 0;
+}
+
+// Weak checksum of a block that can be updated in constant time
+// when the block moves on by one byte. (As used by rsync.)
+class RollingChecksum
+{
+public:
+   void init( const unsigned char* p, qint64 blockSize )
+   {
+      m_a = 0;
+      m_b = 0;
+      m_blockSize = (quint32)blockSize;
+      for( qint64 i=0; i<blockSize; ++i )
+      {
+         m_a += p[i];
+         m_b += (quint32)(blockSize-i) * p[i];
+      }
+   }
+   void roll( unsigned char out, unsigned char in )
+   {
+      m_a += in - out;
+      m_b += m_a - m_blockSize * out;
+   }
+   quint32 value() const { return (m_a & 0xffff) | (m_b << 16); }
+private:
+   quint32 m_a;
+   quint32 m_b;
+   quint32 m_blockSize;
+};
+
+// Offsets of the blocks with the same checksum in ascending order. Those before
+// m_first are behind the current position and are not looked at again.
+struct BlockCandidates
+{
+   BlockCandidates() { m_first = 0; }
+   std::vector<qint64> m_offsets;
+   unsigned int m_first;
+};
+
+// Repetitive data has many blocks with the same checksum. Comparing all of them
+// for every position would need quadratic time.
+static const unsigned int c_maxCandidates = 8;
+
+void calcBinaryDiff( const char* pBuf1, qint64 size1, const char* pBuf2, qint64 size2, BinaryDiffList& diffList )
+{
+   ProgressProxy pp;
+   diffList.clear();
+   const unsigned char* p1 = (const unsigned char*)pBuf1;
+   const unsigned char* p2 = (const unsigned char*)pBuf2;
+
+   // Equal start
+   qint64 pos1 = 0;
+   qint64 pos2 = 0;
+   while ( pos1<size1 && pos2<size2 && p1[pos1]==p2[pos2] )
+   {
+      ++pos1;
+      ++pos2;
+   }
+   qint64 nofEquals = pos1;
+
+   // Index the blocks of the first buffer by their weak checksum.
+   // The block size grows with the data to keep the index small.
+   const qint64 blockSize = minMaxLimiter( (qint64)sqrt( double(size1) ), (qint64)64, (qint64)65536 );
+   QHash<quint32, BlockCandidates> blocks;
+   for( qint64 offset = pos1; offset + blockSize <= size1; offset += blockSize )
+   {
+      RollingChecksum rc;
+      rc.init( p1+offset, blockSize );
+      blocks[ rc.value() ].m_offsets.push_back( offset );
+   }
+
+   RollingChecksum rc;
+   bool bChecksumValid = false;
+   qint64 j = pos2;
+   while ( pos1 + blockSize <= size1 && j + blockSize <= size2 )
+   {
+      if ( !bChecksumValid )
+      {
+         rc.init( p2+j, blockSize );
+         bChecksumValid = true;
+      }
+
+      // Take the first matching block that doesn't precede the last match.
+      qint64 matchPos = -1;
+      QHash<quint32, BlockCandidates>::iterator it = blocks.find( rc.value() );
+      if ( it!=blocks.end() )
+      {
+         BlockCandidates& bc = it.value();
+         while ( bc.m_first < bc.m_offsets.size() && bc.m_offsets[bc.m_first] < pos1 )
+            ++bc.m_first;
+         unsigned int end = min2( (unsigned int)bc.m_offsets.size(), bc.m_first + c_maxCandidates );
+         for( unsigned int k = bc.m_first; k<end; ++k )
+         {
+            if ( memcmp( p1+bc.m_offsets[k], p2+j, blockSize )==0 )
+            {
+               matchPos = bc.m_offsets[k];
+               break;
+            }
+         }
+      }
+
+      if ( matchPos>=0 )
+      {
+         // Extend the match in both directions.
+         qint64 start1 = matchPos;
+         qint64 start2 = j;
+         while ( start1>pos1 && start2>pos2 && p1[start1-1]==p2[start2-1] )
+         {
+            --start1;
+            --start2;
+         }
+         qint64 end1 = matchPos + blockSize;
+         qint64 end2 = j + blockSize;
+         while ( end1<size1 && end2<size2 && p1[end1]==p2[end2] )
+         {
+            ++end1;
+            ++end2;
+         }
+
+         diffList.push_back( BinaryDiff( nofEquals, start1-pos1, start2-pos2 ) );
+         nofEquals = end1 - start1;
+         pos1 = end1;
+         pos2 = end2;
+         j = pos2;
+         bChecksumValid = false;
+      }
+      else
+      {
+         if ( j + blockSize < size2 )
+            rc.roll( p2[j], p2[j+blockSize] );
+         ++j;
+      }
+
+      if ( (j & 0xfffff)==0 )
+         pp.setCurrent( double(j)/size2 );
+   }
+
+   // Remaining bytes. As with DiffList the last entry may contain no differences.
+   diffList.push_back( BinaryDiff( nofEquals, size1-pos1, size2-pos2 ) );
+}
+
+QString getBinaryDiffSummary( const BinaryDiffList& diffList, const QString& name1, const QString& name2 )
+{
+   qint64 nofRanges = 0;
+   qint64 nofBytes1 = 0;
+   qint64 nofBytes2 = 0;
+   qint64 firstDiffPos = -1;
+   qint64 pos1 = 0;
+   BinaryDiffList::const_iterator i;
+   for( i=diffList.begin(); i!=diffList.end(); ++i )
+   {
+      pos1 += i->nofEquals;
+      if ( i->diff1>0 || i->diff2>0 )
+      {
+         ++nofRanges;
+         nofBytes1 += i->diff1;
+         nofBytes2 += i->diff2;
+         if ( firstDiffPos<0 )
+            firstDiffPos = pos1;
+      }
+      pos1 += i->diff1;
+   }
+
+   if ( nofRanges==0 )
+      return i18n("Files %1 and %2 are binary equal.\n",name1,name2);
+
+   return i18n("Files %1 and %2 are binary and differ in %3 byte ranges (%4 bytes in %1, %5 bytes in %2). First difference at offset %6.\n",
+      name1, name2, QString::number(nofRanges), QString::number(nofBytes1), QString::number(nofBytes2), QString::number(firstDiffPos) );
+}
@@ -0,0 +1,52 @@
+/***************************************************************************
+                          binarydiff.h  -  description
+                             -------------------
+    copyright            : (C) 2002-2007 by Joachim Eibl
+    email                : joachim.eibl at gmx.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef BINARYDIFF_H
+#define BINARYDIFF_H
+
+#include <QString>
+#include <list>
+
+class QTextCodec;
+
+// Like Diff but for bytes: A range of equal bytes is followed by
+// a range with differences on either side.
+struct BinaryDiff
+{
+   qint64 nofEquals;
+
+   qint64 diff1;
+   qint64 diff2;
+
+   BinaryDiff(qint64 eq, qint64 d1, qint64 d2){nofEquals=eq; diff1=d1; diff2=d2; }
+};
+
+typedef std::list<BinaryDiff> BinaryDiffList;
+
+/** True if the raw data contains characters that don't occur in text
+    of the given encoding. (Checked before decoding.)
+*/
+bool isBinaryData( const char* pBuf, qint64 size, QTextCodec* pEncoding );
+
+/** Aligns both buffers blockwise via a rolling checksum (similar to rsync)
+    and returns the differing byte ranges. Runs in linear time for typical data.
+*/
+void calcBinaryDiff( const char* pBuf1, qint64 size1, const char* pBuf2, qint64 size2, BinaryDiffList& diffList );
+
+/** Text for the user: Number, size and position of the differing ranges. */
+QString getBinaryDiffSummary( const BinaryDiffList& diffList, const QString& name1, const QString& name2 );
+
+#endif
@@ -151,6 +151,42 @@ QStringList safeStringSplit(const QString& s, char sepChar, char metaChar )
    return sl;
 }
 
+void MemoryReport::add( const QString& item, qint64 bytes )
+{
+   if ( bytes>0 )
+      m_items.push_back( qMakePair( item, bytes ) );
+}
+
+qint64 MemoryReport::getTotal() const
+{
+   qint64 total = 0;
+   for( int i=0; i<m_items.size(); ++i )
+      total += m_items[i].second;
+   return total;
+}
+
+static QString memoryStr( qint64 bytes )
+{
+   if ( bytes < 10*1024 )
+      return QString::number( bytes ) + " B";
+   if ( bytes < 10*1024*1024 )
+      return QString::number( bytes/1024 ) + " KB";
+   return QString::number( double(bytes)/(1024*1024), 'f', 1 ) + " MB";
+}
+
+QString MemoryReport::getAsString() const
+{
+   int width = 5; // "Total"
+   for( int i=0; i<m_items.size(); ++i )
+      width = max2( width, m_items[i].first.length() );
+
+   QString s;
+   for( int i=0; i<m_items.size(); ++i )
+      s += m_items[i].first.leftJustified( width ) + "  " + memoryStr( m_items[i].second ).rightJustified( 10 ) + "\n";
+   s += QString("Total").leftJustified( width ) + "  " + memoryStr( getTotal() ).rightJustified( 10 ) + "\n";
+   return s;
+}
+
 
 
 static QString numStr(int n)
@@ -68,6 +68,8 @@ T minMaxLimiter( T d, T minimum, T maximum )
 
 #include <map>
 #include <QString>
+#include <QList>
+#include <QPair>
 class QFont;
 class QColor;
 class QSize;
@@ -121,4 +123,16 @@ public:
 QStringList safeStringSplit(const QString& s, char sepChar=',', char metaChar='\\' );
 QString safeStringJoin(const QStringList& sl, char sepChar=',', char metaChar='\\' );
 
+// Collects the bytes held by the big data structures, for finding out
+// which of them dominate the memory usage of a comparison.
+class MemoryReport
+{
+public:
+   void add( const QString& item, qint64 bytes );  // Items without bytes are skipped.
+   qint64 getTotal() const;
+   QString getAsString() const;  // One line per item and a final total
+private:
+   QList< QPair<QString,qint64> > m_items;
+};
+
 #endif
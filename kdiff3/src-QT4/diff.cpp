@@ -19,6 +19,7 @@
 #include <cstdlib>
 
 #include "diff.h"
+#include "binarydiff.h"
 #include "fileaccess.h"
 #include "gnudiff_diff.h"
 #include "options.h"
@@ -28,6 +29,7 @@
 #include <klocale.h>
 
 #include <QFileInfo>
+#include <QRegExp>
 #include <QDir>
 #include <QTextCodec>
 #include <QTextStream>
@@ -43,9 +45,9 @@ int LineData::width(int tabSize) const
 {
    int w=0;
    int j=0;
-   for( int i=0; i<size; ++i )
+   for( int i=0; i<m_size; ++i )
    {
-      if ( pLine[i]=='\t' )
+      if ( m_pLine[i]=='\t' )
       {
          for(j %= tabSize; j<tabSize; ++j)
             ++w;
@@ -65,19 +67,20 @@ int LineData::width(int tabSize) const
 // Then the equal()-function requires that the match has more than 2 nonwhite characters.
 // This is to avoid matches on trivial lines (e.g. with white space only).
 // This choice is good for C/C++.
-bool equal( const LineData& l1, const LineData& l2, bool bStrict )
+// With bIgnoreCase the characters are compared case folded, like GnuDiff does.
+bool equal( const LineData& l1, const LineData& l2, bool bStrict, bool bIgnoreCase )
 {
-   if ( l1.pLine==0 || l2.pLine==0) return false;
+   if ( l1.getLine()==0 || l2.getLine()==0) return false;
 
    if ( bStrict && g_bIgnoreTrivialMatches )//&& (l1.occurances>=5 || l2.occurances>=5) )
       return false;
 
    // Ignore white space diff
-   const QChar* p1 = l1.pLine;
-   const QChar* p1End = p1 + l1.size;
+   const QChar* p1 = l1.getLine();
+   const QChar* p1End = p1 + l1.size();
 
-   const QChar* p2 = l2.pLine;
-   const QChar* p2End = p2 + l2.size;
+   const QChar* p2 = l2.getLine();
+   const QChar* p2End = p2 + l2.size();
 
    if ( g_bIgnoreWhiteSpace )
    {
@@ -99,7 +102,7 @@ bool equal( const LineData& l1, const LineData& l2, bool bStrict )
          else if ( p1 == p1End || p2 == p2End )
             return false;
 
-         if( *p1 != *p2 )
+         if( *p1 != *p2 && !( bIgnoreCase && p1->toCaseFolded() == p2->toCaseFolded() ) )
             return false;
          ++p1;
          ++p2;
@@ -109,7 +112,10 @@ bool equal( const LineData& l1, const LineData& l2, bool bStrict )
 
    else
    {
-      if ( l1.size==l2.size && memcmp(p1, p2, l1.size)==0)
+      if ( l1.size()==l2.size() && memcmp(p1, p2, l1.size())==0)
+         return true;
+      else if ( bIgnoreCase && l1.size()==l2.size() &&
+                QString::fromRawData(p1, l1.size()).compare( QString::fromRawData(p2, l2.size()), Qt::CaseInsensitive )==0 )
          return true;
       else
          return false;
@@ -135,20 +141,21 @@ static bool isLineOrBufEnd( const QChar* p, int i, int size )
 - Allocate and free buffers as necessary.
 - Run a preprocessor, when specified.
 - Run the line-matching preprocessor, when specified.
-- Run other preprocessing steps: Uppercase, ignore comments,
+- Run other preprocessing steps: Ignore comments,
                                  remove carriage return, ignore numbers.
+- Ignore case needs no preprocessing: The comparison itself ignores the case.
 
 Order of operation:
- 1. If data was given via a string then save it to a temp file. (see setData())
+ 1. If data was given via a string then use it directly. (see setData())
+    Only if a preprocessor was specified save it to a temp file.
  2. If the specified file is nonlocal (URL) copy it to a temp file.
  3. If a preprocessor was specified, run the input file through it.
  4. Read the output of the preprocessor.
- 5. If Uppercase was specified: Turn the read data to uppercase.
- 6. Write the result to a temp file.
- 7. If a line-matching preprocessor was specified, run the temp file through it.
- 8. Read the output of the line-matching preprocessor.
- 9. If ignore numbers was specified, strip the LMPP-output of all numbers.
-10. If ignore comments was specified, strip the LMPP-output of comments.
+ 5. If a line-matching preprocessor was specified, run the input through it.
+ 6. Read the output of the line-matching preprocessor.
+ 7. If ignore comments was specified without a line-matching preprocessor:
+    Copy the already decoded text of step 4 (no second read and decode).
+ 8. If ignore comments was specified, strip the LMPP-output of comments.
 
 Optimizations: Skip unneeded steps.
 */
@@ -170,6 +177,7 @@ void SourceData::reset()
    m_fileAccess = FileAccess();
    m_normalData.reset();
    m_lmppData.reset();
+   m_inputData = QString();
    if ( !m_tempInputFileName.isEmpty() )
    {
       FileAccess::removeFile( m_tempInputFileName );
@@ -229,6 +237,7 @@ void SourceData::setFileAccess( const FileAccess& fileAccess )
 {
    m_fileAccess = fileAccess;
    m_aliasName = QString();
+   m_inputData = QString();
    if ( !m_tempInputFileName.isEmpty() )
    {
       FileAccess::removeFile( m_tempInputFileName );
@@ -244,24 +253,11 @@ QStringList SourceData::setData( const QString& data )
 {
    QStringList errors;
 
-   // Create a temp file for preprocessing:
-   if ( m_tempInputFileName.isEmpty() )
-   {
-      m_tempInputFileName = FileAccess::tempFileName();
-   }
-
-   FileAccess f( m_tempInputFileName );
-   QByteArray ba = QTextCodec::codecForName("UTF-8")->fromUnicode(data);
-   bool bSuccess = f.writeFile( ba.constData(), ba.length() );
-   if ( !bSuccess )
-   {
-      errors.append( i18n("Writing clipboard data to temp file failed.") );
-   }
-   else
-   {
-      m_aliasName = i18n("From Clipboard");
-      m_fileAccess = FileAccess("");  // Effect: m_fileAccess.isValid() is false
-   }
+   // Keep the text in memory. A temp file is only created in readAndPreprocess()
+   // when a preprocessor needs it.
+   m_inputData = data;
+   m_aliasName = i18n("From Clipboard");
+   m_fileAccess = FileAccess("");  // Effect: m_fileAccess.isValid() is false
 
    return errors;
 }
@@ -322,10 +318,21 @@ bool SourceData::isBinaryEqualWith( const SourceData& other ) const
           ( getSizeBytes()==0 || memcmp( getBuf(), other.getBuf(), getSizeBytes() )==0 );
 }
 
+void SourceData::reportMemory( MemoryReport& report, const QString& name ) const
+{
+   m_normalData.reportMemory( report, name + " " );
+   m_lmppData.reportMemory( report, name + " lmpp " );
+   // Usually shared with m_normalData.m_unicodeBuf (see readAndPreprocess())
+   if ( m_inputData.constData() != m_normalData.m_unicodeBuf.constData() )
+      report.add( name + " input data", m_inputData.capacity() * sizeof(QChar) );
+}
+
 void SourceData::FileData::reset()
 {
-   delete[] (char*)m_pBuf;
+   if ( !m_bBufFromText )
+      delete[] (char*)m_pBuf;
    m_pBuf = 0;
+   m_bBufFromText = false;
    m_v.clear();
    m_size = 0;
    m_vSize = 0;
@@ -365,17 +372,39 @@ bool SourceData::FileData::writeFile( const QString& filename )
    if ( filename.isEmpty() )   { return true; }
 
    FileAccess fa( filename );
+   if ( m_bBufFromText )
+   {
+      // Same format as a temp file for setData() would have had.
+      QByteArray ba = QTextCodec::codecForName("UTF-8")->fromUnicode( m_unicodeBuf );
+      return fa.writeFile( ba.constData(), ba.length() );
+   }
    bool bSuccess = fa.writeFile(m_pBuf, m_size);
    return bSuccess;
 }
 
-void SourceData::FileData::copyBufFrom( const FileData& src )
+// Use already decoded text: preprocess() will only split it into lines.
+void SourceData::FileData::setText( const QString& text )
 {
    reset();
-   char* pBuf;
-   m_size = src.m_size;
-   m_pBuf = pBuf = new char[m_size+100];
-   memcpy( pBuf, src.m_pBuf, m_size );
+   m_unicodeBuf = text;
+   m_pBuf = (const char*)m_unicodeBuf.unicode();
+   m_size = m_unicodeBuf.length() * sizeof(QChar);
+   m_bBufFromText = true;
+}
+
+// Copy the decoded text of src, which must already be preprocessed.
+void SourceData::FileData::copyTextFrom( const FileData& src )
+{
+   // Deep copy: The copy will be modified in place (see removeComments()).
+   setText( QString( src.m_unicodeBuf.unicode(), src.m_unicodeBuf.length() ) );
+}
+
+void SourceData::FileData::reportMemory( MemoryReport& report, const QString& prefix ) const
+{
+   if ( m_pBuf!=0 && !m_bBufFromText )
+      report.add( prefix + "m_pBuf", m_size + 100 );  // See readFile()
+   report.add( prefix + "m_unicodeBuf", m_unicodeBuf.capacity() * sizeof(QChar) );
+   report.add( prefix + "m_v", m_v.capacity() * sizeof(LineData) );
 }
 
 // Convert the input file from input encoding to output encoding and write it to the output file.
@@ -618,6 +647,8 @@ QStringList SourceData::readAndPreprocess( QTextCodec* pEncoding, bool bAutoDete
    QStringList errors;
 
    bool bTempFileFromClipboard = !m_fileAccess.isValid();
+   bool bCopyNormalDataForLmpp = false;
+   bool bNeedsInputFile = ! m_pOptions->m_PreProcessorCmd.isEmpty() || ! m_pOptions->m_LineMatchingPreProcessorCmd.isEmpty();
 
    // Detect the input for the preprocessing operations
    if ( !bTempFileFromClipboard )
@@ -640,8 +671,20 @@ QStringList SourceData::readAndPreprocess( QTextCodec* pEncoding, bool bAutoDete
    }
    else // The input was set via setData(), probably from clipboard.
    {
-      fileNameIn1 = m_tempInputFileName;
       m_pEncoding = QTextCodec::codecForName("UTF-8");
+      if ( bNeedsInputFile )
+      {
+         // Only the external preprocessors need the data in a file.
+         if ( m_tempInputFileName.isEmpty() )  { m_tempInputFileName = FileAccess::tempFileName(); }
+
+         FileAccess f( m_tempInputFileName );
+         QByteArray ba = m_pEncoding->fromUnicode( m_inputData );
+         if ( ! f.writeFile( ba.constData(), ba.length() ) )
+         {
+            errors.append( i18n("Writing clipboard data to temp file failed.") );
+         }
+         fileNameIn1 = m_tempInputFileName;
+      }
    }
    QTextCodec* pEncoding1 = m_pEncoding;
    QTextCodec* pEncoding2 = m_pEncoding;
@@ -652,7 +695,13 @@ QStringList SourceData::readAndPreprocess( QTextCodec* pEncoding, bool bAutoDete
    FileAccess faIn(fileNameIn1);
    int fileInSize = faIn.size();
 
-   if ( faIn.exists() ) // fileInSize > 0 )
+   if ( bTempFileFromClipboard && !bNeedsInputFile )
+   {
+      // No temp file and no decoding needed.
+      m_normalData.setText( m_inputData );
+      bCopyNormalDataForLmpp = m_pOptions->m_bIgnoreComments;
+   }
+   else if ( faIn.exists() ) // fileInSize > 0 )
    {
 
 #if defined(_WIN32) || defined(Q_OS_OS2)
@@ -763,57 +812,54 @@ QStringList SourceData::readAndPreprocess( QTextCodec* pEncoding, bool bAutoDete
             FileAccess::removeTempFile( fileNameInPP );
          }
       }
-      else if ( m_pOptions->m_bIgnoreComments || m_pOptions->m_bIgnoreCase )
+      else if ( m_pOptions->m_bIgnoreComments )
       {
-         // We need a copy of the normal data.
-         m_lmppData.copyBufFrom( m_normalData );
+         // We need a copy of the normal data. (Made after decoding, see below.)
+         bCopyNormalDataForLmpp = true;
       }
       else
-      {  // We don't need any lmpp data at all.
+      {  // We don't need any lmpp data at all. (Ignore case is done by the comparison.)
          m_lmppData.reset();
       }
    }
 
    m_normalData.preprocess( m_pOptions->m_bPreserveCarriageReturn, pEncoding1 );
-   m_lmppData.preprocess( false, pEncoding2 );
+   if ( bCopyNormalDataForLmpp )
+   {
+      m_lmppData.copyTextFrom( m_normalData );
+   }
+
+   // Without lmpp data the diff uses the lines of m_normalData (see getLineDataForDiff()),
+   // so no second line vector is built.
+   bool bLmpp = m_lmppData.m_pBuf!=0;
+   if ( bLmpp )
+      m_lmppData.preprocess( false, pEncoding2 );
 
-   if ( m_lmppData.m_vSize < m_normalData.m_vSize )
+   if ( bLmpp && m_lmppData.m_vSize < m_normalData.m_vSize )
    {
       // This probably is the fault of the LMPP-Command, but not worth reporting.
       m_lmppData.m_v.resize( m_normalData.m_vSize );
       for(int i=m_lmppData.m_vSize; i<m_normalData.m_vSize; ++i )
       {  // Set all empty lines to point to the end of the buffer.
-         m_lmppData.m_v[i].pLine = m_lmppData.m_unicodeBuf.unicode()+m_lmppData.m_unicodeBuf.length();
+         m_lmppData.m_v[i].setLine( m_lmppData.m_unicodeBuf.unicode()+m_lmppData.m_unicodeBuf.length(), 0, 0 );
       }
 
       m_lmppData.m_vSize = m_normalData.m_vSize;
    }
 
-   // Internal Preprocessing: Uppercase-conversion   
-   if ( m_pOptions->m_bIgnoreCase )
-   {
-      int i;
-      QChar* pBuf = const_cast<QChar*>(m_lmppData.m_unicodeBuf.unicode());
-      int ucSize = m_lmppData.m_unicodeBuf.length();
-      for(i=0; i<ucSize; ++i)
-      {
-         pBuf[i] = pBuf[i].toUpper();
-      }
-   }
-
    // Ignore comments
-   if ( m_pOptions->m_bIgnoreComments )
+   if ( bLmpp && m_pOptions->m_bIgnoreComments )
    {
-      m_lmppData.removeComments();
+      m_lmppData.removeComments( m_pOptions->m_commentStyle );
       int vSize = min2(m_normalData.m_vSize, m_lmppData.m_vSize);
       for(int i=0; i<vSize; ++i )
       {
-         m_normalData.m_v[i].bContainsPureComment = m_lmppData.m_v[i].bContainsPureComment;
+         m_normalData.m_v[i].setPureComment( m_lmppData.m_v[i].isPureComment() );
       }
    }
 
-   // Remove unneeded temporary files. (A temp file from clipboard must not be deleted.)
-   if ( !bTempFileFromClipboard && !m_tempInputFileName.isEmpty() )
+   // Remove unneeded temporary files. (Data from clipboard is kept in m_inputData.)
+   if ( !m_tempInputFileName.isEmpty() )
    {
       FileAccess::removeTempFile( m_tempInputFileName );
       m_tempInputFileName = "";
@@ -837,42 +883,67 @@ void SourceData::FileData::preprocess( bool bPreserveCR, QTextCodec* pEncoding )
    qint64 i;
    // detect line end style
    m_eLineEndStyle = eLineEndStyleUndefined;
-   for( i=0; i<m_size; ++i )
+   m_bIsText = true;
+   if ( m_bBufFromText )
    {
-      if ( m_pBuf[i]=='\n' )
+      // The text was given via setText() and is already decoded.
+      int nlPos = m_unicodeBuf.indexOf( '\n' );
+      if ( nlPos >= 0 )
+         m_eLineEndStyle = nlPos>0 && m_unicodeBuf[nlPos-1]=='\r' ? eLineEndStyleDos : eLineEndStyleUnix;
+      else if ( m_unicodeBuf.contains( '\r' ) )
       {
-         if ( (i>0 && m_pBuf[i-1]=='\r') ||  // normal file
-              (i>3 && m_pBuf[i-1]=='\0' && m_pBuf[i-2]=='\r' && m_pBuf[i-3]=='\0')) // 16-bit unicode: TODO only little endian covered here
-            m_eLineEndStyle = eLineEndStyleDos;
-         else
-            m_eLineEndStyle = eLineEndStyleUnix;
-         break;   // Only analyze first line
+         m_unicodeBuf.replace( '\r', '\n' ); // We only fix the old mac line end style, but leave it as "undefined"
+         m_pBuf = (const char*)m_unicodeBuf.unicode();
       }
    }
-   qint64 skipBytes = 0;
-   QTextCodec* pCodec = ::detectEncoding( m_pBuf, m_size, skipBytes );
-   if ( pCodec != pEncoding )
-      skipBytes=0;
-
-   QByteArray ba = QByteArray::fromRawData( m_pBuf+skipBytes, m_size-skipBytes );
-   if ( m_eLineEndStyle == eLineEndStyleUndefined ) // normally only for one liners except when old mac line end style is used
+   else
    {
-      for( int j=0; j<ba.size(); ++j ) // int because QByteArray does not support operator[](qint64)
+      for( i=0; i<m_size; ++i )
       {
-         if ( ba[j]=='\r' )
-            ba[j]='\n'; // We only fix the old mac line end style, but leave it as "undefined"
+         if ( m_pBuf[i]=='\n' )
+         {
+            if ( (i>0 && m_pBuf[i-1]=='\r') ||  // normal file
+                 (i>3 && m_pBuf[i-1]=='\0' && m_pBuf[i-2]=='\r' && m_pBuf[i-3]=='\0')) // 16-bit unicode: TODO only little endian covered here
+               m_eLineEndStyle = eLineEndStyleDos;
+            else
+               m_eLineEndStyle = eLineEndStyleUnix;
+            break;   // Only analyze first line
+         }
+      }
+      qint64 skipBytes = 0;
+      QTextCodec* pCodec = ::detectEncoding( m_pBuf, m_size, skipBytes );
+      if ( pCodec != pEncoding )
+         skipBytes=0;
+
+      // Binary data is detected from the raw bytes and not decoded at all.
+      // It results in one empty line, the bytes are compared via calcBinaryDiff().
+      if ( isBinaryData( m_pBuf, m_size, skipBytes>0 ? pCodec : pEncoding ) )
+      {
+         m_bIsText = false;
+         m_unicodeBuf = QString();
+      }
+      else
+      {
+         QByteArray ba = QByteArray::fromRawData( m_pBuf+skipBytes, m_size-skipBytes );
+         if ( m_eLineEndStyle == eLineEndStyleUndefined ) // normally only for one liners except when old mac line end style is used
+         {
+            for( int j=0; j<ba.size(); ++j ) // int because QByteArray does not support operator[](qint64)
+            {
+               if ( ba[j]=='\r' )
+                  ba[j]='\n'; // We only fix the old mac line end style, but leave it as "undefined"
+            }
+         }
+         QTextStream ts( ba, QIODevice::ReadOnly );
+         ts.setCodec( pEncoding);
+         ts.setAutoDetectUnicode( false );
+         m_unicodeBuf = ts.readAll();
+         ba.clear();
       }
    }
-   QTextStream ts( ba, QIODevice::ReadOnly );
-   ts.setCodec( pEncoding);
-   ts.setAutoDetectUnicode( false );
-   m_unicodeBuf = ts.readAll();
-   ba.clear();
 
    int ucSize = m_unicodeBuf.length();
    const QChar* p = m_unicodeBuf.unicode();
 
-   m_bIsText = true;
    int lines = 1;
    m_bIncompleteConversion = false;
    for( i=0; i<ucSize; ++i )
@@ -900,13 +971,12 @@ void SourceData::FileData::preprocess( bool bPreserveCR, QTextCodec* pEncoding )
    {
       if ( isLineOrBufEnd( p, i, ucSize ) )
       {
-         m_v[lineIdx].pLine = &p[ i-lineLength ];
-         while ( !bPreserveCR  &&  lineLength>0  &&  m_v[lineIdx].pLine[lineLength-1]=='\r'  )
+         const QChar* pLine = &p[ i-lineLength ];
+         while ( !bPreserveCR  &&  lineLength>0  &&  pLine[lineLength-1]=='\r'  )
          {
             --lineLength;
          }
-         m_v[lineIdx].pFirstNonWhiteChar = m_v[lineIdx].pLine + min2(whiteLength,lineLength);
-         m_v[lineIdx].size = lineLength;
+         m_v[lineIdx].setLine( pLine, lineLength, whiteLength );
          lineLength = 0;
          bNonWhiteFound = false;
          whiteLength = 0;
@@ -928,146 +998,139 @@ void SourceData::FileData::preprocess( bool bPreserveCR, QTextCodec* pEncoding )
 }
 
 
-// Must not be entered, when within a comment.
-// Returns either at a newline-character p[i]=='\n' or when i==size.
-// A line that contains only comments is still "white".
-// Comments in white lines must remain, while comments in
-// non-white lines are overwritten with spaces.
-static void checkLineForComments(
-   QChar* p,   // pointer to start of buffer
-   int& i,    // index of current position (in, out)
-   int size,  // size of buffer
-   bool& bWhite,          // false if this line contains nonwhite characters (in, out)
-   bool& bCommentInLine,  // true if any comment is within this line (in, out)
-   bool& bStartsOpenComment  // true if the line ends within an comment (out)
-   )
+// Comment syntax of the languages supported by FileData::removeComments().
+// Indexed by e_CommentStyle. Strings are only recognized within one line.
+struct CommentSyntax
 {
-   bStartsOpenComment = false;
-   for(; i<size; ++i )
-   {
-      // A single apostroph ' has prio over a double apostroph " (e.g. '"')
-      // (if not in a string)
-      if ( p[i]=='\'' )
-      {
-         bWhite = false;
-         ++i;
-         for( ; !isLineOrBufEnd(p,i,size) && p[i]!='\''; ++i)
-            ;
-         if (p[i]=='\'') ++i;
-      }
-
-      // Strings have priority over comments: e.g. "/* Not a comment, but a string. */"
-      else if ( p[i]=='"' )
-      {
-         bWhite = false;
-         ++i;
-         for( ; !isLineOrBufEnd(p,i,size) && !(p[i]=='"' && p[i-1]!='\\'); ++i)
-            ;
-         if (p[i]=='"') ++i;
-      }
-
-      // C++-comment
-      else if ( p[i]=='/' && i+1<size && p[i+1] =='/' )
-      {
-         int commentStart = i;
-         bCommentInLine = true;
-         i+=2;
-         for( ; !isLineOrBufEnd(p,i,size); ++i)
-            ;
-         if ( !bWhite )
-         {
-            memset( &p[commentStart], ' ', i-commentStart );
-         }
-         return;
-      }
-
-      // C-comment
-      else if ( p[i]=='/' && i+1<size && p[i+1] =='*' )
-      {
-         int commentStart = i;
-         bCommentInLine = true;
-         i+=2;
-         for( ; !isLineOrBufEnd(p,i,size); ++i)
-         {
-            if ( i+1<size && p[i]=='*' && p[i+1]=='/')  // end of the comment
-            {
-               i+=2;
+   const char* lineComment;   // 0 if the language has no line comments
+   const char* blockStart;    // 0 if the language has no block comments
+   const char* blockEnd;
+   bool bQuotes;              // ' and " start strings that can't contain comments
+};
 
-               // More comments in the line?
-               checkLineForComments( p, i, size, bWhite, bCommentInLine, bStartsOpenComment );
-               if ( !bWhite )
-               {
-                  memset( &p[commentStart], ' ', i-commentStart );
-               }
-               return;
-            }
-         }
-         bStartsOpenComment = true;
-         return;
-      }
-
-
-      if ( isLineOrBufEnd(p,i,size) )
-      {
-         return;
-      }
-      else if ( !p[i].isSpace() )
-      {
-         bWhite = false;
-      }
+static const CommentSyntax s_commentSyntax[] =
+{
+   { "//", "/*",   "*/",  true  },  // eCommentStyleC
+   { "#",  0,      0,     true  },  // eCommentStyleHash
+   { "--", "/*",   "*/",  true  },  // eCommentStyleSql
+   { 0,    "<!--", "-->", false }   // eCommentStyleXml
+};
+
+// Returns true if the (ascii) string s starts at p[i].
+static bool matchesAt( const QChar* p, int i, int size, const char* s )
+{
+   for( ; *s!=0; ++s, ++i )
+   {
+      if ( i>=size || p[i]!=QLatin1Char(*s) )
+         return false;
    }
+   return true;
+}
+
+static void blankOut( QChar* p, int start, int end )
+{
+   for( int i=start; i<end; ++i )
+      p[i] = ' ';
 }
 
-// Modifies the input data, and replaces C/C++ comments with whitespace
+// Modifies the input data, and replaces comments with whitespace
 // when the line contains other data too. If the line contains only
 // a comment or white data, remember this in the flag bContainsPureComment.
-void SourceData::FileData::removeComments()
+// (Comments in white lines must remain.)
+// Single pass over the data: The state is only kept between the characters.
+void SourceData::FileData::removeComments( int commentStyle )
 {
-   int line=0;
+   const int nofStyles = sizeof(s_commentSyntax)/sizeof(s_commentSyntax[0]);
+   const CommentSyntax& cs = s_commentSyntax[ commentStyle>=0 && commentStyle<nofStyles ? commentStyle : eCommentStyleC ];
+   const QChar lineCommentChar = cs.lineComment ? QChar(QLatin1Char(cs.lineComment[0])) : QChar();
+   const QChar blockStartChar  = cs.blockStart  ? QChar(QLatin1Char(cs.blockStart[0]))  : QChar();
+   const int blockStartLength = cs.blockStart ? qstrlen(cs.blockStart) : 0;
+   const int blockEndLength   = cs.blockEnd   ? qstrlen(cs.blockEnd)   : 0;
+
+   enum { eCode, eString, eLineComment, eBlockComment } state = eCode;
+   QChar quoteChar;
    QChar* p = const_cast<QChar*>(m_unicodeBuf.unicode());
-   bool bWithinComment=false;
    int size = m_unicodeBuf.length();
-   for(int i=0; i<size; ++i )
-   {
-//      std::cout << "2        " << std::string(&p[i], m_v[line].size) << std::endl;
-      bool bWhite = true;
-      bool bCommentInLine = false;
+   int line = 0;
+   bool bWhite = true;           // false if this line contains nonwhite characters outside of comments
+   bool bCommentInLine = false;  // true if any comment is within this line
+   int commentStart = 0;         // start of the current comment
+   int whiteCommentStart = -1;   // start of the comments before the first nonwhite character
 
-      if ( bWithinComment )
+   for( int i=0; line<m_vSize; ++i )
+   {
+      if ( isLineOrBufEnd( p, i, size ) )
       {
-         int commentStart = i;
-         bCommentInLine = true;
+         if ( state==eLineComment || state==eBlockComment )
+         {
+            if ( !bWhite )
+               blankOut( p, commentStart, i );
+            if ( state==eLineComment )
+               state = eCode;
+         }
+         else if ( state==eString )
+            state = eCode;
 
-         for( ; !isLineOrBufEnd(p,i,size); ++i)
+         m_v[line].setPureComment( bCommentInLine && bWhite );
+         ++line;
+
+         bWhite = true;
+         bCommentInLine = state==eBlockComment;
+         commentStart = i+1;
+         whiteCommentStart = -1;
+         continue;
+      }
+
+      QChar c = p[i];
+      if ( state==eCode )
+      {
+         if ( cs.bQuotes && ( c=='\'' || c=='"' ) )
          {
-            if ( i+1<size && p[i]=='*' && p[i+1]=='/')  // end of the comment
-            {
-               i+=2;
+            // Strings have priority over comments: e.g. "/* Not a comment, but a string. */"
+            quoteChar = c;
+            state = eString;
+         }
+         else if ( cs.lineComment && c==lineCommentChar && matchesAt( p, i, size, cs.lineComment ) )
+         {
+            state = eLineComment;
+            commentStart = i;
+            bCommentInLine = true;
+            continue;
+         }
+         else if ( cs.blockStart && c==blockStartChar && matchesAt( p, i, size, cs.blockStart ) )
+         {
+            state = eBlockComment;
+            commentStart = i;
+            bCommentInLine = true;
+            i += blockStartLength-1;
+            continue;
+         }
+         else if ( c.isSpace() )
+            continue;
 
-               // More comments in the line?
-               checkLineForComments( p, i, size, bWhite, bCommentInLine, bWithinComment );
-               if ( !bWhite )
-               {
-                  memset( &p[commentStart], ' ', i-commentStart );
-               }
-               break;
-            }
+         if ( bWhite )
+         {
+            // Comments before the first nonwhite character are no pure comments anymore.
+            bWhite = false;
+            if ( whiteCommentStart>=0 )
+               blankOut( p, whiteCommentStart, i );
          }
       }
-      else
+      else if ( state==eString )
       {
-         checkLineForComments( p, i, size, bWhite, bCommentInLine, bWithinComment );
+         // A single apostroph ' has no escape sequence (e.g. '\')
+         if ( c==quoteChar && !( c=='"' && p[i-1]=='\\' ) )
+            state = eCode;
+      }
+      else if ( state==eBlockComment && matchesAt( p, i, size, cs.blockEnd ) )
+      {
+         i += blockEndLength-1;
+         state = eCode;
+         if ( !bWhite )
+            blankOut( p, commentStart, i+1 );
+         else if ( whiteCommentStart<0 )
+            whiteCommentStart = commentStart;
       }
-
-      // end of line
-      assert( isLineOrBufEnd(p,i,size));
-      m_v[line].bContainsPureComment = bCommentInLine && bWhite;
-/*      std::cout << line << " : " <<
-       ( bCommentInLine ?  "c" : " " ) <<
-       ( bWhite ? "w " : "  ") <<
-       std::string(pLD[line].pLine, pLD[line].size) << std::endl;*/
-
-      ++line;
    }
 }
 
@@ -1444,14 +1507,15 @@ static bool runDiff( const LineData* p1, int size1, const LineData* p2, int size
 {
    ProgressProxy pp;
    static GnuDiff gnuDiff;  // All values are initialized with zeros.
+   static QRegExp ignoreRegExp; // Only recompiled if the option changes.
 
    pp.setCurrent(0);
 
    diffList.clear();
-   if ( p1[0].pLine==0 || p2[0].pLine==0 || size1==0 || size2==0 )
+   if ( p1[0].getLine()==0 || p2[0].getLine()==0 || size1==0 || size2==0 )
    {
       Diff d( 0,0,0);
-      if ( p1[0].pLine==0 && p2[0].pLine==0 && size1 == size2 )
+      if ( p1[0].getLine()==0 && p2[0].getLine()==0 && size1 == size2 )
          d.nofEquals = size1;
       else
       {
@@ -1466,16 +1530,19 @@ static bool runDiff( const LineData* p1, int size1, const LineData* p2, int size
       GnuDiff::comparison comparisonInput;
       memset( &comparisonInput, 0, sizeof(comparisonInput) );
       comparisonInput.parent = 0;
-      comparisonInput.file[0].buffer = p1[0].pLine;//ptr to buffer
-      comparisonInput.file[0].buffered = (p1[size1-1].pLine-p1[0].pLine+p1[size1-1].size); // size of buffer
-      comparisonInput.file[1].buffer = p2[0].pLine;//ptr to buffer
-      comparisonInput.file[1].buffered = (p2[size2-1].pLine-p2[0].pLine+p2[size2-1].size); // size of buffer
+      comparisonInput.file[0].buffer = p1[0].getLine();//ptr to buffer
+      comparisonInput.file[0].buffered = (p1[size1-1].getLine()-p1[0].getLine()+p1[size1-1].size()); // size of buffer
+      comparisonInput.file[1].buffer = p2[0].getLine();//ptr to buffer
+      comparisonInput.file[1].buffered = (p2[size2-1].getLine()-p2[0].getLine()+p2[size2-1].size()); // size of buffer
 
       gnuDiff.ignore_white_space = GnuDiff::IGNORE_ALL_SPACE;  // I think nobody needs anything else ...
       gnuDiff.bIgnoreWhiteSpace = true;
       gnuDiff.bIgnoreNumbers    = pOptions->m_bIgnoreNumbers;
       gnuDiff.minimal = pOptions->m_bTryHard;
-      gnuDiff.ignore_case = false;
+      gnuDiff.ignore_case = pOptions->m_bIgnoreCase;
+      if ( ignoreRegExp.pattern() != pOptions->m_ignoreRegExp )
+         ignoreRegExp.setPattern( pOptions->m_ignoreRegExp );
+      gnuDiff.pIgnoreRegExp = !ignoreRegExp.isEmpty() && ignoreRegExp.isValid() ? &ignoreRegExp : 0;
       GnuDiff::change* script = gnuDiff.diff_2_files( &comparisonInput );
 
       int equalLinesAtStart =  comparisonInput.file[0].prefix_lines;
@@ -1782,7 +1849,8 @@ void correctManualDiffAlignment( Diff3LineList& d3ll, ManualDiffHelpList* pManua
 
 // Fourth step
 void calcDiff3LineListTrim(
-   Diff3LineList& d3ll, const LineData* pldA, const LineData* pldB, const LineData* pldC, ManualDiffHelpList* pManualDiffHelpList
+   Diff3LineList& d3ll, const LineData* pldA, const LineData* pldB, const LineData* pldC, ManualDiffHelpList* pManualDiffHelpList,
+   Options* pOptions
    )
 {
    const Diff3Line d3l_empty;
@@ -1822,7 +1890,7 @@ void calcDiff3LineListTrim(
       }
 
       if( line>lineA && (*i3).lineA != -1 && (*i3A).lineB!=-1 && (*i3A).bBEqC  &&
-          ::equal( pldA[(*i3).lineA], pldB[(*i3A).lineB], false ) &&
+          ::equal( pldA[(*i3).lineA], pldB[(*i3A).lineB], false, pOptions->m_bIgnoreCase ) &&
           isValidMove( pManualDiffHelpList, (*i3).lineA, (*i3A).lineB, 1, 2 ) &&
           isValidMove( pManualDiffHelpList, (*i3).lineA, (*i3A).lineC, 1, 3 ) )
       {
@@ -1838,7 +1906,7 @@ void calcDiff3LineListTrim(
       }
 
       if( line>lineB && (*i3).lineB != -1 && (*i3B).lineA!=-1 && (*i3B).bAEqC  &&
-          ::equal( pldB[(*i3).lineB], pldA[(*i3B).lineA], false ) &&
+          ::equal( pldB[(*i3).lineB], pldA[(*i3B).lineA], false, pOptions->m_bIgnoreCase ) &&
           isValidMove( pManualDiffHelpList, (*i3).lineB, (*i3B).lineA, 2, 1 ) &&
           isValidMove( pManualDiffHelpList, (*i3).lineB, (*i3B).lineC, 2, 3 ) )
       {
@@ -1854,7 +1922,7 @@ void calcDiff3LineListTrim(
       }
 
       if( line>lineC && (*i3).lineC != -1 && (*i3C).lineA!=-1 && (*i3C).bAEqB  &&
-          ::equal( pldC[(*i3).lineC], pldA[(*i3C).lineA], false )&&
+          ::equal( pldC[(*i3).lineC], pldA[(*i3C).lineA], false, pOptions->m_bIgnoreCase )&&
           isValidMove( pManualDiffHelpList, (*i3).lineC, (*i3C).lineA, 3, 1 ) &&
           isValidMove( pManualDiffHelpList, (*i3).lineC, (*i3C).lineB, 3, 2 ) )
       {
@@ -2010,6 +2078,7 @@ void calcDiff3LineListTrim(
 */
 }
 
+
 void DiffBufferInfo::init( Diff3LineList* pD3ll, const Diff3LineVector* pD3lv,
    const LineData* pldA, int sizeA, const LineData* pldB, int sizeB, const LineData* pldC, int sizeC )
 {
@@ -2021,11 +2090,6 @@ void DiffBufferInfo::init( Diff3LineList* pD3ll, const Diff3LineVector* pD3lv,
    m_sizeA = sizeA;
    m_sizeB = sizeB;
    m_sizeC = sizeC;
-   Diff3LineList::iterator i3 = pD3ll->begin();
-   for( ; i3!=pD3ll->end(); ++i3 )
-   {
-      i3->m_pDiffBufferInfo = this;
-   }
 }
 
 void calcWhiteDiff3Lines(
@@ -2036,9 +2100,9 @@ void calcWhiteDiff3Lines(
 
    for( ; i3!=d3ll.end(); ++i3 )
    {
-      i3->bWhiteLineA = ( (*i3).lineA == -1  ||  pldA==0 ||  pldA[(*i3).lineA].whiteLine() || pldA[(*i3).lineA].bContainsPureComment );
-      i3->bWhiteLineB = ( (*i3).lineB == -1  ||  pldB==0 ||  pldB[(*i3).lineB].whiteLine() || pldB[(*i3).lineB].bContainsPureComment );
-      i3->bWhiteLineC = ( (*i3).lineC == -1  ||  pldC==0 ||  pldC[(*i3).lineC].whiteLine() || pldC[(*i3).lineC].bContainsPureComment );
+      i3->bWhiteLineA = ( (*i3).lineA == -1  ||  pldA==0 ||  pldA[(*i3).lineA].whiteLine() || pldA[(*i3).lineA].isPureComment() );
+      i3->bWhiteLineB = ( (*i3).lineB == -1  ||  pldB==0 ||  pldB[(*i3).lineB].whiteLine() || pldB[(*i3).lineB].isPureComment() );
+      i3->bWhiteLineC = ( (*i3).lineC == -1  ||  pldC==0 ||  pldC[(*i3).lineC].whiteLine() || pldC[(*i3).lineC].isPureComment() );
    }
 }
 
@@ -2242,11 +2306,12 @@ bool fineDiff(
       if( (k1==-1 && k2!=-1)  ||  (k1!=-1 && k2==-1) ) bTextsTotalEqual=false;
       if( k1!=-1 && k2!=-1 )
       {
-         if ( v1[k1].size != v2[k2].size || memcmp( v1[k1].pLine, v2[k2].pLine, v1[k1].size<<1)!=0 )
+         if ( v1[k1].size() != v2[k2].size() || memcmp( v1[k1].getLine(), v2[k2].getLine(), v1[k1].size()<<1)!=0 )
          {
             bTextsTotalEqual = false;
+            i->setTextDiff( selector );
             DiffList* pDiffList = new DiffList;
-            calcDiff( v1[k1].pLine, v1[k1].size, v2[k2].pLine, v2[k2].size, *pDiffList, 2, maxSearchLength );
+            calcDiff( v1[k1].getLine(), v1[k1].size(), v2[k2].getLine(), v2[k2].size(), *pDiffList, 2, maxSearchLength );
 
             // Optimize the diff list.
             DiffList::iterator dli;
@@ -2272,13 +2337,10 @@ bool fineDiff(
                }
             }
 
-            if      (selector==1){ delete (*i).pFineAB; (*i).pFineAB = pDiffList; }
-            else if (selector==2){ delete (*i).pFineBC; (*i).pFineBC = pDiffList; }
-            else if (selector==3){ delete (*i).pFineCA; (*i).pFineCA = pDiffList; }
-            else assert(false);
+            i->setFineDiff( selector, pDiffList );
          }
 
-         if ( (v1[k1].bContainsPureComment || v1[k1].whiteLine()) && (v2[k2].bContainsPureComment || v2[k2].whiteLine()))
+         if ( (v1[k1].isPureComment() || v1[k1].whiteLine()) && (v2[k2].isPureComment() || v2[k2].whiteLine()))
          {
             if      (selector==1){ i->bAEqB = true; }
             else if (selector==2){ i->bBEqC = true; }
@@ -2293,6 +2355,45 @@ bool fineDiff(
 }
 
 
+bool fineDiffFlagsOnly(
+   Diff3LineList& diff3LineList,
+   int selector,
+   const LineData* v1,
+   const LineData* v2
+   )
+{
+   Diff3LineList::iterator i;
+   int k1=0;
+   int k2=0;
+   bool bTextsTotalEqual = true;
+   for( i= diff3LineList.begin(); i!= diff3LineList.end(); ++i)
+   {
+      if      (selector==1){ k1=i->lineA; k2=i->lineB; }
+      else if (selector==2){ k1=i->lineB; k2=i->lineC; }
+      else if (selector==3){ k1=i->lineC; k2=i->lineA; }
+      else assert(false);
+      if( (k1==-1 && k2!=-1)  ||  (k1!=-1 && k2==-1) ) bTextsTotalEqual=false;
+      if( k1!=-1 && k2!=-1 )
+      {
+         // The merge (mergeOneLine()) needs to know which lines differ exactly.
+         if ( v1[k1].size() != v2[k2].size() || memcmp( v1[k1].getLine(), v2[k2].getLine(), v1[k1].size()<<1)!=0 )
+         {
+            bTextsTotalEqual = false;
+            i->setTextDiff( selector );
+         }
+
+         if ( (v1[k1].isPureComment() || v1[k1].whiteLine()) && (v2[k2].isPureComment() || v2[k2].whiteLine()))
+         {
+            if      (selector==1){ i->bAEqB = true; }
+            else if (selector==2){ i->bBEqC = true; }
+            else if (selector==3){ i->bAEqC = true; }
+         }
+      }
+   }
+   return bTextsTotalEqual;
+}
+
+
 // Convert the list to a vector of pointers
 void calcDiff3LineVector( Diff3LineList& d3ll, Diff3LineVector& d3lv )
 {
@@ -2306,4 +2407,34 @@ void calcDiff3LineVector( Diff3LineList& d3ll, Diff3LineVector& d3lv )
    assert( j==(int)d3lv.size() );
 }
 
+// std::list and QLinkedList nodes hold two pointers besides the value.
+qint64 getDiffListMemory( const DiffList& diffList )
+{
+   return qint64( diffList.size() ) * ( sizeof(Diff) + 2*sizeof(void*) );
+}
+
+void Diff3LineList::reportMemory( MemoryReport& report, const QString& name ) const
+{
+   qint64 fineDiffs = 0;
+   for( const_iterator i=begin(); i!=end(); ++i )
+   {
+      const DiffList* pFine[3] = { i->getFineAB(), i->getFineBC(), i->getFineCA() };
+      if ( pFine[0]==0 && pFine[1]==0 && pFine[2]==0 )
+         continue;
+      fineDiffs += 3*sizeof(void*);  // Diff3Line::FineDiffs
+      for( int j=0; j<3; ++j )
+      {
+         if ( pFine[j]!=0 )
+            fineDiffs += sizeof(DiffList) + getDiffListMemory( *pFine[j] );
+      }
+   }
+   report.add( name, qint64( size() ) * ( sizeof(Diff3Line) + 2*sizeof(void*) ) );
+   report.add( name + " fine diffs", fineDiffs );
+}
+
+void Diff3LineVector::reportMemory( MemoryReport& report, const QString& name ) const
+{
+   report.add( name, qint64( capacity() ) * sizeof(Diff3Line*) );
+}
+
 
@@ -41,17 +41,28 @@ struct Diff
 
 typedef std::list<Diff> DiffList;
 
-struct LineData
+// Packed into 16 bytes on 64-bit systems (instead of 24): The first non white
+// character is stored as offset from the line start and the flag as one bit.
+class LineData
 {
-   const QChar* pLine;
-   const QChar* pFirstNonWhiteChar;
-   int size;
-
-   LineData(){ pLine=0; pFirstNonWhiteChar=0; size=0; /*occurances=0;*/ bContainsPureComment=false; }
+public:
+   LineData(){ m_pLine=0; m_size=0; m_whiteLength=0; m_bContainsPureComment=false; }
+   void setLine( const QChar* pLine, int size, int whiteLength )
+   {
+      m_pLine = pLine; m_size = size; m_whiteLength = min2(whiteLength,size);
+   }
+   const QChar* getLine() const { return m_pLine; }
+   int size() const { return m_size; }
+   const QChar* getFirstNonWhiteChar() const { return m_pLine + m_whiteLength; }
    int width(int tabSize) const;  // Calcs width considering tabs.
-   //int occurances;
-   bool whiteLine() const { return pFirstNonWhiteChar-pLine == size; }
-   bool bContainsPureComment;
+   bool whiteLine() const { return (int)m_whiteLength == m_size; }
+   bool isPureComment() const { return m_bContainsPureComment; }
+   void setPureComment( bool bPureComment ) { m_bContainsPureComment = bPureComment; }
+private:
+   const QChar* m_pLine;
+   int m_size;
+   unsigned int m_whiteLength : 31;
+   unsigned int m_bContainsPureComment : 1;
 };
 
 class Diff3LineList;
@@ -71,12 +82,18 @@ struct DiffBufferInfo
       const LineData* pldA, int sizeA, const LineData* pldB, int sizeB, const LineData* pldC, int sizeC );
 };
 
+// Only the fine diffs of lines with differences are allocated (see FineDiffs).
+// The line data is reached via the DiffBufferInfo of the comparison, which the
+// caller passes in. This keeps the common case of equal lines small.
 struct Diff3Line
 {
    int lineA;
    int lineB;
    int lineC;
 
+   int linesNeededForDisplay; // Due to wordwrap
+   int sumLinesNeededForDisplay; // For fast conversion to m_diff3WrapLineVector
+
    bool bAEqC : 1;             // These are true if equal or only white-space changes exist.
    bool bBEqC : 1;
    bool bAEqB : 1;
@@ -85,32 +102,68 @@ struct Diff3Line
    bool bWhiteLineB : 1;
    bool bWhiteLineC : 1;
 
-   DiffList* pFineAB;          // These are 0 only if completely equal or if either source doesn't exist.
-   DiffList* pFineBC;
-   DiffList* pFineCA;
+   bool bTextDiffAB : 1;       // These are true if the texts differ in any character. Set by fineDiff()
+   bool bTextDiffBC : 1;       // and fineDiffFlagsOnly(), so they are also known if no fine diffs exist.
+   bool bTextDiffCA : 1;
 
-   int linesNeededForDisplay; // Due to wordwrap
-   int sumLinesNeededForDisplay; // For fast conversion to m_diff3WrapLineVector
+   // Merge classification of this line, stored by calcMergeDetails() (see mergeengine.h).
+   // Fits into the padding before m_pFineDiffs.
+   unsigned char mergeDetails : 4;     // e_MergeDetails
+   unsigned char mergeSrc : 2;         // 0 (none), A, B or C
+   unsigned char bMergeConflict : 1;
+   unsigned char bMergeLineRemoved : 1;
 
-   DiffBufferInfo* m_pDiffBufferInfo; // For convenience
+private:
+   struct FineDiffs
+   {
+      DiffList* pFineAB;
+      DiffList* pFineBC;
+      DiffList* pFineCA;
+      FineDiffs(){ pFineAB=0; pFineBC=0; pFineCA=0; }
+      ~FineDiffs(){ delete pFineAB; delete pFineBC; delete pFineCA; }
+   };
+   FineDiffs* m_pFineDiffs;    // 0 if no fine diff exists for this line
 
+public:
    Diff3Line()
    {
       lineA=-1; lineB=-1; lineC=-1;
       bAEqC=false; bAEqB=false; bBEqC=false;
-      pFineAB=0; pFineBC=0; pFineCA=0;
+      m_pFineDiffs=0;
       linesNeededForDisplay=1;
       sumLinesNeededForDisplay=0;
       bWhiteLineA=false; bWhiteLineB=false; bWhiteLineC=false;
-      m_pDiffBufferInfo=0;
+      bTextDiffAB=false; bTextDiffBC=false; bTextDiffCA=false;
+      mergeDetails=0; mergeSrc=0; bMergeConflict=0; bMergeLineRemoved=0;
    }
 
    ~Diff3Line()
    {
-      if (pFineAB!=0) delete pFineAB;
-      if (pFineBC!=0) delete pFineBC;
-      if (pFineCA!=0) delete pFineCA;
-      pFineAB=0; pFineBC=0; pFineCA=0;
+      delete m_pFineDiffs;
+      m_pFineDiffs=0;
+   }
+
+   // These are 0 only if completely equal or if either source doesn't exist.
+   DiffList* getFineAB() const { return m_pFineDiffs ? m_pFineDiffs->pFineAB : 0; }
+   DiffList* getFineBC() const { return m_pFineDiffs ? m_pFineDiffs->pFineBC : 0; }
+   DiffList* getFineCA() const { return m_pFineDiffs ? m_pFineDiffs->pFineCA : 0; }
+
+   void setTextDiff( int selector ) // selector: 1=AB, 2=BC, 3=CA (as in fineDiff())
+   {
+      if      ( selector==1 ) bTextDiffAB = true;
+      else if ( selector==2 ) bTextDiffBC = true;
+      else if ( selector==3 ) bTextDiffCA = true;
+   }
+
+   // Takes ownership of pDiffList. selector: 1=AB, 2=BC, 3=CA (as in fineDiff())
+   void setFineDiff( int selector, DiffList* pDiffList )
+   {
+      assert( selector>=1 && selector<=3 );
+      if ( m_pFineDiffs==0 )
+         m_pFineDiffs = new FineDiffs;
+      DiffList*& pFine = selector==1 ? m_pFineDiffs->pFineAB : selector==2 ? m_pFineDiffs->pFineBC : m_pFineDiffs->pFineCA;
+      delete pFine;
+      pFine = pDiffList;
    }
 
    bool operator==( const Diff3Line& d3l ) const
@@ -119,19 +172,19 @@ struct Diff3Line
          && bAEqB == d3l.bAEqB  && bAEqC == d3l.bAEqC  && bBEqC == d3l.bBEqC;
    }
 
-   const LineData* getLineData( int src ) const
+   const LineData* getLineData( int src, const DiffBufferInfo* pDiffBufferInfo ) const
    {
-      assert( m_pDiffBufferInfo!=0 );
-      if ( src == 1 && lineA >= 0 ) return &m_pDiffBufferInfo->m_pLineDataA[lineA];
-      if ( src == 2 && lineB >= 0 ) return &m_pDiffBufferInfo->m_pLineDataB[lineB];
-      if ( src == 3 && lineC >= 0 ) return &m_pDiffBufferInfo->m_pLineDataC[lineC];
+      assert( pDiffBufferInfo!=0 );
+      if ( src == 1 && lineA >= 0 ) return &pDiffBufferInfo->m_pLineDataA[lineA];
+      if ( src == 2 && lineB >= 0 ) return &pDiffBufferInfo->m_pLineDataB[lineB];
+      if ( src == 3 && lineC >= 0 ) return &pDiffBufferInfo->m_pLineDataC[lineC];
       return 0;
    }
-   QString getString( int src ) const
+   QString getString( int src, const DiffBufferInfo* pDiffBufferInfo ) const
    {
-      const LineData* pld = getLineData(src);
+      const LineData* pld = getLineData( src, pDiffBufferInfo );
       if ( pld )
-         return QString( pld->pLine, pld->size);
+         return QString( pld->getLine(), pld->size() );
       else
          return QString();
    }
@@ -145,11 +198,17 @@ struct Diff3Line
 };
 
 
+qint64 getDiffListMemory( const DiffList& diffList );
+
 class Diff3LineList : public QLinkedList<Diff3Line>
 {
+public:
+   void reportMemory( MemoryReport& report, const QString& name ) const; // Including the fine diffs
 };
 class Diff3LineVector : public QVector<Diff3Line*>
 {
+public:
+   void reportMemory( MemoryReport& report, const QString& name ) const;
 };
 
 class Diff3WrapLine
@@ -273,6 +332,7 @@ public:
    bool saveNormalDataAs( const QString& fileName );
 
    bool isBinaryEqualWith( const SourceData& other ) const;
+   void reportMemory( MemoryReport& report, const QString& name ) const;
 
    void reset();
 
@@ -285,12 +345,14 @@ private:
    FileAccess m_fileAccess;
    Options* m_pOptions;
    QString m_tempInputFileName;
+   QString m_inputData;  // Text given via setData(). Only written to a file if a preprocessor needs it.
 
    struct FileData
    {
-      FileData(){ m_pBuf=0; m_size=0; m_vSize=0; m_bIsText=false; m_eLineEndStyle=eLineEndStyleUndefined; m_bIncompleteConversion=false;}
+      FileData(){ m_pBuf=0; m_bBufFromText=false; m_size=0; m_vSize=0; m_bIsText=false; m_eLineEndStyle=eLineEndStyleUndefined; m_bIncompleteConversion=false;}
       ~FileData(){ reset(); }
       const char* m_pBuf;
+      bool m_bBufFromText; // m_pBuf is not owned but points into m_unicodeBuf (see setText())
       int m_size;
       int m_vSize; // Nr of lines in m_pBuf1 and size of m_v1, m_dv12 and m_dv13
       QString m_unicodeBuf;
@@ -300,17 +362,20 @@ private:
       e_LineEndStyle m_eLineEndStyle;
       bool readFile( const QString& filename );
       bool writeFile( const QString& filename );
+      void setText( const QString& text );
       void preprocess(bool bPreserveCR, QTextCodec* pEncoding );
       void reset();
-      void removeComments();
-      void copyBufFrom( const FileData& src );
+      void removeComments( int commentStyle );
+      void copyTextFrom( const FileData& src );
+      void reportMemory( MemoryReport& report, const QString& prefix ) const;
    };
    FileData m_normalData;
    FileData m_lmppData;  
    QTextCodec* m_pEncoding; 
 };
 
-void calcDiff3LineListTrim( Diff3LineList& d3ll, const LineData* pldA, const LineData* pldB, const LineData* pldC, ManualDiffHelpList* pManualDiffHelpList );
+void calcDiff3LineListTrim( Diff3LineList& d3ll, const LineData* pldA, const LineData* pldB, const LineData* pldC, ManualDiffHelpList* pManualDiffHelpList,
+                            Options* pOptions );
 void calcWhiteDiff3Lines(   Diff3LineList& d3ll, const LineData* pldA, const LineData* pldB, const LineData* pldC );
 
 void calcDiff3LineVector( Diff3LineList& d3ll, Diff3LineVector& d3lv );
@@ -428,8 +493,19 @@ bool fineDiff(
    const LineData* v2
    );
 
+// Like fineDiff() but without the character level differences, which are only needed
+// for display: Returns if the texts are equal, marks the lines that differ (setTextDiff())
+// and sets the equality flags for lines that are white or pure comment on both sides.
+// Enough for an automatic merge.
+bool fineDiffFlagsOnly(
+   Diff3LineList& diff3LineList,
+   int selector,
+   const LineData* v1,
+   const LineData* v2
+   );
+
 
-bool equal( const LineData& l1, const LineData& l2, bool bStrict );
+bool equal( const LineData& l1, const LineData& l2, bool bStrict, bool bIgnoreCase );
 
 
 
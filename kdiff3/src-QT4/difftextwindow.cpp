@@ -346,6 +346,11 @@ int DiffTextWindow::getNofLines()
                         d->m_pDiff3LineVector->size();
 }
 
+void DiffTextWindow::reportMemory( MemoryReport& report, const QString& name )
+{
+   report.add( name + " Diff3WrapLineVector", qint64( d->m_diff3WrapLineVector.capacity() ) * sizeof(Diff3WrapLine) );
+}
+
 
 int DiffTextWindow::convertLineToDiff3LineIdx( int line )
 {
@@ -936,12 +941,12 @@ void DiffTextWindowData::writeLine(
    {
       // First calculate the "changed" information for each character.
       int i=0;
-      QString lineString( pld->pLine, pld->size );
-      QVector<UINT8> charChanged( pld->size );
+      QString lineString( pld->getLine(), pld->size() );
+      QVector<UINT8> charChanged( pld->size() );
       Merger merger( pLineDiff1, pLineDiff2 );
-      while( ! merger.isEndReached() &&  i<pld->size )
+      while( ! merger.isEndReached() &&  i<pld->size() )
       {
-         if ( i < pld->size )
+         if ( i < pld->size() )
          {
             charChanged[i] = merger.whatChanged();
             ++i;
@@ -1207,7 +1212,7 @@ QString DiffTextWindowData::getString( int d3lIdx )
    else
    {
       const LineData* ld = &m_pLineData[lineIdx];
-      return QString( ld->pLine, ld->size );
+      return QString( ld->getLine(), ld->size() );
    }
    return QString();
 }
@@ -1239,24 +1244,24 @@ void DiffTextWindowData::getLineInfo(
    bool bBEqC = d3l.bBEqC || ( d3l.bWhiteLineB && d3l.bWhiteLineC );
    if      ( m_winIdx == 1 ) {
       lineIdx=d3l.lineA;
-      pFineDiff1=d3l.pFineAB;
-      pFineDiff2=d3l.pFineCA;
+      pFineDiff1=d3l.getFineAB();
+      pFineDiff2=d3l.getFineCA();
       changed |= ((d3l.lineB==-1)!=(lineIdx==-1) ? 1 : 0) +
                  ((d3l.lineC==-1)!=(lineIdx==-1) && m_bTriple ? 2 : 0);
       changed2 |= ( bAEqB ? 0 : 1 ) + (bAEqC || !m_bTriple ? 0 : 2);
    }
    else if ( m_winIdx == 2 ) {
       lineIdx=d3l.lineB;
-      pFineDiff1=d3l.pFineBC;
-      pFineDiff2=d3l.pFineAB;
+      pFineDiff1=d3l.getFineBC();
+      pFineDiff2=d3l.getFineAB();
       changed |= ((d3l.lineC==-1)!=(lineIdx==-1) && m_bTriple ? 1 : 0) +
                  ((d3l.lineA==-1)!=(lineIdx==-1) ? 2 : 0);
       changed2 |= ( bBEqC || !m_bTriple ? 0 : 1 ) + (bAEqB ? 0 : 2);
    }
    else if ( m_winIdx == 3 ) {
       lineIdx=d3l.lineC;
-      pFineDiff1=d3l.pFineCA;
-      pFineDiff2=d3l.pFineBC;
+      pFineDiff1=d3l.getFineCA();
+      pFineDiff2=d3l.getFineBC();
       changed |= ((d3l.lineA==-1)!=(lineIdx==-1) ? 1 : 0) +
                  ((d3l.lineB==-1)!=(lineIdx==-1) ? 2 : 0);
       changed2 |= ( bAEqC ? 0 : 1 ) + (bBEqC ? 0 : 2);
@@ -1312,8 +1317,8 @@ QString DiffTextWindow::getSelection()
 
       if( lineIdx != -1 )
       {
-         const QChar* pLine = d->m_pLineData[lineIdx].pLine;
-         int size = d->m_pLineData[lineIdx].size;
+         const QChar* pLine = d->m_pLineData[lineIdx].getLine();
+         int size = d->m_pLineData[lineIdx].size();
          QString lineString = QString( pLine, size );
 
          if ( d->m_bWordWrap )
@@ -1347,30 +1352,20 @@ QString DiffTextWindow::getSelection()
    return selectionString;
 }
 
-bool DiffTextWindow::findString( const QString& s, int& d3vLine, int& posInLine, bool bDirDown, bool bCaseSensitive )
+void DiffTextWindow::findAll( const FindPattern& pattern, FindHitList& hits )
 {
-   int it = d3vLine;
-   int endIt = bDirDown ? (int)d->m_pDiff3LineVector->size() : -1;
-   int step =  bDirDown ? 1 : -1;
-   int startPos = posInLine;
-
-   for( ; it!=endIt; it+=step )
+   if ( d->m_pDiff3LineVector==0 || d->m_pLineData==0 )
+      return;
+   int nofD3Lines = d->m_pDiff3LineVector->size();
+   for( int d3vLine=0; d3vLine<nofD3Lines; ++d3vLine )
    {
-      QString line = d->getString( it );
-      if ( !line.isEmpty() )
+      int lineIdx = (*d->m_pDiff3LineVector)[d3vLine]->getLineInFile( d->m_winIdx );
+      if ( lineIdx>=0 )
       {
-         int pos = line.indexOf( s, startPos, bCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive );
-         if ( pos != -1 )
-         {
-            d3vLine = it;
-            posInLine = pos;
-            return true;
-         }
-
-         startPos = 0;
+         const LineData& ld = d->m_pLineData[lineIdx];
+         findAllInLine( pattern, ld.getLine(), ld.size(), d->m_winIdx, d3vLine, hits );
       }
    }
-   return false;
 }
 
 void DiffTextWindow::convertD3LCoordsToLineCoords( int d3LIdx, int d3LPos, int& line, int& pos )
@@ -19,6 +19,7 @@
 #define DIFFTEXTWINDOW_H
 
 #include "diff.h"
+#include "findengine.h"
 
 #include <QLabel>
 
@@ -71,12 +72,13 @@ public:
 
    void convertSelectionToD3LCoords();
 
-   bool findString( const QString& s, int& d3vLine, int& posInLine, bool bDirDown, bool bCaseSensitive );
+   void findAll( const FindPattern& pattern, FindHitList& hits );
    void setSelection( int firstLine, int startPos, int lastLine, int endPos, int& l, int& p );
    void getSelectionRange( int* firstLine, int* lastLine, e_CoordType coordType );
 
    void setPaintingAllowed( bool bAllowPainting );
    void recalcWordWrap( bool bWordWrap, int wrapLineVectorSize, int nofVisibleColumns );
+   void reportMemory( MemoryReport& report, const QString& name );
    void print( MyPainter& painter, const QRect& r, int firstLine, int nofLinesPerPage );
 signals:
    void resizeSignal( int nofVisibleColumns, int nofVisibleLines );
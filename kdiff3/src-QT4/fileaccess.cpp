@@ -19,6 +19,7 @@
 
 #include <vector>
 #include <cstdlib>
+#include <cstdio>
 
 #include <klocale.h>
 #include <ktemporaryfile.h>
@@ -892,6 +893,22 @@ bool FileAccess::symLink( const QString& linkTarget, const QString& linkLocation
 }
 #endif
 
+#ifdef _WIN32
+bool FileAccess::replaceFile( const QString& srcName, const QString& destName )
+{
+   return 0!=MoveFileExW( (LPCWSTR)QDir::toNativeSeparators(srcName).utf16(),
+                          (LPCWSTR)QDir::toNativeSeparators(destName).utf16(), MOVEFILE_REPLACE_EXISTING );
+}
+#else
+bool FileAccess::replaceFile( const QString& srcName, const QString& destName )
+{
+   if ( 0==::rename( QFile::encodeName(srcName).constData(), QFile::encodeName(destName).constData() ) )
+      return true;
+   // Where rename() doesn't replace an existing file.
+   return QFile::exists( destName ) && QFile::remove( destName ) && QFile::rename( srcName, destName );
+}
+#endif
+
 bool FileAccess::exists( const QString& name )
 {
    FileAccess fa( name );
@@ -90,6 +90,8 @@ public:
 
    //bool chmod( const QString& );
    bool rename( const QString& );
+   // Local files only: Moves srcName over destName, atomically where the system supports it.
+   static bool replaceFile( const QString& srcName, const QString& destName );
    static bool symLink( const QString& linkTarget, const QString& linkLocation );
 
    void addPath( const QString& txt );
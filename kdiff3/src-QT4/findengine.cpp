@@ -0,0 +1,169 @@
+/***************************************************************************
+                          findengine.cpp  -  description
+                             -------------------
+    copyright            : (C) 2002-2007 by Joachim Eibl
+    email                : joachim.eibl at gmx.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "findengine.h"
+#include "common.h"
+
+#include <string.h>
+
+FindPattern::FindPattern( const QString& s, bool bCaseSensitive, bool bRegExp )
+{
+   m_bCaseSensitive = bCaseSensitive;
+   m_bRegExp = bRegExp;
+   m_first1 = 0;
+   m_first2 = 0;
+   m_bFoldedScan = false;
+   if ( bRegExp )
+   {
+      m_regExp = QRegExp( s, bCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive );
+   }
+   else if ( !s.isEmpty() )
+   {
+      m_pattern = bCaseSensitive ? s : s.toCaseFolded();
+      m_first1 = bCaseSensitive ? s[0].unicode() : s[0].toLower().unicode();
+      m_first2 = bCaseSensitive ? s[0].unicode() : s[0].toUpper().unicode();
+      // Only for ASCII the lower and upper case are all characters that fold to the first
+      // character, except for k and s (KELVIN SIGN and LATIN SMALL LETTER LONG S).
+      const ushort first = m_pattern[0].unicode();
+      m_bFoldedScan = !bCaseSensitive && ( first>=0x80 || first=='k' || first=='s' );
+   }
+}
+
+bool FindPattern::isValid() const
+{
+   return m_bRegExp ? !m_regExp.pattern().isEmpty() && m_regExp.isValid() : !m_pattern.isEmpty();
+}
+
+QString FindPattern::getErrorText() const
+{
+   return m_bRegExp ? m_regExp.errorString() : QString();
+}
+
+// Finds c in [p,pEnd) or returns pEnd. memchr() is vectorized in the C libraries,
+// so it searches the low byte of c and the high byte is checked afterwards.
+static const ushort* findChar( const ushort* p, const ushort* pEnd, ushort c )
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+   const int lowByteOffset = 0;
+#else
+   const int lowByteOffset = 1;
+#endif
+   const char* pBegin = (const char*)p;
+   const char* pc = pBegin + lowByteOffset;
+   const char* pcEnd = (const char*)pEnd;
+   while ( pc < pcEnd )
+   {
+      const char* pFound = (const char*)memchr( pc, c & 0xff, pcEnd - pc );
+      if ( pFound==0 )
+         break;
+      if ( ((pFound - pBegin) & 1) == lowByteOffset )
+      {
+         const ushort* pChar = (const ushort*)( pFound - lowByteOffset );
+         if ( *pChar==c )
+            return pChar;
+         pc = pFound + 2;
+      }
+      else
+      {
+         pc = pFound + 1;
+      }
+   }
+   return pEnd;
+}
+
+// Finds the first character in [p,pEnd) whose case folded form is c or returns pEnd.
+static const ushort* findFoldedChar( const ushort* p, const ushort* pEnd, ushort c )
+{
+   for( ; p<pEnd; ++p )
+   {
+      if ( QChar( *p ).toCaseFolded().unicode() == c )
+         return p;
+   }
+   return pEnd;
+}
+
+int FindPattern::indexIn( const QChar* p, int size, int startPos, int& matchLength ) const
+{
+   if ( m_bRegExp )
+   {
+      QString s = QString::fromRawData( p, size );
+      int pos = startPos;
+      while ( pos<=size )
+      {
+         pos = m_regExp.indexIn( s, pos );
+         if ( pos<0 )
+            return -1;
+         if ( m_regExp.matchedLength()>0 )
+         {
+            matchLength = m_regExp.matchedLength();
+            return pos;
+         }
+         ++pos;
+      }
+      return -1;
+   }
+
+   const int n = m_pattern.length();
+   if ( n==0 || startPos<0 || size-startPos<n )
+      return -1;
+
+   const ushort* pText = (const ushort*)p;
+   const ushort* pLast = pText + size - n + 1;  // End of the possible match starts
+   const ushort* pPattern = m_pattern.utf16();
+   // Candidates start with m_first1 or m_first2, unless they must be found via case folding.
+   const ushort* p1 = m_bFoldedScan ? findFoldedChar( pText+startPos, pLast, pPattern[0] ) : findChar( pText+startPos, pLast, m_first1 );
+   const ushort* p2 = m_first2!=m_first1 && !m_bFoldedScan ? findChar( pText+startPos, pLast, m_first2 ) : pLast;
+   for(;;)
+   {
+      const ushort* pCandidate = min2( p1, p2 );
+      if ( pCandidate==pLast )
+         return -1;
+
+      bool bMatch;
+      if ( m_bCaseSensitive )
+         bMatch = memcmp( pCandidate, pPattern, n*sizeof(ushort) )==0;
+      else
+      {
+         bMatch = true;
+         for( int i=0; i<n && bMatch; ++i )
+            bMatch = QChar( pCandidate[i] ).toCaseFolded().unicode() == pPattern[i];
+      }
+      if ( bMatch )
+      {
+         matchLength = n;
+         return pCandidate - pText;
+      }
+
+      if ( p1==pCandidate ) p1 = m_bFoldedScan ? findFoldedChar( pCandidate+1, pLast, pPattern[0] ) : findChar( pCandidate+1, pLast, m_first1 );
+      if ( p2==pCandidate ) p2 = findChar( pCandidate+1, pLast, m_first2 );
+   }
+}
+
+void findAllInLine( const FindPattern& pattern, const QChar* p, int size, int window, int line, FindHitList& hits )
+{
+   int matchLength = 0;
+   int pos = pattern.indexIn( p, size, 0, matchLength );
+   while ( pos>=0 )
+   {
+      FindHit hit;
+      hit.window = window;
+      hit.line = line;
+      hit.pos = pos;
+      hit.length = matchLength;
+      hits.push_back( hit );
+      pos = pattern.indexIn( p, size, pos+matchLength, matchLength );
+   }
+}
@@ -0,0 +1,69 @@
+/***************************************************************************
+                          findengine.h  -  description
+                             -------------------
+    copyright            : (C) 2002-2007 by Joachim Eibl
+    email                : joachim.eibl at gmx.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef FINDENGINE_H
+#define FINDENGINE_H
+
+#include <QString>
+#include <QRegExp>
+#include <vector>
+
+/** A search string or regular expression, prepared once and then applied
+    directly to the decoded line buffers (LineData), without a QString per line.
+*/
+class FindPattern
+{
+public:
+   FindPattern( const QString& s, bool bCaseSensitive, bool bRegExp );
+   bool isValid() const;  // False for an empty string or an invalid regular expression.
+   QString getErrorText() const;
+
+   /** Returns the position of the first match in p[0..size) at or after startPos
+       or -1. Empty regular expression matches are skipped.
+   */
+   int indexIn( const QChar* p, int size, int startPos, int& matchLength ) const;
+
+private:
+   QString m_pattern;   // Case folded if !m_bCaseSensitive
+   bool m_bCaseSensitive;
+   bool m_bRegExp;
+   QRegExp m_regExp;
+   ushort m_first1;     // First character of the pattern, and its other case
+   ushort m_first2;
+   bool m_bFoldedScan;  // Other characters fold to the first one too: Compare the folded text.
+};
+
+// window: 1, 2 or 3 for A, B or C (line is a Diff3LineVector index), 4 for the output (line is a merge result line)
+struct FindHit
+{
+   int window;
+   int line;
+   int pos;
+   int length;
+   bool operator<( const FindHit& h ) const
+   {
+      if ( window!=h.window ) return window<h.window;
+      if ( line!=h.line ) return line<h.line;
+      return pos<h.pos;
+   }
+};
+
+typedef std::vector<FindHit> FindHitList;
+
+/** Appends all matches within one line to hits. */
+void findAllInLine( const FindPattern& pattern, const QChar* p, int size, int window, int line, FindHitList& hits );
+
+#endif
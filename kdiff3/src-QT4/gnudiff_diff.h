@@ -29,6 +29,8 @@
 #include <stdio.h>
 #include <QString>
 
+class QRegExp;
+
 #define TAB_WIDTH 8
 
 class GnuDiff
@@ -86,6 +88,9 @@ bool ignore_blank_lines;
 bool bIgnoreNumbers;
 bool bIgnoreWhiteSpace;
 
+/* Ignore the parts of lines that match this regexp. 0 if not used. (Similar to bIgnoreNumbers)  */
+const QRegExp* pIgnoreRegExp;
+
 /* Files can be compared byte-by-byte, as if they were binary.
    This depends on various options.  */
 bool files_can_be_treated_as_binary;
@@ -318,6 +323,8 @@ private:
 
    // gnudiff_io.cpp
    void find_and_hash_each_line (struct file_data *current);
+   bool remove_ignored_parts (const QChar *s, size_t len, QString& result);
+   size_t hash_line (const QChar *p, const QChar *end);
    void find_identical_ends (struct file_data filevec[]);
 
    // gnudiff_xmalloc.cpp
@@ -23,6 +23,8 @@
 
 #include "gnudiff_diff.h"
 #include <stdlib.h>
+#include <QRegExp>
+#include <QVector>
 
 /* Rotate an unsigned value to the left.  */
 #define ROL(v, n) ((v) << (n) | (v) >> (sizeof (v) * CHAR_BIT - (n)))
@@ -46,6 +48,11 @@ struct equivclass
   size_t length;	/* That line's length, not counting its newline.  */
 };
 
+/* The lines of the equivalence classes after remove_ignored_parts, if that
+   changed them. `line' of these classes points into this storage, so each
+   line is only masked once and lines_differ compares the masked forms.  */
+static QVector<QString> masked_lines;
+
 /* Hash-table: array of buckets, each being a chain of equivalence classes.
    buckets[-1] is reserved for incomplete lines.  */
 static lin *buckets;
@@ -76,6 +83,7 @@ static lin equivs_alloc;
    according to the command line options.
    For efficiency, this is invoked only when the lines do not match exactly
    but an option like -i might cause us to ignore the difference.
+   With pIgnoreRegExp both lines must already be masked by remove_ignored_parts.
    Return nonzero if the lines differ.  */
 
 bool GnuDiff::lines_differ (const QChar *s1, size_t len1, const QChar *s2, size_t len2 )
@@ -109,9 +117,11 @@ bool GnuDiff::lines_differ (const QChar *s1, size_t len1, const QChar *s2, size_
          if ( t1!=s1end && t2!=s2end )
          {
             if (ignore_case)
-            {  /* Lowercase comparison. */
-               if ( t1->toLower() == t2->toLower() )
+            {  /* Case folded comparison, as in equal() and hash_line(). */
+               if ( t1->toCaseFolded() == t2->toCaseFolded() )
                   continue;
+               else
+                  return true;
             }
             else if ( *t1 == *t2 )
                continue;
@@ -128,6 +138,52 @@ bool GnuDiff::lines_differ (const QChar *s1, size_t len1, const QChar *s2, size_
 }
 
 
+/* Copy the line without the parts that match pIgnoreRegExp into result.
+   Return false if nothing matched: Then result is not touched.  */
+
+bool GnuDiff::remove_ignored_parts (const QChar *s, size_t len, QString& result)
+{
+   QString line = QString::fromRawData( s, len );
+   int pos = pIgnoreRegExp->indexIn( line );
+   if ( pos < 0 )
+      return false;
+
+   result.clear();
+   int last = 0;
+   while ( pos >= 0 )
+   {
+      int matchLength = pIgnoreRegExp->matchedLength();
+      if ( matchLength > 0 )
+      {
+         result += QString::fromRawData( s+last, pos-last );
+         last = pos + matchLength;
+         pos = pIgnoreRegExp->indexIn( line, last );
+      }
+      else
+      {
+         pos = pos+1 < (int)len ? pIgnoreRegExp->indexIn( line, pos+1 ) : -1;
+      }
+   }
+   result += QString::fromRawData( s+last, len-last );
+   return true;
+}
+
+/* Hash the line from p to end the same way as find_and_hash_each_line does.  */
+
+size_t GnuDiff::hash_line (const QChar *p, const QChar *end)
+{
+  hash_value h = 0;
+  for ( ; p<end; ++p )
+    {
+      QChar c = *p;
+      if ( ignore_white_space == IGNORE_ALL_SPACE
+           && (isWhite(c) || (bIgnoreNumbers && (c.isDigit() || c=='-' || c=='.' ))) )
+        continue;
+      h = HASH (h, ignore_case ? c.toCaseFolded().unicode() : c.unicode());
+    }
+  return h;
+}
+
 /* Split the file into lines, simultaneously computing the equivalence
    class for each line.  */
 
@@ -151,25 +207,39 @@ void GnuDiff::find_and_hash_each_line (struct file_data *current)
   const QChar *suffix_begin = current->suffix_begin;
   const QChar *bufend = current->buffer + current->buffered;
   bool diff_length_compare_anyway =
-    ignore_white_space != IGNORE_NO_WHITE_SPACE || bIgnoreNumbers;
+    ignore_white_space != IGNORE_NO_WHITE_SPACE || bIgnoreNumbers || pIgnoreRegExp;
+  QString maskedLine;
   bool same_length_diff_contents_compare_anyway =
     diff_length_compare_anyway | ignore_case;
 
   while ( p < suffix_begin)
     {
       const QChar *ip = p;
+      bool bMasked = false;
 
       h = 0;
 
+      if (pIgnoreRegExp)
+        {
+          /* The regexp needs the whole line: Find its end first.  */
+          while ( p<bufend && *p != '\n' )
+            ++p;
+          bMasked = remove_ignored_parts( ip, p-ip, maskedLine );
+          if ( bMasked )
+            h = hash_line( maskedLine.unicode(), maskedLine.unicode()+maskedLine.length() );
+          else
+            h = hash_line( ip, p );
+        }
+
       /* Hash this line until we find a newline or bufend is reached.  */
-      if (ignore_case)
+      else if (ignore_case)
 	switch (ignore_white_space)
 	  {
 	  case IGNORE_ALL_SPACE:
 	    while ( p<bufend && (c = *p) != '\n' )
             {
           if (! (isWhite(c) || (bIgnoreNumbers && (c.isDigit() || c=='-' || c=='.' )) ))
-                  h = HASH (h, c.toLower().unicode());
+                  h = HASH (h, c.toCaseFolded().unicode());
               ++p;
             }            
 	    break;
@@ -177,7 +247,7 @@ void GnuDiff::find_and_hash_each_line (struct file_data *current)
 	  default:
 	    while ( p<bufend && (c = *p) != '\n' )
             {
-               h = HASH (h, c.toLower().unicode());
+               h = HASH (h, c.toCaseFolded().unicode());
                ++p;
             }
 	    break;
@@ -207,6 +277,10 @@ void GnuDiff::find_and_hash_each_line (struct file_data *current)
       length = p - ip;
       ++p;
 
+      /* The line as it is compared.  */
+      const QChar *cmpline = bMasked ? maskedLine.unicode() : ip;
+      size_t cmplength = bMasked ? (size_t) maskedLine.length() : length;
+
       for (i = *bucket;  ;  i = eqs[i].next)
 	if (!i)
 	  {
@@ -221,8 +295,14 @@ void GnuDiff::find_and_hash_each_line (struct file_data *current)
 	      }
 	    eqs[i].next = *bucket;
 	    eqs[i].hash = h;
-	    eqs[i].line = ip;
-	    eqs[i].length = length;
+	    if (bMasked)
+	      {
+		masked_lines.append (maskedLine);
+		eqs[i].line = masked_lines.last().unicode();
+	      }
+	    else
+	      eqs[i].line = ip;
+	    eqs[i].length = cmplength;
 	    *bucket = i;
 	    break;
 	  }
@@ -232,12 +312,12 @@ void GnuDiff::find_and_hash_each_line (struct file_data *current)
 
 	    /* Reuse existing class if lines_differ reports the lines
                equal.  */
-	    if (eqs[i].length == length)
+	    if (eqs[i].length == cmplength)
 	      {
 		/* Reuse existing equivalence class if the lines are identical.
 		   This detects the common case of exact identity
 		   faster than lines_differ would.  */
-		if (memcmp (eqline, ip, length*sizeof(QChar)) == 0)
+		if (memcmp (eqline, cmpline, cmplength*sizeof(QChar)) == 0)
 		  break;
 		if (!same_length_diff_contents_compare_anyway)
 		  continue;
@@ -245,7 +325,7 @@ void GnuDiff::find_and_hash_each_line (struct file_data *current)
 	    else if (!diff_length_compare_anyway)
 	      continue;
 
-	    if (! lines_differ (eqline, eqs[i].length, ip, length))
+	    if (! lines_differ (eqline, eqs[i].length, cmpline, cmplength))
 	      break;
 	  }
 
@@ -554,6 +634,7 @@ GnuDiff::read_files (struct file_data filevec[], bool /*pretend_binary*/)
 
   free (equivs);
   free (buckets - 1);
+  masked_lines.clear();
 
   return 0;
 }
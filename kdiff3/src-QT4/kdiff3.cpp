@@ -64,6 +64,7 @@
 #include "directorymergewindow.h"
 #include "smalldialogs.h"
 #include "guiutils.h" // namespace KDiff3
+#include "batchmerge.h"
 
 #define ID_STATUS_MSG 1
 #define MAIN_TOOLBAR_NAME "mainToolBar"
@@ -216,6 +217,7 @@ KDiff3App::KDiff3App(QWidget* pParent, const char* /*name*/, KDiff3Part* pKDiff3
    }
 
    m_bAutoFlag = args!=0  && args->isSet("auto");
+   m_bMemoryReport = args!=0 && args->isSet("memory-report");
    m_bAutoMode = m_bAutoFlag || m_pOptions->m_bAutoSaveAndQuitOnMergeWithoutConflicts;
    if ( m_bAutoMode && m_outputFilename.isEmpty() )
    {
@@ -276,6 +278,9 @@ KDiff3App::KDiff3App(QWidget* pParent, const char* /*name*/, KDiff3Part* pKDiff3
    initStatusBar();
 
    m_pFindDialog = new FindDialog( this );
+   m_findHitIdx = -1;
+   m_bFindHitsValid = false;
+   m_findOutputGeneration = 0;
    connect( m_pFindDialog, SIGNAL(findNext()), this, SLOT(slotEditFindNext()));
 
    autoAdvance->setChecked( m_pOptions->m_bAutoAdvance );
@@ -379,43 +384,30 @@ void KDiff3App::completeInit( const QString& fn1, const QString& fn2, const QStr
    {
       m_pDirectoryMergeSplitter->hide();
 
-      init( m_bAutoMode );
       if ( m_bAutoMode )
       {
-         SourceData* pSD=0;
-         if ( m_sd3.isEmpty() )
-         {
-            if ( m_totalDiffStatus.bBinaryAEqB ){ pSD = &m_sd1; }
-         }
-         else
-         {
-            if      ( m_totalDiffStatus.bBinaryBEqC ){ pSD = &m_sd3; } // B==C (assume A is old)
-            else if ( m_totalDiffStatus.bBinaryAEqB ){ pSD = &m_sd3; } // assuming C has changed
-            else if ( m_totalDiffStatus.bBinaryAEqC ){ pSD = &m_sd2; } // assuming B has changed
-         }
-
-         if ( pSD!=0 )
+         // Merge without creating any views: They are only needed if conflicts remain.
+         QStringList errors;
+         errors += m_sd1.readAndPreprocess( m_pOptions->m_pEncodingA, m_pOptions->m_bAutoDetectUnicodeA );
+         errors += m_sd2.readAndPreprocess( m_pOptions->m_pEncodingB, m_pOptions->m_bAutoDetectUnicodeB );
+         if ( !m_sd3.isEmpty() )
+            errors += m_sd3.readAndPreprocess( m_pOptions->m_pEncodingC, m_pOptions->m_bAutoDetectUnicodeC );
+         if ( errors.isEmpty() && m_sd1.isValid() && m_sd2.isValid() && m_sd3.isValid() )
          {
-            // Save this file directly, not via the merge result window.
-            bool bSuccess = false;
-            FileAccess fa( m_outputFilename );
-            if ( m_pOptions->m_bDmCreateBakFiles && fa.exists() )
-            {
-               QString newName = m_outputFilename + ".orig";
-               if ( FileAccess::exists( newName ) ) FileAccess::removeFile( newName );
-               if ( !FileAccess::exists( newName ) ) fa.rename( newName );
-            }
-
-            bSuccess = pSD->saveNormalDataAs( m_outputFilename );
-            if ( bSuccess ) ::exit(0);
-            else KMessageBox::error( this, i18n("Saving failed.") );
-         }
-         else if ( m_pMergeResultWindow->getNrOfUnsolvedConflicts() == 0 )
-         {
-            bool bSuccess = m_pMergeResultWindow->saveDocument( m_pMergeResultWindowTitle->getFileName(), m_pMergeResultWindowTitle->getEncoding(), m_pMergeResultWindowTitle->getLineEndStyle() );
-            if ( bSuccess ) ::exit(0);
+            QString errorText;
+            MemoryReport memoryReport;
+            int nofUnsolvedConflicts = autoMerge( m_pOptions, m_sd1, m_sd2, m_sd3, m_outputFilename, errorText, m_bMemoryReport ? &memoryReport : 0 );
+            if ( m_bMemoryReport )
+               fprintf(stderr, "%s", memoryReport.getAsString().toLatin1().constData());
+            if ( nofUnsolvedConflicts==0 )
+               ::exit(0);
+            // Binary data is never merged, init() will tell about that.
+            else if ( nofUnsolvedConflicts<0 && !isBinaryInput() )
+               KMessageBox::error( this, errorText );
          }
       }
+      // Load the files (again) and create the views. Also reports load errors.
+      init( m_bAutoMode );
    }
    m_bAutoMode = false;
 
@@ -494,6 +486,10 @@ void KDiff3App::initActions( KActionCollection* ac )
 #endif
    fileQuit = KStandardAction::quit(this, SLOT(slotFileQuit()), ac);
    fileQuit->setStatusTip(i18n("Quits the application"));
+   editUndo = KStandardAction::undo(this, SLOT(slotEditUndo()), ac);
+   editUndo->setStatusTip(i18n("Undoes the last change of the merge result"));
+   editRedo = KStandardAction::redo(this, SLOT(slotEditRedo()), ac);
+   editRedo->setStatusTip(i18n("Redoes the last undone change of the merge result"));
    editCut = KStandardAction::cut(this, SLOT(slotEditCut()), ac);
    editCut->setStatusTip(i18n("Cuts the selected section and puts it to the clipboard"));
    editCopy = KStandardAction::copy(this, SLOT(slotEditCopy()), ac);
@@ -506,6 +502,8 @@ void KDiff3App::initActions( KActionCollection* ac )
    editFind->setStatusTip(i18n("Search for a string"));
    editFindNext = KStandardAction::findNext(this, SLOT(slotEditFindNext()), ac);
    editFindNext->setStatusTip(i18n("Search again for the string"));
+   editFindPrev = KStandardAction::findPrev(this, SLOT(slotEditFindPrev()), ac);
+   editFindPrev->setStatusTip(i18n("Search again backwards for the string"));
 /*   FIXME figure out how to implement this action
    viewToolBar = KStandardAction::showToolbar(this, SLOT(slotViewToolBar()), ac);
    viewToolBar->setStatusTip(i18n("Enables/disables the toolbar")); */
@@ -603,6 +601,8 @@ void KDiff3App::initActions( KActionCollection* ac )
    dirShowBoth->setChecked( true );
    dirViewToggle = KDiff3::createAction< KAction >(i18n("Toggle Between Dir && Text View"), this, SLOT(slotDirViewToggle()), ac, "win_dir_view_toggle");
 
+   KDiff3::createAction< KAction >(i18n("Memory Usage..."), this, SLOT(slotShowMemoryReport()), ac, "help_memory_report");
+
    m_pMergeEditorPopupMenu = new QMenu( this );
 /*   chooseA->plug( m_pMergeEditorPopupMenu );
    chooseB->plug( m_pMergeEditorPopupMenu );
@@ -698,6 +698,11 @@ bool KDiff3App::queryClose()
 
 void KDiff3App::slotFileSave()
 {
+   if ( isBinaryInput() )
+   {
+      KMessageBox::sorry( this, i18n("The merge result can't be saved, because binary data is not part of it.") );
+      return;
+   }
    if ( m_bDefaultFilename )
    {
       slotFileSaveAs();
@@ -721,6 +726,11 @@ void KDiff3App::slotFileSave()
 
 void KDiff3App::slotFileSaveAs()
 {
+  if ( isBinaryInput() )
+  {
+     KMessageBox::sorry( this, i18n("The merge result can't be saved, because binary data is not part of it.") );
+     return;
+  }
   slotStatusMsg(i18n("Saving file with a new filename..."));
 
   QString s = KFileDialog::getSaveUrl( QDir::currentPath(), 0, this, i18n("Save As...") ).url();
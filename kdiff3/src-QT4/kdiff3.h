@@ -19,6 +19,7 @@
 #define KDIFF3_H
 
 #include "diff.h"
+#include "findengine.h"
 
 #include <config-kdiff3.h>
 
@@ -126,6 +127,9 @@ class KDiff3App : public QSplitter
     virtual bool isFileSaved();
     virtual bool isDirComparison();
 
+    /** Adds the memory used by the loaded files and the diff and merge data. */
+    void reportMemory( MemoryReport& report );
+
   signals:
      void createNewInstance( const QString& fn1, const QString& fn2, const QString& fn3 );
   protected:
@@ -156,6 +160,10 @@ class KDiff3App : public QSplitter
      * If queryClose() returns false because the user canceled the saveModified() dialog, the closing breaks.
      */
     void slotFileQuit();
+    /** undo/redo the last change of the merge result
+     */
+    void slotEditUndo();
+    void slotEditRedo();
     /** put the marked text/object into the clipboard and remove
      *  it from the document
      */
@@ -188,6 +196,8 @@ class KDiff3App : public QSplitter
     KAction* filePrint;
     KAction* fileQuit;
     KAction* fileReload;
+    KAction* editUndo;
+    KAction* editRedo;
     KAction* editCut;
     KAction* editCopy;
     KAction* editPaste;
@@ -199,6 +209,7 @@ class KDiff3App : public QSplitter
 // Special KDiff3 specific stuff starts here
     KAction *editFind;
     KAction *editFindNext;
+    KAction *editFindPrev;
 
     KAction *goCurrent;
     KAction *goTop;
@@ -306,6 +317,12 @@ class KDiff3App : public QSplitter
    OptionDialog* m_pOptionDialog;
    Options*      m_pOptions;
    FindDialog*   m_pFindDialog;
+   FindHitList   m_findHits;     // All matches of the last search, sorted
+   int           m_findHitIdx;   // The current match or -1
+   bool          m_bFindHitsValid;
+   unsigned int  m_findOutputGeneration;  // See MergeResultWindow::getContentGeneration()
+   bool updateFindHits( bool bDirDown );
+   void showFindHit( const FindHit& hit );
 
    void init( bool bAuto=false, TotalDiffStatus* pTotalDiffStatus=0, bool bLoadFiles=true, bool bUseCurrentEncoding = false);
 
@@ -315,6 +332,7 @@ class KDiff3App : public QSplitter
    bool improveFilenames(bool bCreateNewInstance);
 
    bool canContinue();
+   bool isBinaryInput(); // Binary data isn't part of the merge result, so it can't be saved.
 
    void choose(int choice);
 
@@ -325,6 +343,7 @@ class KDiff3App : public QSplitter
    KParts::MainWindow*       m_pKDiff3Shell;
    bool m_bAutoFlag;
    bool m_bAutoMode;
+   bool m_bMemoryReport; // Print a MemoryReport to stderr after the --auto merge
    bool recalcWordWrap(int nofVisibleColumns=-1);
    bool m_bRecalcWordWrapPosted;
    void setHScrollBarRange();
@@ -351,6 +370,7 @@ public slots:
    void slotEditSelectAll();
    void slotEditFind();
    void slotEditFindNext();
+   void slotEditFindPrev();
    void slotGoCurrent();
    void slotGoTop();
    void slotGoBottom();
@@ -403,6 +423,7 @@ public slots:
    void slotOverviewBC();
    void slotSplitDiff();
    void slotJoinDiffs();
+   void slotShowMemoryReport();
    void slotAddManualDiffHelp();
    void slotClearManualDiffHelpList();
    void slotNoRelevantChangesDetected();
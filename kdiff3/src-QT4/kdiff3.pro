@@ -1,11 +1,16 @@
 TEMPLATE = app
 # When unresolved items remain during linking: Try adding "shared" in the CONFIG.
 CONFIG  += qt warn_on thread precompile_header
+QT      += network
 !os2:PRECOMPILED_HEADER = stable.h
 HEADERS  = version.h                     \
            diff.h                        \
+           binarydiff.h                  \
            difftextwindow.h              \
            mergeresultwindow.h           \
+           mergeengine.h                 \
+           batchmerge.h                  \
+           mergeserver.h                 \
            kdiff3.h                      \
            merger.h                      \
            optiondialog.h                \
@@ -16,13 +21,19 @@ HEADERS  = version.h                     \
            fileaccess.h                  \
            kdiff3_shell.h                \
            kdiff3_part.h                 \
-           smalldialogs.h
+           smalldialogs.h                \
+           findengine.h
 SOURCES  = main.cpp                      \
            diff.cpp                      \
+           binarydiff.cpp                \
            difftextwindow.cpp            \
            kdiff3.cpp                    \
            merger.cpp                    \
            mergeresultwindow.cpp         \
+           mergeengine.cpp               \
+           findengine.cpp                \
+           batchmerge.cpp                \
+           mergeserver.cpp               \
            optiondialog.cpp              \
            pdiff.cpp                     \
            directorymergewindow.cpp      \
@@ -51,12 +62,12 @@ win32 {
    QMAKE_CXXFLAGS_RELEASE  += -DNDEBUG -DQT_NO_ASCII_CAST
    RC_FILE = kdiff3win.rc
    win32-g++ {
-           QMAKE_LFLAGS += -luser32 -lshell32
+           QMAKE_LFLAGS += -luser32 -lshell32 -ladvapi32
            QMAKE_LFLAGS_RELEASE += -static-libgcc  # Remove dependency to libgcc_s_dw2-1.dll
            QMAKE_LFLAGS_EXCEPTIONS_ON -= -mthreads # Remove dependency to mingwm10.dll (hack, yet no problem if not multithreaded)
                                                    # Better: configure -static -release -no-exceptions -fast
    } else {
-           QMAKE_LFLAGS += user32.lib shell32.lib
+           QMAKE_LFLAGS += user32.lib shell32.lib advapi32.lib
    }
 }
 os2 {
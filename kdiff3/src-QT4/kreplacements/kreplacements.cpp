@@ -512,6 +512,7 @@ static void initAction( QAction* pAction, QObject* receiver, const char* slot, K
          p->dirCurrentSyncItemMenu->addAction( pAction );
       }
       else if( n.left(4)=="diff")  p->diffMenu->addAction( pAction );
+      else if( n.left(5)=="help_") p->helpMenu->addAction( pAction );
       else if( name[0]=='d')  p->directoryMenu->addAction( pAction );
       else if( name[0]=='f')  p->fileMenu->addAction( pAction );
       else if( name[0]=='w')  p->windowsMenu->addAction( pAction );
@@ -645,6 +646,22 @@ KAction* KStandardAction::quit( QWidget* parent, const char* slot, KActionCollec
    return a;
 }
 
+KAction* KStandardAction::undo( QWidget* parent, const char* slot, KActionCollection* actionCollection)
+{
+   KMainWindow* p = actionCollection->m_pMainWindow;
+   KAction* a = new KAction( i18n("Undo"), Qt::CTRL+Qt::Key_Z, parent, slot, actionCollection, "undo", false, false );
+   if(p) p->editMenu->addAction( a );
+   return a;
+}
+
+KAction* KStandardAction::redo( QWidget* parent, const char* slot, KActionCollection* actionCollection)
+{
+   KMainWindow* p = actionCollection->m_pMainWindow;
+   KAction* a = new KAction( i18n("Redo"), Qt::CTRL+Qt::SHIFT+Qt::Key_Z, parent, slot, actionCollection, "redo", false, false );
+   if(p) p->editMenu->addAction( a );
+   return a;
+}
+
 KAction* KStandardAction::cut( QWidget* parent, const char* slot, KActionCollection* actionCollection)
 {
    KMainWindow* p = actionCollection->m_pMainWindow;
@@ -744,6 +761,14 @@ KAction* KStandardAction::findNext( QWidget* parent, const char* slot, KActionCo
    return a;
 }
 
+KAction* KStandardAction::findPrev( QWidget* parent, const char* slot, KActionCollection* actionCollection)
+{
+   KMainWindow* p = actionCollection->m_pMainWindow;
+   KAction* a = new KAction( i18n("Find Previous"), Qt::SHIFT+Qt::Key_F3, parent, slot, actionCollection, "findPrev", false, false );
+   if(p) p->editMenu->addAction( a );
+   return a;
+}
+
 KAction* KActionCollection::addAction(const QString& name )
 {
    return new KAction( name, this );
@@ -338,6 +338,8 @@ public:
    static KAction* saveAs( QWidget* parent, const char* slot, KActionCollection* );
    static KAction* print( QWidget* parent, const char* slot, KActionCollection* );
    static KAction* quit( QWidget* parent, const char* slot, KActionCollection* );
+   static KAction* undo( QWidget* parent, const char* slot, KActionCollection* );
+   static KAction* redo( QWidget* parent, const char* slot, KActionCollection* );
    static KAction* cut( QWidget* parent, const char* slot, KActionCollection* );
    static KAction* copy( QWidget* parent, const char* slot, KActionCollection* );
    static KAction* paste( QWidget* parent, const char* slot, KActionCollection* );
@@ -350,6 +352,7 @@ public:
    static KAction* help( QWidget* parent, const char* slot, KActionCollection* );
    static KAction* find( QWidget* parent, const char* slot, KActionCollection* );
    static KAction* findNext( QWidget* parent, const char* slot, KActionCollection* );
+   static KAction* findPrev( QWidget* parent, const char* slot, KActionCollection* );
    static KAction* keyBindings( QWidget* parent, const char* slot, KActionCollection* );
 };
 
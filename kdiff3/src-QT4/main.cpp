@@ -35,6 +35,8 @@
 #include "optiondialog.h"
 #endif
 #include "common.h"
+#include "batchmerge.h"
+#include "mergeserver.h"
 
 void initialiseCmdLineArgs( KCmdLineOptions& options )
 {
@@ -207,6 +209,11 @@ int main(int argc, char *argv[])
    options.add( "out file",    ki18n("Output file, again. (For compatibility with certain tools.)") );
    options.add( "auto",        ki18n("No GUI if all conflicts are auto-solvable. (Needs -o file)") );
    options.add( "qall",        ki18n("Don't solve conflicts automatically.") );
+   options.add( "batch manifest", ki18n("Merge without GUI all files listed in the manifest. (One line per merge: base, A, B and output separated by tabs.)") );
+   options.add( "server",      ki18n("Stay resident and do the automatic merges requested via --use-server.") );
+   options.add( "use-server",  ki18n("With --auto: Let a running kdiff3 --server do the merge. Without a server or if conflicts remain the merge is done here.") );
+   options.add( "memory-report", ki18n("With --auto: Print the memory used by the loaded files and the diff and merge data to stderr.") );
+   options.add( "batch-slice slice", ki18n("Internal: Only merge every n-th manifest entry. (E.g. 0/4)") );
    options.add( "L1 alias1",   ki18n("Visible name replacement for input file 1 (base).") );
    options.add( "L2 alias2",   ki18n("Visible name replacement for input file 2.") );
    options.add( "L3 alias3",   ki18n("Visible name replacement for input file 3.") );
@@ -226,6 +233,11 @@ int main(int argc, char *argv[])
 
    KApplication app;
 
+   KCmdLineArgs* args = KCmdLineArgs::parsedArgs();
+   // Before loading translations and options: That is what the server saves.
+   if ( args!=0 && args->isSet("use-server") && MergeServer::autoMergeViaServer( args ) )
+      return 0;
+
 #ifdef KREPLACEMENTS_H
    QString locale;
 
@@ -248,6 +260,11 @@ int main(int argc, char *argv[])
    }
 #endif
 
+   if ( args!=0 && args->isSet("batch") )
+      return runBatchMerge( args );
+   if ( args!=0 && args->isSet("server") )
+      return runMergeServer( args );
+
 #ifndef QT_NO_SESSIONMANAGER
   if (app.isSessionRestored())
   {
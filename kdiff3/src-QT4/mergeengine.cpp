@@ -0,0 +1,1849 @@
+/***************************************************************************
+                          mergeengine.cpp  -  description
+                             -------------------
+    copyright            : (C) 2002-2007 by Joachim Eibl
+    email                : joachim.eibl at gmx.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "mergeengine.h"
+#include "options.h"
+#include "fileaccess.h"
+#include "progress.h"
+
+#include <QRegExp>
+#include <QTextCodec>
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <QThread>
+
+#include <klocale.h>
+
+#include <assert.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+MergeEngine::MergeEngine( Options* pOptions )
+{
+   m_pOptions = pOptions;
+   m_lineIndexGeneration = 0;
+   m_undoDepth = 0;
+   reset();
+}
+
+void MergeEngine::init(
+   const LineData* pLineDataA, int sizeA,
+   const LineData* pLineDataB, int sizeB,
+   const LineData* pLineDataC, int sizeC,
+   const Diff3LineList* pDiff3LineList,
+   const DiffBufferInfo* pDiffBufferInfo,
+   TotalDiffStatus* pTotalDiffStatus
+   )
+{
+   m_pldA = pLineDataA;
+   m_pldB = pLineDataB;
+   m_pldC = pLineDataC;
+   m_sizeA = sizeA;
+   m_sizeB = sizeB;
+   m_sizeC = sizeC;
+
+   m_pDiff3LineList = pDiff3LineList;
+   m_pDiffBufferInfo = pDiffBufferInfo;
+   m_pTotalDiffStatus = pTotalDiffStatus;
+}
+
+void MergeEngine::reset()
+{
+   m_pDiff3LineList = 0;
+   m_pDiffBufferInfo = 0;
+   m_pTotalDiffStatus = 0;
+   m_pldA = 0;
+   m_pldB = 0;
+   m_pldC = 0;
+   m_sizeA = 0;
+   m_sizeB = 0;
+   m_sizeC = 0;
+   clearUndo();
+}
+
+e_LineEndStyle getDefaultLineEndStyle( Options* pOptions, e_LineEndStyle eLineEndStyleA, e_LineEndStyle eLineEndStyleB, e_LineEndStyle eLineEndStyleC )
+{
+   e_LineEndStyle autoChoice = (e_LineEndStyle)pOptions->m_lineEndStyle;
+
+   if ( pOptions->m_lineEndStyle == eLineEndStyleAutoDetect )
+   {
+      if ( eLineEndStyleA != eLineEndStyleUndefined && eLineEndStyleB != eLineEndStyleUndefined && eLineEndStyleC != eLineEndStyleUndefined )
+      {
+         if ( eLineEndStyleA == eLineEndStyleB )
+            autoChoice = eLineEndStyleC;
+         else if ( eLineEndStyleA == eLineEndStyleC )
+            autoChoice = eLineEndStyleB;
+         else
+            autoChoice = eLineEndStyleConflict;          //conflict (not likely while only two values exist)
+      }
+      else 
+      {
+         e_LineEndStyle c1, c2;
+         if     ( eLineEndStyleA == eLineEndStyleUndefined ) { c1 = eLineEndStyleB; c2 = eLineEndStyleC; }
+         else if( eLineEndStyleB == eLineEndStyleUndefined ) { c1 = eLineEndStyleA; c2 = eLineEndStyleC; }
+         else /*if( eLineEndStyleC == eLineEndStyleUndefined )*/ { c1 = eLineEndStyleA; c2 = eLineEndStyleB; }
+         if ( c1 == c2 && c1!=eLineEndStyleUndefined )
+            autoChoice = c1;
+         else
+            autoChoice = eLineEndStyleConflict;
+      }
+   }
+   return autoChoice;
+}
+
+QTextCodec* getDefaultOutputEncoding( QTextCodec* pCodecForA, QTextCodec* pCodecForB, QTextCodec* pCodecForC )
+{
+   if ( pCodecForC && pCodecForB && pCodecForA )
+   {
+      if ( pCodecForA == pCodecForB )
+         return pCodecForC;
+      else if ( pCodecForA == pCodecForC )
+         return pCodecForB;
+      else
+         return pCodecForC;
+   }
+   else if ( pCodecForA && pCodecForB )
+      return pCodecForB;
+   else
+      return pCodecForA;
+}
+
+// Calculate the merge information for the given Diff3Line.
+// Results will be stored in mergeDetails, bConflict, bLineRemoved and src.
+void mergeOneLine(
+   const Diff3Line& d, e_MergeDetails& mergeDetails, bool& bConflict,
+   bool& bLineRemoved, int& src, bool bTwoInputs
+   )
+{
+   mergeDetails = eDefault;
+   bConflict = false;
+   bLineRemoved = false;
+   src = 0;
+
+   if ( bTwoInputs )   // Only two input files
+   {
+      if ( d.lineA!=-1 && d.lineB!=-1 )
+      {
+         if ( !d.bTextDiffAB )
+         {
+            mergeDetails = eNoChange;           src = A;
+         }
+         else
+         {
+            mergeDetails = eBChanged;           bConflict = true;
+         }
+      }
+      else
+      {
+         if ( d.lineA!=-1 && d.lineB==-1 )
+         {
+            mergeDetails = eBDeleted;   bConflict = true;
+         }
+         else if ( d.lineA==-1 && d.lineB!=-1 )
+         {
+            mergeDetails = eBDeleted;   bConflict = true;
+         }
+      }
+      return;
+   }
+
+   // A is base.
+   if ( d.lineA!=-1 && d.lineB!=-1 && d.lineC!=-1 )
+   {
+      if ( !d.bTextDiffAB  &&  !d.bTextDiffBC &&  !d.bTextDiffCA)
+      {
+         mergeDetails = eNoChange;           src = A;
+      }
+      else if( !d.bTextDiffAB  &&  d.bTextDiffBC  &&  d.bTextDiffCA )
+      {
+         mergeDetails = eCChanged;           src = C;
+      }
+      else if( d.bTextDiffAB  &&  d.bTextDiffBC  &&  !d.bTextDiffCA )
+      {
+         mergeDetails = eBChanged;           src = B;
+      }
+      else if( d.bTextDiffAB  &&  !d.bTextDiffBC  &&  d.bTextDiffCA )
+      {
+         mergeDetails = eBCChangedAndEqual;  src = C;
+      }
+      else if( d.bTextDiffAB  &&  d.bTextDiffBC  &&  d.bTextDiffCA )
+      {
+         mergeDetails = eBCChanged;           bConflict = true;
+      }
+      else
+         assert(false);
+   }
+   else if ( d.lineA!=-1 && d.lineB!=-1 && d.lineC==-1 )
+   {
+      if( d.bTextDiffAB )
+      {
+         mergeDetails = eBChanged_CDeleted;   bConflict = true;
+      }
+      else
+      {
+         mergeDetails = eCDeleted;            bLineRemoved = true;        src = C;
+      }
+   }
+   else if ( d.lineA!=-1 && d.lineB==-1 && d.lineC!=-1 )
+   {
+      if( d.bTextDiffCA )
+      {
+         mergeDetails = eCChanged_BDeleted;   bConflict = true;
+      }
+      else
+      {
+         mergeDetails = eBDeleted;            bLineRemoved = true;        src = B;
+      }
+   }
+   else if ( d.lineA==-1 && d.lineB!=-1 && d.lineC!=-1 )
+   {
+      if( d.bTextDiffBC )
+      {
+         mergeDetails = eBCAdded;             bConflict = true;
+      }
+      else // B==C
+      {
+         mergeDetails = eBCAddedAndEqual;     src = C;
+      }
+   }
+   else if ( d.lineA==-1 && d.lineB==-1 && d.lineC!= -1 )
+   {
+      mergeDetails = eCAdded;                 src = C;
+   }
+   else if ( d.lineA==-1 && d.lineB!=-1 && d.lineC== -1 )
+   {
+      mergeDetails = eBAdded;                 src = B;
+   }
+   else if ( d.lineA!=-1 && d.lineB==-1 && d.lineC==-1 )
+   {
+      mergeDetails = eBCDeleted;              bLineRemoved = true;     src = C;
+   }
+   else
+      assert(false);
+}
+
+void calcMergeDetails( Diff3LineList& d3ll, bool bTwoInputs )
+{
+   StageTrace trace("calcMergeDetails");
+   Diff3LineList::iterator i;
+   for( i=d3ll.begin(); i!=d3ll.end(); ++i )
+   {
+      e_MergeDetails md;
+      bool bConflict;
+      bool bLineRemoved;
+      int src;
+      mergeOneLine( *i, md, bConflict, bLineRemoved, src, bTwoInputs );
+      i->mergeDetails = md;
+      i->mergeSrc = src;
+      i->bMergeConflict = bConflict;
+      i->bMergeLineRemoved = bLineRemoved;
+   }
+}
+
+bool MergeEngine::sameKindCheck( const MergeLine& ml1, const MergeLine& ml2 )
+{
+   if ( ml1.bConflict && ml2.bConflict )
+   {
+      // Both lines have conflicts: If one is only a white space conflict and
+      // the other one is a real conflict, then this line returns false.
+      return ml1.id3l->bAEqC == ml2.id3l->bAEqC && ml1.id3l->bAEqB == ml2.id3l->bAEqB;
+   }
+   else
+      return (
+         ( !ml1.bConflict && !ml2.bConflict && ml1.bDelta && ml2.bDelta && ml1.srcSelect == ml2.srcSelect 
+         && (ml1.mergeDetails==ml2.mergeDetails || (ml1.mergeDetails!=eBCAddedAndEqual && ml2.mergeDetails!=eBCAddedAndEqual) ) )
+         ||
+         (!ml1.bDelta && !ml2.bDelta)
+         );
+}
+
+void MergeEngine::merge(bool bAutoSolve, int defaultSelector, bool bConflictsOnly, bool bWhiteSpaceOnly )
+{
+   StageTrace trace("merge");
+   clearUndo();
+   if ( !bConflictsOnly )
+   {
+      m_mergeLineList.clear();
+      m_totalSize.clear();
+      int lineIdx = 0;
+      Diff3LineList::const_iterator it;
+      for( it=m_pDiff3LineList->begin(); it!=m_pDiff3LineList->end(); ++it, ++lineIdx )
+      {
+         const Diff3Line& d = *it;
+
+         MergeLine ml;
+         bool bLineRemoved;
+         getMergeDetails( d, ml.mergeDetails, ml.bConflict, bLineRemoved, ml.srcSelect );
+
+         // Automatic solving for only whitespace changes.
+         if ( ml.bConflict &&
+              ( (m_pldC==0 && (d.bAEqB || (d.bWhiteLineA && d.bWhiteLineB)))  ||
+                (m_pldC!=0 && ((d.bAEqB && d.bAEqC) || (d.bWhiteLineA && d.bWhiteLineB && d.bWhiteLineC) ) ) ) )
+         {
+            ml.bWhiteSpaceConflict = true;
+         }
+
+         ml.d3lLineIdx   = lineIdx;
+         ml.bDelta       = ml.srcSelect != A;
+         ml.id3l         = it;
+         ml.srcRangeLength = 1;
+
+         MergeLine* back = m_mergeLineList.empty() ? 0 : &m_mergeLineList.back();
+
+         bool bSame = back!=0 && sameKindCheck( ml, *back );
+         if( bSame )
+         {
+            ++back->srcRangeLength;
+            if ( back->bWhiteSpaceConflict && !ml.bWhiteSpaceConflict )
+               back->bWhiteSpaceConflict = false;
+         }
+         else
+         {
+            ml.mergeEditLineList.setTotalSizePtr(&m_totalSize);
+            m_mergeLineList.push_back( ml );
+         }
+
+         if ( ! ml.bConflict )
+         {
+            MergeLine& tmpBack = m_mergeLineList.back();
+            MergeEditLine mel(ml.id3l);
+            mel.setSource( ml.srcSelect, bLineRemoved );
+            tmpBack.mergeEditLineList.push_back(mel);
+         }
+         else if ( back==0  || ! back->bConflict || !bSame )
+         {
+            MergeLine& tmpBack = m_mergeLineList.back();
+            MergeEditLine mel(ml.id3l);
+            mel.setConflict();
+            tmpBack.mergeEditLineList.push_back(mel);
+         }
+      }
+   }
+
+   bool bSolveWhiteSpaceConflicts = false;
+   if ( bAutoSolve ) // when true, then the other params are not used and we can change them here. (see all invocations of merge())
+   {
+      if ( m_pldC==0 && m_pOptions->m_whiteSpace2FileMergeDefault != 0 )  // Only two inputs
+      {
+         defaultSelector = m_pOptions->m_whiteSpace2FileMergeDefault;
+         bWhiteSpaceOnly = true;
+         bSolveWhiteSpaceConflicts = true;
+      }
+      else if ( m_pldC!=0 && m_pOptions->m_whiteSpace3FileMergeDefault != 0 )
+      {
+         defaultSelector = m_pOptions->m_whiteSpace3FileMergeDefault;
+         bWhiteSpaceOnly = true;
+         bSolveWhiteSpaceConflicts = true;
+      }
+   }
+
+   if ( !bAutoSolve || bSolveWhiteSpaceConflicts )
+   {
+      // Change all auto selections
+      MergeLineList::iterator mlIt;
+      for( mlIt=m_mergeLineList.begin(); mlIt!=m_mergeLineList.end(); ++mlIt )
+      {
+         MergeLine& ml = *mlIt;
+         bool bConflict = ml.mergeEditLineList.empty() || ml.mergeEditLineList.begin()->isConflict();
+         if ( ml.bDelta && ( !bConflictsOnly || bConflict ) && (!bWhiteSpaceOnly || ml.bWhiteSpaceConflict ))
+         {
+            ml.mergeEditLineList.clear();
+            if ( defaultSelector==-1 && ml.bDelta )
+            {
+               MergeEditLine mel(ml.id3l);;
+               mel.setConflict();
+               ml.bConflict = true;
+               ml.mergeEditLineList.push_back(mel);
+            }
+            else
+            {
+               Diff3LineList::const_iterator d3llit=ml.id3l;
+               int j;
+
+               for( j=0; j<ml.srcRangeLength; ++j )
+               {
+                  MergeEditLine mel(d3llit);
+                  mel.setSource( defaultSelector, false );
+
+                  int srcLine = defaultSelector==1 ? d3llit->lineA :
+                                defaultSelector==2 ? d3llit->lineB :
+                                defaultSelector==3 ? d3llit->lineC : -1;
+
+                  if ( srcLine != -1 )
+                  {
+                     ml.mergeEditLineList.push_back(mel);
+                  }
+
+                  ++d3llit;
+               }
+
+               if ( ml.mergeEditLineList.empty() ) // Make a line nevertheless
+               {
+                  MergeEditLine mel(ml.id3l);
+                  mel.setRemoved( defaultSelector );
+                  ml.mergeEditLineList.push_back(mel);
+               }
+            }
+         }
+      }
+   }
+
+   MergeLineList::iterator mlIt;
+   for( mlIt=m_mergeLineList.begin(); mlIt!=m_mergeLineList.end(); ++mlIt )
+   {
+      MergeLine& ml = *mlIt;
+      // Remove all lines that are empty, because no src lines are there.
+
+      int oldSrcLine = -1;
+      int oldSrc = -1;
+      MergeEditLineList::iterator melIt;
+      for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); )
+      {
+         MergeEditLine& mel = *melIt;
+         int melsrc = mel.src();
+
+         int srcLine = mel.isRemoved() ? -1 :
+                       melsrc==1 ? mel.id3l()->lineA :
+                       melsrc==2 ? mel.id3l()->lineB :
+                       melsrc==3 ? mel.id3l()->lineC : -1;
+
+         // At least one line remains because oldSrc != melsrc for first line in list
+         // Other empty lines will be removed
+         if ( srcLine == -1 && oldSrcLine==-1 && oldSrc == melsrc )
+            melIt = ml.mergeEditLineList.erase( melIt );
+         else
+            ++melIt;
+
+         oldSrcLine = srcLine;
+         oldSrc = melsrc;
+      }
+   }
+
+   if ( bAutoSolve && !bConflictsOnly )
+   {
+      if ( m_pOptions->m_bRunHistoryAutoMergeOnMergeStart )
+         mergeHistory();
+      if ( m_pOptions->m_bRunRegExpAutoMergeOnMergeStart )
+         regExpAutoMerge();
+   }
+
+   int nrOfSolvedConflicts = 0;
+   int nrOfUnsolvedConflicts = 0;
+   int nrOfWhiteSpaceConflicts = 0;
+
+   MergeLineList::iterator i;
+   for ( i = m_mergeLineList.begin();  i!=m_mergeLineList.end(); ++i )
+   {
+      if ( i->bConflict )
+         ++nrOfUnsolvedConflicts;
+      else if ( i->bDelta )
+         ++nrOfSolvedConflicts;
+
+      if ( i->bWhiteSpaceConflict )
+         ++nrOfWhiteSpaceConflicts;
+   }
+
+   m_pTotalDiffStatus->nofUnsolvedConflicts = nrOfUnsolvedConflicts;
+   m_pTotalDiffStatus->nofSolvedConflicts = nrOfSolvedConflicts;
+   m_pTotalDiffStatus->nofWhitespaceConflicts = nrOfWhiteSpaceConflicts;
+}
+
+int MergeEngine::getNrOfUnsolvedConflicts( int* pNrOfWhiteSpaceConflicts )
+{
+   int nrOfUnsolvedConflicts = 0;
+   if (pNrOfWhiteSpaceConflicts!=0)
+      *pNrOfWhiteSpaceConflicts = 0;
+
+   MergeLineList::iterator mlIt = m_mergeLineList.begin();
+   for(mlIt = m_mergeLineList.begin();mlIt!=m_mergeLineList.end(); ++mlIt)
+   {
+      MergeLine& ml = *mlIt;
+      MergeEditLineList::iterator melIt = ml.mergeEditLineList.begin();
+      if ( melIt->isConflict() )
+      {
+         ++nrOfUnsolvedConflicts;
+         if ( ml.bWhiteSpaceConflict &&  pNrOfWhiteSpaceConflicts!=0 )
+            ++ *pNrOfWhiteSpaceConflicts;
+      }
+   }
+
+   return nrOfUnsolvedConflicts;
+}
+
+void MergeEngine::choose( MergeLineList::iterator mlIt, int selector )
+{
+   if ( mlIt==m_mergeLineList.end() )
+      return;
+
+   // First find range for which this change works.
+   MergeLine& ml = *mlIt;
+
+   MergeEditLineList::iterator melIt;
+
+   // Now check if selector is active for this range already.
+   bool bActive = false;
+
+   // Remove unneeded lines in the range.
+   for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); )
+   {
+      MergeEditLine& mel = *melIt;
+      if ( mel.src()==selector )
+         bActive = true;
+
+      if ( mel.src()==selector || !mel.isEditableText() || mel.isModified() )
+         melIt = ml.mergeEditLineList.erase( melIt );
+      else
+         ++melIt;
+   }
+
+   if ( !bActive )  // Selected source wasn't active.
+   {     // Append the lines from selected source here at rangeEnd.
+      Diff3LineList::const_iterator d3llit=ml.id3l;
+      int j;
+
+      for( j=0; j<ml.srcRangeLength; ++j )
+      {
+         MergeEditLine mel(d3llit);
+         mel.setSource( selector, false );
+         ml.mergeEditLineList.push_back(mel);
+
+         ++d3llit;
+      }
+   }
+
+   if ( ! ml.mergeEditLineList.empty() )
+   {
+      // Remove all lines that are empty, because no src lines are there.
+      for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); )
+      {
+         MergeEditLine& mel = *melIt;
+
+         int srcLine = mel.src()==1 ? mel.id3l()->lineA :
+                       mel.src()==2 ? mel.id3l()->lineB :
+                       mel.src()==3 ? mel.id3l()->lineC : -1;
+
+         if ( srcLine == -1 )
+            melIt = ml.mergeEditLineList.erase( melIt );
+         else
+            ++melIt;
+      }
+   }
+
+   if ( ml.mergeEditLineList.empty() )
+   {
+      // Insert a dummy line:
+      MergeEditLine mel(ml.id3l);
+
+      if ( bActive )  mel.setConflict();         // All src entries deleted => conflict
+      else            mel.setRemoved(selector);  // No lines in corresponding src found.
+
+      ml.mergeEditLineList.push_back(mel);
+   }
+}
+
+static QString calcHistoryLead(const QString& s )
+{
+   // Return the start of the line until the first white char after the first non white char.
+   int i;
+   for( i=0; i<s.length(); ++i )
+   {
+      if (s[i]!=' ' && s[i]!='\t')
+      {
+         for( ; i<s.length(); ++i )
+         {
+            if (s[i]==' ' || s[i]=='\t')
+            {
+               return s.left(i);
+            }
+         }
+         return s;  // Very unlikely
+      }
+   }
+   return "";  // Must be an empty string, not a null string.
+}
+
+static void findHistoryRange( const QRegExp& historyStart, bool bThreeFiles, const Diff3LineList* pD3LList, const DiffBufferInfo* pDiffBufferInfo,
+                             Diff3LineList::const_iterator& iBegin, Diff3LineList::const_iterator& iEnd, int& idxBegin, int& idxEnd )
+{
+   QString historyLead;
+   // Search for start of history
+   for( iBegin = pD3LList->begin(), idxBegin=0; iBegin!=pD3LList->end(); ++iBegin, ++idxBegin )
+   {
+      if ( historyStart.exactMatch( iBegin->getString(A,pDiffBufferInfo) ) && 
+           historyStart.exactMatch( iBegin->getString(B,pDiffBufferInfo) ) && 
+           ( !bThreeFiles || historyStart.exactMatch( iBegin->getString(C,pDiffBufferInfo) ) ) )
+      {
+         historyLead = calcHistoryLead( iBegin->getString(A,pDiffBufferInfo) );
+         break;
+      }
+   }
+   // Search for end of history
+   for( iEnd = iBegin, idxEnd = idxBegin; iEnd!=pD3LList->end(); ++iEnd, ++idxEnd )
+   {
+      QString sA = iEnd->getString(A,pDiffBufferInfo);
+      QString sB = iEnd->getString(B,pDiffBufferInfo);
+      QString sC = iEnd->getString(C,pDiffBufferInfo);
+      if ( ! ((sA.isNull() || historyLead == calcHistoryLead(sA) ) &&
+              (sB.isNull() || historyLead == calcHistoryLead(sB) ) &&
+           (!bThreeFiles || sC.isNull() || historyLead == calcHistoryLead(sC) )
+         ))
+      {
+         break; // End of the history
+      }
+   }
+}
+
+bool findParenthesesGroups( const QString& s, QStringList& sl )
+{
+   sl.clear();
+   int i=0;
+   std::list<int> startPosStack;
+   int length = s.length();
+   for( i=0; i<length; ++i )
+   {
+      if ( s[i]=='\\' && i+1<length && ( s[i+1]=='\\' || s[i+1]=='(' || s[i+1]==')' ) )
+      {
+         ++i;
+         continue;
+      }
+      if ( s[i]=='(' )
+      {
+         startPosStack.push_back(i);
+      }
+      else if ( s[i]==')' )
+      {
+         if (startPosStack.empty())
+            return false; // Parentheses don't match
+         int startPos = startPosStack.back();
+         startPosStack.pop_back();
+         sl.push_back( s.mid( startPos+1, i-startPos-1 ) );
+      }
+   }
+   return startPosStack.empty(); // false if parentheses don't match
+}
+
+static QString calcHistorySortKey( const QStringList& keyOrderList, QRegExp& matchedRegExpr, const QStringList& parenthesesGroupList )
+{
+   QString key;
+   for ( QStringList::iterator keyIt = keyOrderList.begin(); keyIt!=keyOrderList.end(); ++keyIt )
+   {
+      if ( (*keyIt).isEmpty() )
+         continue;
+      bool bOk=false;
+      int groupIdx = (*keyIt).toInt(&bOk);
+      if (!bOk || groupIdx<0 || groupIdx >(int)parenthesesGroupList.size() )
+         continue;
+      QString s = matchedRegExpr.cap( groupIdx );
+      if ( groupIdx == 0 )
+      {
+         key += s + " ";
+         continue;
+      }
+
+      QString groupRegExp = parenthesesGroupList[groupIdx-1];
+      if( groupRegExp.indexOf('|')<0 || groupRegExp.indexOf('(')>=0 )
+      {
+         bool bOk = false;
+         int i = s.toInt( &bOk );
+         if ( bOk && i>=0 && i<10000 )
+            s.sprintf("%04d", i);  // This should help for correct sorting of numbers.
+         key += s + " ";
+      }
+      else
+      {
+         // Assume that the groupRegExp consists of something like "Jan|Feb|Mar|Apr"
+         // s is the string that managed to match.
+         // Now we want to know at which position it occurred. e.g. Jan=0, Feb=1, Mar=2, etc.
+         QStringList sl = groupRegExp.split( '|' );
+         int idx = sl.indexOf( s );
+         if (idx<0)
+         {
+            // Didn't match
+         }
+         else
+         {
+            QString sIdx;
+            sIdx.sprintf("%02d", idx+1 ); // Up to 99 words in the groupRegExp (more than 12 aren't expected)
+            key += sIdx + " ";
+         }
+      }
+   }
+   return key;
+}
+
+QString calcHistorySortKey( const QString& keyOrder, QRegExp& matchedRegExpr, const QStringList& parenthesesGroupList )
+{
+   return calcHistorySortKey( keyOrder.split(','), matchedRegExpr, parenthesesGroupList );
+}
+
+MergeEngine::HistoryRegExps::HistoryRegExps( Options* pOptions )
+: historyStart( pOptions->m_historyStartRegExp ),
+  newHistoryEntry( pOptions->m_historyEntryStartRegExp ),
+  keyOrderList( pOptions->m_historyEntryStartSortKeyOrder.split(',') )
+{
+   findParenthesesGroups( pOptions->m_historyEntryStartRegExp, parenthesesGroups );
+   bUseRegExp = !pOptions->m_historyEntryStartRegExp.isEmpty();
+}
+
+// Moves the lines of one entry into the entry with the key, that is created if it doesn't exist yet.
+void MergeEngine::addHistoryEntry( int src, const QString& key, MergeEditLineList& melList,
+   HistoryMap& historyMap, HistoryList& historyList, HistoryList::iterator itHistoryListFront )
+{
+   HistoryMap::iterator it = historyMap.find( key );
+   if ( it==historyMap.end() )
+   {
+      // New entries of this input go before the entries found in the previous inputs.
+      HistoryList::iterator itEntry = historyList.insert( itHistoryListFront, HistoryMapEntry() );
+      itEntry->key = key;
+      it = historyMap.insert( key, itEntry );
+   }
+   HistoryMapEntry& hme = *it.value();
+   if ( src==A ) hme.mellA.swap( melList );
+   if ( src==B ) hme.mellB.swap( melList );
+   if ( src==C ) hme.mellC.swap( melList );
+   melList.clear(); // Drops the lines of an earlier entry with the same key.
+}
+
+void MergeEngine::collectHistoryInformation(
+   int src, Diff3LineList::const_iterator iHistoryBegin, Diff3LineList::const_iterator iHistoryEnd,
+   HistoryRegExps& regExps, HistoryMap& historyMap, HistoryList& historyList
+   )
+{
+   HistoryList::iterator itHistoryListFront = historyList.begin();
+   Diff3LineList::const_iterator id3l = iHistoryBegin;
+   QString historyLead;
+   {
+      const LineData* pld = id3l->getLineData( src, m_pDiffBufferInfo );
+      QString s( pld->getLine(), pld->size() );
+      historyLead = calcHistoryLead(s);
+   }
+   if ( id3l == iHistoryEnd )
+      return;
+   ++id3l; // Skip line with "$Log ... $"
+   QString key;
+   MergeEditLineList melList;
+   bool bPrevLineIsEmpty = true;
+   for(; id3l != iHistoryEnd; ++id3l )
+   {
+      const LineData* pld = id3l->getLineData( src, m_pDiffBufferInfo );
+      if ( !pld ) continue;
+      QString s = QString::fromRawData( pld->getLine(), pld->size() );
+      QString sLine = s.mid(historyLead.length());
+      bool bLineIsEmpty = sLine.trimmed().isEmpty();
+      if ( ( !regExps.bUseRegExp && !bLineIsEmpty && bPrevLineIsEmpty )
+           || (regExps.bUseRegExp && regExps.newHistoryEntry.exactMatch( sLine ) )
+         )
+      {
+         if ( !key.isEmpty() && !melList.empty() )
+            addHistoryEntry( src, key, melList, historyMap, historyList, itHistoryListFront );
+
+         if ( ! regExps.bUseRegExp )
+            key = sLine;
+         else
+            key = calcHistorySortKey( regExps.keyOrderList, regExps.newHistoryEntry, regExps.parenthesesGroups );
+
+         melList.clear();
+         melList.push_back( MergeEditLine(id3l,src) );
+      }
+      else if ( ! regExps.historyStart.exactMatch( s ) )
+      {
+         melList.push_back( MergeEditLine(id3l,src) );
+      }
+
+      bPrevLineIsEmpty = bLineIsEmpty;
+   }
+   if ( !key.isEmpty() )
+      addHistoryEntry( src, key, melList, historyMap, historyList, itHistoryListFront );
+   // End of the history
+}
+
+bool MergeEngine::historyKeyLess( const HistoryMapEntry* p1, const HistoryMapEntry* p2 )
+{
+   return p1->key < p2->key;
+}
+
+MergeEngine::MergeEditLineList& MergeEngine::HistoryMapEntry::choice( bool bThreeInputs )
+{
+   if ( !bThreeInputs )
+      return mellA.empty() ? mellB : mellA;
+   else
+   {
+      if ( mellA.empty() )
+         return mellC.empty() ? mellB : mellC;       // A doesn't exist, return one that exists
+      else if ( ! mellB.empty() && ! mellC.empty() )
+      {                                              // A, B and C exist
+         return mellA;
+      }
+      else
+         return mellB.empty() ? mellB : mellC;       // A exists, return the one that doesn't exist
+   }
+}
+
+bool MergeEngine::HistoryMapEntry::staysInPlace( bool bThreeInputs, Diff3LineList::const_iterator& iHistoryEnd )
+{
+   // The entry should stay in place if the decision made by the automerger is correct.
+   Diff3LineList::const_iterator& iHistoryLast = iHistoryEnd;
+   --iHistoryLast;
+   if ( !bThreeInputs )
+   {
+      if ( !mellA.empty() && !mellB.empty() && mellA.begin()->id3l()==mellB.begin()->id3l() && 
+           mellA.back().id3l() == iHistoryLast && mellB.back().id3l() == iHistoryLast )
+      {
+         iHistoryEnd = mellA.begin()->id3l();
+         return true;
+      }
+      else
+      {
+         return false;
+      }
+   }
+   else
+   {
+      if ( !mellA.empty() && !mellB.empty() && !mellC.empty() 
+           && mellA.begin()->id3l()==mellB.begin()->id3l() && mellA.begin()->id3l()==mellC.begin()->id3l()
+           && mellA.back().id3l() == iHistoryLast && mellB.back().id3l() == iHistoryLast && mellC.back().id3l() == iHistoryLast )
+      {
+         iHistoryEnd = mellA.begin()->id3l();
+         return true;
+      }
+      else
+      {
+         return false;
+      }
+   }
+}
+
+MergeEngine::MergeLineList::iterator MergeEngine::mergeHistory()
+{
+   Diff3LineList::const_iterator iD3LHistoryBegin;
+   Diff3LineList::const_iterator iD3LHistoryEnd;
+   int d3lHistoryBeginLineIdx = -1;
+   int d3lHistoryEndLineIdx = -1;
+
+   StageTrace trace("mergeHistory");
+   clearUndo();
+   HistoryRegExps regExps( m_pOptions );
+
+   // Search for history start, history end in the diff3LineList
+   findHistoryRange( regExps.historyStart, m_pldC!=0, m_pDiff3LineList, m_pDiffBufferInfo, iD3LHistoryBegin, iD3LHistoryEnd, d3lHistoryBeginLineIdx, d3lHistoryEndLineIdx );
+
+   if (  iD3LHistoryBegin != m_pDiff3LineList->end() )
+   {
+      // Now collect the history entries. The map is only needed to find the entries by key.
+      HistoryList historyList;
+      {
+         HistoryMap historyMap;
+         collectHistoryInformation( A, iD3LHistoryBegin, iD3LHistoryEnd, regExps, historyMap, historyList );
+         collectHistoryInformation( B, iD3LHistoryBegin, iD3LHistoryEnd, regExps, historyMap, historyList );
+         if ( m_pldC!=0 )
+            collectHistoryInformation( C, iD3LHistoryBegin, iD3LHistoryEnd, regExps, historyMap, historyList );
+      }
+
+      Diff3LineList::const_iterator iD3LHistoryOrigEnd = iD3LHistoryEnd;
+
+      bool bHistoryMergeSorting = m_pOptions->m_bHistoryMergeSorting  && ! m_pOptions->m_historyEntryStartSortKeyOrder.isEmpty() && 
+                                  ! m_pOptions->m_historyEntryStartRegExp.isEmpty();
+
+      // Sorting by key is only needed once, after all entries were collected.
+      std::vector<HistoryMapEntry*> sortedEntries;
+      int sortedBegin = 0;
+      if ( bHistoryMergeSorting )
+      {
+         sortedEntries.reserve( historyList.size() );
+         for ( HistoryList::iterator hlit = historyList.begin(); hlit != historyList.end(); ++hlit )
+            sortedEntries.push_back( &*hlit );
+         std::sort( sortedEntries.begin(), sortedEntries.end(), historyKeyLess );
+      }
+
+      if ( m_pOptions->m_maxNofHistoryEntries==-1 )
+      {
+         // Remove the entries that stay in place
+         if ( bHistoryMergeSorting )
+         {
+            while ( sortedBegin < (int)sortedEntries.size() && sortedEntries[sortedBegin]->staysInPlace( m_pldC!=0, iD3LHistoryEnd ) )
+               ++sortedBegin;
+         }
+         else
+         {
+            while ( ! historyList.empty() && historyList.back().staysInPlace( m_pldC!=0, iD3LHistoryEnd ) )
+               historyList.pop_back();
+         }
+         while (iD3LHistoryOrigEnd != iD3LHistoryEnd)
+         {
+            --iD3LHistoryOrigEnd;
+            --d3lHistoryEndLineIdx;
+         }
+      }
+
+      MergeLineList::iterator iMLLStart = splitAtDiff3LineIdx(d3lHistoryBeginLineIdx);
+      MergeLineList::iterator iMLLEnd   = splitAtDiff3LineIdx(d3lHistoryEndLineIdx);
+      // Now join all MergeLines in the history
+      MergeLineList::iterator i = iMLLStart;
+      if ( i != iMLLEnd )
+      {
+         ++i;
+         while ( i!=iMLLEnd )
+         {
+            iMLLStart->join(*i);
+            i = m_mergeLineList.erase( i );
+         }
+      }
+      iMLLStart->mergeEditLineList.clear();
+      // Now insert the complete history into the first MergeLine of the history
+      iMLLStart->mergeEditLineList.push_back( MergeEditLine( iD3LHistoryBegin, m_pldC == 0 ? B : C ) );
+      QString lead = calcHistoryLead( iD3LHistoryBegin->getString( A, m_pDiffBufferInfo ) );
+      MergeEditLine mel( m_pDiff3LineList->end() );
+      mel.setString( lead );
+      iMLLStart->mergeEditLineList.push_back(mel);
+
+      int historyCount = 0;
+      if ( bHistoryMergeSorting )
+      {
+         // Create a sorted history
+         for ( int j = (int)sortedEntries.size()-1; j >= sortedBegin; --j )
+         {
+            if ( historyCount==m_pOptions->m_maxNofHistoryEntries )
+               break;
+            ++historyCount;
+            HistoryMapEntry& hme = *sortedEntries[j];
+            MergeEditLineList& mell = hme.choice(m_pldC!=0);
+            if (!mell.empty())
+               iMLLStart->mergeEditLineList.splice( iMLLStart->mergeEditLineList.end(), mell, mell.begin(), mell.end() );
+         }
+      }
+      else
+      {
+         // Create history in order of appearance
+         HistoryList::iterator hlit;
+         for ( hlit = historyList.begin(); hlit != historyList.end(); ++hlit )
+         {
+            if ( historyCount==m_pOptions->m_maxNofHistoryEntries )
+               break;
+            ++historyCount;
+            HistoryMapEntry& hme = *hlit;
+            MergeEditLineList& mell = hme.choice(m_pldC!=0);
+            if (!mell.empty())
+               iMLLStart->mergeEditLineList.splice( iMLLStart->mergeEditLineList.end(), mell, mell.begin(), mell.end() );
+         }
+         // If the end of start is empty and the first line at the end is empty remove the last line of start
+         if ( !iMLLStart->mergeEditLineList.empty() && !iMLLEnd->mergeEditLineList.empty() )
+         {
+            QString lastLineOfStart = iMLLStart->mergeEditLineList.back().getString(this);
+            QString firstLineOfEnd = iMLLEnd->mergeEditLineList.front().getString(this);
+            if ( lastLineOfStart.mid(lead.length()).trimmed().isEmpty() && firstLineOfEnd.mid(lead.length()).trimmed().isEmpty() )
+               iMLLStart->mergeEditLineList.pop_back();
+         }
+      }
+      return iMLLStart;
+   }
+   return m_mergeLineList.end();
+}
+
+// Matches the lines without copying them into QStrings (as Diff3Line::getString() would).
+static bool exactMatchLine( QRegExp& regExp, const Diff3Line& d3l, int src, const DiffBufferInfo* pDiffBufferInfo )
+{
+   const LineData* pld = d3l.getLineData( src, pDiffBufferInfo );
+   if ( pld==0 )
+      return regExp.exactMatch( QString() );
+   return regExp.exactMatch( QString::fromRawData( pld->getLine(), pld->size() ) );
+}
+
+static void matchRegExpLines( const QString& pattern, const std::vector<const Diff3Line*>& lines,
+   int begin, int end, bool bThreeInputs, const DiffBufferInfo* pDiffBufferInfo, std::vector<char>& matches )
+{
+   QRegExp regExp( pattern ); // Each thread needs its own QRegExp.
+   for( int j=begin; j<end; ++j )
+   {
+      const Diff3Line& d3l = *lines[j];
+      matches[j] = exactMatchLine( regExp, d3l, A, pDiffBufferInfo ) && exactMatchLine( regExp, d3l, B, pDiffBufferInfo ) &&
+                   ( !bThreeInputs || exactMatchLine( regExp, d3l, C, pDiffBufferInfo ) );
+   }
+}
+
+// Only reads the line data, that doesn't change during the merge.
+class RegExpMatchThread : public QThread
+{
+public:
+   RegExpMatchThread( const QString& pattern, const std::vector<const Diff3Line*>& lines,
+      int begin, int end, bool bThreeInputs, const DiffBufferInfo* pDiffBufferInfo, std::vector<char>& matches )
+   : m_pattern( pattern ), m_lines( lines ), m_begin( begin ), m_end( end ),
+     m_bThreeInputs( bThreeInputs ), m_pDiffBufferInfo( pDiffBufferInfo ), m_matches( matches )
+   {
+   }
+   virtual void run()
+   {
+      matchRegExpLines( m_pattern, m_lines, m_begin, m_end, m_bThreeInputs, m_pDiffBufferInfo, m_matches );
+   }
+private:
+   QString m_pattern;
+   const std::vector<const Diff3Line*>& m_lines;
+   int m_begin;
+   int m_end;
+   bool m_bThreeInputs;
+   const DiffBufferInfo* m_pDiffBufferInfo;
+   std::vector<char>& m_matches;
+};
+
+void MergeEngine::regExpAutoMerge()
+{
+   if ( m_pOptions->m_autoMergeRegExp.isEmpty() )
+      return;
+
+   StageTrace trace("regExpAutoMerge");
+   clearUndo();
+
+   // Collect the lines of all conflicts and match them in parallel.
+   std::vector<const Diff3Line*> lines;
+   MergeLineList::iterator i;
+   for ( i=m_mergeLineList.begin(); i!=m_mergeLineList.end(); ++i )
+   {
+      if ( i->bConflict )
+      {
+         Diff3LineList::const_iterator id3l = i->id3l;
+         for( int j=0; j<i->srcRangeLength; ++j, ++id3l )
+            lines.push_back( &*id3l );
+      }
+   }
+
+   std::vector<char> matches( lines.size(), 0 );
+   int nofLines = lines.size();
+   int nofThreads = min2( max2( 1, QThread::idealThreadCount() ), nofLines/1000 + 1 );
+   if ( nofThreads<=1 )
+   {
+      matchRegExpLines( m_pOptions->m_autoMergeRegExp, lines, 0, nofLines, m_pldC!=0, m_pDiffBufferInfo, matches );
+   }
+   else
+   {
+      std::vector<RegExpMatchThread*> threads;
+      for( int t=0; t<nofThreads; ++t )
+      {
+         threads.push_back( new RegExpMatchThread( m_pOptions->m_autoMergeRegExp, lines,
+            nofLines * t / nofThreads, nofLines * (t+1) / nofThreads, m_pldC!=0, m_pDiffBufferInfo, matches ) );
+         threads.back()->start();
+      }
+      for( int t=0; t<nofThreads; ++t )
+      {
+         threads[t]->wait();
+         delete threads[t];
+      }
+   }
+
+   // As before, the leading matching lines of each conflict are solved, each
+   // becoming its own MergeLine. The splits happen here in one pass.
+   int lineIdx = 0;
+   for ( i=m_mergeLineList.begin(); i!=m_mergeLineList.end(); ++i )
+   {
+      if ( i->bConflict )
+      {
+         int endIdx = lineIdx + i->srcRangeLength;
+         for( ; lineIdx<endIdx && matches[lineIdx]; ++lineIdx )
+         {
+            MergeEditLine& mel = *i->mergeEditLineList.begin();
+            mel.setSource( m_pldC==0 ? B : C, false );
+            if ( i->srcRangeLength > 1 )
+            {
+               MergeLine newML;
+               i->split( newML, i->d3lLineIdx+1 );
+               MergeLineList::iterator iNext = i;
+               ++iNext;
+               i = m_mergeLineList.insert( iNext, newML );
+            }
+         }
+         lineIdx = endIdx;
+      }
+   }
+}
+
+// This doesn't detect user modifications and should only be called after automatic merge
+// This will only do something for three file merge.
+// Irrelevant changes are those where all contributions from B are already contained in C.
+// Also irrelevant are conflicts automatically solved (automerge regexp and history automerge)
+// Precondition: The VCS-keyword would also be C.
+bool MergeEngine::doRelevantChangesExist()
+{
+   if ( m_pldC==0 || m_mergeLineList.size() <= 1 )
+      return true;
+
+   MergeLineList::iterator i;
+   for ( i=m_mergeLineList.begin(); i!=m_mergeLineList.end(); ++i )
+   {
+      if ( ( i->bConflict && i->mergeEditLineList.begin()->src()!=C )
+         || i->srcSelect == B )
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+// Returns the iterator to the MergeLine after the split
+MergeEngine::MergeLineList::iterator MergeEngine::splitAtDiff3LineIdx( int d3lLineIdx )
+{
+   MergeLineList::iterator i;
+   for ( i = m_mergeLineList.begin();  i!=m_mergeLineList.end(); ++i )
+   {
+      if ( i->d3lLineIdx==d3lLineIdx )
+      {
+         // No split needed, this is the beginning of a MergeLine
+         return i;
+      }
+      else if ( i->d3lLineIdx > d3lLineIdx )
+      {
+         // The split must be in the previous MergeLine
+         --i;
+         MergeLine& ml = *i;
+         MergeLine newML;
+         ml.split(newML,d3lLineIdx);
+         ++i;
+         return m_mergeLineList.insert( i, newML );
+      }
+   }
+   // The split must be in the previous MergeLine
+   --i;
+   MergeLine& ml = *i;
+   MergeLine newML;
+   ml.split(newML,d3lLineIdx);
+   ++i;
+   return m_mergeLineList.insert( i, newML );
+}
+
+MergeEngine::MergeLineList::iterator MergeEngine::joinDiffs( int firstD3lLineIdx, int lastD3lLineIdx )
+{
+   MergeLineList::iterator i;
+   MergeLineList::iterator iMLLStart = m_mergeLineList.end();
+   MergeLineList::iterator iMLLEnd   = m_mergeLineList.end();
+   for ( i=m_mergeLineList.begin(); i!=m_mergeLineList.end(); ++i )
+   {
+      MergeLine& ml = *i;
+      if ( firstD3lLineIdx >= ml.d3lLineIdx && firstD3lLineIdx < ml.d3lLineIdx + ml.srcRangeLength )
+      {
+         iMLLStart = i;
+      }
+      if ( lastD3lLineIdx >= ml.d3lLineIdx && lastD3lLineIdx < ml.d3lLineIdx + ml.srcRangeLength )
+      {
+         iMLLEnd = i;
+         ++iMLLEnd;
+         break;
+      }
+   }
+
+   bool bJoined = false;
+   for( i=iMLLStart;  i!=iMLLEnd && i!=m_mergeLineList.end(); )
+   {
+      if ( i==iMLLStart )
+      {
+         ++i;
+      }
+      else
+      {
+         iMLLStart->join(*i);
+         i = m_mergeLineList.erase( i );
+         bJoined = true;
+      }
+   }
+   if (bJoined)
+   {
+      iMLLStart->mergeEditLineList.clear();
+      // Insert a conflict line as placeholder
+      iMLLStart->mergeEditLineList.push_back( MergeEditLine( iMLLStart->id3l ) );
+   }
+   return iMLLStart;
+}
+
+MergeEngine::UndoStep::UndoStep()
+{
+   d3lBegin = -1;
+   d3lEnd = -1;
+   cursorLineBefore = 0;
+   cursorPosBefore = 0;
+   cursorLineAfter = 0;
+   cursorPosAfter = 0;
+}
+
+void MergeEngine::UndoStep::swap( UndoStep& step )
+{
+   parts.swap( step.parts );
+   std::swap( d3lBegin, step.d3lBegin );
+   std::swap( d3lEnd, step.d3lEnd );
+   linesBefore.swap( step.linesBefore );
+   linesAfter.swap( step.linesAfter );
+   std::swap( cursorLineBefore, step.cursorLineBefore );
+   std::swap( cursorPosBefore, step.cursorPosBefore );
+   std::swap( cursorLineAfter, step.cursorLineAfter );
+   std::swap( cursorPosAfter, step.cursorPosAfter );
+}
+
+// Returns false for a nested call.
+bool MergeEngine::openUndoStep( int cursorLine, int cursorPos )
+{
+   ++m_undoDepth;
+   if ( m_undoDepth>1 )
+      return false;
+   m_openUndoStep.cursorLineBefore = cursorLine;
+   m_openUndoStep.cursorPosBefore = cursorPos;
+   return true;
+}
+
+void MergeEngine::addUndoPart( MergeLineList::iterator mlIt, MergeEditLineList::iterator melIt, int melIdx, int nofLines )
+{
+   m_openUndoStep.parts.push_back( UndoPart() );
+   UndoPart& part = m_openUndoStep.parts.back();
+   part.d3lLineIdx = mlIt->d3lLineIdx;
+   part.melBegin = melIdx;
+   part.tailSize = mlIt->mergeEditLineList.size() - melIdx - nofLines;
+   part.before.reserve( nofLines );
+   for( int i=0; i<nofLines; ++i, ++melIt )
+      part.before.push_back( *melIt );
+   m_openUndoPartIts.push_back( mlIt );
+}
+
+void MergeEngine::beginUndoStep( int firstLine, int lastLine, int cursorLine, int cursorPos )
+{
+   if ( !openUndoStep( cursorLine, cursorPos ) )
+      return;
+
+   firstLine = max2( firstLine, 0 );
+   lastLine = min2( lastLine, m_totalSize.m_size-1 );
+   if ( firstLine>lastLine )
+      return;
+
+   MergeLineList::iterator mlIt;
+   MergeEditLineList::iterator melIt;
+   calcIteratorFromLineNr( firstLine, mlIt, melIt );
+   int melIdx = 0;
+   for( MergeEditLineList::iterator i = mlIt->mergeEditLineList.begin(); i!=melIt; ++i )
+      ++melIdx;
+
+   int line = firstLine;
+   for(;;)
+   {
+      int nofLines = min2( lastLine+1-line, mlIt->mergeEditLineList.size()-melIdx );
+      addUndoPart( mlIt, melIt, melIdx, nofLines );
+      line += nofLines;
+      ++mlIt;
+      if ( line>lastLine || mlIt==m_mergeLineList.end() )
+         break;
+      melIt = mlIt->mergeEditLineList.begin();
+      melIdx = 0;
+   }
+}
+
+void MergeEngine::beginUndoStepForMergeLine( MergeLineList::iterator mlIt, int cursorLine, int cursorPos )
+{
+   if ( openUndoStep( cursorLine, cursorPos ) && mlIt!=m_mergeLineList.end() )
+      addUndoPart( mlIt, mlIt->mergeEditLineList.begin(), 0, mlIt->mergeEditLineList.size() );
+}
+
+void MergeEngine::beginUndoStepForDiff3Lines( int firstD3lLineIdx, int lastD3lLineIdx, int cursorLine, int cursorPos )
+{
+   if ( !openUndoStep( cursorLine, cursorPos ) )
+      return;
+
+   // The range of the MergeLines that contain these lines.
+   MergeLineList::iterator i;
+   for( i=m_mergeLineList.begin(); i!=m_mergeLineList.end() && i->d3lLineIdx + i->srcRangeLength <= firstD3lLineIdx; ++i )
+      ;
+   if ( i==m_mergeLineList.end() )
+      return;
+   m_openUndoStep.d3lBegin = i->d3lLineIdx;
+   for( ; i!=m_mergeLineList.end() && i->d3lLineIdx <= lastD3lLineIdx; ++i )
+      m_openUndoStep.d3lEnd = i->d3lLineIdx + i->srcRangeLength;
+   saveMergeLines( m_openUndoStep.d3lBegin, m_openUndoStep.d3lEnd, m_openUndoStep.linesBefore );
+}
+
+void MergeEngine::endUndoStep( bool bChanged, int cursorLine, int cursorPos )
+{
+   if ( m_undoDepth==0 )
+      return;
+   --m_undoDepth;
+   if ( m_undoDepth>0 )
+      return;
+
+   if ( bChanged )
+   {
+      // Text edits don't change the MergeLines, so the iterators are still valid.
+      for( int i=0; i<(int)m_openUndoStep.parts.size(); ++i )
+      {
+         UndoPart& part = m_openUndoStep.parts[i];
+         MergeEditLineList& mell = m_openUndoPartIts[i]->mergeEditLineList;
+         MergeEditLineList::iterator melIt = mell.begin();
+         for( int j=0; j<part.melBegin; ++j )
+            ++melIt;
+         int nofLines = mell.size() - part.tailSize - part.melBegin;
+         part.after.reserve( nofLines );
+         for( int j=0; j<nofLines; ++j, ++melIt )
+            part.after.push_back( *melIt );
+      }
+      if ( m_openUndoStep.d3lBegin>=0 )
+         saveMergeLines( m_openUndoStep.d3lBegin, m_openUndoStep.d3lEnd, m_openUndoStep.linesAfter );
+      m_openUndoStep.cursorLineAfter = cursorLine;
+      m_openUndoStep.cursorPosAfter = cursorPos;
+
+      // A new step drops the steps that could be redone.
+      m_undoSteps.erase( m_undoSteps.begin() + m_undoPos, m_undoSteps.end() );
+      m_undoSteps.push_back( UndoStep() );
+      m_undoSteps.back().swap( m_openUndoStep );
+      ++m_undoPos;
+   }
+
+   m_openUndoStep = UndoStep();
+   m_openUndoPartIts.clear();
+}
+
+bool MergeEngine::undo( int& cursorLine, int& cursorPos )
+{
+   if ( !canUndo() )
+      return false;
+   --m_undoPos;
+   UndoStep& step = m_undoSteps[m_undoPos];
+   applyUndoStep( step, true );
+   cursorLine = step.cursorLineBefore;
+   cursorPos = step.cursorPosBefore;
+   return true;
+}
+
+bool MergeEngine::redo( int& cursorLine, int& cursorPos )
+{
+   if ( !canRedo() )
+      return false;
+   UndoStep& step = m_undoSteps[m_undoPos];
+   ++m_undoPos;
+   applyUndoStep( step, false );
+   cursorLine = step.cursorLineAfter;
+   cursorPos = step.cursorPosAfter;
+   return true;
+}
+
+void MergeEngine::clearUndo()
+{
+   m_undoSteps.clear();
+   m_undoPos = 0;
+}
+
+// Copies the MergeLines of [d3lBegin,d3lEnd). The copies aren't counted in m_totalSize.
+void MergeEngine::saveMergeLines( int d3lBegin, int d3lEnd, MergeLineList& lines )
+{
+   for( MergeLineList::iterator i = findMergeLine( d3lBegin ); i!=m_mergeLineList.end() && i->d3lLineIdx < d3lEnd; ++i )
+   {
+      lines.push_back( *i );
+      lines.back().mergeEditLineList.detachTotalSize();
+   }
+}
+
+MergeEngine::MergeLineList::iterator MergeEngine::findMergeLine( int d3lLineIdx )
+{
+   MergeLineList::iterator i;
+   for( i=m_mergeLineList.begin(); i!=m_mergeLineList.end(); ++i )
+   {
+      if ( i->d3lLineIdx==d3lLineIdx )
+         break;
+   }
+   return i;
+}
+
+void MergeEngine::applyUndoStep( UndoStep& step, bool bUndo )
+{
+   if ( step.d3lBegin>=0 )
+   {
+      MergeLineList::iterator i = findMergeLine( step.d3lBegin );
+      while ( i!=m_mergeLineList.end() && i->d3lLineIdx < step.d3lEnd )
+      {
+         i->mergeEditLineList.clear(); // Removes the lines from m_totalSize
+         i = m_mergeLineList.erase( i );
+      }
+      MergeLineList& lines = bUndo ? step.linesBefore : step.linesAfter;
+      for( MergeLineList::iterator j = lines.begin(); j!=lines.end(); ++j )
+      {
+         MergeLineList::iterator k = m_mergeLineList.insert( i, *j );
+         k->mergeEditLineList.setTotalSizePtr( &m_totalSize );
+      }
+   }
+
+   for( int i=0; i<(int)step.parts.size(); ++i )
+   {
+      UndoPart& part = step.parts[i];
+      MergeLineList::iterator mlIt = findMergeLine( part.d3lLineIdx );
+      if ( mlIt==m_mergeLineList.end() )
+      {
+         assert(false);
+         continue;
+      }
+      MergeEditLineList& mell = mlIt->mergeEditLineList;
+      MergeEditLineList::iterator melIt = mell.begin();
+      for( int j=0; j<part.melBegin; ++j )
+         ++melIt;
+      int nofLines = mell.size() - part.tailSize - part.melBegin;
+      for( int j=0; j<nofLines; ++j )
+         melIt = mell.erase( melIt );
+      std::vector<MergeEditLine>& mels = bUndo ? part.before : part.after;
+      for( int j=0; j<(int)mels.size(); ++j )
+         mell.insert( melIt, mels[j] );
+   }
+}
+
+void MergeEngine::updateLineIndex()
+{
+   m_lineIndex.clear();
+   m_lineIndex.reserve( m_totalSize.m_size / c_lineIndexStep + 1 );
+   m_mergeLineStarts.clear();
+   int line = 0;
+   for( MergeLineList::iterator mlIt = m_mergeLineList.begin(); mlIt!=m_mergeLineList.end(); ++mlIt )
+   {
+      MergeLineStart s;
+      s.mlIt = mlIt;
+      s.firstLine = line;
+      m_mergeLineStarts.push_back( s );
+
+      MergeEditLineList& mell = mlIt->mergeEditLineList;
+      for( MergeEditLineList::iterator melIt = mell.begin(); melIt!=mell.end(); ++melIt, ++line )
+      {
+         if ( line % c_lineIndexStep == 0 )
+         {
+            LineIndexEntry e;
+            e.mlIt = mlIt;
+            e.melIt = melIt;
+            m_lineIndex.push_back( e );
+         }
+      }
+   }
+   m_lineIndexGeneration = m_totalSize.m_generation;
+}
+
+void MergeEngine::calcIteratorFromLineNr( int line, MergeLineList::iterator& mlIt, MergeEditLineList::iterator& melIt )
+{
+   if ( m_lineIndexGeneration != m_totalSize.m_generation )
+      updateLineIndex();
+
+   if ( line<0 || line>=m_totalSize.m_size )
+   {
+      assert(false);
+      mlIt = m_mergeLineList.end();
+      return;
+   }
+
+   const LineIndexEntry& e = m_lineIndex[ line / c_lineIndexStep ];
+   mlIt = e.mlIt;
+   melIt = e.melIt;
+   for( int i = line % c_lineIndexStep; i>0; --i )
+   {
+      ++melIt;
+      while ( melIt == mlIt->mergeEditLineList.end() )
+      {
+         ++mlIt;
+         melIt = mlIt->mergeEditLineList.begin();
+      }
+   }
+}
+
+// Returns the position in m_mergeLineStarts of the MergeLine that contains d3lLineIdx or -1.
+int MergeEngine::findMergeLineStart( int d3lLineIdx )
+{
+   if ( m_lineIndexGeneration != m_totalSize.m_generation )
+      updateLineIndex();
+
+   if ( m_mergeLineStarts.empty() || d3lLineIdx < m_mergeLineStarts[0].mlIt->d3lLineIdx )
+      return -1;
+
+   // The last MergeLine that starts at or before d3lLineIdx
+   int lo = 0;
+   int hi = (int)m_mergeLineStarts.size() - 1;
+   while ( lo < hi )
+   {
+      int mid = (lo + hi + 1) / 2;
+      if ( m_mergeLineStarts[mid].mlIt->d3lLineIdx <= d3lLineIdx )
+         lo = mid;
+      else
+         hi = mid - 1;
+   }
+   const MergeLine& ml = *m_mergeLineStarts[lo].mlIt;
+   return d3lLineIdx < ml.d3lLineIdx + ml.srcRangeLength ? lo : -1;
+}
+
+int MergeEngine::getFirstLineOfMergeLine( MergeLineList::iterator mlIt )
+{
+   if ( mlIt==m_mergeLineList.end() )
+      return m_totalSize.m_size;
+   int idx = findMergeLineStart( mlIt->d3lLineIdx );
+   assert( idx>=0 && m_mergeLineStarts[idx].mlIt==mlIt );
+   return idx>=0 ? m_mergeLineStarts[idx].firstLine : 0;
+}
+
+MergeEngine::MergeLineList::iterator MergeEngine::findMergeLineContaining( int d3lLineIdx )
+{
+   int idx = findMergeLineStart( d3lLineIdx );
+   return idx>=0 ? m_mergeLineStarts[idx].mlIt : m_mergeLineList.end();
+}
+
+const LineData* MergeEngine::MergeEditLine::getLineData( const MergeEngine* pEngine )
+{
+   if ( isRemoved() || isModified() || m_src == 0 )
+      return 0;
+
+   const Diff3Line& d3l = *m_id3l;
+   assert( m_src == A || m_src == B || m_src == C );
+   if      ( m_src == A && d3l.lineA!=-1 ) return &pEngine->m_pldA[ d3l.lineA ];
+   else if ( m_src == B && d3l.lineB!=-1 ) return &pEngine->m_pldB[ d3l.lineB ];
+   else if ( m_src == C && d3l.lineC!=-1 ) return &pEngine->m_pldC[ d3l.lineC ];
+   return 0; // This is no error.
+}
+
+QString MergeEngine::MergeEditLine::getString( const MergeEngine* pEngine )
+{
+   if ( isRemoved() )   { return QString(); }
+
+   if ( ! isModified() )
+   {
+      const LineData* pld = getLineData( pEngine );
+      if ( pld == 0 )
+         return QString();
+
+      return QString( pld->getLine(), pld->size() );
+   }
+   else
+   {
+      return m_str;
+   }
+}
+
+// Encodes text into a reused buffer that is written to the device whenever it is full.
+// UTF-8 and Latin-1 are encoded directly, other codecs a chunk at a time (the
+// ConverterState creates the byte order mark for UTF-16 once).
+class OutputEncoder
+{
+public:
+   OutputEncoder( QIODevice& dev, QTextCodec* pCodec )
+   : m_dev( dev ), m_pCodec( pCodec )
+   {
+      m_bufferPos = 0;
+      m_bError = false;
+      int mib = pCodec->mibEnum();
+      m_eMode = mib==106 ? eUtf8 : mib==4 ? eLatin1 : eCodec;
+      if ( m_eMode==eCodec )
+         m_text.reserve( c_chunkSize );
+      else
+         m_buffer.resize( c_chunkSize );
+   }
+
+   void add( const QChar* p, int size )
+   {
+      if ( m_eMode==eCodec )
+      {
+         m_text += QString::fromRawData( p, size );
+         if ( m_text.length() >= c_chunkSize )
+            encodeText();
+         return;
+      }
+
+      for( int i=0; i<size; ++i )
+      {
+         if ( m_bufferPos > c_chunkSize-4 )
+            writeBuffer();
+         char* d = &m_buffer[m_bufferPos];
+         uint c = p[i].unicode();
+         if ( m_eMode==eLatin1 )
+         {
+            *d++ = c<0x100 ? char(c) : '?';
+         }
+         else if ( c<0x80 )
+         {
+            *d++ = char(c);
+         }
+         else if ( c<0x800 )
+         {
+            *d++ = char(0xc0 | (c>>6));
+            *d++ = char(0x80 | (c&0x3f));
+         }
+         else
+         {
+            if ( p[i].isHighSurrogate() && i+1<size && p[i+1].isLowSurrogate() )
+            {
+               c = QChar::surrogateToUcs4( p[i], p[i+1] );
+               ++i;
+               *d++ = char(0xf0 | (c>>18));
+               *d++ = char(0x80 | ((c>>12)&0x3f));
+            }
+            else
+            {
+               if ( p[i].isHighSurrogate() || p[i].isLowSurrogate() )
+                  c = QChar::ReplacementCharacter;
+               *d++ = char(0xe0 | (c>>12));
+            }
+            *d++ = char(0x80 | ((c>>6)&0x3f));
+            *d++ = char(0x80 | (c&0x3f));
+         }
+         m_bufferPos = d - &m_buffer[0];
+      }
+   }
+
+   // Returns false if writing failed.
+   bool flush()
+   {
+      if ( m_eMode==eCodec )
+         encodeText();
+      else
+         writeBuffer();
+      return !m_bError;
+   }
+
+private:
+   enum { c_chunkSize = 1024*1024 };
+   enum e_Mode { eUtf8, eLatin1, eCodec };
+
+   void writeBuffer()
+   {
+      if ( m_bufferPos>0 && m_dev.write( &m_buffer[0], m_bufferPos ) != m_bufferPos )
+         m_bError = true;
+      m_bufferPos = 0;
+   }
+
+   void encodeText()
+   {
+      QByteArray bytes = m_pCodec->fromUnicode( m_text.constData(), m_text.length(), &m_state );
+      if ( !bytes.isEmpty() && m_dev.write( bytes ) != bytes.size() )
+         m_bError = true;
+      m_text.resize( 0 ); // Keeps the reserved capacity
+   }
+
+   QIODevice& m_dev;
+   QTextCodec* m_pCodec;
+   e_Mode m_eMode;
+   std::vector<char> m_buffer;
+   int m_bufferPos;
+   QString m_text;
+   QTextCodec::ConverterState m_state;
+   bool m_bError;
+};
+
+bool MergeEngine::writeOutput( QIODevice& dev, QTextCodec* pEncoding, e_LineEndStyle eLineEndStyle, ProgressProxy* pProgress )
+{
+   static const QChar lineEndDos[2] = { QChar('\r'), QChar('\n') };
+   const QChar* pLineEnd = eLineEndStyle == eLineEndStyleDos ? lineEndDos : lineEndDos+1;
+   const int lineEndLength = eLineEndStyle == eLineEndStyleDos ? 2 : 1;
+
+   OutputEncoder encoder( dev, pEncoding );
+   int line = 0;
+   MergeLineList::iterator mlIt = m_mergeLineList.begin();
+   for(mlIt = m_mergeLineList.begin();mlIt!=m_mergeLineList.end(); ++mlIt)
+   {
+      MergeLine& ml = *mlIt;
+      MergeEditLineList::iterator melIt;
+      for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); ++melIt )
+      {
+         MergeEditLine& mel = *melIt;
+
+         if ( mel.isEditableText() )
+         {
+            if (line>0) // Line end before the line, but not for the first line
+               encoder.add( pLineEnd, lineEndLength );
+
+            // Unmodified lines are encoded directly from the input buffers.
+            const LineData* pld = mel.getLineData( this );
+            if ( pld!=0 )
+               encoder.add( pld->getLine(), pld->size() );
+            else if ( mel.isModified() )
+            {
+               QString str = mel.getString( this );
+               encoder.add( str.constData(), str.length() );
+            }
+
+            ++line;
+            if ( pProgress!=0 && line % 10000 == 0 )
+            {
+               pProgress->setCurrent( double(line) / max2( 1, m_totalSize.m_size ) );
+               if ( pProgress->wasCancelled() )
+                  return false;
+            }
+         }
+      }
+   }
+   return encoder.flush();
+}
+
+bool MergeEngine::getOutputData( QByteArray& dataArray, QTextCodec* pEncoding, e_LineEndStyle eLineEndStyle )
+{
+   if ( getNrOfUnsolvedConflicts()>0 || eLineEndStyle==eLineEndStyleConflict || eLineEndStyle==eLineEndStyleUndefined )
+      return false;
+
+   QBuffer buffer( &dataArray );
+   buffer.open( QIODevice::WriteOnly );
+   return writeOutput( buffer, pEncoding, eLineEndStyle );
+}
+
+// The permissions of a file created via QFile, these depend on the umask.
+static QFile::Permissions getNewFilePermissions()
+{
+   QFile::Permissions perms = QFile::ReadOwner | QFile::WriteOwner | QFile::ReadUser | QFile::WriteUser |
+                              QFile::ReadGroup | QFile::WriteGroup | QFile::ReadOther | QFile::WriteOther;
+#ifndef _WIN32
+   mode_t mask = ::umask( 0 );
+   ::umask( mask );
+   if ( mask & S_IWGRP ) perms &= ~QFile::WriteGroup;
+   if ( mask & S_IRGRP ) perms &= ~QFile::ReadGroup;
+   if ( mask & S_IWOTH ) perms &= ~QFile::WriteOther;
+   if ( mask & S_IROTH ) perms &= ~QFile::ReadOther;
+#endif
+   return perms;
+}
+
+/// Saves and returns true when successful.
+bool MergeEngine::saveDocument( const QString& fileName, QTextCodec* pEncoding, e_LineEndStyle eLineEndStyle, QString& errorText )
+{
+   StageTrace trace("saveDocument");
+   if ( getNrOfUnsolvedConflicts()>0 )
+   {
+      errorText = i18n("Not all conflicts are solved yet.\nFile not saved.\n");
+      return false;
+   }
+
+   if ( eLineEndStyle==eLineEndStyleConflict || eLineEndStyle==eLineEndStyleUndefined )
+   {
+      errorText = i18n("There is a line end style conflict. Please choose the line end style manually.\nFile not saved.\n");
+      return false;
+   }
+
+   FileAccess file( fileName, true /*bWantToWrite*/ );
+   bool bBackup = m_pOptions->m_bDmCreateBakFiles && file.exists();
+
+   if ( !file.isLocal() )
+   {
+      // Remote files are transferred as a whole.
+      QByteArray dataArray;
+      getOutputData( dataArray, pEncoding, eLineEndStyle );
+      if ( bBackup && !file.createBackup(".orig") )
+      {
+         errorText = file.getStatusText() + i18n("\n\nCreating backup failed. File not saved.");
+         return false;
+      }
+      if ( ! file.writeFile( dataArray.data(), dataArray.size() ) )
+      {
+         errorText = i18n("Error while writing.");
+         return false;
+      }
+      return true;
+   }
+
+   // Without a backup the target of a symbolic link is replaced, not the link.
+   // (The backup renames the link, as before.)
+   QString destName = file.absoluteFilePath();
+   QFileInfo destInfo( destName );
+   if ( !bBackup && destInfo.isSymLink() && !destInfo.canonicalFilePath().isEmpty() )
+      destName = destInfo.canonicalFilePath();
+
+   ProgressProxy pp;
+
+   // Write into a temporary file next to the destination, so that an error or a
+   // crash can't leave a partial file behind. If that's impossible (e.g. no write
+   // permission for the directory) write the destination directly.
+   // QTemporaryFile picks a name that doesn't exist yet, so no other file is overwritten.
+   QTemporaryFile tmpFile( destName + ".kdiff3tmp.XXXXXX" );
+   tmpFile.setAutoRemove( false ); // It replaces the destination below.
+   bool bUseTmpFile = tmpFile.open();
+   if ( bUseTmpFile )
+   {
+      bool bSuccess = writeOutput( tmpFile, pEncoding, eLineEndStyle, &pp );
+      tmpFile.close();
+      if ( !bSuccess || tmpFile.error()!=QFile::NoError )
+      {
+         tmpFile.remove();
+         errorText = i18n("Error while writing.");
+         return false;
+      }
+      // The temporary file is only accessible by the owner.
+      tmpFile.setPermissions( destInfo.exists() ? QFile::permissions( destName ) : getNewFilePermissions() );
+   }
+
+   if ( bBackup && !file.createBackup(".orig") )
+   {
+      if ( bUseTmpFile )
+         tmpFile.remove();
+      errorText = file.getStatusText() + i18n("\n\nCreating backup failed. File not saved.");
+      return false;
+   }
+
+   if ( bUseTmpFile )
+   {
+      if ( !FileAccess::replaceFile( tmpFile.fileName(), destName ) )
+      {
+         tmpFile.remove();
+         errorText = i18n("Error while writing.");
+         return false;
+      }
+      return true;
+   }
+
+   QFile destFile( destName );
+   bool bSuccess = destFile.open( QIODevice::WriteOnly | QIODevice::Truncate );
+   if ( bSuccess )
+   {
+      bSuccess = writeOutput( destFile, pEncoding, eLineEndStyle, &pp );
+      destFile.close();
+      bSuccess = bSuccess && destFile.error()==QFile::NoError;
+#ifndef _WIN32
+      if ( bSuccess && bBackup && file.isExecutable() )  // The old file was executable
+         destFile.setPermissions( destFile.permissions() | QFile::ExeUser );
+#endif
+   }
+   if ( ! bSuccess )
+   {
+      errorText = i18n("Error while writing.");
+      return false;
+   }
+   return true;
+}
+
+void MergeEngine::reportMemory( MemoryReport& report )
+{
+   // std::list nodes hold two pointers besides the value.
+   qint64 mergeLines = 0;
+   qint64 mergeEditLines = 0;
+   qint64 editedStrings = 0;
+   for( MergeLineList::iterator mlIt = m_mergeLineList.begin(); mlIt!=m_mergeLineList.end(); ++mlIt )
+   {
+      mergeLines += sizeof(MergeLine) + 2*sizeof(void*);
+      MergeEditLineList& mell = mlIt->mergeEditLineList;
+      for( MergeEditLineList::iterator melIt = mell.begin(); melIt!=mell.end(); ++melIt )
+      {
+         mergeEditLines += sizeof(MergeEditLine) + 2*sizeof(void*);
+         editedStrings += melIt->getStringMemory();
+      }
+   }
+   report.add( "MergeLineList", mergeLines );
+   report.add( "MergeEditLineList", mergeEditLines );
+   report.add( "MergeEditLineList edited strings", editedStrings );
+   report.add( "MergeEngine line index", qint64( m_lineIndex.capacity() ) * sizeof(LineIndexEntry)
+                                         + qint64( m_mergeLineStarts.capacity() ) * sizeof(MergeLineStart) );
+
+   // Without the strings, these are shared with the merge result.
+   qint64 undo = 0;
+   for( int i=0; i<(int)m_undoSteps.size(); ++i )
+   {
+      UndoStep& step = m_undoSteps[i];
+      undo += sizeof(UndoStep);
+      for( int j=0; j<(int)step.parts.size(); ++j )
+         undo += sizeof(UndoPart) + ( step.parts[j].before.capacity() + step.parts[j].after.capacity() ) * sizeof(MergeEditLine);
+      MergeLineList* pLists[2] = { &step.linesBefore, &step.linesAfter };
+      for( int j=0; j<2; ++j )
+      {
+         for( MergeLineList::iterator mlIt = pLists[j]->begin(); mlIt!=pLists[j]->end(); ++mlIt )
+            undo += sizeof(MergeLine) + 2*sizeof(void*) + mlIt->mergeEditLineList.size() * ( sizeof(MergeEditLine) + 2*sizeof(void*) );
+      }
+   }
+   report.add( "Undo journal", undo );
+}
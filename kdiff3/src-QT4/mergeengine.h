@@ -0,0 +1,426 @@
+/***************************************************************************
+                          mergeengine.h  -  description
+                             -------------------
+    copyright            : (C) 2002-2007 by Joachim Eibl
+    email                : joachim.eibl at gmx.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef MERGEENGINE_H
+#define MERGEENGINE_H
+
+#include "diff.h"
+
+#include <QHash>
+#include <QRegExp>
+#include <QStringList>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+
+class QTextCodec;
+class QIODevice;
+class ProgressProxy;
+
+enum e_MergeDetails
+{
+   eDefault,
+   eNoChange,
+   eBChanged,
+   eCChanged,
+   eBCChanged,         // conflict
+   eBCChangedAndEqual, // possible conflict
+   eBDeleted,
+   eCDeleted,
+   eBCDeleted,         // possible conflict
+
+   eBChanged_CDeleted, // conflict
+   eCChanged_BDeleted, // conflict
+   eBAdded,
+   eCAdded,
+   eBCAdded,           // conflict
+   eBCAddedAndEqual    // possible conflict
+};
+
+void mergeOneLine( const Diff3Line& d, e_MergeDetails& mergeDetails, bool& bConflict, bool& bLineRemoved, int& src, bool bTwoInputs );
+
+// Stores the result of mergeOneLine() in each Diff3Line. Call after fineDiff() or
+// fineDiffFlagsOnly(), MergeEngine::merge() and the Overview then only read it via getMergeDetails().
+void calcMergeDetails( Diff3LineList& d3ll, bool bTwoInputs );
+inline void getMergeDetails( const Diff3Line& d, e_MergeDetails& mergeDetails, bool& bConflict, bool& bLineRemoved, int& src )
+{
+   mergeDetails = (e_MergeDetails) d.mergeDetails;
+   bConflict = d.bMergeConflict;
+   bLineRemoved = d.bMergeLineRemoved;
+   src = d.mergeSrc;
+}
+
+enum e_MergeSrcSelector
+{
+   A=1,
+   B=2,
+   C=3
+};
+
+// The output line end style and encoding chosen by default for these inputs.
+e_LineEndStyle getDefaultLineEndStyle( Options* pOptions, e_LineEndStyle eLineEndStyleA, e_LineEndStyle eLineEndStyleB, e_LineEndStyle eLineEndStyleC );
+QTextCodec* getDefaultOutputEncoding( QTextCodec* pCodecForA, QTextCodec* pCodecForB, QTextCodec* pCodecForC );
+
+/** The merge result without any GUI: Calculated from the Diff3LineList
+    of up to three inputs. Automatic solving, history and regexp auto merge
+    and the creation of the output data happen here.
+    The MergeResultWindow only shows and edits it.
+*/
+class MergeEngine
+{
+public:
+   MergeEngine( Options* pOptions );
+
+   void init(
+      const LineData* pLineDataA, int sizeA,
+      const LineData* pLineDataB, int sizeB,
+      const LineData* pLineDataC, int sizeC,
+      const Diff3LineList* pDiff3LineList,
+      const DiffBufferInfo* pDiffBufferInfo,  // Data for line matching, used by the history and regexp merge
+      TotalDiffStatus* pTotalDiffStatus
+      );
+
+   void reset();
+
+   bool isThreeWay() const { return m_pldC!=0; }
+   const Diff3LineList* getDiff3LineList() const { return m_pDiff3LineList; }
+   const TotalDiffStatus* getTotalDiffStatus() const { return m_pTotalDiffStatus; }
+
+   class MergeEditLine
+   {
+   public:
+      MergeEditLine(Diff3LineList::const_iterator i, int src=0){m_id3l=i; m_src=src; m_bLineRemoved=false; }
+      void setConflict() { m_src=0; m_bLineRemoved=false; m_str=QString(); }
+      bool isConflict()  { return  m_src==0 && !m_bLineRemoved && m_str.isNull(); }
+      void setRemoved(int src=0)  { m_src=src; m_bLineRemoved=true; m_str=QString(); }
+      bool isRemoved()   { return m_bLineRemoved; }
+      bool isEditableText() { return !isConflict() && !isRemoved(); }
+      void setString( const QString& s ){ m_str=s; m_bLineRemoved=false; m_src=0; }
+      QString getString( const MergeEngine* );
+      const LineData* getLineData( const MergeEngine* );  // 0 if modified, removed or a conflict
+      bool isModified() { return ! m_str.isNull() ||  (m_bLineRemoved && m_src==0); }
+
+      void setSource( int src, bool bLineRemoved ) { m_src=src; m_bLineRemoved =bLineRemoved; }
+      int src() { return m_src; }
+      Diff3LineList::const_iterator id3l(){return m_id3l;}
+      int getStringMemory() { return m_str.capacity() * sizeof(QChar); }
+      // getString() is implemented as MergeEngine::getString()
+   private:
+      Diff3LineList::const_iterator m_id3l;
+      int m_src;         // 1, 2 or 3 for A, B or C respectively, or 0 when line is from neither source.
+      QString m_str;    // String when modified by user or null-string when orig data is used.
+      bool m_bLineRemoved;
+   };
+
+   // The number of lines of all MergeEditLineLists of the merge result. Each change of
+   // a list also increments the generation, which tells the line index that it is outdated.
+   struct TotalSize
+   {
+      TotalSize(){ m_size=0; m_generation=1; }
+      void add( int deltaSize ) { m_size+=deltaSize; ++m_generation; }
+      void clear() { m_size=0; ++m_generation; }
+      int m_size;
+      unsigned int m_generation;
+   };
+
+   class MergeEditLineList : private std::list<MergeEditLine>
+   { // I want to know the size immediately!
+   private:
+      typedef std::list<MergeEditLine> BASE;
+      int m_size;
+      TotalSize* m_pTotalSize;
+   public:
+      typedef std::list<MergeEditLine>::iterator iterator;
+      typedef std::list<MergeEditLine>::reverse_iterator reverse_iterator;
+      typedef std::list<MergeEditLine>::const_iterator const_iterator;
+      MergeEditLineList(){m_size=0; m_pTotalSize=0; }
+      void clear()                             { ds(-m_size); BASE::clear();          }
+      void push_back( const MergeEditLine& m)  { ds(+1); BASE::push_back(m);     }
+      void push_front( const MergeEditLine& m) { ds(+1); BASE::push_front(m);    }
+      void pop_back()                          { ds(-1); BASE::pop_back();    }
+      iterator erase( iterator i )             { ds(-1); return BASE::erase(i);  }
+      iterator insert( iterator i, const MergeEditLine& m ) { ds(+1); return BASE::insert(i,m); }
+      int size(){ if (!m_pTotalSize) m_size = (int) BASE::size(); return m_size; }
+      iterator begin(){return BASE::begin();}
+      iterator end(){return BASE::end();}
+      reverse_iterator rbegin(){return BASE::rbegin();}
+      reverse_iterator rend(){return BASE::rend();}
+      MergeEditLine& front(){return BASE::front();}
+      MergeEditLine& back(){return BASE::back();}
+      bool empty() { return m_size==0; }
+      void splice(iterator destPos, MergeEditLineList& srcList, iterator srcFirst, iterator srcLast)
+      {
+         TotalSize* pTotalSize = getTotalSizePtr() ? getTotalSizePtr() : srcList.getTotalSizePtr();
+         srcList.setTotalSizePtr(0); // Force size-recalc after splice, because splice doesn't handle size-tracking
+         setTotalSizePtr(0);
+         BASE::splice( destPos, srcList, srcFirst, srcLast );
+         srcList.setTotalSizePtr( pTotalSize );
+         setTotalSizePtr( pTotalSize );
+      }
+      void swap( MergeEditLineList& other ) // Only for lists that aren't counted in a TotalSize.
+      {
+         BASE::swap( other );
+         std::swap( m_size, other.m_size );
+      }
+
+      void setTotalSizePtr(TotalSize* pTotalSize)
+      {
+         if ( pTotalSize==0 && m_pTotalSize!=0 ) { m_pTotalSize->add( -size() ); }
+         else if ( pTotalSize!=0 && m_pTotalSize==0 ) { pTotalSize->add( size() ); }
+         m_pTotalSize = pTotalSize;
+      }
+      TotalSize* getTotalSizePtr()
+      {
+         return m_pTotalSize;
+      }
+      // For a copy that isn't part of the merge result: Stops counting it, without changing the total.
+      void detachTotalSize()
+      {
+         m_pTotalSize = 0;
+      }
+
+   private:
+      void ds(int deltaSize) 
+      {
+         m_size+=deltaSize; 
+         if (m_pTotalSize!=0)  m_pTotalSize->add( deltaSize );
+      }
+   };
+
+
+   friend class MergeEditLine;
+
+   struct MergeLine
+   {
+      MergeLine()
+      {
+         srcSelect=0; mergeDetails=eDefault; d3lLineIdx = -1; srcRangeLength=0;
+         bConflict=false; bDelta=false; bWhiteSpaceConflict=false;
+      }
+      Diff3LineList::const_iterator id3l;
+      int d3lLineIdx;  // Needed to show the correct window pos.
+      int srcRangeLength; // how many src-lines have this properties
+      e_MergeDetails mergeDetails;
+      bool bConflict;
+      bool bWhiteSpaceConflict;
+      bool bDelta;
+      int srcSelect;
+      MergeEditLineList mergeEditLineList;
+      void split( MergeLine& ml2, int d3lLineIdx2 ) // The caller must insert the ml2 after this ml in the m_mergeLineList
+      {
+         if ( d3lLineIdx2<d3lLineIdx || d3lLineIdx2 >= d3lLineIdx + srcRangeLength ) 
+            return; //Error
+         ml2.mergeDetails = mergeDetails;
+         ml2.bConflict = bConflict;
+         ml2.bWhiteSpaceConflict = bWhiteSpaceConflict;
+         ml2.bDelta = bDelta;
+         ml2.srcSelect = srcSelect;
+
+         ml2.d3lLineIdx = d3lLineIdx2;
+         ml2.srcRangeLength = srcRangeLength - (d3lLineIdx2-d3lLineIdx);
+         srcRangeLength = d3lLineIdx2-d3lLineIdx; // current MergeLine controls fewer lines
+         ml2.id3l = id3l;
+         for(int i=0; i<srcRangeLength; ++i)
+            ++ml2.id3l;
+
+         ml2.mergeEditLineList.clear();
+         // Search for best place to splice
+         for(MergeEditLineList::iterator i=mergeEditLineList.begin(); i!=mergeEditLineList.end();++i)
+         {
+            if (i->id3l()==ml2.id3l)
+            {
+               ml2.mergeEditLineList.splice( ml2.mergeEditLineList.begin(), mergeEditLineList, i, mergeEditLineList.end() );
+               return;
+            }
+         }
+         ml2.mergeEditLineList.setTotalSizePtr( mergeEditLineList.getTotalSizePtr() );
+         ml2.mergeEditLineList.push_back(MergeEditLine(ml2.id3l));
+      }
+      void join( MergeLine& ml2 ) // The caller must remove the ml2 from the m_mergeLineList after this call
+      {
+         srcRangeLength += ml2.srcRangeLength;
+         ml2.mergeEditLineList.clear();
+         mergeEditLineList.clear();
+         mergeEditLineList.push_back(MergeEditLine(id3l)); // Create a simple conflict
+         if ( ml2.bConflict ) bConflict = true;
+         if ( !ml2.bWhiteSpaceConflict ) bWhiteSpaceConflict = false;
+         if ( ml2.bDelta ) bDelta = true;
+      }
+   };
+
+   typedef std::list<MergeLine> MergeLineList;
+
+   MergeLineList& getMergeLineList() { return m_mergeLineList; }
+   int getTotalSize() const { return m_totalSize.m_size; } // number of lines in the merge result
+
+   // Finds the MergeEditLine of a line of the merge result. Uses an index of every
+   // c_lineIndexStep-th line, that is rebuilt after the lines were changed.
+   void calcIteratorFromLineNr( int line, MergeLineList::iterator& mlIt, MergeEditLineList::iterator& melIt );
+   // Returns the line of the merge result where the MergeLine starts. Binary search in the same index.
+   int getFirstLineOfMergeLine( MergeLineList::iterator mlIt );
+   // Returns the MergeLine that contains the diff3 line d3lLineIdx or end(). Binary search in the same index.
+   MergeLineList::iterator findMergeLineContaining( int d3lLineIdx );
+
+   // bConflictsOnly: automatically choose for conflicts only (true) or for everywhere (false)
+   void merge( bool bAutoSolve, int defaultSelector, bool bConflictsOnly=false, bool bWhiteSpaceOnly=false );
+   void choose( MergeLineList::iterator mlIt, int selector );
+   // Returns the first MergeLine of the merged history or end() if there was no history.
+   MergeLineList::iterator mergeHistory();
+   void regExpAutoMerge();
+   bool doRelevantChangesExist();
+   int getNrOfUnsolvedConflicts( int* pNrOfWhiteSpaceConflicts=0 );
+
+   // Returns the iterator to the MergeLine after the split
+   MergeLineList::iterator splitAtDiff3LineIdx( int d3lLineIdx );
+   // Returns the joined MergeLine
+   MergeLineList::iterator joinDiffs( int firstD3lLineIdx, int lastD3lLineIdx );
+
+   /** Undo and redo of the edits of the merge result. An edit calls a beginUndoStep*()
+       function for the part it is going to change, changes it and then calls endUndoStep().
+       Nested calls belong to the outermost step. A step only keeps copies of the changed
+       MergeEditLines (text edits, choose()) or MergeLines (split, join), whose strings are
+       shared with the merge result. Changes of the whole merge result clear the journal.
+       The cursor positions are only stored for the caller.
+   */
+   void beginUndoStep( int firstLine, int lastLine, int cursorLine, int cursorPos ); // The lines [firstLine,lastLine]
+   void beginUndoStepForMergeLine( MergeLineList::iterator mlIt, int cursorLine, int cursorPos );
+   void beginUndoStepForDiff3Lines( int firstD3lLineIdx, int lastD3lLineIdx, int cursorLine, int cursorPos );
+   bool isInUndoStep() const { return m_undoDepth>0; }
+   // Drops the step if !bChanged.
+   void endUndoStep( bool bChanged, int cursorLine, int cursorPos );
+   bool canUndo() const { return m_undoPos>0; }
+   bool canRedo() const { return m_undoPos<(int)m_undoSteps.size(); }
+   // Return false if there is nothing to undo/redo, else the cursor position before/after the step.
+   bool undo( int& cursorLine, int& cursorPos );
+   bool redo( int& cursorLine, int& cursorPos );
+   void clearUndo();
+
+   /** The merge result encoded as it would be saved. Returns false if unsolved conflicts remain
+       or the line end style is undefined.
+   */
+   bool getOutputData( QByteArray& dataArray, QTextCodec* pEncoding, e_LineEndStyle eLineEndStyle );
+   /** Encodes the merge result into dev chunk by chunk, without building it in memory.
+       Doesn't check for conflicts. Returns false if writing failed or was cancelled.
+   */
+   bool writeOutput( QIODevice& dev, QTextCodec* pEncoding, e_LineEndStyle eLineEndStyle, ProgressProxy* pProgress=0 );
+   /** Writes the merge result (creating a backup if configured). Local files are written
+       to a temporary file first, that then replaces the destination. Returns false and a
+       description in errorText on failure.
+   */
+   bool saveDocument( const QString& fileName, QTextCodec* pEncoding, e_LineEndStyle eLineEndStyle, QString& errorText );
+
+   void reportMemory( MemoryReport& report );
+
+private:
+   static bool sameKindCheck( const MergeLine& ml1, const MergeLine& ml2 );
+   struct HistoryMapEntry
+   {
+      QString key;  // Sort key, shared with the HistoryMap
+      MergeEditLineList mellA;
+      MergeEditLineList mellB;
+      MergeEditLineList mellC;
+      MergeEditLineList& choice( bool bThreeInputs );
+      bool staysInPlace( bool bThreeInputs, Diff3LineList::const_iterator& iHistoryEnd );
+   };
+   typedef std::list<HistoryMapEntry> HistoryList;           // In order of appearance
+   typedef QHash<QString,HistoryList::iterator> HistoryMap;  // Sort key -> entry
+   // The regular expressions of the options, compiled once per history merge.
+   struct HistoryRegExps
+   {
+      HistoryRegExps( Options* pOptions );
+      QRegExp historyStart;
+      QRegExp newHistoryEntry;
+      QStringList parenthesesGroups;
+      QStringList keyOrderList;
+      bool bUseRegExp;
+   };
+   static void addHistoryEntry( int src, const QString& key, MergeEditLineList& melList,
+      HistoryMap& historyMap, HistoryList& historyList, HistoryList::iterator itHistoryListFront );
+   static bool historyKeyLess( const HistoryMapEntry* p1, const HistoryMapEntry* p2 );
+   void collectHistoryInformation( int src, Diff3LineList::const_iterator iHistoryBegin, Diff3LineList::const_iterator iHistoryEnd,
+      HistoryRegExps& regExps, HistoryMap& historyMap, HistoryList& historyList );
+
+   Options* m_pOptions;
+
+   const LineData* m_pldA;
+   const LineData* m_pldB;
+   const LineData* m_pldC;
+   int m_sizeA;
+   int m_sizeB;
+   int m_sizeC;
+
+   const Diff3LineList* m_pDiff3LineList;
+   const DiffBufferInfo* m_pDiffBufferInfo;
+   TotalDiffStatus* m_pTotalDiffStatus;
+
+   MergeLineList m_mergeLineList;
+   TotalSize m_totalSize; // Same as the number of lines, but tracked by the MergeEditLineLists
+
+   void updateLineIndex();
+   enum { c_lineIndexStep = 64 };
+   struct LineIndexEntry
+   {
+      MergeLineList::iterator mlIt;
+      MergeEditLineList::iterator melIt;
+   };
+   std::vector<LineIndexEntry> m_lineIndex;
+   struct MergeLineStart
+   {
+      MergeLineList::iterator mlIt;
+      int firstLine;
+   };
+   std::vector<MergeLineStart> m_mergeLineStarts; // Every MergeLine, ordered by d3lLineIdx and firstLine
+   int findMergeLineStart( int d3lLineIdx );
+   unsigned int m_lineIndexGeneration; // m_totalSize.m_generation when m_lineIndex was built
+
+   // The changed MergeEditLines of one MergeLine: All but the first melBegin and the last tailSize.
+   struct UndoPart
+   {
+      int d3lLineIdx;   // Identifies the MergeLine
+      int melBegin;
+      int tailSize;
+      std::vector<MergeEditLine> before;
+      std::vector<MergeEditLine> after;
+   };
+   struct UndoStep
+   {
+      UndoStep();
+      void swap( UndoStep& step );
+      std::vector<UndoPart> parts;
+      // Split and join: The MergeLines of the diff3 lines [d3lBegin,d3lEnd), d3lBegin<0 if unused
+      int d3lBegin;
+      int d3lEnd;
+      MergeLineList linesBefore;
+      MergeLineList linesAfter;
+      int cursorLineBefore;
+      int cursorPosBefore;
+      int cursorLineAfter;
+      int cursorPosAfter;
+   };
+   std::deque<UndoStep> m_undoSteps;
+   int m_undoPos;     // Number of steps that can be undone, the others can be redone
+   int m_undoDepth;   // Nesting of beginUndoStep*()
+   UndoStep m_openUndoStep;
+   std::vector<MergeLineList::iterator> m_openUndoPartIts; // The MergeLines of m_openUndoStep.parts
+   bool openUndoStep( int cursorLine, int cursorPos );
+   void addUndoPart( MergeLineList::iterator mlIt, MergeEditLineList::iterator melIt, int melIdx, int nofLines );
+   void saveMergeLines( int d3lBegin, int d3lEnd, MergeLineList& lines );
+   MergeLineList::iterator findMergeLine( int d3lLineIdx );
+   void applyUndoStep( UndoStep& step, bool bUndo );
+};
+
+#endif
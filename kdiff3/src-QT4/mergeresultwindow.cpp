@@ -60,7 +60,7 @@ MergeResultWindow::MergeResultWindow(
    Options* pOptions,
    QStatusBar* pStatusBar
    )
-: QWidget( pParent )
+: QWidget( pParent ), m_mergeEngine( pOptions ), m_mergeLineList( m_mergeEngine.getMergeLineList() )
 {
    setObjectName( "MergeResultWindow" );
    setFocusPolicy( Qt::ClickFocus );
@@ -68,23 +68,18 @@ MergeResultWindow::MergeResultWindow(
    m_firstLine = 0;
    m_horizScrollOffset = 0;
    m_nofLines = 0;
-   m_totalSize = 0;
    m_bMyUpdate = false;
    m_bInsertMode = true;
    m_scrollDeltaX = 0;
    m_scrollDeltaY = 0;
    m_bModified = false;
+   m_contentGeneration = 0;
+   m_undoStepGeneration = 0;
    m_eOverviewMode=Overview::eOMNormal;
+   m_bNavigationIndexValid = false;
+   m_bIndexSkipWhiteConflicts = false;
+   m_indexOverviewMode = Overview::eOMNormal;
 
-   m_pldA = 0;
-   m_pldB = 0;
-   m_pldC = 0;
-   m_sizeA = 0;
-   m_sizeB = 0;
-   m_sizeC = 0;
-
-   m_pDiff3LineList = 0;
-   m_pTotalDiffStatus = 0;
    m_pStatusBar = pStatusBar;
 
    m_pOptions = pOptions;
@@ -111,6 +106,7 @@ void MergeResultWindow::init(
    const LineData* pLineDataB, int sizeB,
    const LineData* pLineDataC, int sizeC,
    const Diff3LineList* pDiff3LineList,
+   const DiffBufferInfo* pDiffBufferInfo,
    TotalDiffStatus* pTotalDiffStatus
    )
 {
@@ -123,15 +119,7 @@ void MergeResultWindow::init(
    m_scrollDeltaY = 0;
    setModified( false );
    
-   m_pldA = pLineDataA;
-   m_pldB = pLineDataB;
-   m_pldC = pLineDataC;
-   m_sizeA = sizeA;
-   m_sizeB = sizeB;
-   m_sizeC = sizeC;
-
-   m_pDiff3LineList = pDiff3LineList;
-   m_pTotalDiffStatus = pTotalDiffStatus;
+   m_mergeEngine.init( pLineDataA, sizeA, pLineDataB, sizeB, pLineDataC, sizeC, pDiff3LineList, pDiffBufferInfo, pTotalDiffStatus );
    
    m_selection.reset();
    m_cursorXPos=0;
@@ -154,142 +142,8 @@ void MergeResultWindow::init(
 
 void MergeResultWindow::reset()
 {
-   m_pDiff3LineList = 0;
-   m_pTotalDiffStatus = 0;
-   m_pldA = 0;
-   m_pldB = 0;
-   m_pldC = 0;
-}
-
-// Calculate the merge information for the given Diff3Line.
-// Results will be stored in mergeDetails, bConflict, bLineRemoved and src.
-void mergeOneLine(
-   const Diff3Line& d, e_MergeDetails& mergeDetails, bool& bConflict,
-   bool& bLineRemoved, int& src, bool bTwoInputs
-   )
-{
-   mergeDetails = eDefault;
-   bConflict = false;
-   bLineRemoved = false;
-   src = 0;
-
-   if ( bTwoInputs )   // Only two input files
-   {
-      if ( d.lineA!=-1 && d.lineB!=-1 )
-      {
-         if ( d.pFineAB == 0 )
-         {
-            mergeDetails = eNoChange;           src = A;
-         }
-         else
-         {
-            mergeDetails = eBChanged;           bConflict = true;
-         }
-      }
-      else
-      {
-         if ( d.lineA!=-1 && d.lineB==-1 )
-         {
-            mergeDetails = eBDeleted;   bConflict = true;
-         }
-         else if ( d.lineA==-1 && d.lineB!=-1 )
-         {
-            mergeDetails = eBDeleted;   bConflict = true;
-         }
-      }
-      return;
-   }
-
-   // A is base.
-   if ( d.lineA!=-1 && d.lineB!=-1 && d.lineC!=-1 )
-   {
-      if ( d.pFineAB == 0  &&  d.pFineBC == 0 &&  d.pFineCA == 0)
-      {
-         mergeDetails = eNoChange;           src = A;
-      }
-      else if( d.pFineAB == 0  &&  d.pFineBC != 0  &&  d.pFineCA != 0 )
-      {
-         mergeDetails = eCChanged;           src = C;
-      }
-      else if( d.pFineAB != 0  &&  d.pFineBC != 0  &&  d.pFineCA == 0 )
-      {
-         mergeDetails = eBChanged;           src = B;
-      }
-      else if( d.pFineAB != 0  &&  d.pFineBC == 0  &&  d.pFineCA != 0 )
-      {
-         mergeDetails = eBCChangedAndEqual;  src = C;
-      }
-      else if( d.pFineAB != 0  &&  d.pFineBC != 0  &&  d.pFineCA != 0 )
-      {
-         mergeDetails = eBCChanged;           bConflict = true;
-      }
-      else
-         assert(false);
-   }
-   else if ( d.lineA!=-1 && d.lineB!=-1 && d.lineC==-1 )
-   {
-      if( d.pFineAB != 0 )
-      {
-         mergeDetails = eBChanged_CDeleted;   bConflict = true;
-      }
-      else
-      {
-         mergeDetails = eCDeleted;            bLineRemoved = true;        src = C;
-      }
-   }
-   else if ( d.lineA!=-1 && d.lineB==-1 && d.lineC!=-1 )
-   {
-      if( d.pFineCA != 0 )
-      {
-         mergeDetails = eCChanged_BDeleted;   bConflict = true;
-      }
-      else
-      {
-         mergeDetails = eBDeleted;            bLineRemoved = true;        src = B;
-      }
-   }
-   else if ( d.lineA==-1 && d.lineB!=-1 && d.lineC!=-1 )
-   {
-      if( d.pFineBC != 0 )
-      {
-         mergeDetails = eBCAdded;             bConflict = true;
-      }
-      else // B==C
-      {
-         mergeDetails = eBCAddedAndEqual;     src = C;
-      }
-   }
-   else if ( d.lineA==-1 && d.lineB==-1 && d.lineC!= -1 )
-   {
-      mergeDetails = eCAdded;                 src = C;
-   }
-   else if ( d.lineA==-1 && d.lineB!=-1 && d.lineC== -1 )
-   {
-      mergeDetails = eBAdded;                 src = B;
-   }
-   else if ( d.lineA!=-1 && d.lineB==-1 && d.lineC==-1 )
-   {
-      mergeDetails = eBCDeleted;              bLineRemoved = true;     src = C;
-   }
-   else
-      assert(false);
-}
-
-bool MergeResultWindow::sameKindCheck( const MergeLine& ml1, const MergeLine& ml2 )
-{
-   if ( ml1.bConflict && ml2.bConflict )
-   {
-      // Both lines have conflicts: If one is only a white space conflict and
-      // the other one is a real conflict, then this line returns false.
-      return ml1.id3l->bAEqC == ml2.id3l->bAEqC && ml1.id3l->bAEqB == ml2.id3l->bAEqB;
-   }
-   else
-      return (
-         ( !ml1.bConflict && !ml2.bConflict && ml1.bDelta && ml2.bDelta && ml1.srcSelect == ml2.srcSelect 
-         && (ml1.mergeDetails==ml2.mergeDetails || (ml1.mergeDetails!=eBCAddedAndEqual && ml2.mergeDetails!=eBCAddedAndEqual) ) )
-         ||
-         (!ml1.bDelta && !ml2.bDelta)
-         );
+   m_mergeEngine.reset();
+   m_bNavigationIndexValid = false;
 }
 
 void MergeResultWindow::merge(bool bAutoSolve, int defaultSelector, bool bConflictsOnly, bool bWhiteSpaceOnly )
@@ -307,194 +161,17 @@ void MergeResultWindow::merge(bool bAutoSolve, int defaultSelector, bool bConfli
          if ( result==KMessageBox::No )
             return;
       }
-
-      m_mergeLineList.clear();
-      m_totalSize = 0;
-      int lineIdx = 0;
-      Diff3LineList::const_iterator it;
-      for( it=m_pDiff3LineList->begin(); it!=m_pDiff3LineList->end(); ++it, ++lineIdx )
-      {
-         const Diff3Line& d = *it;
-
-         MergeLine ml;
-         bool bLineRemoved;
-         mergeOneLine( d, ml.mergeDetails, ml.bConflict, bLineRemoved, ml.srcSelect, m_pldC==0 );
-
-         // Automatic solving for only whitespace changes.
-         if ( ml.bConflict &&
-              ( (m_pldC==0 && (d.bAEqB || (d.bWhiteLineA && d.bWhiteLineB)))  ||
-                (m_pldC!=0 && ((d.bAEqB && d.bAEqC) || (d.bWhiteLineA && d.bWhiteLineB && d.bWhiteLineC) ) ) ) )
-         {
-            ml.bWhiteSpaceConflict = true;
-         }
-
-         ml.d3lLineIdx   = lineIdx;
-         ml.bDelta       = ml.srcSelect != A;
-         ml.id3l         = it;
-         ml.srcRangeLength = 1;
-
-         MergeLine* back = m_mergeLineList.empty() ? 0 : &m_mergeLineList.back();
-
-         bool bSame = back!=0 && sameKindCheck( ml, *back );
-         if( bSame )
-         {
-            ++back->srcRangeLength;
-            if ( back->bWhiteSpaceConflict && !ml.bWhiteSpaceConflict )
-               back->bWhiteSpaceConflict = false;
-         }
-         else
-         {
-            ml.mergeEditLineList.setTotalSizePtr(&m_totalSize);
-            m_mergeLineList.push_back( ml );
-         }
-
-         if ( ! ml.bConflict )
-         {
-            MergeLine& tmpBack = m_mergeLineList.back();
-            MergeEditLine mel(ml.id3l);
-            mel.setSource( ml.srcSelect, bLineRemoved );
-            tmpBack.mergeEditLineList.push_back(mel);
-         }
-         else if ( back==0  || ! back->bConflict || !bSame )
-         {
-            MergeLine& tmpBack = m_mergeLineList.back();
-            MergeEditLine mel(ml.id3l);
-            mel.setConflict();
-            tmpBack.mergeEditLineList.push_back(mel);
-         }
-      }
-   }
-
-   bool bSolveWhiteSpaceConflicts = false;
-   if ( bAutoSolve ) // when true, then the other params are not used and we can change them here. (see all invocations of merge())
-   {
-      if ( m_pldC==0 && m_pOptions->m_whiteSpace2FileMergeDefault != 0 )  // Only two inputs
-      {
-         defaultSelector = m_pOptions->m_whiteSpace2FileMergeDefault;
-         bWhiteSpaceOnly = true;
-         bSolveWhiteSpaceConflicts = true;
-      }
-      else if ( m_pldC!=0 && m_pOptions->m_whiteSpace3FileMergeDefault != 0 )
-      {
-         defaultSelector = m_pOptions->m_whiteSpace3FileMergeDefault;
-         bWhiteSpaceOnly = true;
-         bSolveWhiteSpaceConflicts = true;
-      }
-   }
-
-   if ( !bAutoSolve || bSolveWhiteSpaceConflicts )
-   {
-      // Change all auto selections
-      MergeLineList::iterator mlIt;
-      for( mlIt=m_mergeLineList.begin(); mlIt!=m_mergeLineList.end(); ++mlIt )
-      {
-         MergeLine& ml = *mlIt;
-         bool bConflict = ml.mergeEditLineList.empty() || ml.mergeEditLineList.begin()->isConflict();
-         if ( ml.bDelta && ( !bConflictsOnly || bConflict ) && (!bWhiteSpaceOnly || ml.bWhiteSpaceConflict ))
-         {
-            ml.mergeEditLineList.clear();
-            if ( defaultSelector==-1 && ml.bDelta )
-            {
-               MergeEditLine mel(ml.id3l);;
-               mel.setConflict();
-               ml.bConflict = true;
-               ml.mergeEditLineList.push_back(mel);
-            }
-            else
-            {
-               Diff3LineList::const_iterator d3llit=ml.id3l;
-               int j;
-
-               for( j=0; j<ml.srcRangeLength; ++j )
-               {
-                  MergeEditLine mel(d3llit);
-                  mel.setSource( defaultSelector, false );
-
-                  int srcLine = defaultSelector==1 ? d3llit->lineA :
-                                defaultSelector==2 ? d3llit->lineB :
-                                defaultSelector==3 ? d3llit->lineC : -1;
-
-                  if ( srcLine != -1 )
-                  {
-                     ml.mergeEditLineList.push_back(mel);
-                  }
-
-                  ++d3llit;
-               }
-
-               if ( ml.mergeEditLineList.empty() ) // Make a line nevertheless
-               {
-                  MergeEditLine mel(ml.id3l);
-                  mel.setRemoved( defaultSelector );
-                  ml.mergeEditLineList.push_back(mel);
-               }
-            }
-         }
-      }
    }
 
-   MergeLineList::iterator mlIt;
-   for( mlIt=m_mergeLineList.begin(); mlIt!=m_mergeLineList.end(); ++mlIt )
-   {
-      MergeLine& ml = *mlIt;
-      // Remove all lines that are empty, because no src lines are there.
-
-      int oldSrcLine = -1;
-      int oldSrc = -1;
-      MergeEditLineList::iterator melIt;
-      for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); )
-      {
-         MergeEditLine& mel = *melIt;
-         int melsrc = mel.src();
-
-         int srcLine = mel.isRemoved() ? -1 :
-                       melsrc==1 ? mel.id3l()->lineA :
-                       melsrc==2 ? mel.id3l()->lineB :
-                       melsrc==3 ? mel.id3l()->lineC : -1;
-
-         // At least one line remains because oldSrc != melsrc for first line in list
-         // Other empty lines will be removed
-         if ( srcLine == -1 && oldSrcLine==-1 && oldSrc == melsrc )
-            melIt = ml.mergeEditLineList.erase( melIt );
-         else
-            ++melIt;
-
-         oldSrcLine = srcLine;
-         oldSrc = melsrc;
-      }
-   }
+   m_mergeEngine.merge( bAutoSolve, defaultSelector, bConflictsOnly, bWhiteSpaceOnly );
+   m_bNavigationIndexValid = false;
 
    if ( bAutoSolve && !bConflictsOnly )
    {
-      if ( m_pOptions->m_bRunHistoryAutoMergeOnMergeStart )
-         slotMergeHistory();
-      if ( m_pOptions->m_bRunRegExpAutoMergeOnMergeStart )
-         slotRegExpAutoMerge();
-      if ( m_pldC != 0 && ! doRelevantChangesExist() )
+      if ( m_mergeEngine.isThreeWay() && ! m_mergeEngine.doRelevantChangesExist() )
          emit noRelevantChangesDetected();
    }
 
-   int nrOfSolvedConflicts = 0;
-   int nrOfUnsolvedConflicts = 0;
-   int nrOfWhiteSpaceConflicts = 0;
-
-   MergeLineList::iterator i;
-   for ( i = m_mergeLineList.begin();  i!=m_mergeLineList.end(); ++i )
-   {
-      if ( i->bConflict )
-         ++nrOfUnsolvedConflicts;
-      else if ( i->bDelta )
-         ++nrOfSolvedConflicts;
-
-      if ( i->bWhiteSpaceConflict )
-         ++nrOfWhiteSpaceConflicts;
-   }
-
-   m_pTotalDiffStatus->nofUnsolvedConflicts = nrOfUnsolvedConflicts;
-   m_pTotalDiffStatus->nofSolvedConflicts = nrOfSolvedConflicts;
-   m_pTotalDiffStatus->nofWhitespaceConflicts = nrOfWhiteSpaceConflicts;
-
-
    m_cursorXPos=0;
    m_cursorOldXPixelPos=0;
    m_cursorYPos=0;
@@ -514,8 +191,19 @@ void MergeResultWindow::merge(bool bAutoSolve, int defaultSelector, bool bConfli
 
 void MergeResultWindow::setFirstLine(int firstLine)
 {
+   int oldFirstLine = m_firstLine;
    m_firstLine = max2(0,firstLine);
-   update();
+
+   // Move the lines that stay visible, paintEvent() then only draws the revealed ones.
+   // (Pending updates are moved along and the cursor belongs to its line.)
+   int deltaY = ( oldFirstLine - m_firstLine ) * fontMetrics().lineSpacing();
+   if ( deltaY!=0 && qAbs(deltaY) < height() && m_pixmap.size()==size() && m_bPaintingAllowed && isVisible() )
+   {
+      m_pixmap.scroll( 0, deltaY, m_pixmap.rect() );
+      QWidget::scroll( 0, deltaY );
+   }
+   else
+      update();
 }
 
 void MergeResultWindow::setHorizScrollOffset(int horizScrollOffset)
@@ -538,7 +226,7 @@ int MergeResultWindow::getMaxTextWidth()
          for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); ++melIt )
          {
             MergeEditLine& mel = *melIt;
-            QString s = mel.getString( this );
+            QString s = mel.getString( &m_mergeEngine );
 
             QTextLayout textLayout( s, font(), this );
             textLayout.beginLayout();
@@ -557,7 +245,7 @@ int MergeResultWindow::getMaxTextWidth()
 
 int MergeResultWindow::getNofLines()
 {
-   return m_totalSize;
+   return m_mergeEngine.getTotalSize();
 }
 
 int MergeResultWindow::getVisibleTextAreaWidth()
@@ -612,7 +300,6 @@ void MergeResultWindow::go( e_Direction eDir, e_EndPoint eEndPoint )
 {
    assert( eDir==eUp || eDir==eDown );
    MergeLineList::iterator i = m_currentMergeLineIt;
-   bool bSkipWhiteConflicts = ! m_pOptions->m_bShowWhiteSpace;
    if( eEndPoint==eEnd )
    {
       if (eDir==eUp) i = m_mergeLineList.begin();     // first mergeline
@@ -624,32 +311,21 @@ void MergeResultWindow::go( e_Direction eDir, e_EndPoint eEndPoint )
          else              --i;                       // search upwards
       }
    }
-   else if ( eEndPoint == eDelta  &&  isItAtEnd(eDir!=eUp, i) )
+   else if ( eEndPoint==eDelta || eEndPoint==eConflict || eEndPoint==eUnsolvedConflict )
    {
-      do
+      checkNavigationIndex();
+      MergeLineIndex& index = eEndPoint==eDelta ? m_deltaIndex : eEndPoint==eConflict ? m_conflictIndex : m_unsolvedIndex;
+      int key = getCurrentIndexKey();
+      if ( eDir==eUp && isItAtEnd(false, i) )
       {
-         if ( eDir==eUp )  --i;
-         else              ++i;
+         MergeLineIndex::iterator it = index.lower_bound( key );
+         i = it==index.begin() ? m_mergeLineList.begin() : (--it)->second;
       }
-      while ( isItAtEnd(eDir!=eUp, i) && ( i->bDelta == false || checkOverviewIgnore(i) || (bSkipWhiteConflicts && i->bWhiteSpaceConflict) ) );
-   }
-   else if ( eEndPoint == eConflict  &&  isItAtEnd(eDir!=eUp, i) )
-   {
-      do
-      {
-         if ( eDir==eUp )  --i;
-         else              ++i;
-      }
-      while ( isItAtEnd(eDir!=eUp, i) && (i->bConflict == false || (bSkipWhiteConflicts && i->bWhiteSpaceConflict) ) );
-   }
-   else if ( isItAtEnd(eDir!=eUp, i)  &&  eEndPoint == eUnsolvedConflict )
-   {
-      do
+      else if ( eDir==eDown && isItAtEnd(true, i) )
       {
-         if ( eDir==eUp )  --i;
-         else              ++i;
+         MergeLineIndex::iterator it = index.upper_bound( key );
+         i = it==index.end() ? m_mergeLineList.end() : it->second;
       }
-      while ( isItAtEnd(eDir!=eUp, i) && ! i->mergeEditLineList.begin()->isConflict() );
    }
 
    if ( isVisible() )
@@ -658,73 +334,90 @@ void MergeResultWindow::go( e_Direction eDir, e_EndPoint eEndPoint )
    setFastSelector( i );
 }
 
-bool MergeResultWindow::isDeltaAboveCurrent()
+// Rebuilds the navigation index if it was invalidated or the filter of go() changed.
+void MergeResultWindow::checkNavigationIndex()
 {
    bool bSkipWhiteConflicts = ! m_pOptions->m_bShowWhiteSpace;
-   if (m_mergeLineList.empty()) return false;
-   MergeLineList::iterator i = m_currentMergeLineIt;
-   if (i == m_mergeLineList.begin()) return false;
-   do
-   {
-      --i;
-      if ( i->bDelta && !checkOverviewIgnore(i) && !( bSkipWhiteConflicts && i->bWhiteSpaceConflict ) ) return true;
+   if ( m_bNavigationIndexValid && m_bIndexSkipWhiteConflicts==bSkipWhiteConflicts && m_indexOverviewMode==m_eOverviewMode )
+      return;
+
+   m_deltaIndex.clear();
+   m_conflictIndex.clear();
+   m_unsolvedIndex.clear();
+   m_unsolvedWhiteSpaceIndex.clear();
+   m_bIndexSkipWhiteConflicts = bSkipWhiteConflicts;
+   m_indexOverviewMode = m_eOverviewMode;
+   m_bNavigationIndexValid = true;
+   for( MergeLineList::iterator i = m_mergeLineList.begin(); i!=m_mergeLineList.end(); ++i )
+      addToNavigationIndex( i );
+}
+
+void MergeResultWindow::addToNavigationIndex( MergeLineList::iterator i )
+{
+   // The hint makes appending in order (the rebuild) constant time.
+   MergeLineIndex::value_type entry( i->d3lLineIdx, i );
+   bool bSkipped = m_bIndexSkipWhiteConflicts && i->bWhiteSpaceConflict;
+   if ( i->bDelta && !bSkipped && !checkOverviewIgnore(i) )
+      m_deltaIndex.insert( m_deltaIndex.end(), entry );
+   if ( i->bConflict && !bSkipped )
+      m_conflictIndex.insert( m_conflictIndex.end(), entry );
+   if ( i->mergeEditLineList.begin()->isConflict() )
+   {
+      m_unsolvedIndex.insert( m_unsolvedIndex.end(), entry );
+      if ( i->bWhiteSpaceConflict )
+         m_unsolvedWhiteSpaceIndex.insert( m_unsolvedWhiteSpaceIndex.end(), entry );
    }
-   while (i!=m_mergeLineList.begin());
+}
 
-   return false;
+static void eraseKeyRange( std::map<int, MergeEngine::MergeLineList::iterator>& index, int first, int end )
+{
+   index.erase( index.lower_bound( first ), index.lower_bound( end ) );
 }
 
-bool MergeResultWindow::isDeltaBelowCurrent()
+// Call after the MergeLine i was chosen, edited, split or joined. The entries of
+// all MergeLines within its source range (e.g. those joined into it) are replaced.
+void MergeResultWindow::updateNavigationIndex( MergeLineList::iterator i )
 {
-   bool bSkipWhiteConflicts = ! m_pOptions->m_bShowWhiteSpace;
-   if (m_mergeLineList.empty()) return false;
+   if ( !m_bNavigationIndexValid || i==m_mergeLineList.end() )
+      return;  // Will be rebuilt anyway
 
-   MergeLineList::iterator i = m_currentMergeLineIt;
-   if (i!=m_mergeLineList.end())
-   {
-      ++i;
-      for( ; i!=m_mergeLineList.end(); ++i )
-      {
-         if ( i->bDelta && !checkOverviewIgnore(i) && !( bSkipWhiteConflicts && i->bWhiteSpaceConflict ) ) return true;
-      }
-   }
-   return false;
+   int first = i->d3lLineIdx;
+   int end = i->d3lLineIdx + i->srcRangeLength;
+   eraseKeyRange( m_deltaIndex, first, end );
+   eraseKeyRange( m_conflictIndex, first, end );
+   eraseKeyRange( m_unsolvedIndex, first, end );
+   eraseKeyRange( m_unsolvedWhiteSpaceIndex, first, end );
+   addToNavigationIndex( i );
 }
 
-bool MergeResultWindow::isConflictAboveCurrent()
+// The position of the current MergeLine in the navigation index (after all others if there is none).
+int MergeResultWindow::getCurrentIndexKey()
 {
-   if (m_mergeLineList.empty()) return false;
-   MergeLineList::iterator i = m_currentMergeLineIt;
-   if (i == m_mergeLineList.begin()) return false;
-
-   bool bSkipWhiteConflicts = ! m_pOptions->m_bShowWhiteSpace;
+   return m_currentMergeLineIt==m_mergeLineList.end() ? INT_MAX : m_currentMergeLineIt->d3lLineIdx;
+}
 
-   do
-   {
-      --i;
-      if ( i->bConflict && !(bSkipWhiteConflicts && i->bWhiteSpaceConflict) ) return true;
-   } 
-   while (i!=m_mergeLineList.begin());
-   
-   return false;
+bool MergeResultWindow::isDeltaAboveCurrent()
+{
+   checkNavigationIndex();
+   return m_deltaIndex.lower_bound( getCurrentIndexKey() ) != m_deltaIndex.begin();
 }
 
-bool MergeResultWindow::isConflictBelowCurrent()
+bool MergeResultWindow::isDeltaBelowCurrent()
 {
-   MergeLineList::iterator i = m_currentMergeLineIt;
-   if (m_mergeLineList.empty()) return false;
+   checkNavigationIndex();
+   return m_deltaIndex.upper_bound( getCurrentIndexKey() ) != m_deltaIndex.end();
+}
 
-   bool bSkipWhiteConflicts = ! m_pOptions->m_bShowWhiteSpace;
+bool MergeResultWindow::isConflictAboveCurrent()
+{
+   checkNavigationIndex();
+   return m_conflictIndex.lower_bound( getCurrentIndexKey() ) != m_conflictIndex.begin();
+}
 
-   if (i!=m_mergeLineList.end())
-   {
-      ++i;
-      for( ; i!=m_mergeLineList.end(); ++i )
-      {
-         if ( i->bConflict && !(bSkipWhiteConflicts && i->bWhiteSpaceConflict) ) return true;
-      }
-   }
-   return false;
+bool MergeResultWindow::isConflictBelowCurrent()
+{
+   checkNavigationIndex();
+   return m_conflictIndex.upper_bound( getCurrentIndexKey() ) != m_conflictIndex.end();
 }
 
 bool MergeResultWindow::isUnsolvedConflictAtCurrent()
@@ -736,34 +429,14 @@ bool MergeResultWindow::isUnsolvedConflictAtCurrent()
 
 bool MergeResultWindow::isUnsolvedConflictAboveCurrent()
 {
-   if (m_mergeLineList.empty()) return false;
-   MergeLineList::iterator i = m_currentMergeLineIt;
-   if (i == m_mergeLineList.begin()) return false;
-   
-   do
-   {
-      --i;
-      if ( i->mergeEditLineList.begin()->isConflict() ) return true;
-   } 
-   while (i!=m_mergeLineList.begin());
-   
-   return false;
+   checkNavigationIndex();
+   return m_unsolvedIndex.lower_bound( getCurrentIndexKey() ) != m_unsolvedIndex.begin();
 }
 
 bool MergeResultWindow::isUnsolvedConflictBelowCurrent()
 {
-   MergeLineList::iterator i = m_currentMergeLineIt;
-   if (m_mergeLineList.empty()) return false;
-   
-   if (i!=m_mergeLineList.end())
-   {
-      ++i;
-      for( ; i!=m_mergeLineList.end(); ++i )
-      {
-         if ( i->mergeEditLineList.begin()->isConflict() ) return true;
-      }
-   }
-   return false;
+   checkNavigationIndex();
+   return m_unsolvedIndex.upper_bound( getCurrentIndexKey() ) != m_unsolvedIndex.end();
 }
 
 void MergeResultWindow::slotGoTop()
@@ -815,40 +488,17 @@ void MergeResultWindow::slotGoNextUnsolvedConflict()
     The function calculates the corresponding iterator. */
 void MergeResultWindow::slotSetFastSelectorLine( int line )
 {
-   MergeLineList::iterator i;
-   for ( i = m_mergeLineList.begin();  i!=m_mergeLineList.end(); ++i )
-   {
-      if ( line>=i->d3lLineIdx  && line < i->d3lLineIdx + i->srcRangeLength )
-      {
-         //if ( i->bDelta )
-         {
-            setFastSelector( i );
-         }
-         break;
-      }
-   }
+   MergeLineList::iterator i = m_mergeEngine.findMergeLineContaining( line );
+   if ( i!=m_mergeLineList.end() )
+      setFastSelector( i );
 }
 
 int MergeResultWindow::getNrOfUnsolvedConflicts( int* pNrOfWhiteSpaceConflicts )
 {
-   int nrOfUnsolvedConflicts = 0;
-   if (pNrOfWhiteSpaceConflicts!=0)
-      *pNrOfWhiteSpaceConflicts = 0;
-
-   MergeLineList::iterator mlIt = m_mergeLineList.begin();
-   for(mlIt = m_mergeLineList.begin();mlIt!=m_mergeLineList.end(); ++mlIt)
-   {
-      MergeLine& ml = *mlIt;
-      MergeEditLineList::iterator melIt = ml.mergeEditLineList.begin();
-      if ( melIt->isConflict() )
-      {
-         ++nrOfUnsolvedConflicts;
-         if ( ml.bWhiteSpaceConflict &&  pNrOfWhiteSpaceConflicts!=0 )
-            ++ *pNrOfWhiteSpaceConflicts;
-      }
-   }
-
-   return nrOfUnsolvedConflicts;
+   checkNavigationIndex();
+   if ( pNrOfWhiteSpaceConflicts!=0 )
+      *pNrOfWhiteSpaceConflicts = m_unsolvedWhiteSpaceIndex.size();
+   return m_unsolvedIndex.size();
 }
 
 void MergeResultWindow::showNrOfConflicts()
@@ -863,17 +513,18 @@ void MergeResultWindow::showNrOfConflicts()
          ++nrOfConflicts;
    }
    QString totalInfo;
-   if ( m_pTotalDiffStatus->bBinaryAEqB && m_pTotalDiffStatus->bBinaryAEqC )
+   const TotalDiffStatus* pTotalDiffStatus = m_mergeEngine.getTotalDiffStatus();
+   if ( pTotalDiffStatus->bBinaryAEqB && pTotalDiffStatus->bBinaryAEqC )
       totalInfo += i18n("All input files are binary equal.");
-   else  if ( m_pTotalDiffStatus->bTextAEqB && m_pTotalDiffStatus->bTextAEqC )
+   else  if ( pTotalDiffStatus->bTextAEqB && pTotalDiffStatus->bTextAEqC )
       totalInfo += i18n("All input files contain the same text.");
    else {
-      if    ( m_pTotalDiffStatus->bBinaryAEqB ) totalInfo += i18n("Files %1 and %2 are binary equal.\n",QString("A"),QString("B"));
-      else if ( m_pTotalDiffStatus->bTextAEqB ) totalInfo += i18n("Files %1 and %2 have equal text.\n",QString("A"),QString("B"));
-      if    ( m_pTotalDiffStatus->bBinaryAEqC ) totalInfo += i18n("Files %1 and %2 are binary equal.\n",QString("A"),QString("C"));
-      else if ( m_pTotalDiffStatus->bTextAEqC ) totalInfo += i18n("Files %1 and %2 have equal text.\n",QString("A"),QString("C"));
-      if    ( m_pTotalDiffStatus->bBinaryBEqC ) totalInfo += i18n("Files %1 and %2 are binary equal.\n",QString("B"),QString("C"));
-      else if ( m_pTotalDiffStatus->bTextBEqC ) totalInfo += i18n("Files %1 and %2 have equal text.\n",QString("B"),QString("C"));
+      if    ( pTotalDiffStatus->bBinaryAEqB ) totalInfo += i18n("Files %1 and %2 are binary equal.\n",QString("A"),QString("B"));
+      else if ( pTotalDiffStatus->bTextAEqB ) totalInfo += i18n("Files %1 and %2 have equal text.\n",QString("A"),QString("B"));
+      if    ( pTotalDiffStatus->bBinaryAEqC ) totalInfo += i18n("Files %1 and %2 are binary equal.\n",QString("A"),QString("C"));
+      else if ( pTotalDiffStatus->bTextAEqC ) totalInfo += i18n("Files %1 and %2 have equal text.\n",QString("A"),QString("C"));
+      if    ( pTotalDiffStatus->bBinaryBEqC ) totalInfo += i18n("Files %1 and %2 are binary equal.\n",QString("B"),QString("C"));
+      else if ( pTotalDiffStatus->bTextBEqC ) totalInfo += i18n("Files %1 and %2 have equal text.\n",QString("B"),QString("C"));
    }
 
    int nrOfUnsolvedConflicts = getNrOfUnsolvedConflicts();
@@ -894,15 +545,7 @@ void MergeResultWindow::setFastSelector(MergeLineList::iterator i)
    m_currentMergeLineIt = i;
    emit setFastSelectorRange( i->d3lLineIdx, i->srcRangeLength );
 
-   int line1 = 0;
-
-   MergeLineList::iterator mlIt = m_mergeLineList.begin();
-   for(mlIt = m_mergeLineList.begin();mlIt!=m_mergeLineList.end(); ++mlIt)
-   {
-      if(mlIt==m_currentMergeLineIt)
-         break;
-      line1 += mlIt->mergeEditLineList.size();
-   }
+   int line1 = m_mergeEngine.getFirstLineOfMergeLine( m_currentMergeLineIt );
 
    int nofLines = m_currentMergeLineIt->mergeEditLineList.size();
    int newFirstLine = getBestFirstLine( line1, nofLines, m_firstLine, getNofVisibleLines() );
@@ -928,78 +571,19 @@ void MergeResultWindow::choose( int selector )
    if ( m_currentMergeLineIt==m_mergeLineList.end() )
       return;
 
+   m_undoStepGeneration = m_contentGeneration;
+   m_mergeEngine.beginUndoStepForMergeLine( m_currentMergeLineIt, m_cursorYPos, m_cursorXPos );
    setModified();
 
-   // First find range for which this change works.
-   MergeLine& ml = *m_currentMergeLineIt;
-
-   MergeEditLineList::iterator melIt;
-
-   // Now check if selector is active for this range already.
-   bool bActive = false;
+   m_mergeEngine.choose( m_currentMergeLineIt, selector );
+   updateNavigationIndex( m_currentMergeLineIt );
 
-   // Remove unneeded lines in the range.
-   for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); )
+   if ( m_cursorYPos >= m_mergeEngine.getTotalSize() )
    {
-      MergeEditLine& mel = *melIt;
-      if ( mel.src()==selector )
-         bActive = true;
-
-      if ( mel.src()==selector || !mel.isEditableText() || mel.isModified() )
-         melIt = ml.mergeEditLineList.erase( melIt );
-      else
-         ++melIt;
-   }
-
-   if ( !bActive )  // Selected source wasn't active.
-   {     // Append the lines from selected source here at rangeEnd.
-      Diff3LineList::const_iterator d3llit=ml.id3l;
-      int j;
-
-      for( j=0; j<ml.srcRangeLength; ++j )
-      {
-         MergeEditLine mel(d3llit);
-         mel.setSource( selector, false );
-         ml.mergeEditLineList.push_back(mel);
-
-         ++d3llit;
-      }
-   }
-
-   if ( ! ml.mergeEditLineList.empty() )
-   {
-      // Remove all lines that are empty, because no src lines are there.
-      for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); )
-      {
-         MergeEditLine& mel = *melIt;
-
-         int srcLine = mel.src()==1 ? mel.id3l()->lineA :
-                       mel.src()==2 ? mel.id3l()->lineB :
-                       mel.src()==3 ? mel.id3l()->lineC : -1;
-
-         if ( srcLine == -1 )
-            melIt = ml.mergeEditLineList.erase( melIt );
-         else
-            ++melIt;
-      }
-   }
-
-   if ( ml.mergeEditLineList.empty() )
-   {
-      // Insert a dummy line:
-      MergeEditLine mel(ml.id3l);
-
-      if ( bActive )  mel.setConflict();         // All src entries deleted => conflict
-      else            mel.setRemoved(selector);  // No lines in corresponding src found.
-
-      ml.mergeEditLineList.push_back(mel);
-   }
-
-   if ( m_cursorYPos >= m_totalSize )
-   {
-      m_cursorYPos = m_totalSize-1;
+      m_cursorYPos = m_mergeEngine.getTotalSize()-1;
       m_cursorXPos = 0;
    }
+   endUndoStep();
 
    m_maxTextWidth = -1;
    update();
@@ -1008,566 +592,101 @@ void MergeResultWindow::choose( int selector )
    int wsc;
    int nofUnsolved = getNrOfUnsolvedConflicts(&wsc);
    m_pStatusBar->showMessage( i18n("Number of remaining unsolved conflicts: %1 (of which %2 are whitespace)"
-         ,nofUnsolved,wsc) );
-}
-
-// bConflictsOnly: automatically choose for conflicts only (true) or for everywhere (false)
-void MergeResultWindow::chooseGlobal(int selector, bool bConflictsOnly, bool bWhiteSpaceOnly )
-{
-   resetSelection();
-
-   merge( false, selector, bConflictsOnly, bWhiteSpaceOnly );
-   setModified( true );
-   update();
-   int wsc;
-   int nofUnsolved = getNrOfUnsolvedConflicts(&wsc);
-   m_pStatusBar->showMessage( i18n("Number of remaining unsolved conflicts: %1 (of which %2 are whitespace)"
-         ,nofUnsolved,wsc) );
-}
-
-void MergeResultWindow::slotAutoSolve()
-{
-   resetSelection();
-   merge( true, -1 );
-   setModified( true );
-   update();
-   int wsc;
-   int nofUnsolved = getNrOfUnsolvedConflicts(&wsc);
-   m_pStatusBar->showMessage( i18n("Number of remaining unsolved conflicts: %1 (of which %2 are whitespace)"
-         ,nofUnsolved,wsc) );
-}
-
-void MergeResultWindow::slotUnsolve()
-{
-   resetSelection();
-   merge( false, -1 );
-   setModified( true );
-   update();
-   int wsc;
-   int nofUnsolved = getNrOfUnsolvedConflicts(&wsc);
-   m_pStatusBar->showMessage( i18n("Number of remaining unsolved conflicts: %1 (of which %2 are whitespace)"
-         ,nofUnsolved,wsc) );
-}
-
-static QString calcHistoryLead(const QString& s )
-{
-   // Return the start of the line until the first white char after the first non white char.
-   int i;
-   for( i=0; i<s.length(); ++i )
-   {
-      if (s[i]!=' ' && s[i]!='\t')
-      {
-         for( ; i<s.length(); ++i )
-         {
-            if (s[i]==' ' || s[i]=='\t')
-            {
-               return s.left(i);
-            }
-         }
-         return s;  // Very unlikely
-      }
-   }
-   return "";  // Must be an empty string, not a null string.
-}
-
-static void findHistoryRange( const QRegExp& historyStart, bool bThreeFiles, const Diff3LineList* pD3LList, 
-                             Diff3LineList::const_iterator& iBegin, Diff3LineList::const_iterator& iEnd, int& idxBegin, int& idxEnd )
-{
-   QString historyLead;
-   // Search for start of history
-   for( iBegin = pD3LList->begin(), idxBegin=0; iBegin!=pD3LList->end(); ++iBegin, ++idxBegin )
-   {
-      if ( historyStart.exactMatch( iBegin->getString(A) ) && 
-           historyStart.exactMatch( iBegin->getString(B) ) && 
-           ( !bThreeFiles || historyStart.exactMatch( iBegin->getString(C) ) ) )
-      {
-         historyLead = calcHistoryLead( iBegin->getString(A) );
-         break;
-      }
-   }
-   // Search for end of history
-   for( iEnd = iBegin, idxEnd = idxBegin; iEnd!=pD3LList->end(); ++iEnd, ++idxEnd )
-   {
-      QString sA = iEnd->getString(A);
-      QString sB = iEnd->getString(B);
-      QString sC = iEnd->getString(C);
-      if ( ! ((sA.isNull() || historyLead == calcHistoryLead(sA) ) &&
-              (sB.isNull() || historyLead == calcHistoryLead(sB) ) &&
-           (!bThreeFiles || sC.isNull() || historyLead == calcHistoryLead(sC) )
-         ))
-      {
-         break; // End of the history
-      }
-   }
-}
-
-bool findParenthesesGroups( const QString& s, QStringList& sl )
-{
-   sl.clear();
-   int i=0;
-   std::list<int> startPosStack;
-   int length = s.length();
-   for( i=0; i<length; ++i )
-   {
-      if ( s[i]=='\\' && i+1<length && ( s[i+1]=='\\' || s[i+1]=='(' || s[i+1]==')' ) )
-      {
-         ++i;
-         continue;
-      }
-      if ( s[i]=='(' )
-      {
-         startPosStack.push_back(i);
-      }
-      else if ( s[i]==')' )
-      {
-         if (startPosStack.empty())
-            return false; // Parentheses don't match
-         int startPos = startPosStack.back();
-         startPosStack.pop_back();
-         sl.push_back( s.mid( startPos+1, i-startPos-1 ) );
-      }
-   }
-   return startPosStack.empty(); // false if parentheses don't match
-}
-
-QString calcHistorySortKey( const QString& keyOrder, QRegExp& matchedRegExpr, const QStringList& parenthesesGroupList )
-{
-   QStringList keyOrderList = keyOrder.split(',');
-   QString key;
-   for ( QStringList::iterator keyIt = keyOrderList.begin(); keyIt!=keyOrderList.end(); ++keyIt )
-   {
-      if ( (*keyIt).isEmpty() )
-         continue;
-      bool bOk=false;
-      int groupIdx = (*keyIt).toInt(&bOk);
-      if (!bOk || groupIdx<0 || groupIdx >(int)parenthesesGroupList.size() )
-         continue;
-      QString s = matchedRegExpr.cap( groupIdx );
-      if ( groupIdx == 0 )
-      {
-         key += s + " ";
-         continue;
-      }
-
-      QString groupRegExp = parenthesesGroupList[groupIdx-1];
-      if( groupRegExp.indexOf('|')<0 || groupRegExp.indexOf('(')>=0 )
-      {
-         bool bOk = false;
-         int i = s.toInt( &bOk );
-         if ( bOk && i>=0 && i<10000 )
-            s.sprintf("%04d", i);  // This should help for correct sorting of numbers.
-         key += s + " ";
-      }
-      else
-      {
-         // Assume that the groupRegExp consists of something like "Jan|Feb|Mar|Apr"
-         // s is the string that managed to match.
-         // Now we want to know at which position it occurred. e.g. Jan=0, Feb=1, Mar=2, etc.
-         QStringList sl = groupRegExp.split( '|' );
-         int idx = sl.indexOf( s );
-         if (idx<0)
-         {
-            // Didn't match
-         }
-         else
-         {
-            QString sIdx;
-            sIdx.sprintf("%02d", idx+1 ); // Up to 99 words in the groupRegExp (more than 12 aren't expected)
-            key += sIdx + " ";
-         }
-      }
-   }
-   return key;
-}
-
-void MergeResultWindow::collectHistoryInformation(
-   int src, Diff3LineList::const_iterator iHistoryBegin, Diff3LineList::const_iterator iHistoryEnd,
-   HistoryMap& historyMap,
-   std::list< HistoryMap::iterator >& hitList  // list of iterators
-   )
-{
-   std::list< HistoryMap::iterator >::iterator itHitListFront = hitList.begin();
-   Diff3LineList::const_iterator id3l = iHistoryBegin;
-   QString historyLead;
-   {
-      const LineData* pld = id3l->getLineData(src);
-      QString s( pld->pLine, pld->size );
-      historyLead = calcHistoryLead(s);
-   }
-   QRegExp historyStart( m_pOptions->m_historyStartRegExp );
-   if ( id3l == iHistoryEnd )
-      return;
-   ++id3l; // Skip line with "$Log ... $"
-   QRegExp newHistoryEntry( m_pOptions->m_historyEntryStartRegExp );
-   QStringList parenthesesGroups;
-   findParenthesesGroups( m_pOptions->m_historyEntryStartRegExp, parenthesesGroups );
-   QString key;
-   MergeEditLineList melList;
-   bool bPrevLineIsEmpty = true;
-   bool bUseRegExp = !m_pOptions->m_historyEntryStartRegExp.isEmpty();
-   for(; id3l != iHistoryEnd; ++id3l )
-   {
-      const LineData* pld = id3l->getLineData(src);
-      if ( !pld ) continue;
-      QString s( pld->pLine, pld->size );
-      if (historyLead.isNull()) historyLead = calcHistoryLead(s);
-      QString sLine = s.mid(historyLead.length());
-      if ( ( !bUseRegExp && !sLine.trimmed().isEmpty() && bPrevLineIsEmpty )
-           || (bUseRegExp && newHistoryEntry.exactMatch( sLine ) )
-         )
-      {
-         if ( !key.isEmpty() && !melList.empty() )
-         {
-            // Only insert new HistoryMapEntry if key not found; in either case p.first is a valid iterator to element key.
-            std::pair<HistoryMap::iterator, bool> p = historyMap.insert(HistoryMap::value_type(key,HistoryMapEntry()));
-            HistoryMapEntry& hme = p.first->second;
-            if ( src==A ) hme.mellA = melList;
-            if ( src==B ) hme.mellB = melList;
-            if ( src==C ) hme.mellC = melList;
-            if ( p.second ) // Not in list yet?
-            {
-               hitList.insert( itHitListFront, p.first );
-            }
-         }
-
-         if ( ! bUseRegExp )
-            key = sLine;
-         else
-            key = calcHistorySortKey(m_pOptions->m_historyEntryStartSortKeyOrder,newHistoryEntry,parenthesesGroups);
-
-         melList.clear();
-         melList.push_back( MergeEditLine(id3l,src) );
-      }
-      else if ( ! historyStart.exactMatch( s ) )
-      {
-         melList.push_back( MergeEditLine(id3l,src) );
-      }
-
-      bPrevLineIsEmpty = sLine.trimmed().isEmpty();
-   }
-   if ( !key.isEmpty() )
-   {
-      // Only insert new HistoryMapEntry if key not found; in either case p.first is a valid iterator to element key.
-      std::pair<HistoryMap::iterator, bool> p = historyMap.insert(HistoryMap::value_type(key,HistoryMapEntry()));
-      HistoryMapEntry& hme = p.first->second;
-      if ( src==A ) hme.mellA = melList;
-      if ( src==B ) hme.mellB = melList;
-      if ( src==C ) hme.mellC = melList;
-      if ( p.second ) // Not in list yet?
-      {
-         hitList.insert( itHitListFront, p.first );
-      }
-   }
-   // End of the history
-}
-
-MergeResultWindow::MergeEditLineList& MergeResultWindow::HistoryMapEntry::choice( bool bThreeInputs )
-{
-   if ( !bThreeInputs )
-      return mellA.empty() ? mellB : mellA;
-   else
-   {
-      if ( mellA.empty() )
-         return mellC.empty() ? mellB : mellC;       // A doesn't exist, return one that exists
-      else if ( ! mellB.empty() && ! mellC.empty() )
-      {                                              // A, B and C exist
-         return mellA;
-      }
-      else
-         return mellB.empty() ? mellB : mellC;       // A exists, return the one that doesn't exist
-   }
-}
-
-bool MergeResultWindow::HistoryMapEntry::staysInPlace( bool bThreeInputs, Diff3LineList::const_iterator& iHistoryEnd )
-{
-   // The entry should stay in place if the decision made by the automerger is correct.
-   Diff3LineList::const_iterator& iHistoryLast = iHistoryEnd;
-   --iHistoryLast;
-   if ( !bThreeInputs )
-   {
-      if ( !mellA.empty() && !mellB.empty() && mellA.begin()->id3l()==mellB.begin()->id3l() && 
-           mellA.back().id3l() == iHistoryLast && mellB.back().id3l() == iHistoryLast )
-      {
-         iHistoryEnd = mellA.begin()->id3l();
-         return true;
-      }
-      else
-      {
-         return false;
-      }
-   }
-   else
-   {
-      if ( !mellA.empty() && !mellB.empty() && !mellC.empty() 
-           && mellA.begin()->id3l()==mellB.begin()->id3l() && mellA.begin()->id3l()==mellC.begin()->id3l()
-           && mellA.back().id3l() == iHistoryLast && mellB.back().id3l() == iHistoryLast && mellC.back().id3l() == iHistoryLast )
-      {
-         iHistoryEnd = mellA.begin()->id3l();
-         return true;
-      }
-      else
-      {
-         return false;
-      }
-   }
-}
-
-void MergeResultWindow::slotMergeHistory()
-{
-   Diff3LineList::const_iterator iD3LHistoryBegin;
-   Diff3LineList::const_iterator iD3LHistoryEnd;
-   int d3lHistoryBeginLineIdx = -1;
-   int d3lHistoryEndLineIdx = -1;
-
-   // Search for history start, history end in the diff3LineList
-   findHistoryRange( QRegExp(m_pOptions->m_historyStartRegExp), m_pldC!=0, m_pDiff3LineList, iD3LHistoryBegin, iD3LHistoryEnd, d3lHistoryBeginLineIdx, d3lHistoryEndLineIdx );
-
-   if (  iD3LHistoryBegin != m_pDiff3LineList->end() )
-   {
-      // Now collect the historyMap information
-      HistoryMap historyMap;
-      std::list< HistoryMap::iterator > hitList;
-      if (m_pldC==0)
-      {
-         collectHistoryInformation( A, iD3LHistoryBegin, iD3LHistoryEnd, historyMap, hitList );
-         collectHistoryInformation( B, iD3LHistoryBegin, iD3LHistoryEnd, historyMap, hitList );
-      }
-      else
-      {
-         collectHistoryInformation( A, iD3LHistoryBegin, iD3LHistoryEnd, historyMap, hitList );
-         collectHistoryInformation( B, iD3LHistoryBegin, iD3LHistoryEnd, historyMap, hitList );
-         collectHistoryInformation( C, iD3LHistoryBegin, iD3LHistoryEnd, historyMap, hitList );
-      }
-
-      Diff3LineList::const_iterator iD3LHistoryOrigEnd = iD3LHistoryEnd;
-
-      bool bHistoryMergeSorting = m_pOptions->m_bHistoryMergeSorting  && ! m_pOptions->m_historyEntryStartSortKeyOrder.isEmpty() && 
-                                  ! m_pOptions->m_historyEntryStartRegExp.isEmpty();
-
-      if ( m_pOptions->m_maxNofHistoryEntries==-1 )
-      {
-         // Remove parts from the historyMap and hitList that stay in place
-         if ( bHistoryMergeSorting )
-         {
-            while ( ! historyMap.empty() )
-            {
-               HistoryMap::iterator hMapIt = historyMap.begin();
-               if( hMapIt->second.staysInPlace( m_pldC!=0, iD3LHistoryEnd ) )
-                  historyMap.erase(hMapIt);
-               else
-                  break;
-            }
-         }
-         else
-         {
-            while ( ! hitList.empty() )
-            {
-               HistoryMap::iterator hMapIt = hitList.back();
-               if( hMapIt->second.staysInPlace( m_pldC!=0, iD3LHistoryEnd ) )
-                  hitList.pop_back();
-               else
-                  break;
-            }
-         }
-         while (iD3LHistoryOrigEnd != iD3LHistoryEnd)
-         {
-            --iD3LHistoryOrigEnd;
-            --d3lHistoryEndLineIdx;
-         }
-      }
-
-      MergeLineList::iterator iMLLStart = splitAtDiff3LineIdx(d3lHistoryBeginLineIdx);
-      MergeLineList::iterator iMLLEnd   = splitAtDiff3LineIdx(d3lHistoryEndLineIdx);
-      // Now join all MergeLines in the history
-      MergeLineList::iterator i = iMLLStart;
-      if ( i != iMLLEnd )
-      {
-         ++i;
-         while ( i!=iMLLEnd )
-         {
-            iMLLStart->join(*i);
-            i = m_mergeLineList.erase( i );
-         }
-      }
-      iMLLStart->mergeEditLineList.clear();
-      // Now insert the complete history into the first MergeLine of the history
-      iMLLStart->mergeEditLineList.push_back( MergeEditLine( iD3LHistoryBegin, m_pldC == 0 ? B : C ) );
-      QString lead = calcHistoryLead( iD3LHistoryBegin->getString(A) );
-      MergeEditLine mel( m_pDiff3LineList->end() );
-      mel.setString( lead );
-      iMLLStart->mergeEditLineList.push_back(mel);
-
-      int historyCount = 0;
-      if ( bHistoryMergeSorting )
-      {
-         // Create a sorted history
-         HistoryMap::reverse_iterator hmit;
-         for ( hmit = historyMap.rbegin(); hmit != historyMap.rend(); ++hmit )
-         {
-            if ( historyCount==m_pOptions->m_maxNofHistoryEntries )
-               break;
-            ++historyCount;
-            HistoryMapEntry& hme = hmit->second;
-            MergeEditLineList& mell = hme.choice(m_pldC!=0);
-            if (!mell.empty())
-               iMLLStart->mergeEditLineList.splice( iMLLStart->mergeEditLineList.end(), mell, mell.begin(), mell.end() );
-         }
-      }
-      else
-      {
-         // Create history in order of appearance
-         std::list< HistoryMap::iterator >::iterator hlit;
-         for ( hlit = hitList.begin(); hlit != hitList.end(); ++hlit )
-         {
-            if ( historyCount==m_pOptions->m_maxNofHistoryEntries )
-               break;
-            ++historyCount;
-            HistoryMapEntry& hme = (*hlit)->second;
-            MergeEditLineList& mell = hme.choice(m_pldC!=0);
-            if (!mell.empty())
-               iMLLStart->mergeEditLineList.splice( iMLLStart->mergeEditLineList.end(), mell, mell.begin(), mell.end() );
-         }
-         // If the end of start is empty and the first line at the end is empty remove the last line of start
-         if ( !iMLLStart->mergeEditLineList.empty() && !iMLLEnd->mergeEditLineList.empty() )
-         {
-            QString lastLineOfStart = iMLLStart->mergeEditLineList.back().getString(this);
-            QString firstLineOfEnd = iMLLEnd->mergeEditLineList.front().getString(this);
-            if ( lastLineOfStart.mid(lead.length()).trimmed().isEmpty() && firstLineOfEnd.mid(lead.length()).trimmed().isEmpty() )
-               iMLLStart->mergeEditLineList.pop_back();
-         }
-      }
-      setFastSelector( iMLLStart );
-      update();
-   }
+         ,nofUnsolved,wsc) );
 }
 
-void MergeResultWindow::slotRegExpAutoMerge()
+// bConflictsOnly: automatically choose for conflicts only (true) or for everywhere (false)
+void MergeResultWindow::chooseGlobal(int selector, bool bConflictsOnly, bool bWhiteSpaceOnly )
 {
-   if ( m_pOptions->m_autoMergeRegExp.isEmpty() )
-      return;
+   resetSelection();
 
-   QRegExp vcsKeywords( m_pOptions->m_autoMergeRegExp );
-   MergeLineList::iterator i;
-   for ( i=m_mergeLineList.begin(); i!=m_mergeLineList.end(); ++i )
-   {
-      if (i->bConflict )
-      {
-         Diff3LineList::const_iterator id3l = i->id3l;
-         if ( vcsKeywords.exactMatch( id3l->getString(A) ) && 
-              vcsKeywords.exactMatch( id3l->getString(B) ) &&
-              (m_pldC==0 || vcsKeywords.exactMatch( id3l->getString(C) )))
-         {
-            MergeEditLine& mel = *i->mergeEditLineList.begin();
-            mel.setSource( m_pldC==0 ? B : C, false );
-            splitAtDiff3LineIdx( i->d3lLineIdx+1 );
-         }
-      }
-   }
+   merge( false, selector, bConflictsOnly, bWhiteSpaceOnly );
+   setModified( true );
    update();
+   int wsc;
+   int nofUnsolved = getNrOfUnsolvedConflicts(&wsc);
+   m_pStatusBar->showMessage( i18n("Number of remaining unsolved conflicts: %1 (of which %2 are whitespace)"
+         ,nofUnsolved,wsc) );
 }
 
-// This doesn't detect user modifications and should only be called after automatic merge
-// This will only do something for three file merge.
-// Irrelevant changes are those where all contributions from B are already contained in C.
-// Also irrelevant are conflicts automatically solved (automerge regexp and history automerge)
-// Precondition: The VCS-keyword would also be C.
-bool MergeResultWindow::doRelevantChangesExist()
+void MergeResultWindow::slotAutoSolve()
 {
-   if ( m_pldC==0 || m_mergeLineList.size() <= 1 )
-      return true;
-
-   MergeLineList::iterator i;
-   for ( i=m_mergeLineList.begin(); i!=m_mergeLineList.end(); ++i )
-   {
-      if ( ( i->bConflict && i->mergeEditLineList.begin()->src()!=C )
-         || i->srcSelect == B )
-      {
-         return true;
-      }
-   }
+   resetSelection();
+   merge( true, -1 );
+   setModified( true );
+   update();
+   int wsc;
+   int nofUnsolved = getNrOfUnsolvedConflicts(&wsc);
+   m_pStatusBar->showMessage( i18n("Number of remaining unsolved conflicts: %1 (of which %2 are whitespace)"
+         ,nofUnsolved,wsc) );
+}
 
-   return false;
+void MergeResultWindow::slotUnsolve()
+{
+   resetSelection();
+   merge( false, -1 );
+   setModified( true );
+   update();
+   int wsc;
+   int nofUnsolved = getNrOfUnsolvedConflicts(&wsc);
+   m_pStatusBar->showMessage( i18n("Number of remaining unsolved conflicts: %1 (of which %2 are whitespace)"
+         ,nofUnsolved,wsc) );
 }
 
-// Returns the iterator to the MergeLine after the split
-MergeResultWindow::MergeLineList::iterator MergeResultWindow::splitAtDiff3LineIdx( int d3lLineIdx )
+void MergeResultWindow::slotMergeHistory()
 {
-   MergeLineList::iterator i;
-   for ( i = m_mergeLineList.begin();  i!=m_mergeLineList.end(); ++i )
+   ++m_contentGeneration;
+   MergeLineList::iterator iMLLStart = m_mergeEngine.mergeHistory();
+   m_bNavigationIndexValid = false;
+   if ( iMLLStart != m_mergeLineList.end() )
    {
-      if ( i->d3lLineIdx==d3lLineIdx )
-      {
-         // No split needed, this is the beginning of a MergeLine
-         return i;
-      }
-      else if ( i->d3lLineIdx > d3lLineIdx )
-      {
-         // The split must be in the previous MergeLine
-         --i;
-         MergeLine& ml = *i;
-         MergeLine newML;
-         ml.split(newML,d3lLineIdx);
-         ++i;
-         return m_mergeLineList.insert( i, newML );
-      }
+      setFastSelector( iMLLStart );
+      update();
    }
-   // The split must be in the previous MergeLine
-   --i;
-   MergeLine& ml = *i;
-   MergeLine newML;
-   ml.split(newML,d3lLineIdx);
-   ++i;
-   return m_mergeLineList.insert( i, newML );
+}
+
+void MergeResultWindow::slotRegExpAutoMerge()
+{
+   ++m_contentGeneration;
+   m_mergeEngine.regExpAutoMerge();
+   m_bNavigationIndexValid = false;
+   update();
 }
 
 void MergeResultWindow::slotSplitDiff( int firstD3lLineIdx, int lastD3lLineIdx )
 {
+   m_undoStepGeneration = m_contentGeneration;
+   m_mergeEngine.beginUndoStepForDiff3Lines( firstD3lLineIdx, max2( firstD3lLineIdx, lastD3lLineIdx+1 ), m_cursorYPos, m_cursorXPos );
+   ++m_contentGeneration;
    if (lastD3lLineIdx>=0)
       splitAtDiff3LineIdx( lastD3lLineIdx + 1 );
    setFastSelector( splitAtDiff3LineIdx(firstD3lLineIdx) );
+   endUndoStep();
 }
 
-void MergeResultWindow::slotJoinDiffs( int firstD3lLineIdx, int lastD3lLineIdx )
+MergeResultWindow::MergeLineList::iterator MergeResultWindow::splitAtDiff3LineIdx( int d3lLineIdx )
 {
-   MergeLineList::iterator i;
-   MergeLineList::iterator iMLLStart = m_mergeLineList.end();
-   MergeLineList::iterator iMLLEnd   = m_mergeLineList.end();
-   for ( i=m_mergeLineList.begin(); i!=m_mergeLineList.end(); ++i )
+   MergeLineList::iterator i = m_mergeEngine.splitAtDiff3LineIdx( d3lLineIdx );
+   // Both parts changed.
+   if ( i!=m_mergeLineList.begin() )
    {
-      MergeLine& ml = *i;
-      if ( firstD3lLineIdx >= ml.d3lLineIdx && firstD3lLineIdx < ml.d3lLineIdx + ml.srcRangeLength )
-      {
-         iMLLStart = i;
-      }
-      if ( lastD3lLineIdx >= ml.d3lLineIdx && lastD3lLineIdx < ml.d3lLineIdx + ml.srcRangeLength )
-      {
-         iMLLEnd = i;
-         ++iMLLEnd;
-         break;
-      }
+      MergeLineList::iterator iPrev = i;
+      --iPrev;
+      updateNavigationIndex( iPrev );
    }
+   updateNavigationIndex( i );
+   return i;
+}
 
-   bool bJoined = false;
-   for( i=iMLLStart;  i!=iMLLEnd && i!=m_mergeLineList.end(); )
-   {
-      if ( i==iMLLStart )
-      {
-         ++i;
-      }
-      else
-      {
-         iMLLStart->join(*i);
-         i = m_mergeLineList.erase( i );
-         bJoined = true;
-      }
-   }
-   if (bJoined)
-   {
-      iMLLStart->mergeEditLineList.clear();
-      // Insert a conflict line as placeholder
-      iMLLStart->mergeEditLineList.push_back( MergeEditLine( iMLLStart->id3l ) );
-   }
-   setFastSelector( iMLLStart );
+void MergeResultWindow::slotJoinDiffs( int firstD3lLineIdx, int lastD3lLineIdx )
+{
+   m_undoStepGeneration = m_contentGeneration;
+   m_mergeEngine.beginUndoStepForDiff3Lines( firstD3lLineIdx, lastD3lLineIdx, m_cursorYPos, m_cursorXPos );
+   ++m_contentGeneration;
+   MergeLineList::iterator i = m_mergeEngine.joinDiffs( firstD3lLineIdx, lastD3lLineIdx );
+   updateNavigationIndex( i );
+   setFastSelector( i );
+   endUndoStep();
 }
 
 void MergeResultWindow::myUpdate(int afterMilliSecs)
@@ -1598,37 +717,6 @@ void MergeResultWindow::timerEvent(QTimerEvent*)
    }
 }
 
-QString MergeResultWindow::MergeEditLine::getString( const MergeResultWindow* mrw )
-{
-   if ( isRemoved() )   { return QString(); }
-
-   if ( ! isModified() )
-   {
-      int src = m_src;
-      if ( src == 0 )   { return QString(); }
-      const Diff3Line& d3l = *m_id3l;
-      const LineData* pld = 0;
-      assert( src == A || src == B || src == C );
-      if      ( src == A && d3l.lineA!=-1 ) pld = &mrw->m_pldA[ d3l.lineA ];
-      else if ( src == B && d3l.lineB!=-1 ) pld = &mrw->m_pldB[ d3l.lineB ];
-      else if ( src == C && d3l.lineC!=-1 ) pld = &mrw->m_pldC[ d3l.lineC ];
-
-      if ( pld == 0 )
-      {
-         // assert(false);      This is no error.
-         return QString();
-      }
-
-      return QString( pld->pLine, pld->size );
-   }
-   else
-   {
-      return m_str;
-   }
-   return 0;
-}
-
-/// Converts the cursor-posOnScreen into a text index, considering tabulators.
 int convertToPosInText( const QString& /*s*/, int posOnScreen, int /*tabSize*/ )
 {
    return posOnScreen;
@@ -1854,9 +942,9 @@ void MergeResultWindow::setPaintingAllowed(bool bPaintingAllowed)
    update();
 }
 
-void MergeResultWindow::paintEvent( QPaintEvent* )
+void MergeResultWindow::paintEvent( QPaintEvent* e )
 {
-   if (m_pDiff3LineList==0 || !m_bPaintingAllowed) 
+   if (m_mergeEngine.getDiff3LineList()==0 || !m_bPaintingAllowed) 
       return;
 
    bool bOldSelectionContainsData = m_selection.bSelectionContainsData;
@@ -1865,59 +953,64 @@ void MergeResultWindow::paintEvent( QPaintEvent* )
 
    if ( !m_bCursorUpdate )  // Don't redraw everything for blinking cursor?
    {
-      m_selection.bSelectionContainsData = false;
+      // After setFirstLine() scrolled the pixmap only the revealed lines must be drawn.
+      int fontHeight = fm.lineSpacing();
+      int firstLineToDraw = m_firstLine;
+      int lastLineToDraw = m_firstLine + getNofVisibleLines() + 5;
+      QRect drawRect = rect();
       if ( size() != m_pixmap.size() )
          m_pixmap = QPixmap(size());
+      else if ( !e->rect().contains( rect() ) )
+      {
+         firstLineToDraw = m_firstLine + e->rect().top() / fontHeight;
+         lastLineToDraw = min2( lastLineToDraw, m_firstLine + e->rect().bottom() / fontHeight );
+         drawRect = QRect( 0, (firstLineToDraw-m_firstLine)*fontHeight, width(), (lastLineToDraw-firstLineToDraw+1)*fontHeight );
+      }
+      if ( drawRect == rect() )
+         m_selection.bSelectionContainsData = false;
 
       MyPainter p(&m_pixmap, m_pOptions->m_bRightToLeftLanguage, width(), fontWidth);
       p.setFont( font() );
-      p.QPainter::fillRect( rect(), m_pOptions->m_bgColor );
+      p.QPainter::fillRect( drawRect, m_pOptions->m_bgColor );
 
-      //int visibleLines = height() / fontHeight;
-
-      int lastVisibleLine = m_firstLine + getNofVisibleLines() + 5;
-      int line = 0;
-      MergeLineList::iterator mlIt = m_mergeLineList.begin();
-      for(mlIt = m_mergeLineList.begin();mlIt!=m_mergeLineList.end(); ++mlIt)
+      int line = firstLineToDraw;
+      lastLineToDraw = min2( lastLineToDraw, m_mergeEngine.getTotalSize()-1 );
+      if ( line <= lastLineToDraw )
       {
-         MergeLine& ml = *mlIt;
-         if ( line > lastVisibleLine  || line + ml.mergeEditLineList.size() < m_firstLine)
-         {
-            line += ml.mergeEditLineList.size();
-         }
-         else
+         MergeLineList::iterator mlIt;
+         MergeEditLineList::iterator melIt;
+         calcIteratorFromLineNr( line, mlIt, melIt );
+         for( ; line<=lastLineToDraw; ++line )
          {
-            MergeEditLineList::iterator melIt;
-            for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); ++melIt )
-            {
-               if (line>=m_firstLine && line<=lastVisibleLine)
-               {
-                  MergeEditLine& mel = *melIt;
-                  MergeEditLineList::iterator melIt1 = melIt;
-                  ++melIt1;
+            MergeLine& ml = *mlIt;
+            MergeEditLine& mel = *melIt;
+            MergeEditLineList::iterator melIt1 = melIt;
+            ++melIt1;
 
-                  int rangeMark = 0;
-                  if ( melIt==ml.mergeEditLineList.begin() ) rangeMark |= 1; // Begin range mark
-                  if ( melIt1==ml.mergeEditLineList.end() )  rangeMark |= 2; // End range mark
+            int rangeMark = 0;
+            if ( melIt==ml.mergeEditLineList.begin() ) rangeMark |= 1; // Begin range mark
+            if ( melIt1==ml.mergeEditLineList.end() )  rangeMark |= 2; // End range mark
 
-                  if ( mlIt == m_currentMergeLineIt )        rangeMark |= 4; // Mark of the current line
+            if ( mlIt == m_currentMergeLineIt )        rangeMark |= 4; // Mark of the current line
 
-                  QString s;
-                  s = mel.getString( this );
+            QString s;
+            s = mel.getString( &m_mergeEngine );
 
-                  writeLine( p, line, s, mel.src(), ml.mergeDetails, rangeMark,
-                     mel.isModified(), mel.isRemoved(), ml.bWhiteSpaceConflict );
-               }
-               ++line;
+            writeLine( p, line, s, mel.src(), ml.mergeDetails, rangeMark,
+               mel.isModified(), mel.isRemoved(), ml.bWhiteSpaceConflict );
+
+            melIt = melIt1;
+            while ( melIt==mlIt->mergeEditLineList.end() && line<lastLineToDraw )
+            {
+               ++mlIt;
+               melIt = mlIt->mergeEditLineList.begin();
             }
          }
       }
 
-      if ( line != m_nofLines )
+      if ( m_mergeEngine.getTotalSize() != m_nofLines )
       {
-         m_nofLines = line;
-         assert( m_nofLines == m_totalSize );
-
+         m_nofLines = m_mergeEngine.getTotalSize();
          emit resizeSignal();
       }
 
@@ -1955,14 +1048,14 @@ void MergeResultWindow::updateSourceMask()
 {
    int srcMask=0; 
    int enabledMask = 0;
-   if( !hasFocus() || m_pDiff3LineList==0 || !m_bPaintingAllowed || m_currentMergeLineIt == m_mergeLineList.end() )
+   if( !hasFocus() || m_mergeEngine.getDiff3LineList()==0 || !m_bPaintingAllowed || m_currentMergeLineIt == m_mergeLineList.end() )
    {
       srcMask = 0;
       enabledMask = 0;
    }
    else
    {
-      enabledMask = m_pldC==0 ? 3 : 7;
+      enabledMask = m_mergeEngine.isThreeWay() ? 7 : 3;
       MergeLine& ml = *m_currentMergeLineIt;
 
       srcMask = 0;
@@ -2001,7 +1094,7 @@ int MergeResultWindow::convertToLine( int y )
 
    int yOffset = topLineYOffset - m_firstLine * fontHeight;
 
-   int line = min2( ( y - yOffset ) / fontHeight, m_totalSize-1 );
+   int line = min2( ( y - yOffset ) / fontHeight, m_mergeEngine.getTotalSize()-1 );
    return line;
 }
 
@@ -2229,7 +1322,7 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
    MergeEditLineList::iterator melIt;
    calcIteratorFromLineNr( y, mlIt, melIt );
 
-   QString str = melIt->getString( this );
+   QString str = melIt->getString( &m_mergeEngine );
    int x = convertToPosInText( str, m_cursorXPos, m_pOptions->m_tabSize );
 
    QTextLayout textLayoutOrig( str, font(), this );
@@ -2243,6 +1336,7 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
    #endif
 
    bool bYMoveKey = false;
+   bool bUndoStep = false;
    // Special keys
    switch ( e->key() )
    {
@@ -2251,11 +1345,13 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
       case  Qt::Key_Backtab:      break;
       case  Qt::Key_Delete:
       {
+         beginUndoStep( y, y+1 );
+         bUndoStep = true;
          if ( deleteSelection2( str, x, y, mlIt, melIt )) break;
          if( !melIt->isEditableText() )  break;
          if (x>=(int)str.length())
          {
-            if ( y<m_totalSize-1 )
+            if ( y<m_mergeEngine.getTotalSize()-1 )
             {
                setModified();
                MergeLineList::iterator mlIt1;
@@ -2263,7 +1359,7 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
                calcIteratorFromLineNr( y+1, mlIt1, melIt1 );
                if ( melIt1->isEditableText() )
                {
-                  QString s2 = melIt1->getString( this );
+                  QString s2 = melIt1->getString( &m_mergeEngine );
                   melIt->setString( str + s2 );
 
                   // Remove the line
@@ -2285,6 +1381,8 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
       }
       case  Qt::Key_Backspace:
       {
+         beginUndoStep( y-1, y );
+         bUndoStep = true;
          if ( deleteSelection2( str, x, y, mlIt, melIt )) break;
          if( !melIt->isEditableText() )  break;
          if (x==0)
@@ -2297,7 +1395,7 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
                calcIteratorFromLineNr( y-1, mlIt1, melIt1 );
                if ( melIt1->isEditableText() )
                {
-                  QString s1 = melIt1->getString( this );
+                  QString s1 = melIt1->getString( &m_mergeEngine );
                   melIt1->setString( s1 + str );
 
                   // Remove the previous line
@@ -2325,6 +1423,8 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
       case  Qt::Key_Enter:
       {
          if( !melIt->isEditableText() )  break;
+         beginUndoStep( y, y );
+         bUndoStep = true;
          deleteSelection2( str, x, y, mlIt, melIt );
          setModified();
          QString indentation;
@@ -2333,7 +1433,7 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
             MergeLineList::iterator mlIt1 = mlIt;
             MergeEditLineList::iterator melIt1 = melIt;
             for(;;) {
-               const QString s = melIt1->getString(this);
+               const QString s = melIt1->getString( &m_mergeEngine );
                if ( !s.isEmpty() ) {
                   int i;
                   for( i=0; i<s.length(); ++i ){ if(s[i]!=' ' && s[i]!='\t') break; }
@@ -2408,7 +1508,7 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
             if ( !bCtrl )
             {
                int newX = textLayoutOrig.nextCursorPosition(x);
-               if( newX == x && y<m_totalSize-1){ ++y; x=0; }
+               if( newX == x && y<m_mergeEngine.getTotalSize()-1){ ++y; x=0; }
                else                             { x = newX; }
             }
             else
@@ -2447,6 +1547,8 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
             else
             {
                if( !melIt->isEditableText() )  break;
+               beginUndoStep( y, y );
+               bUndoStep = true;
                deleteSelection2( str, x, y, mlIt, melIt );
 
                setModified();
@@ -2470,10 +1572,10 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
       }
    }
 
-   y = minMaxLimiter( y, 0, m_totalSize-1 );
+   y = minMaxLimiter( y, 0, m_mergeEngine.getTotalSize()-1 );
 
    calcIteratorFromLineNr( y, mlIt, melIt );
-   str = melIt->getString( this );
+   str = melIt->getString( &m_mergeEngine );
 
    x = minMaxLimiter( x, 0, (int)str.length() );
 
@@ -2524,6 +1626,8 @@ void MergeResultWindow::keyPressEvent( QKeyEvent* e )
 
    m_cursorYPos = y;
    m_cursorXPos = newCursorX;
+   if ( bUndoStep )
+      endUndoStep();
 
    // TODO if width of current line exceeds the current maximum width then force recalculating the scrollbars
    if ( textLayout.maximumWidth()>getMaxTextWidth() )
@@ -2551,23 +1655,7 @@ void MergeResultWindow::calcIteratorFromLineNr(
    MergeResultWindow::MergeEditLineList::iterator& melIt
    )
 {
-   for( mlIt = m_mergeLineList.begin(); mlIt!=m_mergeLineList.end(); ++mlIt)
-   {
-      MergeLine& ml = *mlIt;
-      if ( line > ml.mergeEditLineList.size() )
-      {
-         line -= ml.mergeEditLineList.size();
-      }
-      else
-      {
-         for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); ++melIt )
-         {
-            --line;
-            if (line<0) return;
-         }
-      }
-   }
-   assert(false);
+   m_mergeEngine.calcIteratorFromLineNr( line, mlIt, melIt );
 }
 
 
@@ -2590,7 +1678,7 @@ QString MergeResultWindow::getSelection()
             int outPos = 0;
             if (mel.isEditableText())
             {
-               const QString str = mel.getString( this );
+               const QString str = mel.getString( &m_mergeEngine );
 
                // Consider tabs
 
@@ -2639,7 +1727,7 @@ bool MergeResultWindow::deleteSelection2( QString& s, int& x, int& y,
       deleteSelection();
       y = m_cursorYPos;
       calcIteratorFromLineNr( y, mlIt, melIt );
-      s = melIt->getString( this );
+      s = melIt->getString( &m_mergeEngine );
       x = convertToPosInText( s, m_cursorXPos, m_pOptions->m_tabSize );
       return true;
    }
@@ -2652,7 +1740,6 @@ void MergeResultWindow::deleteSelection()
    {
       return;
    }
-   setModified();
 
    int line = 0;
    MergeLineList::iterator mlItFirst;
@@ -2686,6 +1773,8 @@ void MergeResultWindow::deleteSelection()
    {
       return; // Nothing to delete.
    }
+   beginUndoStep( firstLine, lastLine );
+   setModified();
 
    line = 0;
    for(mlIt = m_mergeLineList.begin();mlIt!=m_mergeLineList.end(); ++mlIt)
@@ -2700,7 +1789,7 @@ void MergeResultWindow::deleteSelection()
 
          if ( mel.isEditableText()  &&  m_selection.lineWithin(line) )
          {
-            QString lineString = mel.getString( this );
+            QString lineString = mel.getString( &m_mergeEngine );
 
             int firstPosInLine = m_selection.firstPosInLine(line);
             int lastPosInLine = m_selection.lastPosInLine(line);
@@ -2741,10 +1830,12 @@ void MergeResultWindow::deleteSelection()
    m_cursorOldXPixelPos = m_cursorXPixelPos;
 
    m_selection.reset();
+   endUndoStep();
 }
 
 void MergeResultWindow::pasteClipboard( bool bFromSelection )
 {
+   beginUndoStep( m_cursorYPos, m_cursorYPos );
    if (m_selection.firstLine != -1 )
       deleteSelection();
 
@@ -2756,7 +1847,7 @@ void MergeResultWindow::pasteClipboard( bool bFromSelection )
    calcIteratorFromLineNr( y, mlIt, melIt );
    melItAfter = melIt;
    ++melItAfter;
-   QString str = melIt->getString( this );
+   QString str = melIt->getString( &m_mergeEngine );
    int x = convertToPosInText( str, m_cursorXPos, m_pOptions->m_tabSize );
 
    if ( !QApplication::clipboard()->supportsSelection() )
@@ -2790,10 +1881,12 @@ void MergeResultWindow::pasteClipboard( bool bFromSelection )
 
    currentLine += endOfLine;
    melIt->setString( currentLine );
+   updateNavigationIndex( mlIt );  // Pasting into a conflict solves it
 
    m_cursorYPos = y;
    m_cursorXPos = convertToPosOnScreen( currentLine, x, m_pOptions->m_tabSize );
    m_cursorOldXPixelPos = m_cursorXPixelPos;
+   endUndoStep();
 
    update();
 }
@@ -2804,8 +1897,73 @@ void MergeResultWindow::resetSelection()
    update();
 }
 
+// Begins an undo step for an edit of the lines [firstLine,lastLine]. A selection with
+// data is included, because the edit might delete it first.
+void MergeResultWindow::beginUndoStep( int firstLine, int lastLine )
+{
+   if ( m_selection.firstLine!=-1 && m_selection.bSelectionContainsData )
+   {
+      firstLine = min2( firstLine, m_selection.beginLine() );
+      lastLine = max2( lastLine, m_selection.endLine() );
+   }
+   if ( !m_mergeEngine.isInUndoStep() )
+      m_undoStepGeneration = m_contentGeneration;
+   m_mergeEngine.beginUndoStep( firstLine, lastLine, m_cursorYPos, m_cursorXPos );
+}
+
+// Keeps the step only if the edit changed something.
+void MergeResultWindow::endUndoStep()
+{
+   bool bCouldUndo = canUndo();
+   bool bCouldRedo = canRedo();
+   m_mergeEngine.endUndoStep( m_contentGeneration!=m_undoStepGeneration, m_cursorYPos, m_cursorXPos );
+   if ( bCouldUndo!=canUndo() || bCouldRedo!=canRedo() )
+      emit updateAvailabilities();
+}
+
+void MergeResultWindow::slotUndo()
+{
+   undoRedo( true );
+}
+
+void MergeResultWindow::slotRedo()
+{
+   undoRedo( false );
+}
+
+void MergeResultWindow::undoRedo( bool bUndo )
+{
+   int cursorLine = 0;
+   int cursorPos = 0;
+   if ( ! ( bUndo ? m_mergeEngine.undo( cursorLine, cursorPos ) : m_mergeEngine.redo( cursorLine, cursorPos ) ) )
+      return;
+
+   // Split and join replace MergeLines, so the current one must be set again.
+   m_cursorYPos = minMaxLimiter( cursorLine, 0, m_mergeEngine.getTotalSize()-1 );
+   m_cursorXPos = cursorPos;
+   m_cursorOldXPixelPos = m_cursorXPixelPos;
+   MergeLineList::iterator mlIt;
+   MergeEditLineList::iterator melIt;
+   calcIteratorFromLineNr( m_cursorYPos, mlIt, melIt );
+   m_currentMergeLineIt = mlIt;
+   m_bNavigationIndexValid = false;
+   m_selection.reset();
+   m_maxTextWidth = -1;
+   setModified();
+
+   emit setFastSelectorRange( mlIt->d3lLineIdx, mlIt->srcRangeLength );
+   int newFirstLine = getBestFirstLine( m_cursorYPos, 1, m_firstLine, getNofVisibleLines() );
+   if ( newFirstLine != m_firstLine )
+      scroll( 0, newFirstLine - m_firstLine );
+
+   update();
+   updateSourceMask();
+   emit updateAvailabilities();
+}
+
 void MergeResultWindow::setModified(bool bModified)
 {
+   ++m_contentGeneration;  // All edits and merges come here.
    if (bModified != m_bModified)
    {
       m_bModified = bModified;
@@ -2837,57 +1995,10 @@ bool MergeResultWindow::saveDocument( const QString& fileName, QTextCodec* pEnco
 
    update();
 
-   FileAccess file( fileName, true /*bWantToWrite*/ );
-   if ( m_pOptions->m_bDmCreateBakFiles && file.exists() )
-   {
-      bool bSuccess = file.createBackup(".orig");
-      if ( !bSuccess )
-      {
-         KMessageBox::error( this, file.getStatusText() + i18n("\n\nCreating backup failed. File not saved."), i18n("File Save Error") );
-         return false;
-      }
-   }
-
-   QByteArray dataArray;
-   QTextStream textOutStream(&dataArray, QIODevice::WriteOnly);
-   if ( pEncoding->name()=="UTF-8" )
-      textOutStream.setGenerateByteOrderMark( false ); // Shouldn't be necessary. Bug in Qt or docs
-   else
-      textOutStream.setGenerateByteOrderMark( true ); // Only for UTF-16
-   textOutStream.setCodec( pEncoding );
-
-   int line = 0;
-   MergeLineList::iterator mlIt = m_mergeLineList.begin();
-   for(mlIt = m_mergeLineList.begin();mlIt!=m_mergeLineList.end(); ++mlIt)
-   {
-      MergeLine& ml = *mlIt;
-      MergeEditLineList::iterator melIt;
-      for( melIt = ml.mergeEditLineList.begin(); melIt != ml.mergeEditLineList.end(); ++melIt )
-      {
-         MergeEditLine& mel = *melIt;
-
-         if ( mel.isEditableText() )
-         {
-            QString str = mel.getString( this );
-
-            if (line>0) // Prepend line feed, but not for first line
-            {
-               if ( eLineEndStyle == eLineEndStyleDos )
-               {   str.prepend("\r\n"); }
-               else
-               {   str.prepend("\n");   }
-            }
-
-            textOutStream << str;
-            ++line;
-         }
-      }
-   }
-   textOutStream.flush();
-   bool bSuccess = file.writeFile( dataArray.data(), dataArray.size() );
-   if ( ! bSuccess )
+   QString errorText;
+   if ( ! m_mergeEngine.saveDocument( fileName, pEncoding, eLineEndStyle, errorText ) )
    {
-      KMessageBox::error( this, i18n("Error while writing."), i18n("File Save Error") );
+      KMessageBox::error( this, errorText, i18n("File Save Error") );
       return false;
    }
 
@@ -2902,34 +2013,31 @@ QString MergeResultWindow::getString( int lineIdx )
    MergeResultWindow::MergeLineList::iterator mlIt;
    MergeResultWindow::MergeEditLineList::iterator melIt;
    calcIteratorFromLineNr( lineIdx, mlIt, melIt );
-   QString s = melIt->getString( this );
+   QString s = melIt->getString( &m_mergeEngine );
    return s;
 }
 
-bool MergeResultWindow::findString( const QString& s, int& d3vLine, int& posInLine, bool bDirDown, bool bCaseSensitive )
+void MergeResultWindow::findAll( const FindPattern& pattern, FindHitList& hits )
 {
-   int it = d3vLine;
-   int endIt = bDirDown ? getNofLines() : -1;
-   int step =  bDirDown ? 1 : -1;
-   int startPos = posInLine;
-
-   for( ; it!=endIt; it+=step )
+   int line = 0;
+   for( MergeLineList::iterator mlIt = m_mergeLineList.begin(); mlIt!=m_mergeLineList.end(); ++mlIt )
    {
-      QString line = getString( it );
-      if ( !line.isEmpty() )
+      MergeEditLineList& mell = mlIt->mergeEditLineList;
+      for( MergeEditLineList::iterator melIt = mell.begin(); melIt!=mell.end(); ++melIt, ++line )
       {
-         int pos = line.indexOf( s, startPos, bCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive );
-         if ( pos != -1 )
+         if ( melIt->isModified() )
          {
-            d3vLine = it;
-            posInLine = pos;
-            return true;
+            QString s = melIt->getString( &m_mergeEngine );  // Shared, not copied
+            findAllInLine( pattern, s.constData(), s.length(), 4, line, hits );
+         }
+         else
+         {
+            const LineData* pld = melIt->getLineData( &m_mergeEngine );
+            if ( pld!=0 )
+               findAllInLine( pattern, pld->getLine(), pld->size(), 4, line, hits );
          }
-
-         startPos = 0;
       }
    }
-   return false;
 }
 
 void MergeResultWindow::setSelection( int firstLine, int startPos, int lastLine, int endPos )
@@ -2955,6 +2063,8 @@ Overview::Overview( Options* pOptions )
    m_eOverviewMode = eOMNormal;
    m_nofLines = 1;
    m_bPaintingAllowed = false;
+   m_eRunsMode = eOMNormal;
+   m_bRunsValid = false;
    setFixedWidth(20);
 }
 
@@ -2962,6 +2072,7 @@ void Overview::init( Diff3LineList* pDiff3LineList, bool bTripleDiff )
 {
    m_pDiff3LineList = pDiff3LineList;
    m_bTripleDiff = bTripleDiff;
+   m_bRunsValid = false;
    m_pixmap = QPixmap( QSize(0,0) );   // make sure that a redraw happens
    update();
 }
@@ -2969,10 +2080,15 @@ void Overview::init( Diff3LineList* pDiff3LineList, bool bTripleDiff )
 void Overview::reset()
 {
    m_pDiff3LineList = 0;
+   m_bRunsValid = false;
+   m_runsNormal.clear();
+   m_runsMode.clear();
 }
 
+// Called after the word wrap or the displayed options changed.
 void Overview::slotRedraw()
 {
+   m_bRunsValid = false;
    m_pixmap = QPixmap( QSize(0,0) );   // make sure that a redraw happens
    update();
 }
@@ -3023,45 +2139,35 @@ void Overview::setPaintingAllowed( bool bAllowPainting )
    }
 }
 
-void Overview::drawColumn( QPainter& p, e_OverviewMode eOverviewMode, int x, int w, int h, int nofLines )
+void Overview::calcRuns( e_OverviewMode eOverviewMode, RunList& runs )
 {
-   p.setPen(Qt::black);
-   p.drawLine( x, 0, x, h );
-
-   if (nofLines==0) return;
-   
+   runs.clear();
    int line = 0;
-   int oldY = 0;
-   int oldConflictY = -1;
-   int wrapLineIdx=0;
    Diff3LineList::const_iterator i;
-   for( i = m_pDiff3LineList->begin(); i!= m_pDiff3LineList->end();  )
+   for( i = m_pDiff3LineList->begin(); i!= m_pDiff3LineList->end(); ++i )
    {
       const Diff3Line& d3l = *i;
-      int y = h * (line+1) / nofLines;
       e_MergeDetails md;
       bool bConflict;
       bool bLineRemoved;
       int src;
-      mergeOneLine( d3l, md, bConflict, bLineRemoved, src, !m_bTripleDiff );
+      getMergeDetails( d3l, md, bConflict, bLineRemoved, src );
 
-      QColor c = m_pOptions->m_bgColor;
+      e_RunColor c = eRunNone;
       bool bWhiteSpaceChange = false;
-      //if( bConflict )  c=m_pOptions->m_colorForConflict;
-      //else
       if ( eOverviewMode==eOMNormal )
       {
          switch( md )
          {
          case eDefault:
          case eNoChange:
-                        c = m_pOptions->m_bgColor;
+                        c = eRunNone;
                         break;
 
          case eBAdded:
          case eBDeleted:
          case eBChanged:
-                        c = bConflict ? m_pOptions->m_colorForConflict : m_pOptions->m_colorB;
+                        c = bConflict ? eRunConflict : eRunB;
                         bWhiteSpaceChange = d3l.bAEqB || (d3l.bWhiteLineA && d3l.bWhiteLineB);
                         break;
 
@@ -3069,7 +2175,7 @@ void Overview::drawColumn( QPainter& p, e_OverviewMode eOverviewMode, int x, int
          case eCDeleted:
          case eCChanged:
                         bWhiteSpaceChange = d3l.bAEqC || (d3l.bWhiteLineA && d3l.bWhiteLineC);
-                        c = bConflict ? m_pOptions->m_colorForConflict : m_pOptions->m_colorC;
+                        c = bConflict ? eRunConflict : eRunC;
                         break;
 
          case eBCChanged:         // conflict
@@ -3079,7 +2185,7 @@ void Overview::drawColumn( QPainter& p, e_OverviewMode eOverviewMode, int x, int
          case eCChanged_BDeleted: // conflict
          case eBCAdded:           // conflict
          case eBCAddedAndEqual:   // possible conflict
-                     c=m_pOptions->m_colorForConflict;
+                     c = eRunConflict;
                      break;
          default: assert(false); break;
          }
@@ -3093,7 +2199,7 @@ void Overview::drawColumn( QPainter& p, e_OverviewMode eOverviewMode, int x, int
          case eCAdded:
          case eCDeleted:
          case eCChanged:  break;
-         default:         c = m_pOptions->m_colorForConflict;
+         default:         c = eRunConflict;
                           bWhiteSpaceChange = d3l.bAEqB || (d3l.bWhiteLineA && d3l.bWhiteLineB);
                           break;
          }
@@ -3107,7 +2213,7 @@ void Overview::drawColumn( QPainter& p, e_OverviewMode eOverviewMode, int x, int
          case eBAdded:
          case eBDeleted:
          case eBChanged:  break;
-         default:         c = m_pOptions->m_colorForConflict;
+         default:         c = eRunConflict;
                           bWhiteSpaceChange = d3l.bAEqC || (d3l.bWhiteLineA && d3l.bWhiteLineC);
                           break;
          }
@@ -3121,60 +2227,98 @@ void Overview::drawColumn( QPainter& p, e_OverviewMode eOverviewMode, int x, int
          case eBCChangedAndEqual:
          case eBCDeleted:      
          case eBCAddedAndEqual:   break;
-         default:                 c=m_pOptions->m_colorForConflict;
+         default:                 c = eRunConflict;
                                   bWhiteSpaceChange = d3l.bBEqC || (d3l.bWhiteLineB && d3l.bWhiteLineC);
                                   break;
          }
       }
-      
-      int x2 = x;
-      int w2 = w;
-      
+
+      e_RunPart part = eRunFull;
       if ( ! m_bTripleDiff )
       {
          if ( d3l.lineA == -1 && d3l.lineB>=0 )
          {
-            c = m_pOptions->m_colorA;
-            x2 = w/2;
-            w2 = x2;
+            c = eRunA;
+            part = eRunRightHalf;
          }
          if ( d3l.lineA >= 0 && d3l.lineB==-1 )
          {
-            c = m_pOptions->m_colorB;
-            w2 = w/2;
+            c = eRunB;
+            part = eRunLeftHalf;
          }
       }
 
-      if (!bWhiteSpaceChange || m_pOptions->m_bShowWhiteSpace )
+      line += m_pOptions->m_bWordWrap ? d3l.linesNeededForDisplay : 1;
+
+      if ( !runs.empty() && runs.back().color==c && runs.back().part==part && runs.back().bWhiteSpaceChange==bWhiteSpaceChange )
+      {
+         runs.back().endLine = line;
+      }
+      else
+      {
+         Run r;
+         r.endLine = line;
+         r.color = c;
+         r.part = part;
+         r.bWhiteSpaceChange = bWhiteSpaceChange;
+         runs.push_back( r );
+      }
+   }
+   m_nofLines = line;
+}
+
+void Overview::drawColumn( QPainter& p, const RunList& runs, int x, int w, int h, int nofLines )
+{
+   p.setPen(Qt::black);
+   p.drawLine( x, 0, x, h );
+
+   if (nofLines==0) return;
+   
+   int oldY = 0;
+   int oldConflictY = -1;
+   RunList::const_iterator i;
+   for( i = runs.begin(); i!= runs.end(); ++i )
+   {
+      const Run& r = *i;
+      int y = h * r.endLine / nofLines;
+
+      QColor c = m_pOptions->m_bgColor;
+      switch( r.color )
+      {
+      case eRunA:        c = m_pOptions->m_colorA; break;
+      case eRunB:        c = m_pOptions->m_colorB; break;
+      case eRunC:        c = m_pOptions->m_colorC; break;
+      case eRunConflict: c = m_pOptions->m_colorForConflict; break;
+      default: break;
+      }
+
+      int x2 = x;
+      int w2 = w;
+      if ( r.part==eRunRightHalf )
+      {
+         x2 = w/2;
+         w2 = x2;
+      }
+      else if ( r.part==eRunLeftHalf )
+      {
+         w2 = w/2;
+      }
+
+      if (!r.bWhiteSpaceChange || m_pOptions->m_bShowWhiteSpace )
       {
          // Make sure that lines with conflict are not overwritten.
-         if (  c == m_pOptions->m_colorForConflict )
+         if ( r.color==eRunConflict )
          {
-            p.fillRect(x2+1, oldY, w2, max2(1,y-oldY), bWhiteSpaceChange ? QBrush(c,Qt::Dense4Pattern) : QBrush(c) );
+            p.fillRect(x2+1, oldY, w2, max2(1,y-oldY), r.bWhiteSpaceChange ? QBrush(c,Qt::Dense4Pattern) : QBrush(c) );
             oldConflictY = oldY;
          }
-         else if ( c!=m_pOptions->m_bgColor  &&  oldY>oldConflictY )
+         else if ( r.color!=eRunNone  &&  oldY>oldConflictY )
          {
-            p.fillRect(x2+1, oldY, w2, max2(1,y-oldY), bWhiteSpaceChange ? QBrush(c,Qt::Dense4Pattern) : QBrush(c) );
+            p.fillRect(x2+1, oldY, w2, max2(1,y-oldY), r.bWhiteSpaceChange ? QBrush(c,Qt::Dense4Pattern) : QBrush(c) );
          }
       }
 
       oldY = y;
-
-      ++line;
-      if ( m_pOptions->m_bWordWrap )
-      {
-         ++wrapLineIdx;
-         if(wrapLineIdx>=d3l.linesNeededForDisplay)
-         {
-            wrapLineIdx=0;
-            ++i;
-         }
-      }
-      else
-      {
-         ++i;
-      }
    }
 }
 
@@ -3187,18 +2331,17 @@ void Overview::paintEvent( QPaintEvent* )
 
    if ( m_pixmap.size() != size() )
    {
-      if ( m_pOptions->m_bWordWrap )
+      bool bModeColumn = m_bTripleDiff && m_eOverviewMode != eOMNormal;
+      if ( !m_bRunsValid )
       {
-         m_nofLines = 0;
-         Diff3LineList::const_iterator i;
-         for( i = m_pDiff3LineList->begin(); i!= m_pDiff3LineList->end(); ++i )
-         {
-            m_nofLines += i->linesNeededForDisplay;
-         }
+         calcRuns( eOMNormal, m_runsNormal );
+         m_runsMode.clear();
+         m_bRunsValid = true;
       }
-      else
+      if ( bModeColumn && ( m_runsMode.empty() || m_eRunsMode!=m_eOverviewMode ) )
       {
-         m_nofLines = m_pDiff3LineList->size();
+         calcRuns( m_eOverviewMode, m_runsMode );
+         m_eRunsMode = m_eOverviewMode;
       }
    
       m_pixmap = QPixmap( size() );
@@ -3206,14 +2349,14 @@ void Overview::paintEvent( QPaintEvent* )
       QPainter p(&m_pixmap);
       p.fillRect( rect(), m_pOptions->m_bgColor );
 
-      if ( !m_bTripleDiff || m_eOverviewMode == eOMNormal )
+      if ( !bModeColumn )
       {
-         drawColumn( p, eOMNormal, 0, w, h, m_nofLines );
+         drawColumn( p, m_runsNormal, 0, w, h, m_nofLines );
       }
       else
       {
-         drawColumn( p, eOMNormal, 0, w/2, h, m_nofLines );
-         drawColumn( p, m_eOverviewMode, w/2, w/2, h, m_nofLines );
+         drawColumn( p, m_runsNormal, 0, w/2, h, m_nofLines );
+         drawColumn( p, m_runsMode, w/2, w/2, h, m_nofLines );
       }
    }
 
@@ -3310,31 +2453,7 @@ void WindowTitleWidget::setLineEndStyles( e_LineEndStyle eLineEndStyleA, e_LineE
    m_pLineEndStyleSelector->addItem( i18n("Unix") + (unxUsers.isEmpty() ? QString("") : " (" + unxUsers + ")" )  );
    m_pLineEndStyleSelector->addItem( i18n("DOS")  + (dosUsers.isEmpty() ? QString("") : " (" + dosUsers + ")" )  );
 
-   e_LineEndStyle autoChoice = (e_LineEndStyle)m_pOptions->m_lineEndStyle;
-
-   if ( m_pOptions->m_lineEndStyle == eLineEndStyleAutoDetect )
-   {
-      if ( eLineEndStyleA != eLineEndStyleUndefined && eLineEndStyleB != eLineEndStyleUndefined && eLineEndStyleC != eLineEndStyleUndefined )
-      {
-         if ( eLineEndStyleA == eLineEndStyleB )
-            autoChoice = eLineEndStyleC;
-         else if ( eLineEndStyleA == eLineEndStyleC )
-            autoChoice = eLineEndStyleB;
-         else
-            autoChoice = eLineEndStyleConflict;          //conflict (not likely while only two values exist)
-      }
-      else 
-      {
-         e_LineEndStyle c1, c2;
-         if     ( eLineEndStyleA == eLineEndStyleUndefined ) { c1 = eLineEndStyleB; c2 = eLineEndStyleC; }
-         else if( eLineEndStyleB == eLineEndStyleUndefined ) { c1 = eLineEndStyleA; c2 = eLineEndStyleC; }
-         else /*if( eLineEndStyleC == eLineEndStyleUndefined )*/ { c1 = eLineEndStyleA; c2 = eLineEndStyleB; }
-         if ( c1 == c2 && c1!=eLineEndStyleUndefined )
-            autoChoice = c1;
-         else
-            autoChoice = eLineEndStyleConflict;
-      }
-   }
+   e_LineEndStyle autoChoice = getDefaultLineEndStyle( m_pOptions, eLineEndStyleA, eLineEndStyleB, eLineEndStyleC );
 
    if ( autoChoice == eLineEndStyleUnix )
       m_pLineEndStyleSelector->setCurrentIndex(0);
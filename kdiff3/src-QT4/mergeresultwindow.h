@@ -18,7 +18,8 @@
 #ifndef MERGERESULTWINDOW_H
 #define MERGERESULTWINDOW_H
 
-#include "diff.h"
+#include "mergeengine.h"
+#include "findengine.h"
 
 #include <QWidget>
 #include <QPixmap>
@@ -59,41 +60,30 @@ private:
    e_OverviewMode m_eOverviewMode;
    int m_nofLines;
 
+   // A column as runs of display lines that look the same. Calculated once per
+   // alignment and mode, so repainting (e.g. resizing) doesn't visit every line.
+   enum e_RunColor { eRunNone, eRunA, eRunB, eRunC, eRunConflict };
+   enum e_RunPart { eRunFull, eRunLeftHalf, eRunRightHalf };  // Two inputs: Line only in B or only in A
+   struct Run
+   {
+      int endLine;      // The display line after the run
+      unsigned char color;
+      unsigned char part;
+      bool bWhiteSpaceChange;
+   };
+   typedef std::vector<Run> RunList;
+   RunList m_runsNormal;
+   RunList m_runsMode;            // For the second column in triple diff mode
+   e_OverviewMode m_eRunsMode;    // The mode of m_runsMode
+   bool m_bRunsValid;
+
    virtual void paintEvent( QPaintEvent* e );
    virtual void mousePressEvent( QMouseEvent* e );
    virtual void mouseMoveEvent( QMouseEvent* e );
-   void drawColumn( QPainter& p, e_OverviewMode eOverviewMode, int x, int w, int h, int nofLines );
-};
-
-
-enum e_MergeDetails
-{
-   eDefault,
-   eNoChange,
-   eBChanged,
-   eCChanged,
-   eBCChanged,         // conflict
-   eBCChangedAndEqual, // possible conflict
-   eBDeleted,
-   eCDeleted,
-   eBCDeleted,         // possible conflict
-
-   eBChanged_CDeleted, // conflict
-   eCChanged_BDeleted, // conflict
-   eBAdded,
-   eCAdded,
-   eBCAdded,           // conflict
-   eBCAddedAndEqual    // possible conflict
+   void calcRuns( e_OverviewMode eOverviewMode, RunList& runs );
+   void drawColumn( QPainter& p, const RunList& runs, int x, int w, int h, int nofLines );
 };
 
-void mergeOneLine( const Diff3Line& d, e_MergeDetails& mergeDetails, bool& bConflict, bool& bLineRemoved, int& src, bool bTwoInputs );
-
-enum e_MergeSrcSelector
-{
-   A=1,
-   B=2,
-   C=3
-};
 
 class MergeResultWindow : public QWidget
 {
@@ -110,6 +100,7 @@ public:
       const LineData* pLineDataB, int sizeB,
       const LineData* pLineDataC, int sizeC,
       const Diff3LineList* pDiff3LineList,
+      const DiffBufferInfo* pDiffBufferInfo,
       TotalDiffStatus* pTotalDiffStatus
       );
 
@@ -117,6 +108,7 @@ public:
 
    bool saveDocument( const QString& fileName, QTextCodec* pEncoding, e_LineEndStyle eLineEndStyle );
    int getNrOfUnsolvedConflicts(int* pNrOfWhiteSpaceConflicts=0);
+   void reportMemory( MemoryReport& report ) { m_mergeEngine.reportMemory( report ); }
    void choose(int selector);
    void chooseGlobal(int selector, bool bConflictsOnly, bool bWhiteSpaceOnly );
 
@@ -134,10 +126,14 @@ public:
    bool isUnsolvedConflictAtCurrent();
    bool isUnsolvedConflictAboveCurrent();
    bool isUnsolvedConflictBelowCurrent();
-   bool findString( const QString& s, int& d3vLine, int& posInLine, bool bDirDown, bool bCaseSensitive );
+   void findAll( const FindPattern& pattern, FindHitList& hits );
+   // Changes whenever the text of the merge result might have changed.
+   unsigned int getContentGeneration() { return m_contentGeneration; }
    void setSelection( int firstLine, int startPos, int lastLine, int endPos );
    void setOverviewMode( Overview::e_OverviewMode eOverviewMode );
    Overview::e_OverviewMode getOverviewMode();
+   bool canUndo() { return m_mergeEngine.canUndo(); }
+   bool canRedo() { return m_mergeEngine.canRedo(); }
 public slots:
    void setFirstLine(int firstLine);
    void setHorizScrollOffset(int horizScrollOffset);
@@ -160,6 +156,8 @@ public slots:
    void slotSetFastSelectorLine(int);
    void setPaintingAllowed(bool);
    void updateSourceMask();
+   void slotUndo();
+   void slotRedo();
 
 signals:
    void scroll( int deltaX, int deltaY );
@@ -179,174 +177,18 @@ private:
 
    Options* m_pOptions;
 
-   const LineData* m_pldA;
-   const LineData* m_pldB;
-   const LineData* m_pldC;
-   int m_sizeA;
-   int m_sizeB;
-   int m_sizeC;
+   typedef MergeEngine::MergeEditLine MergeEditLine;
+   typedef MergeEngine::MergeEditLineList MergeEditLineList;
+   typedef MergeEngine::MergeLine MergeLine;
+   typedef MergeEngine::MergeLineList MergeLineList;
 
-   const Diff3LineList* m_pDiff3LineList;
-   TotalDiffStatus* m_pTotalDiffStatus;
+   MergeEngine m_mergeEngine;
+   MergeLineList& m_mergeLineList; // Shortcut for m_mergeEngine.getMergeLineList()
 
    bool m_bPaintingAllowed;
    int m_delayedDrawTimer;
    Overview::e_OverviewMode m_eOverviewMode;
 
-private:
-   class MergeEditLine
-   {
-   public:
-      MergeEditLine(Diff3LineList::const_iterator i, int src=0){m_id3l=i; m_src=src; m_bLineRemoved=false; }
-      void setConflict() { m_src=0; m_bLineRemoved=false; m_str=QString(); }
-      bool isConflict()  { return  m_src==0 && !m_bLineRemoved && m_str.isNull(); }
-      void setRemoved(int src=0)  { m_src=src; m_bLineRemoved=true; m_str=QString(); }
-      bool isRemoved()   { return m_bLineRemoved; }
-      bool isEditableText() { return !isConflict() && !isRemoved(); }
-      void setString( const QString& s ){ m_str=s; m_bLineRemoved=false; m_src=0; }
-      QString getString( const MergeResultWindow* );
-      bool isModified() { return ! m_str.isNull() ||  (m_bLineRemoved && m_src==0); }
-
-      void setSource( int src, bool bLineRemoved ) { m_src=src; m_bLineRemoved =bLineRemoved; }
-      int src() { return m_src; }
-      Diff3LineList::const_iterator id3l(){return m_id3l;}
-      // getString() is implemented as MergeResultWindow::getString()
-   private:
-      Diff3LineList::const_iterator m_id3l;
-      int m_src;         // 1, 2 or 3 for A, B or C respectively, or 0 when line is from neither source.
-      QString m_str;    // String when modified by user or null-string when orig data is used.
-      bool m_bLineRemoved;
-   };
-
-   class MergeEditLineList : private std::list<MergeEditLine>
-   { // I want to know the size immediately!
-   private:
-      typedef std::list<MergeEditLine> BASE;
-      int m_size;
-      int* m_pTotalSize;
-   public:
-      typedef std::list<MergeEditLine>::iterator iterator;
-      typedef std::list<MergeEditLine>::reverse_iterator reverse_iterator;
-      typedef std::list<MergeEditLine>::const_iterator const_iterator;
-      MergeEditLineList(){m_size=0; m_pTotalSize=0; }
-      void clear()                             { ds(-m_size); BASE::clear();          }
-      void push_back( const MergeEditLine& m)  { ds(+1); BASE::push_back(m);     }
-      void push_front( const MergeEditLine& m) { ds(+1); BASE::push_front(m);    }
-      void pop_back()                          { ds(-1); BASE::pop_back();    }
-      iterator erase( iterator i )             { ds(-1); return BASE::erase(i);  }
-      iterator insert( iterator i, const MergeEditLine& m ) { ds(+1); return BASE::insert(i,m); }
-      int size(){ if (!m_pTotalSize) m_size = (int) BASE::size(); return m_size; }
-      iterator begin(){return BASE::begin();}
-      iterator end(){return BASE::end();}
-      reverse_iterator rbegin(){return BASE::rbegin();}
-      reverse_iterator rend(){return BASE::rend();}
-      MergeEditLine& front(){return BASE::front();}
-      MergeEditLine& back(){return BASE::back();}
-      bool empty() { return m_size==0; }
-      void splice(iterator destPos, MergeEditLineList& srcList, iterator srcFirst, iterator srcLast)
-      {
-         int* pTotalSize = getTotalSizePtr() ? getTotalSizePtr() : srcList.getTotalSizePtr();
-         srcList.setTotalSizePtr(0); // Force size-recalc after splice, because splice doesn't handle size-tracking
-         setTotalSizePtr(0);
-         BASE::splice( destPos, srcList, srcFirst, srcLast );
-         srcList.setTotalSizePtr( pTotalSize );
-         setTotalSizePtr( pTotalSize );
-      }
-
-      void setTotalSizePtr(int* pTotalSize)
-      {
-         if ( pTotalSize==0 && m_pTotalSize!=0 ) { *m_pTotalSize -= size(); }
-         else if ( pTotalSize!=0 && m_pTotalSize==0 ) { *pTotalSize += size(); }
-         m_pTotalSize = pTotalSize;
-      }
-      int* getTotalSizePtr()
-      {
-         return m_pTotalSize;
-      }
-
-   private:
-      void ds(int deltaSize) 
-      {
-         m_size+=deltaSize; 
-         if (m_pTotalSize!=0)  *m_pTotalSize+=deltaSize;
-      }
-   };
-
-   friend class MergeEditLine;
-
-   struct MergeLine
-   {
-      MergeLine()
-      {
-         srcSelect=0; mergeDetails=eDefault; d3lLineIdx = -1; srcRangeLength=0;
-         bConflict=false; bDelta=false; bWhiteSpaceConflict=false;
-      }
-      Diff3LineList::const_iterator id3l;
-      int d3lLineIdx;  // Needed to show the correct window pos.
-      int srcRangeLength; // how many src-lines have this properties
-      e_MergeDetails mergeDetails;
-      bool bConflict;
-      bool bWhiteSpaceConflict;
-      bool bDelta;
-      int srcSelect;
-      MergeEditLineList mergeEditLineList;
-      void split( MergeLine& ml2, int d3lLineIdx2 ) // The caller must insert the ml2 after this ml in the m_mergeLineList
-      {
-         if ( d3lLineIdx2<d3lLineIdx || d3lLineIdx2 >= d3lLineIdx + srcRangeLength ) 
-            return; //Error
-         ml2.mergeDetails = mergeDetails;
-         ml2.bConflict = bConflict;
-         ml2.bWhiteSpaceConflict = bWhiteSpaceConflict;
-         ml2.bDelta = bDelta;
-         ml2.srcSelect = srcSelect;
-
-         ml2.d3lLineIdx = d3lLineIdx2;
-         ml2.srcRangeLength = srcRangeLength - (d3lLineIdx2-d3lLineIdx);
-         srcRangeLength = d3lLineIdx2-d3lLineIdx; // current MergeLine controls fewer lines
-         ml2.id3l = id3l;
-         for(int i=0; i<srcRangeLength; ++i)
-            ++ml2.id3l;
-
-         ml2.mergeEditLineList.clear();
-         // Search for best place to splice
-         for(MergeEditLineList::iterator i=mergeEditLineList.begin(); i!=mergeEditLineList.end();++i)
-         {
-            if (i->id3l()==ml2.id3l)
-            {
-               ml2.mergeEditLineList.splice( ml2.mergeEditLineList.begin(), mergeEditLineList, i, mergeEditLineList.end() );
-               return;
-            }
-         }
-         ml2.mergeEditLineList.setTotalSizePtr( mergeEditLineList.getTotalSizePtr() );
-         ml2.mergeEditLineList.push_back(MergeEditLine(ml2.id3l));
-      }
-      void join( MergeLine& ml2 ) // The caller must remove the ml2 from the m_mergeLineList after this call
-      {
-         srcRangeLength += ml2.srcRangeLength;
-         ml2.mergeEditLineList.clear();
-         mergeEditLineList.clear();
-         mergeEditLineList.push_back(MergeEditLine(id3l)); // Create a simple conflict
-         if ( ml2.bConflict ) bConflict = true;
-         if ( !ml2.bWhiteSpaceConflict ) bWhiteSpaceConflict = false;
-         if ( ml2.bDelta ) bDelta = true;
-      }
-   };
-
-private:
-   static bool sameKindCheck( const MergeLine& ml1, const MergeLine& ml2 );
-   struct HistoryMapEntry
-   {
-      MergeEditLineList mellA;
-      MergeEditLineList mellB;
-      MergeEditLineList mellC;
-      MergeEditLineList& choice( bool bThreeInputs );
-      bool staysInPlace( bool bThreeInputs, Diff3LineList::const_iterator& iHistoryEnd );
-   };
-   typedef std::map<QString,HistoryMapEntry> HistoryMap;
-   void collectHistoryInformation( int src, Diff3LineList::const_iterator iHistoryBegin, Diff3LineList::const_iterator iHistoryEnd, HistoryMap& historyMap, std::list< HistoryMap::iterator >& hitList );
-
-   typedef std::list<MergeLine> MergeLineList;
-   MergeLineList m_mergeLineList;
    MergeLineList::iterator m_currentMergeLineIt;
    bool isItAtEnd( bool bIncrement, MergeLineList::iterator i )
    {
@@ -357,6 +199,23 @@ private:
    int m_currentPos;
    bool checkOverviewIgnore(MergeLineList::iterator &i);
 
+   // Navigation index: The MergeLines of each kind, keyed by d3lLineIdx (increasing
+   // along m_mergeLineList). Updated by choose(), pasting, split and join. Bulk changes
+   // invalidate it, it's rebuilt on the next use or when the filter of go() changed.
+   typedef std::map<int, MergeLineList::iterator> MergeLineIndex;
+   MergeLineIndex m_deltaIndex;               // Deltas that go() doesn't skip
+   MergeLineIndex m_conflictIndex;            // Conflicts that go() doesn't skip
+   MergeLineIndex m_unsolvedIndex;            // Unsolved conflicts
+   MergeLineIndex m_unsolvedWhiteSpaceIndex;  // Unsolved whitespace conflicts
+   bool m_bNavigationIndexValid;
+   bool m_bIndexSkipWhiteConflicts;           // The filter when the index was built
+   Overview::e_OverviewMode m_indexOverviewMode;
+   void checkNavigationIndex();
+   void addToNavigationIndex( MergeLineList::iterator i );
+   void updateNavigationIndex( MergeLineList::iterator i );
+   int getCurrentIndexKey();
+   MergeLineList::iterator splitAtDiff3LineIdx( int d3lLineIdx );
+
    enum e_Direction { eUp, eDown };
    enum e_EndPoint  { eDelta, eConflict, eUnsolvedConflict, eLine, eEnd };
    void go( e_Direction eDir, e_EndPoint eEndPoint );
@@ -365,7 +224,6 @@ private:
       MergeLineList::iterator& mlIt,
       MergeEditLineList::iterator& melIt
       );
-   MergeLineList::iterator splitAtDiff3LineIdx( int d3lLineIdx );
 
    virtual void paintEvent( QPaintEvent* e );
 
@@ -393,13 +251,18 @@ private:
    int m_firstLine;
    int m_horizScrollOffset;
    int m_nofLines;
-   int m_totalSize; //Same as m_nofLines, but calculated differently
    int m_maxTextWidth;
    bool m_bMyUpdate;
    bool m_bInsertMode;
    bool m_bModified;
+   unsigned int m_contentGeneration;
    void setModified(bool bModified=true);
 
+   unsigned int m_undoStepGeneration;  // m_contentGeneration when the undo step began
+   void beginUndoStep( int firstLine, int lastLine );
+   void endUndoStep();
+   void undoRedo( bool bUndo );
+
    int m_scrollDeltaX;
    int m_scrollDeltaY;
    int m_cursorXPos;
@@ -415,7 +278,6 @@ private:
 
    bool deleteSelection2( QString& str, int& x, int& y,
                     MergeLineList::iterator& mlIt, MergeEditLineList::iterator& melIt );
-   bool doRelevantChangesExist();
 public slots:
    void deleteSelection();
    void pasteClipboard(bool bFromSelection);
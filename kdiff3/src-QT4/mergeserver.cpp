@@ -0,0 +1,327 @@
+/***************************************************************************
+                          mergeserver.cpp  -  description
+                             -------------------
+    copyright            : (C) 2002-2007 by Joachim Eibl
+    email                : joachim.eibl at gmx.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "mergeserver.h"
+#include "batchmerge.h"
+#include "fileaccess.h"
+#include "optiondialog.h"
+#include "progress.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QLocalSocket>
+#include <QPointer>
+
+#include <kcmdlineargs.h>
+#include <kglobal.h>
+#include <klocale.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <sddl.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+// Every message is a block: quint32 size followed by the data written via QDataStream.
+// Request: QStringList (base, A, B, output), B may be empty.
+// Reply: qint32 number of unsolved conflicts or -1 for errors.
+
+static void writeBlock( QLocalSocket* pSocket, const QByteArray& data )
+{
+   QByteArray block;
+   QDataStream out( &block, QIODevice::WriteOnly );
+   out.setVersion( QDataStream::Qt_4_0 );
+   out << (quint32)data.size();
+   block.append( data );
+   pSocket->write( block );
+   pSocket->flush();
+}
+
+// Returns true if a complete block was available.
+static bool readBlock( QLocalSocket* pSocket, QByteArray& data )
+{
+   if ( pSocket->bytesAvailable() < (qint64)sizeof(quint32) )
+      return false;
+   quint32 size = 0;
+   QDataStream in( pSocket->peek( sizeof(quint32) ) );
+   in.setVersion( QDataStream::Qt_4_0 );
+   in >> size;
+   if ( pSocket->bytesAvailable() < (qint64)(sizeof(quint32) + size) )
+      return false;
+   pSocket->read( sizeof(quint32) );
+   data = pSocket->read( size );
+   return true;
+}
+
+#ifdef _WIN32
+// Returns the SID of the user that runs the process or an empty array.
+static QByteArray getProcessUserSid( HANDLE hProcess )
+{
+   QByteArray sid;
+   HANDLE hToken = 0;
+   if ( !OpenProcessToken( hProcess, TOKEN_QUERY, &hToken ) )
+      return sid;
+   DWORD size = 0;
+   GetTokenInformation( hToken, TokenUser, 0, 0, &size );
+   QByteArray buf( (int)size, '\0' );
+   if ( size>0 && GetTokenInformation( hToken, TokenUser, buf.data(), size, &size ) )
+   {
+      PSID pSid = ((TOKEN_USER*)buf.data())->User.Sid;
+      sid = QByteArray( (const char*)pSid, (int)GetLengthSid( pSid ) );
+   }
+   CloseHandle( hToken );
+   return sid;
+}
+
+// Another user could create the pipe first and report merges as successful. So the client
+// only talks to a server run by the same user. GetNamedPipeServerProcessId() needs Vista.
+static bool isServerOfCurrentUser( QLocalSocket& socket )
+{
+   typedef BOOL (WINAPI *GetNamedPipeServerProcessIdFunc)( HANDLE, PULONG );
+   GetNamedPipeServerProcessIdFunc pGetServerPid = (GetNamedPipeServerProcessIdFunc)
+      GetProcAddress( GetModuleHandleA( "kernel32.dll" ), "GetNamedPipeServerProcessId" );
+   ULONG serverPid = 0;
+   if ( pGetServerPid==0 || !pGetServerPid( (HANDLE)socket.socketDescriptor(), &serverPid ) )
+      return false;
+   HANDLE hServer = OpenProcess( 0x1000 /*PROCESS_QUERY_LIMITED_INFORMATION*/, FALSE, serverPid );
+   if ( hServer==0 )
+      return false;
+   QByteArray serverSid = getProcessUserSid( hServer );
+   CloseHandle( hServer );
+   QByteArray ownSid = getProcessUserSid( GetCurrentProcess() );
+   return !ownSid.isEmpty() && serverSid==ownSid;
+}
+#endif
+
+MergeServer::MergeServer( Options* pOptions )
+{
+   m_pOptions = pOptions;
+   m_bBusy = false;
+   connect( &m_server, SIGNAL(newConnection()), this, SLOT(slotNewConnection()) );
+}
+
+QString MergeServer::serverName()
+{
+#ifdef _WIN32
+   // The SID identifies the user, unlike USERNAME that can be set to anything.
+   // The owner of the pipe is checked by the client too (see isServerOfCurrentUser()).
+   QByteArray sid = getProcessUserSid( GetCurrentProcess() );
+   LPWSTR pSidString = 0;
+   if ( sid.isEmpty() || !ConvertSidToStringSidW( (PSID)sid.data(), &pSidString ) )
+      return QString(); // Would be shared by all users.
+   QString name = "kdiff3-mergeserver-" + QString::fromUtf16( (const ushort*)pSidString );
+   LocalFree( pSidString );
+   return name;
+#else
+   // The socket is placed in a directory that only this user can access. Otherwise another
+   // user could create the socket first and report merges as successful.
+   QByteArray dirName = QFile::encodeName( QDir::tempPath() + QString("/kdiff3-%1").arg( (qulonglong)getuid() ) );
+   if ( ::mkdir( dirName.constData(), 0700 ) != 0 && errno != EEXIST )
+      return QString();
+   struct stat dirStatus;
+   if ( ::lstat( dirName.constData(), &dirStatus ) != 0 || !S_ISDIR( dirStatus.st_mode ) ||
+        dirStatus.st_uid != getuid() || ( dirStatus.st_mode & 077 ) != 0 )
+      return QString();
+   return QFile::decodeName( dirName ) + "/mergeserver";
+#endif
+}
+
+bool MergeServer::listen( QString& errorText )
+{
+   QString name = serverName();
+   if ( name.isEmpty() )
+   {
+      errorText = i18n("No location only accessible by the current user was found for the server socket.");
+      return false;
+   }
+   QLocalServer::removeServer( name ); // Left over from a crashed server
+   if ( !m_server.listen( name ) )
+   {
+      errorText = m_server.errorString();
+      return false;
+   }
+   return true;
+}
+
+void MergeServer::slotNewConnection()
+{
+   while ( m_server.hasPendingConnections() )
+   {
+      QLocalSocket* pSocket = m_server.nextPendingConnection();
+      connect( pSocket, SIGNAL(readyRead()), this, SLOT(slotReadyRead()) );
+      connect( pSocket, SIGNAL(disconnected()), this, SLOT(slotDisconnected()) );
+      if ( pSocket->bytesAvailable()>0 )
+         slotReadyRead();
+   }
+}
+
+void MergeServer::slotReadyRead()
+{
+   QLocalSocket* pSocket = qobject_cast<QLocalSocket*>( sender() );
+   if ( pSocket==0 || pSocket->bytesAvailable() < (qint64)sizeof(quint32) )
+      return;
+   if ( std::find( m_pendingRequests.begin(), m_pendingRequests.end(), pSocket ) == m_pendingRequests.end() )
+      m_pendingRequests.push_back( pSocket );
+   processPendingRequests();
+}
+
+void MergeServer::slotDisconnected()
+{
+   QLocalSocket* pSocket = qobject_cast<QLocalSocket*>( sender() );
+   if ( pSocket==0 )
+      return;
+   m_pendingRequests.remove( pSocket );
+   pSocket->deleteLater();
+}
+
+void MergeServer::processPendingRequests()
+{
+   if ( m_bBusy )
+      return; // Called again from within a merge, the outer call will continue.
+   m_bBusy = true;
+
+   std::list<QLocalSocket*>::iterator i = m_pendingRequests.begin();
+   while ( i!=m_pendingRequests.end() )
+   {
+      QPointer<QLocalSocket> pSocket = *i;
+      QByteArray data;
+      if ( !readBlock( pSocket, data ) )
+      {
+         ++i; // Not complete yet.
+         continue;
+      }
+      i = m_pendingRequests.erase( i );
+
+      QStringList files;
+      QDataStream in( data );
+      in.setVersion( QDataStream::Qt_4_0 );
+      in >> files;
+
+      qint32 result = -1;
+      QString errorText;
+      if ( files.count()==4 )
+         result = autoMergeFiles( m_pOptions, files[0], files[1], files[2], files[3], errorText );
+
+      if ( !pSocket.isNull() ) // The client might have given up.
+      {
+         QByteArray reply;
+         QDataStream out( &reply, QIODevice::WriteOnly );
+         out.setVersion( QDataStream::Qt_4_0 );
+         out << result;
+         writeBlock( pSocket, reply );
+      }
+
+      i = m_pendingRequests.begin(); // The list might have changed during the merge.
+   }
+
+   m_bBusy = false;
+}
+
+bool MergeServer::autoMergeViaServer( KCmdLineArgs* args )
+{
+   // Only plain automatic merges are handed over: The server has its own fixed options.
+   QString outputFilename = args->getOption("output");
+   if ( outputFilename.isEmpty() )
+      outputFilename = args->getOption("out");
+   if ( !args->isSet("auto") || args->isSet("qall") || outputFilename.isEmpty() ||
+        !args->getOptionList("cs").isEmpty() || args->isSet("config") || args->isSet("memory-report") )
+      return false;
+
+   QString name = serverName();
+   if ( name.isEmpty() )
+      return false;
+
+   // The server has its own working directory, so relative names must be resolved here.
+   QStringList files;
+   QString base = args->getOption("base");
+   if ( !base.isEmpty() )
+      files << FileAccess( base ).absoluteFilePath();
+   for ( int i=0; i<args->count(); ++i )
+      files << FileAccess( args->url(i).url() ).absoluteFilePath();
+   if ( files.count()==2 )
+      files << QString(); // two way merge
+   if ( files.count()!=3 )
+      return false;
+   files << FileAccess( outputFilename, true ).absoluteFilePath();
+
+   QLocalSocket socket;
+   socket.connectToServer( name );
+   if ( !socket.waitForConnected( 1000 ) )
+      return false;
+#ifdef _WIN32
+   if ( !isServerOfCurrentUser( socket ) )
+      return false;
+#endif
+
+   QByteArray request;
+   QDataStream out( &request, QIODevice::WriteOnly );
+   out.setVersion( QDataStream::Qt_4_0 );
+   out << files;
+   writeBlock( &socket, request );
+
+   QByteArray reply;
+   while ( !readBlock( &socket, reply ) )
+   {
+      if ( !socket.waitForReadyRead( -1 ) )
+         return false; // Server terminated
+   }
+
+   qint32 result = -1;
+   QDataStream in( reply );
+   in.setVersion( QDataStream::Qt_4_0 );
+   in >> result;
+   return result==0;
+}
+
+int runMergeServer( KCmdLineArgs* args )
+{
+   // Needed before any file operations via FileAccess happen.
+   if (!g_pProgressDialog)
+   {
+      g_pProgressDialog = new ProgressDialog(0);
+      g_pProgressDialog->setStayHidden( true );
+   }
+
+   // The options are read only once. Options given via --cs apply to all requests.
+   OptionDialog optionDialog( false );
+   optionDialog.readOptions( KGlobal::config() );
+   QString s = optionDialog.parseOptions( args->getOptionList("cs") );
+   if ( !s.isEmpty() )
+   {
+      fprintf(stderr, "%s\n", i18n("Config Option Error:").toLatin1().constData());
+      fprintf(stderr, "%s\n", s.toLatin1().constData());
+      return 1;
+   }
+
+   MergeServer server( &optionDialog.m_options );
+   QString errorText;
+   if ( !server.listen( errorText ) )
+   {
+      fprintf(stderr, "%s\n", errorText.toLocal8Bit().constData());
+      return 1;
+   }
+   return QCoreApplication::exec();
+}
@@ -0,0 +1,68 @@
+/***************************************************************************
+                          mergeserver.h  -  description
+                             -------------------
+    copyright            : (C) 2002-2007 by Joachim Eibl
+    email                : joachim.eibl at gmx.de
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef MERGESERVER_H
+#define MERGESERVER_H
+
+#include <QObject>
+#include <QLocalServer>
+#include <QStringList>
+#include <list>
+
+class Options;
+class QLocalSocket;
+class KCmdLineArgs;
+
+/** Resident process for automatic merges, started via "kdiff3 --server".
+    A client started with "--auto --use-server" hands over its files and only
+    waits for the result, so it doesn't need to load the options itself.
+    The requests are handled one after the other, because the diff code
+    uses global state.
+*/
+class MergeServer : public QObject
+{
+   Q_OBJECT
+public:
+   MergeServer( Options* pOptions );
+   bool listen( QString& errorText );
+
+   // Name of the local socket. (One server per user.) On Unix the full path of a socket
+   // in a directory only accessible by the user, on Windows a pipe name with the user's SID.
+   // Empty if no safe name is available.
+   static QString serverName();
+
+   // Client side: Returns true if a server did the merge without conflicts.
+   // Otherwise (no server running, conflicts or errors) the caller must do the merge itself.
+   static bool autoMergeViaServer( KCmdLineArgs* args );
+
+private slots:
+   void slotNewConnection();
+   void slotReadyRead();
+   void slotDisconnected();
+
+private:
+   void processPendingRequests();
+
+   QLocalServer m_server;
+   Options* m_pOptions;
+   std::list<QLocalSocket*> m_pendingRequests;
+   bool m_bBusy; // Progress handling may process events during a merge.
+};
+
+// Handles the option --server. Returns the exit code.
+int runMergeServer( KCmdLineArgs* args );
+
+#endif
@@ -68,6 +68,13 @@ void OptionDialog::addOptionItem(OptionItem* p)
    m_optionItemList.push_back(p);
 }
 
+void OptionDialog::addOptionWidget(OptionWidget* p)
+{
+   m_optionWidgetList.push_back(p);
+}
+
+// An option value with its default, as read from and written to the config.
+// Exists independent of the dialog pages, which are only created when needed.
 class OptionItem
 {
 public:
@@ -79,9 +86,6 @@ public:
       m_bPreserved = false;
    }
    virtual ~OptionItem(){}
-   virtual void setToDefault()=0;
-   virtual void setToCurrent()=0;
-   virtual void apply()=0;
    virtual void write(ValueMap*)=0;
    virtual void read(ValueMap*)=0;
    void doPreserve(){ if (!m_bPreserved){ m_bPreserved=true; preserve(); } }
@@ -94,6 +98,17 @@ protected:
    QString m_saveName;
 };
 
+OptionItem* OptionDialog::findOptionItem( const QString& saveName )
+{
+   std::list<OptionItem*>::iterator i;
+   for(i=m_optionItemList.begin(); i!=m_optionItemList.end(); ++i)
+   {
+      if ( (*i)->getSaveName()==saveName )
+         return *i;
+   }
+   return 0;
+}
+
 template <class T>
 class OptionItemT : public OptionItem
 {
@@ -101,6 +116,7 @@ public:
   OptionItemT( OptionDialog* pOptionDialog, const QString& saveName ) 
   : OptionItem(pOptionDialog,saveName ) 
   {}
+  const T& getDefault() const { return m_defaultVal; }
   
 protected:
    virtual void preserve(){ m_preservedVal = *m_pVar; }
@@ -110,44 +126,8 @@ protected:
    T m_defaultVal;
 };
 
-class OptionCheckBox : public QCheckBox, public OptionItemT<bool>
-{
-public:
-   OptionCheckBox( QString text, bool bDefaultVal, const QString& saveName, bool* pbVar,
-                   QWidget* pParent, OptionDialog* pOD )
-   : QCheckBox( text, pParent ), OptionItemT<bool>( pOD, saveName )
-   {
-      m_pVar = pbVar;
-      m_defaultVal = bDefaultVal;
-   }
-   void setToDefault(){ setChecked( m_defaultVal );      }
-   void setToCurrent(){ setChecked( *m_pVar );           }
-   void apply()       { *m_pVar = isChecked();                              }
-   void write(ValueMap* config){ config->writeEntry(m_saveName, *m_pVar );   }
-   void read (ValueMap* config){ *m_pVar = config->readBoolEntry( m_saveName, *m_pVar ); }
-private:
-   OptionCheckBox( const OptionCheckBox& ); // private copy constructor without implementation
-};
-
-class OptionRadioButton : public QRadioButton, public OptionItemT<bool>
-{
-public:
-   OptionRadioButton( QString text, bool bDefaultVal, const QString& saveName, bool* pbVar,
-                   QWidget* pParent, OptionDialog* pOD )
-   : QRadioButton( text, pParent ), OptionItemT<bool>( pOD, saveName )
-   {
-      m_pVar = pbVar;
-      m_defaultVal = bDefaultVal;
-   }
-   void setToDefault(){ setChecked( m_defaultVal );      }
-   void setToCurrent(){ setChecked( *m_pVar );           }
-   void apply()       { *m_pVar = isChecked();                              }
-   void write(ValueMap* config){ config->writeEntry(m_saveName, *m_pVar );   }
-   void read (ValueMap* config){ *m_pVar = config->readBoolEntry( m_saveName, *m_pVar ); }
-private:
-   OptionRadioButton( const OptionRadioButton& ); // private copy constructor without implementation
-};
-
+template <class T> void writeEntry(ValueMap* vm, const QString& saveName, const T& v ) {   vm->writeEntry( saveName, v ); }
+static void writeEntry(ValueMap* vm, const QString& saveName, const QStringList& v )   {   vm->writeEntry( saveName, v, '|' ); }
 
 template<class T>
 class OptionT : public OptionItemT<T>
@@ -158,24 +138,20 @@ public:
    {
       this->m_pVar = pVar;
       *this->m_pVar = defaultVal;
+      this->m_defaultVal = defaultVal;
    }
    OptionT( const QString& saveName, T* pVar, OptionDialog* pOD )
    : OptionItemT<T>( pOD, saveName )
    {
       this->m_pVar = pVar;
+      this->m_defaultVal = *pVar;
    }
-   void setToDefault(){}
-   void setToCurrent(){}
-   void apply()       {}
    void write(ValueMap* vm){ writeEntry( vm, this->m_saveName, *this->m_pVar ); }
    void read (ValueMap* vm){ *this->m_pVar = vm->readEntry ( this->m_saveName, *this->m_pVar ); }
 private:
    OptionT( const OptionT& ); // private copy constructor without implementation
 };
 
-template <class T> void writeEntry(ValueMap* vm, const QString& saveName, const T& v ) {   vm->writeEntry( saveName, v ); }
-static void writeEntry(ValueMap* vm, const QString& saveName, const QStringList& v )   {   vm->writeEntry( saveName, v, '|' ); }
-
 //static void readEntry(ValueMap* vm, const QString& saveName, bool& v )       {   v = vm->readBoolEntry( saveName, v ); }
 //static void readEntry(ValueMap* vm, const QString& saveName, int&  v )       {   v = vm->readNumEntry( saveName, v ); }
 //static void readEntry(ValueMap* vm, const QString& saveName, QSize& v )      {   v = vm->readSizeEntry( saveName, &v ); }
@@ -187,96 +163,252 @@ typedef OptionT<int>  OptionNum;
 typedef OptionT<QPoint> OptionPoint;
 typedef OptionT<QSize> OptionSize;
 typedef OptionT<QStringList> OptionStringList;
+typedef OptionT<QString> OptionString;
+typedef OptionT<QColor> OptionColor;
+typedef OptionT<QFont> OptionFont;
 
-class OptionFontChooser : public KFontChooser, public OptionItemT<QFont>
+// A string that also remembers the last ten different values (for the editable combo boxes).
+class OptionStringHistory : public OptionItemT<QString>
 {
 public:
-   OptionFontChooser( const QFont& defaultVal, const QString& saveName, QFont* pVar, QWidget* pParent, OptionDialog* pOD ) :
-       KFontChooser( pParent ),
-       OptionItemT<QFont>( pOD, saveName )
+   OptionStringHistory( const QString& defaultVal, const QString& saveName, QString* pVar, OptionDialog* pOD )
+   : OptionItemT<QString>( pOD, saveName )
    {
       m_pVar = pVar;
       *m_pVar = defaultVal;
       m_defaultVal = defaultVal;
+      m_list.push_back(defaultVal);
+   }
+   const QStringList& getList() const { return m_list; }
+   void setCurrent( const QString& s )
+   {  // Check if the text exists. If yes remove it and push it in as first element
+      *m_pVar = s;
+      m_list.removeAll( s );
+      m_list.push_front( s );
+      if ( m_list.size()>10 ) 
+         m_list.erase( m_list.begin()+10, m_list.end() );
+   }
+   void write(ValueMap* config){ config->writeEntry( m_saveName, m_list, '|' );      }
+   void read (ValueMap* config){ 
+      m_list = config->readListEntry( m_saveName, QStringList(m_defaultVal), '|' ); 
+      if ( !m_list.empty() ) *m_pVar = m_list.front();
+   }
+private:
+   OptionStringHistory( const OptionStringHistory& ); // private copy constructor without implementation
+   QStringList m_list;
+};
+
+// UTF8-Codec that saves a BOM
+// UTF8-Codec that saves a BOM
+class Utf8BOMCodec : public QTextCodec
+{
+   QTextCodec* m_pUtf8Codec;
+   class PublicTextCodec : public QTextCodec
+   {
+   public:
+      QString publicConvertToUnicode ( const char * p, int len, ConverterState* pState ) const
+      {
+         return convertToUnicode( p, len, pState );
+      }
+      QByteArray publicConvertFromUnicode ( const QChar * input, int number, ConverterState * pState ) const
+      {
+         return convertFromUnicode( input, number, pState );
+      }
+   };
+public:
+   Utf8BOMCodec()
+   {
+      m_pUtf8Codec = QTextCodec::codecForName("UTF-8");
+   }
+   QByteArray name () const { return "UTF-8-BOM"; }
+   int mibEnum () const { return 2123; }
+   QByteArray convertFromUnicode ( const QChar * input, int number, ConverterState * pState ) const
+   {
+      QByteArray r;
+      if ( pState && pState->state_data[2]==0)  // state_data[2] not used by QUtf8::convertFromUnicode (see qutfcodec.cpp)
+      {
+        r += "\xEF\xBB\xBF";
+        pState->state_data[2]=1;
+        pState->flags |= QTextCodec::IgnoreHeader;
+      }
+
+      r += ((PublicTextCodec*)m_pUtf8Codec)->publicConvertFromUnicode( input, number, pState );
+      return r;
+   }
+   QString convertToUnicode ( const char * p, int len, ConverterState* pState ) const
+   {
+      return ((PublicTextCodec*)m_pUtf8Codec)->publicConvertToUnicode( p, len, pState );
+   }
+};
+
+// The codecs that get a descriptive name in the encoding combo boxes.
+static QTextCodec* s_namedCodecs[3];
+
+static void initNamedCodecs()
+{
+   s_namedCodecs[0] = QTextCodec::codecForName("UTF-8");
+   s_namedCodecs[1] = QTextCodec::codecForName("iso-10646-UCS-2");
+   s_namedCodecs[2] = QTextCodec::codecForName("iso 8859-1");
+}
+
+// The codec for the locale. Unless it is listed with a descriptive name: Then Unicode, 8 bit.
+static QTextCodec* getDefaultCodec()
+{
+   QTextCodec* pCodec = QTextCodec::codecForLocale();
+   for( int i=0; i<3; ++i )
+   {
+      if ( pCodec==s_namedCodecs[i] && s_namedCodecs[0]!=0 )
+         return s_namedCodecs[0];
+   }
+   return pCodec;
+}
+
+class OptionCodec : public OptionItemT<QTextCodec*>
+{
+public:
+   OptionCodec( const QString& saveName, QTextCodec** ppVarCodec, OptionDialog* pOD )
+   : OptionItemT<QTextCodec*>( pOD, saveName )
+   {
+      m_pVar = ppVarCodec;
+      m_defaultVal = getDefaultCodec();
+      *m_pVar = m_defaultVal;
+   }
+   void write(ValueMap* config)
+   {
+      config->writeEntry(m_saveName, QString((*m_pVar)->name()) );
+   }
+   void read (ValueMap* config)
+   {
+      QString codecName = config->readEntry( m_saveName, QString((*m_pVar)->name()) );
+      QTextCodec* pCodec = QTextCodec::codecForName( codecName.toLatin1() );
+      if ( pCodec!=0 )
+         *m_pVar = pCodec;
+   }
+private:
+   OptionCodec( const OptionCodec& ); // private copy constructor without implementation
+};
+
+// A widget in one of the dialog pages that shows and edits an option value.
+class OptionWidget
+{
+public:
+   OptionWidget( OptionDialog* pOptionDialog )
+   {
+      assert(pOptionDialog!=0);
+      pOptionDialog->addOptionWidget( this );
+   }
+   virtual ~OptionWidget(){}
+   virtual void setToDefault()=0;
+   virtual void setToCurrent()=0;
+   virtual void apply()=0;
+};
+
+template <class T>
+class OptionWidgetT : public OptionWidget
+{
+public:
+   OptionWidgetT( OptionDialog* pOptionDialog, const QString& saveName, T* pVar )
+   : OptionWidget( pOptionDialog )
+   {
+      OptionItemT<T>* pItem = static_cast<OptionItemT<T>*>( pOptionDialog->findOptionItem( saveName ) );
+      assert( pItem!=0 ); // Must be created in OptionDialog::setupOptions()
+      m_pVar = pVar;
+      m_defaultVal = pItem->getDefault();
+   }
+protected:
+   T* m_pVar;
+   T m_defaultVal;
+};
+
+class OptionCheckBox : public QCheckBox, public OptionWidgetT<bool>
+{
+public:
+   OptionCheckBox( QString text, const QString& saveName, bool* pbVar,
+                   QWidget* pParent, OptionDialog* pOD )
+   : QCheckBox( text, pParent ), OptionWidgetT<bool>( pOD, saveName, pbVar )
+   {
+   }
+   void setToDefault(){ setChecked( m_defaultVal );      }
+   void setToCurrent(){ setChecked( *m_pVar );           }
+   void apply()       { *m_pVar = isChecked();                              }
+private:
+   OptionCheckBox( const OptionCheckBox& ); // private copy constructor without implementation
+};
+
+class OptionRadioButton : public QRadioButton, public OptionWidgetT<bool>
+{
+public:
+   OptionRadioButton( QString text, const QString& saveName, bool* pbVar,
+                   QWidget* pParent, OptionDialog* pOD )
+   : QRadioButton( text, pParent ), OptionWidgetT<bool>( pOD, saveName, pbVar )
+   {
+   }
+   void setToDefault(){ setChecked( m_defaultVal );      }
+   void setToCurrent(){ setChecked( *m_pVar );           }
+   void apply()       { *m_pVar = isChecked();                              }
+private:
+   OptionRadioButton( const OptionRadioButton& ); // private copy constructor without implementation
+};
+
+class OptionFontChooser : public KFontChooser, public OptionWidgetT<QFont>
+{
+public:
+   OptionFontChooser( const QString& saveName, QFont* pVar, QWidget* pParent, OptionDialog* pOD ) :
+       KFontChooser( pParent ),
+       OptionWidgetT<QFont>( pOD, saveName, pVar )
+   {
    }
    void setToDefault(){ setFont( m_defaultVal, false ); }
    void setToCurrent(){ setFont( *m_pVar, false ); }
    void apply()       { *m_pVar = font();}
-   void write(ValueMap* config){ config->writeEntry(m_saveName, *m_pVar );   }
-   void read (ValueMap* config){ *m_pVar = config->readFontEntry( m_saveName, m_pVar ); }
 private:
-   OptionFontChooser( const OptionToggleAction& ); // private copy constructor without implementation
+   OptionFontChooser( const OptionFontChooser& ); // private copy constructor without implementation
 };
 
-class OptionColorButton : public KColorButton, public OptionItemT<QColor>
+class OptionColorButton : public KColorButton, public OptionWidgetT<QColor>
 {
 public:
-   OptionColorButton( QColor defaultVal, const QString& saveName, QColor* pVar, QWidget* pParent, OptionDialog* pOD )
-   : KColorButton( pParent ), OptionItemT<QColor>( pOD, saveName )
+   OptionColorButton( const QString& saveName, QColor* pVar, QWidget* pParent, OptionDialog* pOD )
+   : KColorButton( pParent ), OptionWidgetT<QColor>( pOD, saveName, pVar )
    {
-      m_pVar = pVar;
-      m_defaultVal = defaultVal;
    }
    void setToDefault(){ setColor( m_defaultVal );      }
    void setToCurrent(){ setColor( *m_pVar );           }
    void apply()       { *m_pVar = color();                              }
-   void write(ValueMap* config){ config->writeEntry(m_saveName, *m_pVar );   }
-   void read (ValueMap* config){ *m_pVar = config->readColorEntry( m_saveName, m_pVar ); }
 private:
    OptionColorButton( const OptionColorButton& ); // private copy constructor without implementation
 };
 
-class OptionLineEdit : public QComboBox, public OptionItemT<QString>
+class OptionLineEdit : public QComboBox, public OptionWidgetT<QString>
 {
 public:
-   OptionLineEdit( const QString& defaultVal, const QString& saveName, QString* pVar,
+   OptionLineEdit( const QString& saveName, QString* pVar,
                    QWidget* pParent, OptionDialog* pOD )
-   : QComboBox( pParent ), OptionItemT<QString>( pOD, saveName )
+   : QComboBox( pParent ), OptionWidgetT<QString>( pOD, saveName, pVar )
    {
       setMinimumWidth(50);
       setEditable(true);
-      m_pVar = pVar;
-      m_defaultVal = defaultVal;
-      m_list.push_back(defaultVal);
-      insertText();
+      m_pItem = static_cast<OptionStringHistory*>( pOD->findOptionItem( saveName ) );
+      insertItems(0,m_pItem->getList());
    }
    void setToDefault(){ setEditText( m_defaultVal );   }
-   void setToCurrent(){ setEditText( *m_pVar );        }
-   void apply()       { *m_pVar = currentText(); insertText();            }
-   void write(ValueMap* config){ config->writeEntry( m_saveName, m_list, '|' );      }
-   void read (ValueMap* config){ 
-      m_list = config->readListEntry( m_saveName, QStringList(m_defaultVal), '|' ); 
-      if ( !m_list.empty() ) *m_pVar = m_list.front();
-      clear();
-      insertItems(0,m_list);
-   }
+   void setToCurrent(){ clear(); insertItems(0,m_pItem->getList()); setEditText( *m_pVar ); }
+   void apply()       { m_pItem->setCurrent( currentText() ); clear(); insertItems(0,m_pItem->getList()); }
 private:
-   void insertText()
-   {  // Check if the text exists. If yes remove it and push it in as first element
-      QString current = currentText();
-      m_list.removeAll( current );
-      m_list.push_front( current );
-      clear();
-      if ( m_list.size()>10 ) 
-         m_list.erase( m_list.begin()+10, m_list.end() );
-      insertItems(0,m_list);
-   }
    OptionLineEdit( const OptionLineEdit& ); // private copy constructor without implementation
-   QStringList m_list;
+   OptionStringHistory* m_pItem; // Also keeps the list of recent values
 };
 
 #if defined QT_NO_VALIDATOR
 #error No validator
 #endif
-class OptionIntEdit : public QLineEdit, public OptionItemT<int>
+class OptionIntEdit : public QLineEdit, public OptionWidgetT<int>
 {
 public:
-   OptionIntEdit( int defaultVal, const QString& saveName, int* pVar, int rangeMin, int rangeMax,
+   OptionIntEdit( const QString& saveName, int* pVar, int rangeMin, int rangeMax,
                    QWidget* pParent, OptionDialog* pOD )
-   : QLineEdit( pParent ), OptionItemT<int>( pOD, saveName )
+   : QLineEdit( pParent ), OptionWidgetT<int>( pOD, saveName, pVar )
    {
-      m_pVar = pVar;
-      m_defaultVal = defaultVal;
       QIntValidator* v = new QIntValidator(this);
       v->setRange( rangeMin, rangeMax );
       setValidator( v );
@@ -286,38 +418,36 @@ public:
    void apply()       { const QIntValidator* v=static_cast<const QIntValidator*>(validator());
                         *m_pVar = minMaxLimiter( text().toInt(), v->bottom(), v->top());
                         setText( QString::number(*m_pVar) );  }
-   void write(ValueMap* config){ config->writeEntry(m_saveName, *m_pVar );   }
-   void read (ValueMap* config){ *m_pVar = config->readNumEntry( m_saveName, *m_pVar ); }
 private:
    OptionIntEdit( const OptionIntEdit& ); // private copy constructor without implementation
 };
 
-class OptionComboBox : public QComboBox, public OptionItem
+class OptionComboBox : public QComboBox, public OptionWidget
 {
 public:
-   OptionComboBox( int defaultVal, const QString& saveName, int* pVarNum,
+   OptionComboBox( const QString& saveName, int* pVarNum,
                    QWidget* pParent, OptionDialog* pOD )
-   : QComboBox( pParent ), OptionItem( pOD, saveName )
+   : QComboBox( pParent ), OptionWidget( pOD )
    {
       setMinimumWidth(50);
       m_pVarNum = pVarNum;
       m_pVarStr = 0;
-      m_defaultVal = defaultVal;
+      m_defaultNumVal = static_cast<OptionItemT<int>*>( pOD->findOptionItem( saveName ) )->getDefault();
       setEditable(false);
    }
-   OptionComboBox( int defaultVal, const QString& saveName, QString* pVarStr,
+   OptionComboBox( const QString& saveName, QString* pVarStr,
                    QWidget* pParent, OptionDialog* pOD )
-   : QComboBox( pParent ), OptionItem( pOD, saveName )
+   : QComboBox( pParent ), OptionWidget( pOD )
    {
       m_pVarNum = 0;
       m_pVarStr = pVarStr;
-      m_defaultVal = defaultVal;
+      m_defaultStrVal = static_cast<OptionItemT<QString>*>( pOD->findOptionItem( saveName ) )->getDefault();
       setEditable(false);
    }
    void setToDefault()
    { 
-      setCurrentIndex( m_defaultVal ); 
-      if (m_pVarStr!=0){ *m_pVarStr=currentText(); } 
+      if (m_pVarNum!=0) setCurrentIndex( m_defaultNumVal );
+      else              setText( m_defaultStrVal );
    }
    void setToCurrent()
    { 
@@ -329,43 +459,20 @@ public:
       if (m_pVarNum!=0){ *m_pVarNum = currentIndex(); }
       else             { *m_pVarStr = currentText(); }
    }
-   void write(ValueMap* config)
-   { 
-      if (m_pVarStr!=0) config->writeEntry(m_saveName, *m_pVarStr );
-      else              config->writeEntry(m_saveName, *m_pVarNum );   
-   }
-   void read (ValueMap* config)
-   {
-      if (m_pVarStr!=0)  setText( config->readEntry( m_saveName, currentText() ) );
-      else               *m_pVarNum = config->readNumEntry( m_saveName, *m_pVarNum ); 
-   }
-   void preserve()
-   {
-      if (m_pVarStr!=0)  { m_preservedStrVal = *m_pVarStr; }
-      else               { m_preservedNumVal = *m_pVarNum; }
-   }
-   void unpreserve()
-   {
-      if (m_pVarStr!=0)  { *m_pVarStr = m_preservedStrVal; }
-      else               { *m_pVarNum = m_preservedNumVal; }
-   }
 private:
    OptionComboBox( const OptionIntEdit& ); // private copy constructor without implementation
    int* m_pVarNum;
-   int m_preservedNumVal;
+   int m_defaultNumVal;
    QString* m_pVarStr;
-   QString m_preservedStrVal;
-   int m_defaultVal;
+   QString m_defaultStrVal;
    
    void setText(const QString& s)
    {
-      // Find the string in the combobox-list, don't change the value if nothing fits.
+      // Find the string in the combobox-list, don't change the selection if nothing fits.
       for( int i=0; i<count(); ++i )
       {
          if ( itemText(i)==s )
          {
-            if (m_pVarNum!=0) *m_pVarNum = i;
-            if (m_pVarStr!=0) *m_pVarStr = s;
             setCurrentIndex(i);
             return;
          }
@@ -373,19 +480,19 @@ private:
    }
 };
 
-class OptionEncodingComboBox : public QComboBox, public OptionItem
+class OptionEncodingComboBox : public QComboBox, public OptionWidget
 {
    QVector<QTextCodec*> m_codecVec;
    QTextCodec** m_ppVarCodec;
 public:
-   OptionEncodingComboBox( const QString& saveName, QTextCodec** ppVarCodec,
+   OptionEncodingComboBox( const QString& /*saveName*/, QTextCodec** ppVarCodec,
                    QWidget* pParent, OptionDialog* pOD )
-   : QComboBox( pParent ), OptionItem( pOD, saveName )
+   : QComboBox( pParent ), OptionWidget( pOD )
    {
       m_ppVarCodec = ppVarCodec;
-      insertCodec( i18n("Unicode, 8 bit"),  QTextCodec::codecForName("UTF-8") );
-      insertCodec( i18n("Unicode"), QTextCodec::codecForName("iso-10646-UCS-2") );
-      insertCodec( i18n("Latin1"), QTextCodec::codecForName("iso 8859-1") );
+      insertCodec( i18n("Unicode, 8 bit"),  s_namedCodecs[0] );
+      insertCodec( i18n("Unicode"), s_namedCodecs[1] );
+      insertCodec( i18n("Latin1"), s_namedCodecs[2] );
 
       // First sort codec names:
       std::map<QString, QTextCodec*> names;
@@ -420,62 +527,30 @@ public:
          m_codecVec.push_back( c );
       }
    }
-   void setToDefault()
+   void setCodec( QTextCodec* pCodec )
    {
-      QString defaultName = QTextCodec::codecForLocale()->name();
-      for(int i=0;i<count();++i)
+      for( int i=0; i<m_codecVec.size(); ++i)
       {
-         if (defaultName==itemText(i) &&
-             m_codecVec[i]==QTextCodec::codecForLocale())
+         if ( pCodec==m_codecVec[i] )
          {
-            setCurrentIndex(i);
-            if (m_ppVarCodec!=0){ *m_ppVarCodec=m_codecVec[i]; }
-            return;
+            setCurrentIndex( i );
+            break;
          }
       }
-
-      setCurrentIndex( 0 );
-      if (m_ppVarCodec!=0){ *m_ppVarCodec=m_codecVec[0]; }
+   }
+   void setToDefault()
+   {
+      setCodec( getDefaultCodec() );
    }
    void setToCurrent()
    {
       if (m_ppVarCodec!=0)
-      {
-         for( int i=0; i<m_codecVec.size(); ++i)
-         {
-            if ( *m_ppVarCodec==m_codecVec[i] )
-            {
-               setCurrentIndex( i );
-               break;
-            }
-         }
-      }
+         setCodec( *m_ppVarCodec );
    }
    void apply()
    {
       if (m_ppVarCodec!=0){ *m_ppVarCodec = m_codecVec[ currentIndex() ]; }
    }
-   void write(ValueMap* config)
-   {
-      if (m_ppVarCodec!=0) config->writeEntry(m_saveName, QString((*m_ppVarCodec)->name()) );
-   }
-   void read (ValueMap* config)
-   {
-      QString codecName = config->readEntry( m_saveName, QString(m_codecVec[ currentIndex() ]->name()) );
-      for( int i=0; i<m_codecVec.size(); ++i)
-      {
-         if ( codecName == m_codecVec[i]->name() )
-         {
-            setCurrentIndex( i );
-            if (m_ppVarCodec!=0) *m_ppVarCodec = m_codecVec[i];
-            break;
-         }
-      }
-   }
-protected:
-   void preserve()   { m_preservedVal = currentIndex(); }
-   void unpreserve() { setCurrentIndex( m_preservedVal ); }
-   int m_preservedVal;
 };
 
 
@@ -493,13 +568,32 @@ OptionDialog::OptionDialog( bool bShowDirMergeSettings, QWidget *parent, char *n
    showButtonSeparator( true );
    setHelp( "kdiff3/index.html", QString::null );
 
+   m_bShowDirMergeSettings = bShowDirMergeSettings;
+   m_bPagesCreated = false;
+
+   // Only the values are initialized here. The pages with all their widgets
+   // are created when the dialog is shown for the first time (see setState()).
+   setupOptions();
+   setupOtherOptions();
+
+   connect(this, SIGNAL(applyClicked()), this, SLOT(slotApply()));
+   connect(this, SIGNAL(okClicked()), this, SLOT(slotOk()));
+   //helpClicked() is connected in KDiff3App::KDiff3App
+   connect(this, SIGNAL(defaultClicked()), this, SLOT(slotDefault()));
+}
+
+OptionDialog::~OptionDialog( void )
+{
+}
+
+void OptionDialog::createPages()
+{
    setupFontPage();
    setupColorPage();
    setupEditPage();
    setupDiffPage();
    setupMergePage();
-   setupOtherOptions();
-   if (bShowDirMergeSettings)
+   if (m_bShowDirMergeSettings)
       setupDirectoryMergePage();
 
    setupRegionalPage();
@@ -507,17 +601,131 @@ OptionDialog::OptionDialog( bool bShowDirMergeSettings, QWidget *parent, char *n
 
    //setupKeysPage();
 
-   // Initialize all values in the dialog
-   resetToDefaults();
-   slotApply();
-   connect(this, SIGNAL(applyClicked()), this, SLOT(slotApply()));
-   connect(this, SIGNAL(okClicked()), this, SLOT(slotOk()));
-   //helpClicked() is connected in KDiff3App::KDiff3App
-   connect(this, SIGNAL(defaultClicked()), this, SLOT(slotDefault()));
+   m_bPagesCreated = true;
 }
 
-OptionDialog::~OptionDialog( void )
+void OptionDialog::setupOptions()
 {
+   QFont defaultFont =
+#ifdef _WIN32
+      QFont("Courier New", 10 );
+#elif defined( KREPLACEMENTS_H )
+      QFont("Courier", 10 );
+#else
+      KGlobalSettings::fixedFont();
+#endif
+   new OptionFont( defaultFont, "Font", &m_options.m_font, this );
+   new OptionToggleAction( false, "ItalicForDeltas", &m_options.m_bItalicForDeltas, this );
+
+   int depth = QPixmap::defaultDepth();
+   bool bLowColor = depth<=8;
+   new OptionColor( Qt::black, "FgColor", &m_options.m_fgColor, this );
+   new OptionColor( Qt::white, "BgColor", &m_options.m_bgColor, this );
+   new OptionColor( bLowColor ? QColor(Qt::lightGray) : qRgb(224,224,224), "DiffBgColor", &m_options.m_diffBgColor, this );
+   new OptionColor( bLowColor ? qRgb(0,0,255) : qRgb(0,0,200)/*blue*/, "ColorA", &m_options.m_colorA, this );
+   new OptionColor( bLowColor ? qRgb(0,128,0) : qRgb(0,150,0)/*green*/, "ColorB", &m_options.m_colorB, this );
+   new OptionColor( bLowColor ? qRgb(128,0,128) : qRgb(150,0,150)/*magenta*/, "ColorC", &m_options.m_colorC, this );
+   new OptionColor( Qt::red, "ColorForConflict", &m_options.m_colorForConflict, this );
+   new OptionColor( bLowColor ? qRgb(192,192,192) : qRgb(220,220,100), "CurrentRangeBgColor", &m_options.m_currentRangeBgColor, this );
+   new OptionColor( bLowColor ? qRgb(255,255,0) : qRgb(255,255,150), "CurrentRangeDiffBgColor", &m_options.m_currentRangeDiffBgColor, this );
+   new OptionColor( qRgb(0xff,0xd0,0x80), "ManualAlignmentRangeColor", &m_options.m_manualHelpRangeColor, this );
+   new OptionColor( qRgb(0,0xd0,0), "NewestFileColor", &m_options.m_newestFileColor, this );
+   new OptionColor( qRgb(0xf0,0,0), "OldestFileColor", &m_options.m_oldestFileColor, this );
+   new OptionColor( qRgb(0xc0,0xc0,0), "MidAgeFileColor", &m_options.m_midAgeFileColor, this );
+   new OptionColor( qRgb(0,0,0), "MissingFileColor", &m_options.m_missingFileColor, this );
+
+   new OptionToggleAction( false, "ReplaceTabs", &m_options.m_bReplaceTabs, this );
+   new OptionNum( 8, "TabSize", &m_options.m_tabSize, this );
+   new OptionToggleAction( true,  "AutoIndentation", &m_options.m_bAutoIndentation, this );
+   new OptionToggleAction( false, "AutoCopySelection", &m_options.m_bAutoCopySelection, this );
+   new OptionNum( eLineEndStyleAutoDetect, "LineEndStyle", &m_options.m_lineEndStyle, this );
+
+   m_options.m_bPreserveCarriageReturn = false;
+   new OptionToggleAction( false, "IgnoreNumbers", &m_options.m_bIgnoreNumbers, this );
+   new OptionToggleAction( false, "IgnoreComments", &m_options.m_bIgnoreComments, this );
+   new OptionNum( eCommentStyleC, "CommentStyle", &m_options.m_commentStyle, this );
+   new OptionToggleAction( false, "IgnoreCase", &m_options.m_bIgnoreCase, this );
+   new OptionStringHistory( "", "PreProcessorCmd", &m_options.m_PreProcessorCmd, this );
+   new OptionStringHistory( "", "LineMatchingPreProcessorCmd", &m_options.m_LineMatchingPreProcessorCmd, this );
+   new OptionStringHistory( "", "IgnoreRegExp", &m_options.m_ignoreRegExp, this );
+   new OptionToggleAction( true,  "TryHard", &m_options.m_bTryHard, this );
+   new OptionToggleAction( false, "Diff3AlignBC", &m_options.m_bDiff3AlignBC, this );
+
+   new OptionNum( 500, "AutoAdvanceDelay", &m_options.m_autoAdvanceDelay, this );
+   new OptionToggleAction( true,  "ShowInfoDialogs", &m_options.m_bShowInfoDialogs, this );
+   new OptionNum( 0, "WhiteSpace2FileMergeDefault", &m_options.m_whiteSpace2FileMergeDefault, this );
+   new OptionNum( 0, "WhiteSpace3FileMergeDefault", &m_options.m_whiteSpace3FileMergeDefault, this );
+   new OptionStringHistory( ".*\\$(Version|Header|Date|Author).*\\$.*", "AutoMergeRegExp", &m_options.m_autoMergeRegExp, this );
+   new OptionToggleAction( false, "RunRegExpAutoMergeOnMergeStart", &m_options.m_bRunRegExpAutoMergeOnMergeStart, this );
+   new OptionStringHistory( ".*\\$Log.*\\$.*", "HistoryStartRegExp", &m_options.m_historyStartRegExp, this );
+   // Example line:  "** \main\rolle_fsp_dev_008\1   17 Aug 2001 10:45:44   rolle"
+   QString historyEntryStartDefault =
+         "\\s*\\\\main\\\\(\\S+)\\s+"  // Start with  "\main\"
+         "([0-9]+) "          // day
+         "(Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Oct|Nov|Dec) " //month
+         "([0-9][0-9][0-9][0-9]) " // year
+         "([0-9][0-9]:[0-9][0-9]:[0-9][0-9])\\s+(.*)";  // time, name
+   new OptionStringHistory( historyEntryStartDefault, "HistoryEntryStartRegExp", &m_options.m_historyEntryStartRegExp, this );
+   new OptionToggleAction( false, "HistoryMergeSorting", &m_options.m_bHistoryMergeSorting, this );
+         //QString branch = newHistoryEntry.cap(1);
+         //int day    = newHistoryEntry.cap(2).toInt();
+         //int month  = QString("Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Oct|Nov|Dec").find(newHistoryEntry.cap(3))/4 + 1;
+         //int year   = newHistoryEntry.cap(4).toInt();
+         //QString time = newHistoryEntry.cap(5);
+         //QString name = newHistoryEntry.cap(6);
+   QString defaultSortKeyOrder = "4,3,2,5,1,6"; //QDate(year,month,day).toString(Qt::ISODate) +" "+ time + " " + branch + " " + name;
+   new OptionStringHistory( defaultSortKeyOrder, "HistoryEntryStartSortKeyOrder", &m_options.m_historyEntryStartSortKeyOrder, this );
+   new OptionToggleAction( false, "RunHistoryAutoMergeOnMergeStart", &m_options.m_bRunHistoryAutoMergeOnMergeStart, this );
+   new OptionNum( -1, "MaxNofHistoryEntries", &m_options.m_maxNofHistoryEntries, this );
+   new OptionStringHistory( "", "IrrelevantMergeCmd", &m_options.m_IrrelevantMergeCmd, this );
+   new OptionToggleAction( false, "AutoSaveAndQuitOnMergeWithoutConflicts", &m_options.m_bAutoSaveAndQuitOnMergeWithoutConflicts, this );
+
+   // The directory merge values are needed even if that page isn't shown.
+   new OptionToggleAction( true,  "RecursiveDirs", &m_options.m_bDmRecursiveDirs, this );
+   new OptionStringHistory( "*", "FilePattern", &m_options.m_DmFilePattern, this );
+   new OptionStringHistory( "*.orig;*.o;*.obj;*.rej;*.bak", "FileAntiPattern", &m_options.m_DmFileAntiPattern, this );
+   new OptionStringHistory( "CVS;.deps;.svn;.hg;.git", "DirAntiPattern", &m_options.m_DmDirAntiPattern, this );
+   new OptionToggleAction( false, "UseCvsIgnore", &m_options.m_bDmUseCvsIgnore, this );
+   new OptionToggleAction( true,  "FindHidden", &m_options.m_bDmFindHidden, this );
+   new OptionToggleAction( false, "FollowFileLinks", &m_options.m_bDmFollowFileLinks, this );
+   new OptionToggleAction( false, "FollowDirLinks", &m_options.m_bDmFollowDirLinks, this );
+#if defined(_WIN32) || defined(Q_OS_OS2)
+   bool bCaseSensitiveFilenameComparison = false;
+#else
+   bool bCaseSensitiveFilenameComparison = true;
+#endif
+   new OptionToggleAction( bCaseSensitiveFilenameComparison, "CaseSensitiveFilenameComparison", &m_options.m_bDmCaseSensitiveFilenameComparison, this );
+   new OptionToggleAction( false, "UnfoldSubdirs", &m_options.m_bDmUnfoldSubdirs, this );
+   new OptionToggleAction( false, "SkipDirStatus", &m_options.m_bDmSkipDirStatus, this );
+   new OptionToggleAction( true,  "BinaryComparison", &m_options.m_bDmBinaryComparison, this );
+   new OptionToggleAction( false, "FullAnalysis", &m_options.m_bDmFullAnalysis, this );
+   new OptionToggleAction( false, "TrustDate", &m_options.m_bDmTrustDate, this );
+   new OptionToggleAction( false, "TrustDateFallbackToBinary", &m_options.m_bDmTrustDateFallbackToBinary, this );
+   new OptionToggleAction( false, "TrustSize", &m_options.m_bDmTrustSize, this );
+   new OptionToggleAction( false, "SyncMode", &m_options.m_bDmSyncMode, this );
+   new OptionToggleAction( true,  "WhiteSpaceEqual", &m_options.m_bDmWhiteSpaceEqual, this );
+   new OptionToggleAction( false, "CopyNewer", &m_options.m_bDmCopyNewer, this );
+   new OptionToggleAction( true,  "CreateBakFiles", &m_options.m_bDmCreateBakFiles, this );
+
+   new Utf8BOMCodec();
+   initNamedCodecs();
+#ifdef KREPLACEMENTS_H
+   new OptionString( "Auto", "Language", &m_options.m_language, this );
+#endif
+   new OptionToggleAction( true,  "SameEncoding", &m_options.m_bSameEncoding, this );
+   new OptionCodec( "EncodingForA", &m_options.m_pEncodingA, this );
+   new OptionToggleAction( true,  "AutoDetectUnicodeA", &m_options.m_bAutoDetectUnicodeA, this );
+   new OptionCodec( "EncodingForB", &m_options.m_pEncodingB, this );
+   new OptionToggleAction( true,  "AutoDetectUnicodeB", &m_options.m_bAutoDetectUnicodeB, this );
+   new OptionCodec( "EncodingForC", &m_options.m_pEncodingC, this );
+   new OptionToggleAction( true,  "AutoDetectUnicodeC", &m_options.m_bAutoDetectUnicodeC, this );
+   new OptionCodec( "EncodingForOutput", &m_options.m_pEncodingOut, this );
+   new OptionToggleAction( true,  "AutoSelectOutEncoding", &m_options.m_bAutoSelectOutEncoding, this );
+   new OptionCodec( "EncodingForPP", &m_options.m_pEncodingPP, this );
+   new OptionToggleAction( false, "RightToLeftLanguage", &m_options.m_bRightToLeftLanguage, this );
+
+   new OptionStringHistory( "-u;-query;-html;-abort", "IgnorableCmdLineOptions", &m_options.m_ignorableCmdLineOptions, this );
+   new OptionToggleAction( false, "EscapeKeyQuits", &m_options.m_bEscapeKeyQuits, this );
 }
 
 void OptionDialog::setupOtherOptions()
@@ -562,23 +770,14 @@ void OptionDialog::setupFontPage( void )
    topLayout->setMargin( 5 );
    topLayout->setSpacing( spacingHint() );
 
-   QFont defaultFont =
-#ifdef _WIN32
-      QFont("Courier New", 10 );
-#elif defined( KREPLACEMENTS_H )
-      QFont("Courier", 10 );
-#else
-      KGlobalSettings::fixedFont();
-#endif
-
-   OptionFontChooser* pFontChooser = new OptionFontChooser( defaultFont, "Font", &m_options.m_font, page, this );
+   OptionFontChooser* pFontChooser = new OptionFontChooser( "Font", &m_options.m_font, page, this );
    topLayout->addWidget( pFontChooser );
 
    QGridLayout *gbox = new QGridLayout();
    topLayout->addLayout( gbox );
    int line=0;
 
-   OptionCheckBox* pItalicDeltas = new OptionCheckBox( i18n("Italic font for deltas"), false, "ItalicForDeltas", &m_options.m_bItalicForDeltas, page, this );
+   OptionCheckBox* pItalicDeltas = new OptionCheckBox( i18n("Italic font for deltas"), "ItalicForDeltas", &m_options.m_bItalicForDeltas, page, this );
    gbox->addWidget( pItalicDeltas, line, 0, 1, 2 );
    pItalicDeltas->setToolTip( i18n(
       "Selects the italic version of the font for differences.\n"
@@ -607,9 +806,6 @@ void OptionDialog::setupColorPage( void )
   QLabel* label;
   int line = 0;
 
-  int depth = QPixmap::defaultDepth();
-  bool bLowColor = depth<=8;
-
   label = new QLabel( i18n("Editor and Diff Views:"), page );
   gbox->addWidget( label, line, 0 );
   QFont f( label->font() );
@@ -617,14 +813,14 @@ void OptionDialog::setupColorPage( void )
   label->setFont(f);
   ++line;
 
-  OptionColorButton* pFgColor = new OptionColorButton( Qt::black,"FgColor", &m_options.m_fgColor, page, this );
+  OptionColorButton* pFgColor = new OptionColorButton( "FgColor", &m_options.m_fgColor, page, this );
   label = new QLabel( i18n("Foreground color:"), page );
   label->setBuddy(pFgColor);
   gbox->addWidget( label, line, 0 );
   gbox->addWidget( pFgColor, line, 1 );
   ++line;
 
-  OptionColorButton* pBgColor = new OptionColorButton( Qt::white, "BgColor", &m_options.m_bgColor, page, this );
+  OptionColorButton* pBgColor = new OptionColorButton( "BgColor", &m_options.m_bgColor, page, this );
   label = new QLabel( i18n("Background color:"), page );
   label->setBuddy(pBgColor);
   gbox->addWidget( label, line, 0 );
@@ -632,62 +828,56 @@ void OptionDialog::setupColorPage( void )
 
   ++line;
 
-  OptionColorButton* pDiffBgColor = new OptionColorButton( 
-     bLowColor ? QColor(Qt::lightGray) : qRgb(224,224,224), "DiffBgColor", &m_options.m_diffBgColor, page, this );
+  OptionColorButton* pDiffBgColor = new OptionColorButton( "DiffBgColor", &m_options.m_diffBgColor, page, this );
   label = new QLabel( i18n("Diff background color:"), page );
   label->setBuddy(pDiffBgColor);
   gbox->addWidget( label, line, 0 );
   gbox->addWidget( pDiffBgColor, line, 1 );
   ++line;
 
-  OptionColorButton* pColorA = new OptionColorButton(
-     bLowColor ? qRgb(0,0,255) : qRgb(0,0,200)/*blue*/, "ColorA", &m_options.m_colorA, page, this );
+  OptionColorButton* pColorA = new OptionColorButton( "ColorA", &m_options.m_colorA, page, this );
   label = new QLabel( i18n("Color A:"), page );
   label->setBuddy(pColorA);
   gbox->addWidget( label, line, 0 );
   gbox->addWidget( pColorA, line, 1 );
   ++line;
 
-  OptionColorButton* pColorB = new OptionColorButton(
-     bLowColor ? qRgb(0,128,0) : qRgb(0,150,0)/*green*/, "ColorB", &m_options.m_colorB, page, this );
+  OptionColorButton* pColorB = new OptionColorButton( "ColorB", &m_options.m_colorB, page, this );
   label = new QLabel( i18n("Color B:"), page );
   label->setBuddy(pColorB);
   gbox->addWidget( label, line, 0 );
   gbox->addWidget( pColorB, line, 1 );
   ++line;
 
-  OptionColorButton* pColorC = new OptionColorButton(
-     bLowColor ? qRgb(128,0,128) : qRgb(150,0,150)/*magenta*/, "ColorC", &m_options.m_colorC, page, this );
+  OptionColorButton* pColorC = new OptionColorButton( "ColorC", &m_options.m_colorC, page, this );
   label = new QLabel( i18n("Color C:"), page );
   label->setBuddy(pColorC);
   gbox->addWidget( label, line, 0 );
   gbox->addWidget( pColorC, line, 1 );
   ++line;
 
-  OptionColorButton* pColorForConflict = new OptionColorButton( Qt::red, "ColorForConflict", &m_options.m_colorForConflict, page, this );
+  OptionColorButton* pColorForConflict = new OptionColorButton( "ColorForConflict", &m_options.m_colorForConflict, page, this );
   label = new QLabel( i18n("Conflict color:"), page );
   label->setBuddy(pColorForConflict);
   gbox->addWidget( label, line, 0 );
   gbox->addWidget( pColorForConflict, line, 1 );
   ++line;
 
-  OptionColorButton* pColor = new OptionColorButton( 
-     bLowColor ? qRgb(192,192,192) : qRgb(220,220,100), "CurrentRangeBgColor", &m_options.m_currentRangeBgColor, page, this );
+  OptionColorButton* pColor = new OptionColorButton( "CurrentRangeBgColor", &m_options.m_currentRangeBgColor, page, this );
   label = new QLabel( i18n("Current range background color:"), page );
   label->setBuddy(pColor);
   gbox->addWidget( label, line, 0 );
   gbox->addWidget( pColor, line, 1 );
   ++line;
 
-  pColor = new OptionColorButton( 
-     bLowColor ? qRgb(255,255,0) : qRgb(255,255,150), "CurrentRangeDiffBgColor", &m_options.m_currentRangeDiffBgColor, page, this );
+  pColor = new OptionColorButton( "CurrentRangeDiffBgColor", &m_options.m_currentRangeDiffBgColor, page, this );
   label = new QLabel( i18n("Current range diff background color:"), page );
   label->setBuddy(pColor);
   gbox->addWidget( label, line, 0 );
   gbox->addWidget( pColor, line, 1 );
   ++line;
 
-  pColor = new OptionColorButton( qRgb(0xff,0xd0,0x80), "ManualAlignmentRangeColor", &m_options.m_manualHelpRangeColor, page, this );
+  pColor = new OptionColorButton( "ManualAlignmentRangeColor", &m_options.m_manualHelpRangeColor, page, this );
   label = new QLabel( i18n("Color for manually aligned difference ranges:"), page );
   label->setBuddy(pColor);
   gbox->addWidget( label, line, 0 );
@@ -699,7 +889,7 @@ void OptionDialog::setupColorPage( void )
   label->setFont(f);
   ++line;
 
-  pColor = new OptionColorButton( qRgb(0,0xd0,0), "NewestFileColor", &m_options.m_newestFileColor, page, this );
+  pColor = new OptionColorButton( "NewestFileColor", &m_options.m_newestFileColor, page, this );
   label = new QLabel( i18n("Newest file color:"), page );
   label->setBuddy(pColor);
   gbox->addWidget( label, line, 0 );
@@ -708,7 +898,7 @@ void OptionDialog::setupColorPage( void )
   label->setToolTip( dirColorTip );
   ++line;
 
-  pColor = new OptionColorButton( qRgb(0xf0,0,0), "OldestFileColor", &m_options.m_oldestFileColor, page, this );
+  pColor = new OptionColorButton( "OldestFileColor", &m_options.m_oldestFileColor, page, this );
   label = new QLabel( i18n("Oldest file color:"), page );
   label->setBuddy(pColor);
   gbox->addWidget( label, line, 0 );
@@ -716,7 +906,7 @@ void OptionDialog::setupColorPage( void )
   label->setToolTip( dirColorTip );
   ++line;
 
-  pColor = new OptionColorButton( qRgb(0xc0,0xc0,0), "MidAgeFileColor", &m_options.m_midAgeFileColor, page, this );
+  pColor = new OptionColorButton( "MidAgeFileColor", &m_options.m_midAgeFileColor, page, this );
   label = new QLabel( i18n("Middle age file color:"), page );
   label->setBuddy(pColor);
   gbox->addWidget( label, line, 0 );
@@ -724,7 +914,7 @@ void OptionDialog::setupColorPage( void )
   label->setToolTip( dirColorTip );
   ++line;
 
-  pColor = new OptionColorButton( qRgb(0,0,0), "MissingFileColor", &m_options.m_missingFileColor, page, this );
+  pColor = new OptionColorButton( "MissingFileColor", &m_options.m_missingFileColor, page, this );
   label = new QLabel( i18n("Color for missing files:"), page );
   label->setBuddy(pColor);
   gbox->addWidget( label, line, 0 );
@@ -754,7 +944,7 @@ void OptionDialog::setupEditPage( void )
    QLabel* label;
    int line=0;
 
-   OptionCheckBox* pReplaceTabs = new OptionCheckBox( i18n("Tab inserts spaces"), false, "ReplaceTabs", &m_options.m_bReplaceTabs, page, this );
+   OptionCheckBox* pReplaceTabs = new OptionCheckBox( i18n("Tab inserts spaces"), "ReplaceTabs", &m_options.m_bReplaceTabs, page, this );
    gbox->addWidget( pReplaceTabs, line, 0, 1, 2 );
    pReplaceTabs->setToolTip( i18n(
       "On: Pressing tab generates the appropriate number of spaces.\n"
@@ -762,21 +952,21 @@ void OptionDialog::setupEditPage( void )
       );
    ++line;
 
-   OptionIntEdit* pTabSize = new OptionIntEdit( 8, "TabSize", &m_options.m_tabSize, 1, 100, page, this );
+   OptionIntEdit* pTabSize = new OptionIntEdit( "TabSize", &m_options.m_tabSize, 1, 100, page, this );
    label = new QLabel( i18n("Tab size:"), page );
    label->setBuddy( pTabSize );
    gbox->addWidget( label, line, 0 );
    gbox->addWidget( pTabSize, line, 1 );
    ++line;
 
-   OptionCheckBox* pAutoIndentation = new OptionCheckBox( i18n("Auto indentation"), true, "AutoIndentation", &m_options.m_bAutoIndentation, page, this  );
+   OptionCheckBox* pAutoIndentation = new OptionCheckBox( i18n("Auto indentation"), "AutoIndentation", &m_options.m_bAutoIndentation, page, this  );
    gbox->addWidget( pAutoIndentation, line, 0, 1, 2 );
    pAutoIndentation->setToolTip( i18n(
       "On: The indentation of the previous line is used for a new line.\n"
       ));
    ++line;
 
-   OptionCheckBox* pAutoCopySelection = new OptionCheckBox( i18n("Auto copy selection"), false, "AutoCopySelection", &m_options.m_bAutoCopySelection, page, this );
+   OptionCheckBox* pAutoCopySelection = new OptionCheckBox( i18n("Auto copy selection"), "AutoCopySelection", &m_options.m_bAutoCopySelection, page, this );
    gbox->addWidget( pAutoCopySelection, line, 0, 1, 2 );
    pAutoCopySelection->setToolTip( i18n(
       "On: Any selection is immediately written to the clipboard.\n"
@@ -787,7 +977,7 @@ void OptionDialog::setupEditPage( void )
    label = new QLabel( i18n("Line end style:"), page );
    gbox->addWidget( label, line, 0 );
 
-   OptionComboBox* pLineEndStyle = new OptionComboBox( eLineEndStyleAutoDetect, "LineEndStyle", &m_options.m_lineEndStyle, page, this );
+   OptionComboBox* pLineEndStyle = new OptionComboBox( "LineEndStyle", &m_options.m_lineEndStyle, page, this );
    gbox->addWidget( pLineEndStyle, line, 1 );
    pLineEndStyle->insertItem( eLineEndStyleUnix, "Unix" );
    pLineEndStyle->insertItem( eLineEndStyleDos, "Dos/Windows" );
@@ -823,7 +1013,6 @@ void OptionDialog::setupDiffPage( void )
 
    QLabel* label=0;
 
-   m_options.m_bPreserveCarriageReturn = false;
    //OptionCheckBox* pPreserveCarriageReturn = new OptionCheckBox( i18n("Preserve carriage return"), false, "PreserveCarriageReturn", &m_bPreserveCarriageReturn, page, this );
    //gbox->addWidget( pPreserveCarriageReturn, line, 0, 1, 2 );
    //pPreserveCarriageReturn->setToolTip( i18n(
@@ -833,7 +1022,7 @@ void OptionDialog::setupDiffPage( void )
    //++line;
    QString treatAsWhiteSpace = " ("+i18n("Treat as white space.")+")";
 
-   OptionCheckBox* pIgnoreNumbers = new OptionCheckBox( i18n("Ignore numbers")+treatAsWhiteSpace, false, "IgnoreNumbers", &m_options.m_bIgnoreNumbers, page, this );
+   OptionCheckBox* pIgnoreNumbers = new OptionCheckBox( i18n("Ignore numbers")+treatAsWhiteSpace, "IgnoreNumbers", &m_options.m_bIgnoreNumbers, page, this );
    gbox->addWidget( pIgnoreNumbers, line, 0, 1, 2 );
    pIgnoreNumbers->setToolTip( i18n(
       "Ignore number characters during line matching phase. (Similar to Ignore white space.)\n"
@@ -841,13 +1030,24 @@ void OptionDialog::setupDiffPage( void )
       );
    ++line;
 
-   OptionCheckBox* pIgnoreComments = new OptionCheckBox( i18n("Ignore C/C++ comments")+treatAsWhiteSpace, false, "IgnoreComments", &m_options.m_bIgnoreComments, page, this );
+   OptionCheckBox* pIgnoreComments = new OptionCheckBox( i18n("Ignore comments")+treatAsWhiteSpace, "IgnoreComments", &m_options.m_bIgnoreComments, page, this );
    gbox->addWidget( pIgnoreComments, line, 0, 1, 2 );
-   pIgnoreComments->setToolTip( i18n( "Treat C/C++ comments like white space.")
+   pIgnoreComments->setToolTip( i18n( "Treat comments like white space. (See also: Comment style)")
       );
    ++line;
 
-   OptionCheckBox* pIgnoreCase = new OptionCheckBox( i18n("Ignore case")+treatAsWhiteSpace, false, "IgnoreCase", &m_options.m_bIgnoreCase, page, this );
+   label = new QLabel( i18n("Comment style:"), page );
+   gbox->addWidget( label, line, 0 );
+   OptionComboBox* pCommentStyle = new OptionComboBox( "CommentStyle", &m_options.m_commentStyle, page, this );
+   gbox->addWidget( pCommentStyle, line, 1 );
+   pCommentStyle->insertItem( eCommentStyleC,    "C/C++:  //  /* */" );
+   pCommentStyle->insertItem( eCommentStyleHash, i18n("Shell/Python:  #") );
+   pCommentStyle->insertItem( eCommentStyleSql,  "SQL:  --  /* */" );
+   pCommentStyle->insertItem( eCommentStyleXml,  "XML/HTML:  <!-- -->" );
+   label->setToolTip( i18n("The comment syntax used for \"Ignore comments\".") );
+   ++line;
+
+   OptionCheckBox* pIgnoreCase = new OptionCheckBox( i18n("Ignore case")+treatAsWhiteSpace, "IgnoreCase", &m_options.m_bIgnoreCase, page, this );
    gbox->addWidget( pIgnoreCase, line, 0, 1, 2 );
    pIgnoreCase->setToolTip( i18n(
       "Treat case differences like white space changes. ('a'<=>'A')")
@@ -856,19 +1056,30 @@ void OptionDialog::setupDiffPage( void )
 
    label = new QLabel( i18n("Preprocessor command:"), page );
    gbox->addWidget( label, line, 0 );
-   OptionLineEdit* pLE = new OptionLineEdit( "", "PreProcessorCmd", &m_options.m_PreProcessorCmd, page, this );
+   OptionLineEdit* pLE = new OptionLineEdit( "PreProcessorCmd", &m_options.m_PreProcessorCmd, page, this );
    gbox->addWidget( pLE, line, 1 );
    label->setToolTip( i18n("User defined pre-processing. (See the docs for details.)") );
    ++line;
 
    label = new QLabel( i18n("Line-matching preprocessor command:"), page );
    gbox->addWidget( label, line, 0 );
-   pLE = new OptionLineEdit( "", "LineMatchingPreProcessorCmd", &m_options.m_LineMatchingPreProcessorCmd, page, this );
+   pLE = new OptionLineEdit( "LineMatchingPreProcessorCmd", &m_options.m_LineMatchingPreProcessorCmd, page, this );
    gbox->addWidget( pLE, line, 1 );
    label->setToolTip( i18n("This pre-processor is only used during line matching.\n(See the docs for details.)") );
    ++line;
 
-   OptionCheckBox* pTryHard = new OptionCheckBox( i18n("Try hard (slower)"), true, "TryHard", &m_options.m_bTryHard, page, this );
+   label = new QLabel( i18n("Ignore regular expression:"), page );
+   gbox->addWidget( label, line, 0 );
+   pLE = new OptionLineEdit( "IgnoreRegExp", &m_options.m_ignoreRegExp, page, this );
+   gbox->addWidget( pLE, line, 1 );
+   label->setToolTip( i18n(
+      "Parts of lines that match this regular expression are ignored during line matching.\n"
+      "(Similar to Ignore numbers. Combine several expressions with '|'.)\n"
+      "E.g. timestamps: [0-9]{2}:[0-9]{2}:[0-9]{2}\n"
+      "This is faster than a line-matching preprocessor command.") );
+   ++line;
+
+   OptionCheckBox* pTryHard = new OptionCheckBox( i18n("Try hard (slower)"), "TryHard", &m_options.m_bTryHard, page, this );
    gbox->addWidget( pTryHard, line, 0, 1, 2 );
    pTryHard->setToolTip( i18n(
       "Enables the --minimal option for the external diff.\n"
@@ -876,7 +1087,7 @@ void OptionDialog::setupDiffPage( void )
       );
    ++line;
 
-   OptionCheckBox* pDiff3AlignBC = new OptionCheckBox( i18n("Align B and C for 3 input files"), false, "Diff3AlignBC", &m_options.m_bDiff3AlignBC, page, this );
+   OptionCheckBox* pDiff3AlignBC = new OptionCheckBox( i18n("Align B and C for 3 input files"), "Diff3AlignBC", &m_options.m_bDiff3AlignBC, page, this );
    gbox->addWidget( pDiff3AlignBC, line, 0, 1, 2 );
    pDiff3AlignBC->setToolTip( i18n(
       "Try to align B and C when comparing or merging three input files.\n"
@@ -909,7 +1120,7 @@ void OptionDialog::setupMergePage( void )
 
    label = new QLabel( i18n("Auto advance delay (ms):"), page );
    gbox->addWidget( label, line, 0 );
-   OptionIntEdit* pAutoAdvanceDelay = new OptionIntEdit( 500, "AutoAdvanceDelay", &m_options.m_autoAdvanceDelay, 0, 2000, page, this );
+   OptionIntEdit* pAutoAdvanceDelay = new OptionIntEdit( "AutoAdvanceDelay", &m_options.m_autoAdvanceDelay, 0, 2000, page, this );
    gbox->addWidget( pAutoAdvanceDelay, line, 1 );
    label->setToolTip(i18n(
       "When in Auto-Advance mode the result of the current selection is shown \n"
@@ -917,14 +1128,14 @@ void OptionDialog::setupMergePage( void )
       );
    ++line;
 
-   OptionCheckBox* pShowInfoDialogs = new OptionCheckBox( i18n("Show info dialogs"), true, "ShowInfoDialogs", &m_options.m_bShowInfoDialogs, page, this );
+   OptionCheckBox* pShowInfoDialogs = new OptionCheckBox( i18n("Show info dialogs"), "ShowInfoDialogs", &m_options.m_bShowInfoDialogs, page, this );
    gbox->addWidget( pShowInfoDialogs, line, 0, 1, 2 );
    pShowInfoDialogs->setToolTip( i18n("Show a dialog with information about the number of conflicts.") );
    ++line;
 
    label = new QLabel( i18n("White space 2-file merge default:"), page );
    gbox->addWidget( label, line, 0 );
-   OptionComboBox* pWhiteSpace2FileMergeDefault = new OptionComboBox( 0, "WhiteSpace2FileMergeDefault", &m_options.m_whiteSpace2FileMergeDefault, page, this );
+   OptionComboBox* pWhiteSpace2FileMergeDefault = new OptionComboBox( "WhiteSpace2FileMergeDefault", &m_options.m_whiteSpace2FileMergeDefault, page, this );
    gbox->addWidget( pWhiteSpace2FileMergeDefault, line, 1 );
    pWhiteSpace2FileMergeDefault->insertItem( 0, i18n("Manual Choice") );
    pWhiteSpace2FileMergeDefault->insertItem( 1, "A" );
@@ -937,7 +1148,7 @@ void OptionDialog::setupMergePage( void )
 
    label = new QLabel( i18n("White space 3-file merge default:"), page );
    gbox->addWidget( label, line, 0 );
-   OptionComboBox* pWhiteSpace3FileMergeDefault = new OptionComboBox( 0, "WhiteSpace3FileMergeDefault", &m_options.m_whiteSpace3FileMergeDefault, page, this );
+   OptionComboBox* pWhiteSpace3FileMergeDefault = new OptionComboBox( "WhiteSpace3FileMergeDefault", &m_options.m_whiteSpace3FileMergeDefault, page, this );
    gbox->addWidget( pWhiteSpace3FileMergeDefault, line, 1 );
    pWhiteSpace3FileMergeDefault->insertItem( 0, i18n("Manual Choice") );
    pWhiteSpace3FileMergeDefault->insertItem( 1, "A" );
@@ -960,7 +1171,7 @@ void OptionDialog::setupMergePage( void )
 
       label = new QLabel( i18n("Auto merge regular expression:"), page );
       gbox->addWidget( label, line, 0 );
-      m_pAutoMergeRegExpLineEdit = new OptionLineEdit( ".*\\$(Version|Header|Date|Author).*\\$.*", "AutoMergeRegExp", &m_options.m_autoMergeRegExp, page, this );
+      m_pAutoMergeRegExpLineEdit = new OptionLineEdit( "AutoMergeRegExp", &m_options.m_autoMergeRegExp, page, this );
       gbox->addWidget( m_pAutoMergeRegExpLineEdit, line, 1 );
       s_autoMergeRegExpToolTip = i18n("Regular expression for lines where KDiff3 should automatically choose one source.\n"
             "When a line with a conflict matches the regular expression then\n"
@@ -968,7 +1179,7 @@ void OptionDialog::setupMergePage( void )
       label->setToolTip( s_autoMergeRegExpToolTip );
       ++line;
 
-      OptionCheckBox* pAutoMergeRegExp = new OptionCheckBox( i18n("Run regular expression auto merge on merge start"), false, "RunRegExpAutoMergeOnMergeStart", &m_options.m_bRunRegExpAutoMergeOnMergeStart, page, this );
+      OptionCheckBox* pAutoMergeRegExp = new OptionCheckBox( i18n("Run regular expression auto merge on merge start"), "RunRegExpAutoMergeOnMergeStart", &m_options.m_bRunRegExpAutoMergeOnMergeStart, page, this );
       gbox->addWidget( pAutoMergeRegExp, line, 0, 1, 2 );
       pAutoMergeRegExp->setToolTip( i18n( "Run the merge for auto merge regular expressions\n"
             "immediately when a merge starts.\n"));
@@ -986,7 +1197,7 @@ void OptionDialog::setupMergePage( void )
 
       label = new QLabel( i18n("History start regular expression:"), page );
       gbox->addWidget( label, line, 0 );
-      m_pHistoryStartRegExpLineEdit = new OptionLineEdit( ".*\\$Log.*\\$.*", "HistoryStartRegExp", &m_options.m_historyStartRegExp, page, this );
+      m_pHistoryStartRegExpLineEdit = new OptionLineEdit( "HistoryStartRegExp", &m_options.m_historyStartRegExp, page, this );
       gbox->addWidget( m_pHistoryStartRegExpLineEdit, line, 1 );
       s_historyStartRegExpToolTip = i18n("Regular expression for the start of the version control history entry.\n"
             "Usually this line contains the \"$Log$\" keyword.\n"
@@ -996,15 +1207,7 @@ void OptionDialog::setupMergePage( void )
    
       label = new QLabel( i18n("History entry start regular expression:"), page );
       gbox->addWidget( label, line, 0 );
-      // Example line:  "** \main\rolle_fsp_dev_008\1   17 Aug 2001 10:45:44   rolle"
-      QString historyEntryStartDefault =
-            "\\s*\\\\main\\\\(\\S+)\\s+"  // Start with  "\main\"
-            "([0-9]+) "          // day
-            "(Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Oct|Nov|Dec) " //month
-            "([0-9][0-9][0-9][0-9]) " // year
-            "([0-9][0-9]:[0-9][0-9]:[0-9][0-9])\\s+(.*)";  // time, name
-   
-      m_pHistoryEntryStartRegExpLineEdit = new OptionLineEdit( historyEntryStartDefault, "HistoryEntryStartRegExp", &m_options.m_historyEntryStartRegExp, page, this );
+      m_pHistoryEntryStartRegExpLineEdit = new OptionLineEdit( "HistoryEntryStartRegExp", &m_options.m_historyEntryStartRegExp, page, this );
       gbox->addWidget( m_pHistoryEntryStartRegExpLineEdit, line, 1 );
       s_historyEntryStartRegExpToolTip = i18n("A version control history entry consists of several lines.\n"
             "Specify the regular expression to detect the first line (without the leading comment).\n"
@@ -1014,21 +1217,13 @@ void OptionDialog::setupMergePage( void )
       label->setToolTip( s_historyEntryStartRegExpToolTip );
       ++line;
    
-      m_pHistoryMergeSorting = new OptionCheckBox( i18n("History merge sorting"), false, "HistoryMergeSorting", &m_options.m_bHistoryMergeSorting, page, this );
+      m_pHistoryMergeSorting = new OptionCheckBox( i18n("History merge sorting"), "HistoryMergeSorting", &m_options.m_bHistoryMergeSorting, page, this );
       gbox->addWidget( m_pHistoryMergeSorting, line, 0, 1, 2 );
       m_pHistoryMergeSorting->setToolTip( i18n("Sort version control history by a key.") );
       ++line;
-            //QString branch = newHistoryEntry.cap(1);
-            //int day    = newHistoryEntry.cap(2).toInt();
-            //int month  = QString("Jan|Feb|Mar|Apr|May|Jun|Jul|Aug|Sep|Oct|Nov|Dec").find(newHistoryEntry.cap(3))/4 + 1;
-            //int year   = newHistoryEntry.cap(4).toInt();
-            //QString time = newHistoryEntry.cap(5);
-            //QString name = newHistoryEntry.cap(6);
-      QString defaultSortKeyOrder = "4,3,2,5,1,6"; //QDate(year,month,day).toString(Qt::ISODate) +" "+ time + " " + branch + " " + name;
-
       label = new QLabel( i18n("History entry start sort key order:"), page );
       gbox->addWidget( label, line, 0 );
-      m_pHistorySortKeyOrderLineEdit = new OptionLineEdit( defaultSortKeyOrder, "HistoryEntryStartSortKeyOrder", &m_options.m_historyEntryStartSortKeyOrder, page, this );
+      m_pHistorySortKeyOrderLineEdit = new OptionLineEdit( "HistoryEntryStartSortKeyOrder", &m_options.m_historyEntryStartSortKeyOrder, page, this );
       gbox->addWidget( m_pHistorySortKeyOrderLineEdit, line, 1 );
       s_historyEntryStartSortKeyOrderToolTip = i18n("Each pair of parentheses used in the regular expression for the history start entry\n"
             "groups a key that can be used for sorting.\n"
@@ -1041,12 +1236,12 @@ void OptionDialog::setupMergePage( void )
       connect( m_pHistoryMergeSorting, SIGNAL(toggled(bool)), m_pHistorySortKeyOrderLineEdit, SLOT(setEnabled(bool)));
       ++line;
 
-      m_pHistoryAutoMerge = new OptionCheckBox( i18n("Merge version control history on merge start"), false, "RunHistoryAutoMergeOnMergeStart", &m_options.m_bRunHistoryAutoMergeOnMergeStart, page, this );
+      m_pHistoryAutoMerge = new OptionCheckBox( i18n("Merge version control history on merge start"), "RunHistoryAutoMergeOnMergeStart", &m_options.m_bRunHistoryAutoMergeOnMergeStart, page, this );
       gbox->addWidget( m_pHistoryAutoMerge, line, 0, 1, 2 );
       m_pHistoryAutoMerge->setToolTip( i18n("Run version control history automerge on merge start.") );
       ++line;
 
-      OptionIntEdit* pMaxNofHistoryEntries = new OptionIntEdit( -1, "MaxNofHistoryEntries", &m_options.m_maxNofHistoryEntries, -1, 1000, page, this );
+      OptionIntEdit* pMaxNofHistoryEntries = new OptionIntEdit( "MaxNofHistoryEntries", &m_options.m_maxNofHistoryEntries, -1, 1000, page, this );
       label = new QLabel( i18n("Max number of history entries:"), page );
       gbox->addWidget( label, line, 0 );
       gbox->addWidget( pMaxNofHistoryEntries, line, 1 );
@@ -1061,7 +1256,7 @@ void OptionDialog::setupMergePage( void )
 
    label = new QLabel( i18n("Irrelevant merge command:"), page );
    gbox->addWidget( label, line, 0 );
-   OptionLineEdit* pLE = new OptionLineEdit( "", "IrrelevantMergeCmd", &m_options.m_IrrelevantMergeCmd, page, this );
+   OptionLineEdit* pLE = new OptionLineEdit( "IrrelevantMergeCmd", &m_options.m_IrrelevantMergeCmd, page, this );
    gbox->addWidget( pLE, line, 1 );
    label->setToolTip( i18n("If specified this script is run after automerge\n"
          "when no other relevant changes were detected.\n"
@@ -1069,7 +1264,7 @@ void OptionDialog::setupMergePage( void )
    ++line;
 
 
-   OptionCheckBox* pAutoSaveAndQuit = new OptionCheckBox( i18n("Auto save and quit on merge without conflicts"), false,
+   OptionCheckBox* pAutoSaveAndQuit = new OptionCheckBox( i18n("Auto save and quit on merge without conflicts"),
       "AutoSaveAndQuitOnMergeWithoutConflicts", &m_options.m_bAutoSaveAndQuitOnMergeWithoutConflicts, page, this );
    gbox->addWidget( pAutoSaveAndQuit, line, 0, 1, 2 );
    pAutoSaveAndQuit->setToolTip( i18n("If KDiff3 was started for a file-merge from the command line and all\n"
@@ -1097,13 +1292,13 @@ void OptionDialog::setupDirectoryMergePage( void )
    topLayout->addLayout( gbox );
    int line=0;
 
-   OptionCheckBox* pRecursiveDirs = new OptionCheckBox( i18n("Recursive directories"), true, "RecursiveDirs", &m_options.m_bDmRecursiveDirs, page, this );
+   OptionCheckBox* pRecursiveDirs = new OptionCheckBox( i18n("Recursive directories"), "RecursiveDirs", &m_options.m_bDmRecursiveDirs, page, this );
    gbox->addWidget( pRecursiveDirs, line, 0, 1, 2 );
    pRecursiveDirs->setToolTip( i18n("Whether to analyze subdirectories or not.") );
    ++line;
    QLabel* label = new QLabel( i18n("File pattern(s):"), page );
    gbox->addWidget( label, line, 0 );
-   OptionLineEdit* pFilePattern = new OptionLineEdit( "*", "FilePattern", &m_options.m_DmFilePattern, page, this );
+   OptionLineEdit* pFilePattern = new OptionLineEdit( "FilePattern", &m_options.m_DmFilePattern, page, this );
    gbox->addWidget( pFilePattern, line, 1 );
    label->setToolTip( i18n(
       "Pattern(s) of files to be analyzed. \n"
@@ -1114,7 +1309,7 @@ void OptionDialog::setupDirectoryMergePage( void )
 
    label = new QLabel( i18n("File-anti-pattern(s):"), page );
    gbox->addWidget( label, line, 0 );
-   OptionLineEdit* pFileAntiPattern = new OptionLineEdit( "*.orig;*.o;*.obj;*.rej;*.bak", "FileAntiPattern", &m_options.m_DmFileAntiPattern, page, this );
+   OptionLineEdit* pFileAntiPattern = new OptionLineEdit( "FileAntiPattern", &m_options.m_DmFileAntiPattern, page, this );
    gbox->addWidget( pFileAntiPattern, line, 1 );
    label->setToolTip( i18n(
       "Pattern(s) of files to be excluded from analysis. \n"
@@ -1125,7 +1320,7 @@ void OptionDialog::setupDirectoryMergePage( void )
 
    label = new QLabel( i18n("Dir-anti-pattern(s):"), page );
    gbox->addWidget( label, line, 0 );
-   OptionLineEdit* pDirAntiPattern = new OptionLineEdit( "CVS;.deps;.svn;.hg;.git", "DirAntiPattern", &m_options.m_DmDirAntiPattern, page, this );
+   OptionLineEdit* pDirAntiPattern = new OptionLineEdit( "DirAntiPattern", &m_options.m_DmDirAntiPattern, page, this );
    gbox->addWidget( pDirAntiPattern, line, 1 );
    label->setToolTip( i18n(
       "Pattern(s) of directories to be excluded from analysis. \n"
@@ -1134,7 +1329,7 @@ void OptionDialog::setupDirectoryMergePage( void )
       ));
    ++line;
 
-   OptionCheckBox* pUseCvsIgnore = new OptionCheckBox( i18n("Use .cvsignore"), false, "UseCvsIgnore", &m_options.m_bDmUseCvsIgnore, page, this );
+   OptionCheckBox* pUseCvsIgnore = new OptionCheckBox( i18n("Use .cvsignore"), "UseCvsIgnore", &m_options.m_bDmUseCvsIgnore, page, this );
    gbox->addWidget( pUseCvsIgnore, line, 0, 1, 2 );
    pUseCvsIgnore->setToolTip( i18n(
       "Extends the antipattern to anything that would be ignored by CVS.\n"
@@ -1142,7 +1337,7 @@ void OptionDialog::setupDirectoryMergePage( void )
       ));
    ++line;
 
-   OptionCheckBox* pFindHidden = new OptionCheckBox( i18n("Find hidden files and directories"), true, "FindHidden", &m_options.m_bDmFindHidden, page, this );
+   OptionCheckBox* pFindHidden = new OptionCheckBox( i18n("Find hidden files and directories"), "FindHidden", &m_options.m_bDmFindHidden, page, this );
    gbox->addWidget( pFindHidden, line, 0, 1, 2 );
 #if defined(_WIN32) || defined(Q_OS_OS2)
    pFindHidden->setToolTip( i18n("Finds files and directories with the hidden attribute.") );
@@ -1151,7 +1346,7 @@ void OptionDialog::setupDirectoryMergePage( void )
 #endif
    ++line;
 
-   OptionCheckBox* pFollowFileLinks = new OptionCheckBox( i18n("Follow file links"), false, "FollowFileLinks", &m_options.m_bDmFollowFileLinks, page, this );
+   OptionCheckBox* pFollowFileLinks = new OptionCheckBox( i18n("Follow file links"), "FollowFileLinks", &m_options.m_bDmFollowFileLinks, page, this );
    gbox->addWidget( pFollowFileLinks, line, 0, 1, 2 );
    pFollowFileLinks->setToolTip( i18n(
       "On: Compare the file the link points to.\n"
@@ -1159,7 +1354,7 @@ void OptionDialog::setupDirectoryMergePage( void )
       ));
    ++line;
 
-   OptionCheckBox* pFollowDirLinks = new OptionCheckBox( i18n("Follow directory links"), false, "FollowDirLinks", &m_options.m_bDmFollowDirLinks, page, this );
+   OptionCheckBox* pFollowDirLinks = new OptionCheckBox( i18n("Follow directory links"), "FollowDirLinks", &m_options.m_bDmFollowDirLinks, page, this );
    gbox->addWidget( pFollowDirLinks, line, 0, 1, 2 );
    pFollowDirLinks->setToolTip(    i18n(
       "On: Compare the directory the link points to.\n"
@@ -1173,19 +1368,14 @@ void OptionDialog::setupDirectoryMergePage( void )
    //              "Files and directories without change will not appear in the list."));
    //++line;
 
-#if defined(_WIN32) || defined(Q_OS_OS2)
-   bool bCaseSensitiveFilenameComparison = false;
-#else
-   bool bCaseSensitiveFilenameComparison = true;
-#endif
-   OptionCheckBox* pCaseSensitiveFileNames = new OptionCheckBox( i18n("Case sensitive filename comparison"),bCaseSensitiveFilenameComparison,"CaseSensitiveFilenameComparison", &m_options.m_bDmCaseSensitiveFilenameComparison, page, this );
+   OptionCheckBox* pCaseSensitiveFileNames = new OptionCheckBox( i18n("Case sensitive filename comparison"), "CaseSensitiveFilenameComparison", &m_options.m_bDmCaseSensitiveFilenameComparison, page, this );
    gbox->addWidget( pCaseSensitiveFileNames, line, 0, 1, 2 );
    pCaseSensitiveFileNames->setToolTip( i18n(
                  "The directory comparison will compare files or directories when their names match.\n"
                  "Set this option if the case of the names must match. (Default for Windows is off, otherwise on.)"));
    ++line;
 
-   OptionCheckBox* pUnfoldSubdirs = new OptionCheckBox( i18n("Unfold all subdirectories on load"), false, "UnfoldSubdirs", &m_options.m_bDmUnfoldSubdirs, page, this );
+   OptionCheckBox* pUnfoldSubdirs = new OptionCheckBox( i18n("Unfold all subdirectories on load"), "UnfoldSubdirs", &m_options.m_bDmUnfoldSubdirs, page, this );
    gbox->addWidget( pUnfoldSubdirs, line, 0, 1, 2 );
    pUnfoldSubdirs->setToolTip(    i18n(
       "On: Unfold all subdirectories when starting a directory diff.\n"
@@ -1193,7 +1383,7 @@ void OptionDialog::setupDirectoryMergePage( void )
       ));
    ++line;
 
-   OptionCheckBox* pSkipDirStatus = new OptionCheckBox( i18n("Skip directory status report"), false, "SkipDirStatus", &m_options.m_bDmSkipDirStatus, page, this );
+   OptionCheckBox* pSkipDirStatus = new OptionCheckBox( i18n("Skip directory status report"), "SkipDirStatus", &m_options.m_bDmSkipDirStatus, page, this );
    gbox->addWidget( pSkipDirStatus, line, 0, 1, 2 );
    pSkipDirStatus->setToolTip(    i18n(
       "On: Do not show the Directory Comparison Status.\n"
@@ -1207,28 +1397,28 @@ void OptionDialog::setupDirectoryMergePage( void )
    QVBoxLayout* pBGLayout = new QVBoxLayout( pBG );
    pBGLayout->setMargin(spacingHint());
    
-   OptionRadioButton* pBinaryComparison = new OptionRadioButton( i18n("Binary comparison"), true, "BinaryComparison", &m_options.m_bDmBinaryComparison, pBG, this );
+   OptionRadioButton* pBinaryComparison = new OptionRadioButton( i18n("Binary comparison"), "BinaryComparison", &m_options.m_bDmBinaryComparison, pBG, this );
    pBinaryComparison->setToolTip( i18n("Binary comparison of each file. (Default)") );
    pBGLayout->addWidget( pBinaryComparison );
    
-   OptionRadioButton* pFullAnalysis = new OptionRadioButton( i18n("Full analysis"), false, "FullAnalysis", &m_options.m_bDmFullAnalysis, pBG, this );
+   OptionRadioButton* pFullAnalysis = new OptionRadioButton( i18n("Full analysis"), "FullAnalysis", &m_options.m_bDmFullAnalysis, pBG, this );
    pFullAnalysis->setToolTip( i18n("Do a full analysis and show statistics information in extra columns.\n"
                                       "(Slower than a binary comparison, much slower for binary files.)") );
    pBGLayout->addWidget( pFullAnalysis );
    
-   OptionRadioButton* pTrustDate = new OptionRadioButton( i18n("Trust the size and modification date (unsafe)"), false, "TrustDate", &m_options.m_bDmTrustDate, pBG, this );
+   OptionRadioButton* pTrustDate = new OptionRadioButton( i18n("Trust the size and modification date (unsafe)"), "TrustDate", &m_options.m_bDmTrustDate, pBG, this );
    pTrustDate->setToolTip( i18n("Assume that files are equal if the modification date and file length are equal.\n"
                                    "Files with equal contents but different modification dates will appear as different.\n"
                                      "Useful for big directories or slow networks.") );
    pBGLayout->addWidget( pTrustDate );
                                      
-   OptionRadioButton* pTrustDateFallbackToBinary = new OptionRadioButton( i18n("Trust the size and date, but use binary comparison if date does not match (unsafe)"), false, "TrustDateFallbackToBinary", &m_options.m_bDmTrustDateFallbackToBinary, pBG, this );
+   OptionRadioButton* pTrustDateFallbackToBinary = new OptionRadioButton( i18n("Trust the size and date, but use binary comparison if date does not match (unsafe)"), "TrustDateFallbackToBinary", &m_options.m_bDmTrustDateFallbackToBinary, pBG, this );
    pTrustDateFallbackToBinary->setToolTip( i18n("Assume that files are equal if the modification date and file length are equal.\n"
                                      "If the dates are not equal but the sizes are, use binary comparison.\n"
                                      "Useful for big directories or slow networks.") );
    pBGLayout->addWidget( pTrustDateFallbackToBinary );
 
-   OptionRadioButton* pTrustSize = new OptionRadioButton( i18n("Trust the size (unsafe)"), false, "TrustSize", &m_options.m_bDmTrustSize, pBG, this );
+   OptionRadioButton* pTrustSize = new OptionRadioButton( i18n("Trust the size (unsafe)"), "TrustSize", &m_options.m_bDmTrustSize, pBG, this );
    pTrustSize->setToolTip( i18n("Assume that files are equal if their file lengths are equal.\n"
                                    "Useful for big directories or slow networks when the date is modified during download.") );
    pBGLayout->addWidget( pTrustSize );
@@ -1237,7 +1427,7 @@ void OptionDialog::setupDirectoryMergePage( void )
    
 
    // Some two Dir-options: Affects only the default actions.
-   OptionCheckBox* pSyncMode = new OptionCheckBox( i18n("Synchronize directories"), false,"SyncMode", &m_options.m_bDmSyncMode, page, this );
+   OptionCheckBox* pSyncMode = new OptionCheckBox( i18n("Synchronize directories"), "SyncMode", &m_options.m_bDmSyncMode, page, this );
    gbox->addWidget( pSyncMode, line, 0, 1, 2 );
    pSyncMode->setToolTip( i18n(
                   "Offers to store files in both directories so that\n"
@@ -1246,7 +1436,7 @@ void OptionDialog::setupDirectoryMergePage( void )
    ++line;
 
    // Allow white-space only differences to be considered equal
-   OptionCheckBox* pWhiteSpaceDiffsEqual = new OptionCheckBox( i18n("White space differences considered equal"), true,"WhiteSpaceEqual", &m_options.m_bDmWhiteSpaceEqual, page, this );
+   OptionCheckBox* pWhiteSpaceDiffsEqual = new OptionCheckBox( i18n("White space differences considered equal"), "WhiteSpaceEqual", &m_options.m_bDmWhiteSpaceEqual, page, this );
    gbox->addWidget( pWhiteSpaceDiffsEqual, line, 0, 1, 2 );
    pWhiteSpaceDiffsEqual->setToolTip( i18n(
                   "If files differ only by white space consider them equal.\n"
@@ -1255,7 +1445,7 @@ void OptionDialog::setupDirectoryMergePage( void )
    pWhiteSpaceDiffsEqual->setEnabled(false);
    ++line;
 
-   OptionCheckBox* pCopyNewer = new OptionCheckBox( i18n("Copy newer instead of merging (unsafe)"), false, "CopyNewer", &m_options.m_bDmCopyNewer, page, this );
+   OptionCheckBox* pCopyNewer = new OptionCheckBox( i18n("Copy newer instead of merging (unsafe)"), "CopyNewer", &m_options.m_bDmCopyNewer, page, this );
    gbox->addWidget( pCopyNewer, line, 0, 1, 2 );
    pCopyNewer->setToolTip( i18n(
                   "Don't look inside, just take the newer file.\n"
@@ -1263,7 +1453,7 @@ void OptionDialog::setupDirectoryMergePage( void )
                   "Only effective when comparing two directories."  ) );
    ++line;
 
-   OptionCheckBox* pCreateBakFiles = new OptionCheckBox( i18n("Backup files (.orig)"), true, "CreateBakFiles", &m_options.m_bDmCreateBakFiles, page, this );
+   OptionCheckBox* pCreateBakFiles = new OptionCheckBox( i18n("Backup files (.orig)"), "CreateBakFiles", &m_options.m_bDmCreateBakFiles, page, this );
    gbox->addWidget( pCreateBakFiles, line, 0, 1, 2 );
    pCreateBakFiles->setToolTip( i18n(
                  "If a file would be saved over an old file, then the old file\n"
@@ -1291,53 +1481,8 @@ static void insertCodecs(OptionComboBox* p)
 }
 */
 
-// UTF8-Codec that saves a BOM
-// UTF8-Codec that saves a BOM
-class Utf8BOMCodec : public QTextCodec
-{
-   QTextCodec* m_pUtf8Codec;
-   class PublicTextCodec : public QTextCodec
-   {
-   public:
-      QString publicConvertToUnicode ( const char * p, int len, ConverterState* pState ) const
-      {
-         return convertToUnicode( p, len, pState );
-      }
-      QByteArray publicConvertFromUnicode ( const QChar * input, int number, ConverterState * pState ) const
-      {
-         return convertFromUnicode( input, number, pState );
-      }
-   };
-public:
-   Utf8BOMCodec()
-   {
-      m_pUtf8Codec = QTextCodec::codecForName("UTF-8");
-   }
-   QByteArray name () const { return "UTF-8-BOM"; }
-   int mibEnum () const { return 2123; }
-   QByteArray convertFromUnicode ( const QChar * input, int number, ConverterState * pState ) const
-   {
-      QByteArray r;
-      if ( pState && pState->state_data[2]==0)  // state_data[2] not used by QUtf8::convertFromUnicode (see qutfcodec.cpp)
-      {
-        r += "\xEF\xBB\xBF";
-        pState->state_data[2]=1;
-        pState->flags |= QTextCodec::IgnoreHeader;
-      }
-
-      r += ((PublicTextCodec*)m_pUtf8Codec)->publicConvertFromUnicode( input, number, pState );
-      return r;
-   }
-   QString convertToUnicode ( const char * p, int len, ConverterState* pState ) const
-   {
-      return ((PublicTextCodec*)m_pUtf8Codec)->publicConvertToUnicode( p, len, pState );
-   }
-};
-
 void OptionDialog::setupRegionalPage( void )
 {
-   new Utf8BOMCodec();
-
    QFrame* page = new QFrame();
    KPageWidgetItem* pageItem = new KPageWidgetItem( page, i18n("Regional Settings") );
    pageItem->setHeader( i18n("Regional Settings") );
@@ -1445,7 +1590,7 @@ static const char* countryMap[]={
 
    label = new QLabel( i18n("Language (restart required)"), page );
    gbox->addWidget( label, line, 0 );
-   OptionComboBox* pLanguage = new OptionComboBox( 0, "Language", &m_options.m_language, page, this );
+   OptionComboBox* pLanguage = new OptionComboBox( "Language", &m_options.m_language, page, this );
    gbox->addWidget( pLanguage, line, 1 );
    pLanguage->addItem( "Auto" );  // Must not translate, won't work otherwise!
    pLanguage->addItem( "en_orig" );
@@ -1504,7 +1649,7 @@ static const char* countryMap[]={
 */      
 #endif
 
-   m_pSameEncoding = new OptionCheckBox( i18n("Use the same encoding for everything:"), true, "SameEncoding", &m_options.m_bSameEncoding, page, this );
+   m_pSameEncoding = new OptionCheckBox( i18n("Use the same encoding for everything:"), "SameEncoding", &m_options.m_bSameEncoding, page, this );
    gbox->addWidget( m_pSameEncoding, line, 0, 1, 2 );
    m_pSameEncoding->setToolTip( i18n(
                   "Enable this allows to change all encodings by changing the first only.\n"
@@ -1526,7 +1671,7 @@ static const char* countryMap[]={
       "If the file is not Unicode then the selected encoding will be used as fallback.\n"
       "(Unicode detection depends on the first bytes of a file.)"
       );
-   m_pAutoDetectUnicodeA = new OptionCheckBox( i18n("Auto Detect Unicode"), true, "AutoDetectUnicodeA", &m_options.m_bAutoDetectUnicodeA, page, this );
+   m_pAutoDetectUnicodeA = new OptionCheckBox( i18n("Auto Detect Unicode"), "AutoDetectUnicodeA", &m_options.m_bAutoDetectUnicodeA, page, this );
    gbox->addWidget( m_pAutoDetectUnicodeA, line, 2 );
    m_pAutoDetectUnicodeA->setToolTip( autoDetectToolTip );
    ++line;
@@ -1535,7 +1680,7 @@ static const char* countryMap[]={
    gbox->addWidget( label, line, 0 );
    m_pEncodingBComboBox = new OptionEncodingComboBox( "EncodingForB", &m_options.m_pEncodingB, page, this );
    gbox->addWidget( m_pEncodingBComboBox, line, 1 );
-   m_pAutoDetectUnicodeB = new OptionCheckBox( i18n("Auto Detect Unicode"), true, "AutoDetectUnicodeB", &m_options.m_bAutoDetectUnicodeB, page, this );
+   m_pAutoDetectUnicodeB = new OptionCheckBox( i18n("Auto Detect Unicode"), "AutoDetectUnicodeB", &m_options.m_bAutoDetectUnicodeB, page, this );
    gbox->addWidget( m_pAutoDetectUnicodeB, line, 2 );
    m_pAutoDetectUnicodeB->setToolTip( autoDetectToolTip );
    ++line;
@@ -1544,7 +1689,7 @@ static const char* countryMap[]={
    gbox->addWidget( label, line, 0 );
    m_pEncodingCComboBox = new OptionEncodingComboBox( "EncodingForC", &m_options.m_pEncodingC, page, this );
    gbox->addWidget( m_pEncodingCComboBox, line, 1 );
-   m_pAutoDetectUnicodeC = new OptionCheckBox( i18n("Auto Detect Unicode"), true, "AutoDetectUnicodeC", &m_options.m_bAutoDetectUnicodeC, page, this );
+   m_pAutoDetectUnicodeC = new OptionCheckBox( i18n("Auto Detect Unicode"), "AutoDetectUnicodeC", &m_options.m_bAutoDetectUnicodeC, page, this );
    gbox->addWidget( m_pAutoDetectUnicodeC, line, 2 );
    m_pAutoDetectUnicodeC->setToolTip( autoDetectToolTip );
    ++line;
@@ -1553,7 +1698,7 @@ static const char* countryMap[]={
    gbox->addWidget( label, line, 0 );
    m_pEncodingOutComboBox = new OptionEncodingComboBox( "EncodingForOutput", &m_options.m_pEncodingOut, page, this );
    gbox->addWidget( m_pEncodingOutComboBox, line, 1 );
-   m_pAutoSelectOutEncoding = new OptionCheckBox( i18n("Auto Select"), true, "AutoSelectOutEncoding", &m_options.m_bAutoSelectOutEncoding, page, this );
+   m_pAutoSelectOutEncoding = new OptionCheckBox( i18n("Auto Select"), "AutoSelectOutEncoding", &m_options.m_bAutoSelectOutEncoding, page, this );
    gbox->addWidget( m_pAutoSelectOutEncoding, line, 2 );
    m_pAutoSelectOutEncoding->setToolTip( i18n(
       "If enabled then the encoding from the input files is used.\n"
@@ -1571,7 +1716,7 @@ static const char* countryMap[]={
    connect(m_pAutoDetectUnicodeA, SIGNAL(toggled(bool)), this, SLOT(slotEncodingChanged()));
    connect(m_pAutoSelectOutEncoding, SIGNAL(toggled(bool)), this, SLOT(slotEncodingChanged()));
 
-   OptionCheckBox* pRightToLeftLanguage = new OptionCheckBox( i18n("Right To Left Language"), false, "RightToLeftLanguage", &m_options.m_bRightToLeftLanguage, page, this );
+   OptionCheckBox* pRightToLeftLanguage = new OptionCheckBox( i18n("Right To Left Language"), "RightToLeftLanguage", &m_options.m_bRightToLeftLanguage, page, this );
    gbox->addWidget( pRightToLeftLanguage, line, 0, 1, 2 );
    pRightToLeftLanguage->setToolTip( i18n(
                  "Some languages are read from right to left.\n"
@@ -1606,7 +1751,7 @@ void OptionDialog::setupIntegrationPage( void )
    QLabel* label;
    label = new QLabel( i18n("Command line options to ignore:"), page );
    gbox->addWidget( label, line, 0 );
-   OptionLineEdit* pIgnorableCmdLineOptions = new OptionLineEdit( "-u;-query;-html;-abort", "IgnorableCmdLineOptions", &m_options.m_ignorableCmdLineOptions, page, this );
+   OptionLineEdit* pIgnorableCmdLineOptions = new OptionLineEdit( "IgnorableCmdLineOptions", &m_options.m_ignorableCmdLineOptions, page, this );
    gbox->addWidget( pIgnorableCmdLineOptions, line, 1, 1, 2 );
    label->setToolTip( i18n(
       "List of command line options that should be ignored when KDiff3 is used by other tools.\n"
@@ -1616,7 +1761,7 @@ void OptionDialog::setupIntegrationPage( void )
    ++line;
 
 
-   OptionCheckBox* pEscapeKeyQuits = new OptionCheckBox( i18n("Quit also via Escape key"), false, "EscapeKeyQuits", &m_options.m_bEscapeKeyQuits, page, this );
+   OptionCheckBox* pEscapeKeyQuits = new OptionCheckBox( i18n("Quit also via Escape key"), "EscapeKeyQuits", &m_options.m_bEscapeKeyQuits, page, this );
    gbox->addWidget( pEscapeKeyQuits, line, 0, 1, 2 );
    pEscapeKeyQuits->setToolTip( i18n(
                   "Fast method to exit.\n"
@@ -1718,8 +1863,8 @@ void OptionDialog::slotOk( void )
 /** Copy the values from the widgets to the public variables.*/
 void OptionDialog::slotApply( void )
 {
-   std::list<OptionItem*>::iterator i;
-   for(i=m_optionItemList.begin(); i!=m_optionItemList.end(); ++i)
+   std::list<OptionWidget*>::iterator i;
+   for(i=m_optionWidgetList.begin(); i!=m_optionWidgetList.end(); ++i)
    {
       (*i)->apply();
    }
@@ -1748,8 +1893,8 @@ void OptionDialog::slotDefault()
 
 void OptionDialog::resetToDefaults()
 {
-   std::list<OptionItem*>::iterator i;
-   for(i=m_optionItemList.begin(); i!=m_optionItemList.end(); ++i)
+   std::list<OptionWidget*>::iterator i;
+   for(i=m_optionWidgetList.begin(); i!=m_optionWidgetList.end(); ++i)
    {
       (*i)->setToDefault();
    }
@@ -1760,8 +1905,11 @@ void OptionDialog::resetToDefaults()
 /** Initialise the widgets using the values in the public varibles. */
 void OptionDialog::setState()
 {
-   std::list<OptionItem*>::iterator i;
-   for(i=m_optionItemList.begin(); i!=m_optionItemList.end(); ++i)
+   if ( !m_bPagesCreated )
+      createPages();
+
+   std::list<OptionWidget*>::iterator i;
+   for(i=m_optionWidgetList.begin(); i!=m_optionWidgetList.end(); ++i)
    {
       (*i)->setToCurrent();
    }
@@ -1826,7 +1974,8 @@ void OptionDialog::readOptions( KSharedConfigPtr config )
       (*i)->read(&cvm);
    }
 
-   setState();
+   if ( m_bPagesCreated )
+      setState();
 }
 
 QString OptionDialog::parseOptions( const QStringList& optionList )
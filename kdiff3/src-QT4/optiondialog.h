@@ -30,6 +30,7 @@
 #include "options.h"
 
 class OptionItem;
+class OptionWidget;
 class OptionCheckBox;
 class OptionEncodingComboBox;
 class OptionLineEdit;
@@ -52,9 +53,11 @@ public:
     void saveOptions(KSharedConfigPtr config);
     void readOptions(KSharedConfigPtr config);
 
-    void setState(); // Must be called before calling exec();
+    void setState(); // Must be called before calling exec(); Creates the pages if necessary.
 
     void addOptionItem(OptionItem*);
+    void addOptionWidget(OptionWidget*);
+    OptionItem* findOptionItem( const QString& saveName );
     KKeyDialog* m_pKeyDialog;
 protected slots:
     virtual void slotDefault( void );
@@ -71,6 +74,9 @@ private:
     void resetToDefaults();
 
     std::list<OptionItem*> m_optionItemList;
+    std::list<OptionWidget*> m_optionWidgetList;
+    bool m_bShowDirMergeSettings;
+    bool m_bPagesCreated;
 
     OptionCheckBox* m_pSameEncoding;
     OptionEncodingComboBox* m_pEncodingAComboBox;
@@ -90,6 +96,8 @@ private:
     OptionLineEdit* m_pHistorySortKeyOrderLineEdit;
 
 private:
+    void setupOptions();
+    void createPages();
     void setupFontPage();
     void setupColorPage();
     void setupEditPage();
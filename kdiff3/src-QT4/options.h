@@ -34,6 +34,14 @@ enum e_LineEndStyle
    eLineEndStyleConflict   // User must resolve manually
 };
 
+enum e_CommentStyle
+{
+   eCommentStyleC=0,       // C/C++, Java, ...: // and /* */
+   eCommentStyleHash,      // Shell, Python, Perl, ...: #
+   eCommentStyleSql,       // SQL: -- and /* */
+   eCommentStyleXml        // XML, HTML: <!-- -->
+};
+
 class Options
 {
 public:
@@ -96,6 +104,8 @@ public:
     bool m_bIgnoreCase;
     bool m_bIgnoreNumbers;
     bool m_bIgnoreComments;
+    int  m_commentStyle;
+    QString m_ignoreRegExp;
     QString m_PreProcessorCmd;
     QString m_LineMatchingPreProcessorCmd;
     bool m_bRunRegExpAutoMergeOnMergeStart;
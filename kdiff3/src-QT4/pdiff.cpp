@@ -37,6 +37,8 @@
 #include <QDropEvent>
 #include <QUrl>
 #include <QProcess>
+#include <QTextEdit>
+#include <QPushButton>
 
 #include <klocale.h>
 #include <kmessagebox.h>
@@ -50,6 +52,7 @@
 #include "optiondialog.h"
 #include "fileaccess.h"
 #include "progress.h"
+#include "binarydiff.h"
 #ifdef _WIN32
 #include <windows.h>
 #else
@@ -107,8 +110,14 @@ static void debugLineCheck( Diff3LineList& d3ll, int size, int idx )
 
 void KDiff3App::init( bool bAuto, TotalDiffStatus* pTotalDiffStatus, bool bLoadFiles, bool bUseCurrentEncoding)
 {
+   StageTrace trace("init");
    ProgressProxy pp;
 
+   // Line numbers of the matches are no longer valid.
+   m_findHits.clear();
+   m_findHitIdx = -1;
+   m_bFindHitsValid = false;
+
    // When doing a full analysis in the directory-comparison, then the statistics-results
    // will be stored in the given TotalDiffStatus. Otherwise it will be 0.
    bool bGUI = pTotalDiffStatus == 0;
@@ -213,6 +222,8 @@ void KDiff3App::init( bool bAuto, TotalDiffStatus* pTotalDiffStatus, bool bLoadF
       calcDiff3LineListUsingAB( &m_diffList12, m_diff3LineList );
       pTotalDiffStatus->bTextAEqB = fineDiff( m_diff3LineList, 1, m_sd1.getLineDataForDisplay(), m_sd2.getLineDataForDisplay() );
       if ( m_sd1.getSizeBytes()==0 ) pTotalDiffStatus->bTextAEqB=false;
+      // Binary data is not split into lines (see FileData::preprocess()), so only bytes count.
+      if ( !m_sd1.isText() || !m_sd2.isText() ) pTotalDiffStatus->bTextAEqB = pTotalDiffStatus->bBinaryAEqB;
 
       pp.step();
    }
@@ -248,13 +259,13 @@ void KDiff3App::init( bool bAuto, TotalDiffStatus* pTotalDiffStatus, bool bLoadF
       calcDiff3LineListUsingAB( &m_diffList12, m_diff3LineList );
       calcDiff3LineListUsingAC( &m_diffList13, m_diff3LineList );
       correctManualDiffAlignment( m_diff3LineList, &m_manualDiffHelpList );
-      calcDiff3LineListTrim( m_diff3LineList, m_sd1.getLineDataForDiff(), m_sd2.getLineDataForDiff(), m_sd3.getLineDataForDiff(), &m_manualDiffHelpList );
+      calcDiff3LineListTrim( m_diff3LineList, m_sd1.getLineDataForDiff(), m_sd2.getLineDataForDiff(), m_sd3.getLineDataForDiff(), &m_manualDiffHelpList, m_pOptions );
 
       if ( m_pOptions->m_bDiff3AlignBC )
       {
          calcDiff3LineListUsingBC( &m_diffList23, m_diff3LineList );
          correctManualDiffAlignment( m_diff3LineList, &m_manualDiffHelpList );
-         calcDiff3LineListTrim( m_diff3LineList, m_sd1.getLineDataForDiff(), m_sd2.getLineDataForDiff(), m_sd3.getLineDataForDiff(), &m_manualDiffHelpList );
+         calcDiff3LineListTrim( m_diff3LineList, m_sd1.getLineDataForDiff(), m_sd2.getLineDataForDiff(), m_sd3.getLineDataForDiff(), &m_manualDiffHelpList, m_pOptions );
       }
       debugLineCheck( m_diff3LineList, m_sd1.getSizeLines(), 1 );
       debugLineCheck( m_diff3LineList, m_sd2.getSizeLines(), 2 );
@@ -271,6 +282,9 @@ void KDiff3App::init( bool bAuto, TotalDiffStatus* pTotalDiffStatus, bool bLoadF
       pp.step();
       if ( m_sd1.getSizeBytes()==0 ) { pTotalDiffStatus->bTextAEqB=false;  pTotalDiffStatus->bTextAEqC=false; }
       if ( m_sd2.getSizeBytes()==0 ) { pTotalDiffStatus->bTextAEqB=false;  pTotalDiffStatus->bTextBEqC=false; }
+      if ( !m_sd1.isText() || !m_sd2.isText() ) pTotalDiffStatus->bTextAEqB = pTotalDiffStatus->bBinaryAEqB;
+      if ( !m_sd1.isText() || !m_sd3.isText() ) pTotalDiffStatus->bTextAEqC = pTotalDiffStatus->bBinaryAEqC;
+      if ( !m_sd2.isText() || !m_sd3.isText() ) pTotalDiffStatus->bTextBEqC = pTotalDiffStatus->bBinaryBEqC;
    }
    m_diffBufferInfo.init( &m_diff3LineList, &m_diff3LineVector,
       m_sd1.getLineDataForDiff(), m_sd1.getSizeLines(),
@@ -278,6 +292,7 @@ void KDiff3App::init( bool bAuto, TotalDiffStatus* pTotalDiffStatus, bool bLoadF
       m_sd3.getLineDataForDiff(), m_sd3.getSizeLines() );
    calcWhiteDiff3Lines( m_diff3LineList, m_sd1.getLineDataForDiff(), m_sd2.getLineDataForDiff(), m_sd3.getLineDataForDiff() );
    calcDiff3LineVector( m_diff3LineList, m_diff3LineVector );
+   calcMergeDetails( m_diff3LineList, m_sd3.isEmpty() );
 
    // Calc needed lines for display
    m_neededLines = m_diff3LineList.size();
@@ -335,6 +350,7 @@ void KDiff3App::init( bool bAuto, TotalDiffStatus* pTotalDiffStatus, bool bLoadF
       m_sd2.getLineDataForDisplay(), m_sd2.getSizeLines(),
       m_bTripleDiff ? m_sd3.getLineDataForDisplay() : 0, m_sd3.getSizeLines(),
       &m_diff3LineList,
+      &m_diffBufferInfo,
       pTotalDiffStatus      
       );
    m_pMergeResultWindowTitle->setFileName( m_outputFilename.isEmpty() ? QString("unnamed.txt") : m_outputFilename );
@@ -417,7 +433,9 @@ void KDiff3App::init( bool bAuto, TotalDiffStatus* pTotalDiffStatus, bool bLoadF
 
    if ( bLoadFiles )
    {
-      if ( bVisibleMergeResultWindow && !bAuto )
+      bool bBinaryInput = isBinaryInput();
+      // For binary input the merge result is meaningless, show the binary summary instead.
+      if ( bVisibleMergeResultWindow && !bAuto && !bBinaryInput )
          m_pMergeResultWindow->showNrOfConflicts();
       else if ( !bAuto && 
          // Avoid showing this message during startup without parameters.
@@ -426,7 +444,20 @@ void KDiff3App::init( bool bAuto, TotalDiffStatus* pTotalDiffStatus, bool bLoadF
          )
       {
          QString totalInfo;
-         if ( pTotalDiffStatus->bBinaryAEqB && pTotalDiffStatus->bBinaryAEqC )
+         if ( bBinaryInput && !(pTotalDiffStatus->bBinaryAEqB && pTotalDiffStatus->bBinaryAEqC) )
+         {
+            BinaryDiffList binaryDiffList;
+            calcBinaryDiff( m_sd1.getBuf(), m_sd1.getSizeBytes(), m_sd2.getBuf(), m_sd2.getSizeBytes(), binaryDiffList );
+            totalInfo += getBinaryDiffSummary( binaryDiffList, QString("A"), QString("B") );
+            if ( !m_sd3.isEmpty() )
+            {
+               calcBinaryDiff( m_sd1.getBuf(), m_sd1.getSizeBytes(), m_sd3.getBuf(), m_sd3.getSizeBytes(), binaryDiffList );
+               totalInfo += getBinaryDiffSummary( binaryDiffList, QString("A"), QString("C") );
+               calcBinaryDiff( m_sd2.getBuf(), m_sd2.getSizeBytes(), m_sd3.getBuf(), m_sd3.getSizeBytes(), binaryDiffList );
+               totalInfo += getBinaryDiffSummary( binaryDiffList, QString("B"), QString("C") );
+            }
+         }
+         else if ( pTotalDiffStatus->bBinaryAEqB && pTotalDiffStatus->bBinaryAEqC )
             totalInfo += i18n("All input files are binary equal.");
          else  if ( pTotalDiffStatus->bTextAEqB && pTotalDiffStatus->bTextAEqC )
             totalInfo += i18n("All input files contain the same text, but are not binary equal.");
@@ -443,12 +474,12 @@ void KDiff3App::init( bool bAuto, TotalDiffStatus* pTotalDiffStatus, bool bLoadF
             KMessageBox::information( this, totalInfo );
       }
 
-      if ( bVisibleMergeResultWindow && (!m_sd1.isText() || !m_sd2.isText() || !m_sd3.isText()) )
+      if ( bVisibleMergeResultWindow && bBinaryInput )
       {
          KMessageBox::information( this, i18n(
             "Some inputfiles don't seem to be pure textfiles.\n"
-            "Note that the KDiff3-merge was not meant for binary data.\n"
-            "Continue at your own risk.") );
+            "Binary data is not compared line by line and is not part of the merge result.\n"
+            "Saving the merge result is disabled.") );
       }
       if ( m_sd1.isIncompleteConversion() || m_sd2.isIncompleteConversion() || m_sd3.isIncompleteConversion() )
       {
@@ -484,6 +515,11 @@ void KDiff3App::init( bool bAuto, TotalDiffStatus* pTotalDiffStatus, bool bLoadF
 }
 
 
+bool KDiff3App::isBinaryInput()
+{
+   return !m_sd1.isText() || !m_sd2.isText() || !m_sd3.isText();
+}
+
 void KDiff3App::setHScrollBarRange()
 {
    int w1 = m_pDiffTextWindow1!=0 && m_pDiffTextWindow1->isVisible() ? m_pDiffTextWindow1->getMaxTextWidth() : 0;
@@ -1178,6 +1214,18 @@ void KDiff3App::slotFileNameChanged(const QString& fileName, int winIdx)
 }
 
 
+void KDiff3App::slotEditUndo()
+{
+   if ( m_pMergeResultWindow!=0 )
+      m_pMergeResultWindow->slotUndo();
+}
+
+void KDiff3App::slotEditRedo()
+{
+   if ( m_pMergeResultWindow!=0 )
+      m_pMergeResultWindow->slotRedo();
+}
+
 void KDiff3App::slotEditCut()
 {
    slotStatusMsg(i18n("Cutting selection..."));
@@ -1425,6 +1473,43 @@ void KDiff3App::slotJoinDiffs()
    }
 }
 
+void KDiff3App::reportMemory( MemoryReport& report )
+{
+   m_sd1.reportMemory( report, "A" );
+   m_sd2.reportMemory( report, "B" );
+   m_sd3.reportMemory( report, "C" );
+   report.add( "DiffList AB", getDiffListMemory( m_diffList12 ) );
+   report.add( "DiffList BC", getDiffListMemory( m_diffList23 ) );
+   report.add( "DiffList AC", getDiffListMemory( m_diffList13 ) );
+   m_diff3LineList.reportMemory( report, "Diff3LineList" );
+   m_diff3LineVector.reportMemory( report, "Diff3LineVector" );
+   if ( m_pDiffTextWindow1 ) m_pDiffTextWindow1->reportMemory( report, "A" );
+   if ( m_pDiffTextWindow2 ) m_pDiffTextWindow2->reportMemory( report, "B" );
+   if ( m_pDiffTextWindow3 ) m_pDiffTextWindow3->reportMemory( report, "C" );
+   if ( m_pMergeResultWindow ) m_pMergeResultWindow->reportMemory( report );
+}
+
+void KDiff3App::slotShowMemoryReport()
+{
+   MemoryReport report;
+   reportMemory( report );
+
+   QDialog dialog( this );
+   dialog.setWindowTitle( i18n("Memory Usage") );
+   QVBoxLayout* pLayout = new QVBoxLayout( &dialog );
+   QTextEdit* pTextEdit = new QTextEdit( &dialog );
+   pTextEdit->setReadOnly( true );
+   pTextEdit->setLineWrapMode( QTextEdit::NoWrap );
+   pTextEdit->setFont( m_pOptions->m_font ); // Fixed width for the columns
+   pTextEdit->setPlainText( report.getAsString() );
+   pLayout->addWidget( pTextEdit );
+   QPushButton* pClose = new QPushButton( i18n("Close"), &dialog );
+   connect( pClose, SIGNAL(clicked()), &dialog, SLOT(accept()) );
+   pLayout->addWidget( pClose );
+   dialog.resize( 500, 400 );
+   dialog.exec();
+}
+
 void KDiff3App::slotConfigure()
 {
    m_pOptionDialog->setState();
@@ -1568,6 +1653,7 @@ void KDiff3App::slotRecalcWordWrap()
 
 bool KDiff3App::recalcWordWrap(int nofVisibleColumns) // nofVisibleColumns is >=0 only for printing, otherwise the really visible width is used
 {
+   StageTrace trace("recalcWordWrap");
    bool bPrinting = nofVisibleColumns>=0;
    int firstD3LIdx = 0;
    if( m_pDiffTextWindow1 ) 
@@ -1916,10 +2002,6 @@ void KDiff3App::slotShowWindowCToggled()
 
 void KDiff3App::slotEditFind()
 {
-   m_pFindDialog->currentLine = 0;
-   m_pFindDialog->currentPos = 0;
-   m_pFindDialog->currentWindow = 1;
-
    // Use currently selected text:
    QString s;
    if (               m_pDiffTextWindow1!=0 )   s = m_pDiffTextWindow1->getSelection();
@@ -1933,10 +2015,81 @@ void KDiff3App::slotEditFind()
    
    if ( QDialog::Accepted == m_pFindDialog->exec() )
    {
+      // New search: start from the beginning.
+      m_bFindHitsValid = false;
+      m_findHits.clear();
+      m_findHitIdx = -1;
       slotEditFindNext();
    }
 }
 
+// Searches all selected windows at once and keeps the sorted list of matches, so that
+// find next/previous only step through the list. The list is rebuilt after the
+// output was edited, keeping the position relative to the last shown match.
+bool KDiff3App::updateFindHits( bool bDirDown )
+{
+   bool bSearchOutput = m_pFindDialog->m_pSearchInOutput->isChecked() && m_pMergeResultWindow!=0 && m_pMergeResultWindow->isVisible();
+   if ( m_bFindHitsValid && !( bSearchOutput && m_pMergeResultWindow->getContentGeneration()!=m_findOutputGeneration ) )
+      return true;
+
+   FindPattern pattern( m_pFindDialog->m_pSearchString->text(),
+      m_pFindDialog->m_pCaseSensitive->isChecked(), m_pFindDialog->m_pRegExp->isChecked() );
+   if ( !pattern.isValid() )
+   {
+      KMessageBox::error( this, i18n("Invalid regular expression:\n%1", pattern.getErrorText()), i18n("Find") );
+      return false;
+   }
+
+   bool bHadHit = m_findHitIdx>=0 && m_findHitIdx<(int)m_findHits.size();
+   FindHit lastHit;
+   if ( bHadHit )
+      lastHit = m_findHits[m_findHitIdx];
+
+   m_findHits.clear();
+   if ( m_pFindDialog->m_pSearchInA->isChecked() && m_pDiffTextWindow1!=0 )
+      m_pDiffTextWindow1->findAll( pattern, m_findHits );
+   if ( m_pFindDialog->m_pSearchInB->isChecked() && m_pDiffTextWindow2!=0 )
+      m_pDiffTextWindow2->findAll( pattern, m_findHits );
+   if ( m_pFindDialog->m_pSearchInC->isChecked() && m_pDiffTextWindow3!=0 )
+      m_pDiffTextWindow3->findAll( pattern, m_findHits );
+   if ( bSearchOutput )
+   {
+      m_pMergeResultWindow->findAll( pattern, m_findHits );
+      m_findOutputGeneration = m_pMergeResultWindow->getContentGeneration();
+   }
+   m_bFindHitsValid = true;
+
+   // The windows are searched in order, so the list is already sorted.
+   m_findHitIdx = -1;
+   if ( bHadHit )
+   {
+      // Leave the index so that the next step in search direction continues after lastHit.
+      if ( bDirDown )
+         m_findHitIdx = int( std::upper_bound( m_findHits.begin(), m_findHits.end(), lastHit ) - m_findHits.begin() ) - 1;
+      else
+         m_findHitIdx = int( std::lower_bound( m_findHits.begin(), m_findHits.end(), lastHit ) - m_findHits.begin() );
+   }
+   return true;
+}
+
+void KDiff3App::showFindHit( const FindHit& hit )
+{
+   if ( hit.window==4 )
+   {
+      m_pMergeResultWindow->setSelection( hit.line, hit.pos, hit.line, hit.pos+hit.length );
+      m_pMergeVScrollBar->setValue( hit.line - m_pMergeVScrollBar->pageStep()/2 );
+      m_pHScrollBar->setValue( max2( 0, hit.pos+hit.length-m_pHScrollBar->pageStep()) );
+      return;
+   }
+
+   DiffTextWindow* pDTW = hit.window==1 ? m_pDiffTextWindow1 : hit.window==2 ? m_pDiffTextWindow2 : m_pDiffTextWindow3;
+   int l=0;
+   int p=0;
+   pDTW->setSelection( hit.line, hit.pos, hit.line, hit.pos+hit.length, l, p );
+   m_pDiffVScrollBar->setValue( l-m_pDiffVScrollBar->pageStep()/2 );
+   m_pHScrollBar->setValue( max2( 0, p+hit.length-m_pHScrollBar->pageStep()) );
+}
+
 void KDiff3App::slotEditFindNext()
 {
    QString s = m_pFindDialog->m_pSearchString->text();
@@ -1946,91 +2099,41 @@ void KDiff3App::slotEditFindNext()
       return;
    }
 
-   bool bDirDown = true;
-   bool bCaseSensitive = m_pFindDialog->m_pCaseSensitive->isChecked();
+   if ( !updateFindHits( true ) )
+      return;
 
-   int d3vLine = m_pFindDialog->currentLine;
-   int posInLine = m_pFindDialog->currentPos;
-   int l=0;
-   int p=0;
-   if ( m_pFindDialog->currentWindow == 1 )
+   ++m_findHitIdx;
+   if ( m_findHitIdx >= (int)m_findHits.size() )
    {
-      if ( m_pFindDialog->m_pSearchInA->isChecked() && m_pDiffTextWindow1!=0  &&
-           m_pDiffTextWindow1->findString( s, d3vLine, posInLine, bDirDown, bCaseSensitive ) )
-      {
-         m_pDiffTextWindow1->setSelection( d3vLine, posInLine, d3vLine, posInLine+s.length(), l, p );
-         m_pDiffVScrollBar->setValue(l-m_pDiffVScrollBar->pageStep()/2);
-         m_pHScrollBar->setValue( max2( 0, p+(int)s.length()-m_pHScrollBar->pageStep()) );
-         m_pFindDialog->currentLine = d3vLine;
-         m_pFindDialog->currentPos = posInLine + 1;
-         return;
-      }
-      m_pFindDialog->currentWindow = 2;
-      m_pFindDialog->currentLine = 0;
-      m_pFindDialog->currentPos = 0;
+      KMessageBox::information(this,i18n("Search complete."),i18n("Search Complete"));
+      m_findHitIdx = -1;
+      return;
    }
+   showFindHit( m_findHits[m_findHitIdx] );
+}
 
-   d3vLine = m_pFindDialog->currentLine;
-   posInLine = m_pFindDialog->currentPos;
-   if ( m_pFindDialog->currentWindow == 2 )
+void KDiff3App::slotEditFindPrev()
+{
+   QString s = m_pFindDialog->m_pSearchString->text();
+   if ( s.isEmpty() )
    {
-      if ( m_pFindDialog->m_pSearchInB->isChecked() && m_pDiffTextWindow2!=0 &&
-           m_pDiffTextWindow2->findString( s, d3vLine, posInLine, bDirDown, bCaseSensitive ) )
-      {
-         m_pDiffTextWindow2->setSelection( d3vLine, posInLine, d3vLine, posInLine+s.length(),l,p );
-         m_pDiffVScrollBar->setValue(l-m_pDiffVScrollBar->pageStep()/2);
-         m_pHScrollBar->setValue( max2( 0, p+(int)s.length()-m_pHScrollBar->pageStep()) );
-         m_pFindDialog->currentLine = d3vLine;
-         m_pFindDialog->currentPos = posInLine + 1;
-         return;
-      }
-      m_pFindDialog->currentWindow = 3;
-      m_pFindDialog->currentLine = 0;
-      m_pFindDialog->currentPos = 0;
+      slotEditFind();
+      return;
    }
 
-   d3vLine = m_pFindDialog->currentLine;
-   posInLine = m_pFindDialog->currentPos;
-   if ( m_pFindDialog->currentWindow == 3 )
-   {
-      if ( m_pFindDialog->m_pSearchInC->isChecked() && m_pDiffTextWindow3!=0 &&
-           m_pDiffTextWindow3->findString( s, d3vLine, posInLine, bDirDown, bCaseSensitive ) )
-      {
-         m_pDiffTextWindow3->setSelection( d3vLine, posInLine, d3vLine, posInLine+s.length(),l,p );
-         m_pDiffVScrollBar->setValue(l-m_pDiffVScrollBar->pageStep()/2);
-         m_pHScrollBar->setValue( max2( 0, p+(int)s.length()-m_pHScrollBar->pageStep()) );
-         m_pFindDialog->currentLine = d3vLine;
-         m_pFindDialog->currentPos = posInLine + 1;
-         return;
-      }
-      m_pFindDialog->currentWindow = 4;
-      m_pFindDialog->currentLine = 0;
-      m_pFindDialog->currentPos = 0;
-   }  
+   if ( !updateFindHits( false ) )
+      return;
 
-   d3vLine = m_pFindDialog->currentLine;
-   posInLine = m_pFindDialog->currentPos;
-   if ( m_pFindDialog->currentWindow == 4 )
+   if ( m_findHitIdx < 0 )
+      m_findHitIdx = m_findHits.size();
+   --m_findHitIdx;
+   if ( m_findHitIdx < 0 )
    {
-      if ( m_pFindDialog->m_pSearchInOutput->isChecked() && m_pMergeResultWindow!=0 && m_pMergeResultWindow->isVisible() &&
-           m_pMergeResultWindow->findString( s, d3vLine, posInLine, bDirDown, bCaseSensitive ) )
-      {
-         m_pMergeResultWindow->setSelection( d3vLine, posInLine, d3vLine, posInLine+s.length() );
-         m_pMergeVScrollBar->setValue(d3vLine - m_pMergeVScrollBar->pageStep()/2);
-         m_pHScrollBar->setValue( max2( 0, posInLine+(int)s.length()-m_pHScrollBar->pageStep()) );
-         m_pFindDialog->currentLine = d3vLine;
-         m_pFindDialog->currentPos = posInLine + 1;
-         return;
-      }
-      m_pFindDialog->currentWindow = 5;
-      m_pFindDialog->currentLine = 0;
-      m_pFindDialog->currentPos = 0;
+      KMessageBox::information(this,i18n("Search complete."),i18n("Search Complete"));
+      m_findHitIdx = -1;
+      return;
    }
-
-   KMessageBox::information(this,i18n("Search complete."),i18n("Search Complete"));
-   m_pFindDialog->currentWindow = 1;
-   m_pFindDialog->currentLine = 0;
-   m_pFindDialog->currentPos = 0;
+   showFindHit( m_findHits[m_findHitIdx] );
 }
 
 void KDiff3App::slotMergeCurrentFile()
@@ -2368,10 +2471,13 @@ void KDiff3App::slotUpdateAvailabilities()
    showWindowC->setEnabled( bDiffWindowVisible &&  m_bTripleDiff && ( m_pDiffTextWindow1->isVisible() || m_pDiffTextWindow2->isVisible() ) );
    editFind->setEnabled( bDiffWindowVisible );
    editFindNext->setEnabled( bDiffWindowVisible );
+   editFindPrev->setEnabled( bDiffWindowVisible );
+   editUndo->setEnabled( bMergeEditorVisible && m_pMergeResultWindow->canUndo() );
+   editRedo->setEnabled( bMergeEditorVisible && m_pMergeResultWindow->canRedo() );
    m_pFindDialog->m_pSearchInC->setEnabled( m_bTripleDiff );
    m_pFindDialog->m_pSearchInOutput->setEnabled( bMergeEditorVisible );
 
-   bool bSavable = bMergeEditorVisible && m_pMergeResultWindow->getNrOfUnsolvedConflicts()==0;
+   bool bSavable = bMergeEditorVisible && m_pMergeResultWindow->getNrOfUnsolvedConflicts()==0 && !isBinaryInput();
    fileSave->setEnabled( m_bOutputModified && bSavable );
    fileSaveAs->setEnabled( bSavable );
 
@@ -15,6 +15,7 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QApplication>
+#include <QFile>
 #include <kio/job.h>
 
 #include <klocale.h>
@@ -90,6 +91,8 @@ void ProgressDialog::pop( bool bRedrawUpdate )
 {
    if ( !m_progressStack.empty() )
    {
+      if ( StageTrace::isEnabled() && !m_progressStack.back().m_traceName.isEmpty() )
+         StageTrace::writeSpan( m_progressStack.back().m_traceName, m_progressStack.back().m_traceStart, StageTrace::now() );
       m_progressStack.pop_back();
       if ( m_progressStack.empty() )
          hide();
@@ -98,10 +101,25 @@ void ProgressDialog::pop( bool bRedrawUpdate )
    }
 }
 
+// Ends the span of the previous information of this level and starts a new one.
+void ProgressDialog::traceInformation( const QString& info )
+{
+   ProgressLevelData& pld = m_progressStack.back();
+   if ( pld.m_traceName == info )
+      return;
+   qint64 t = StageTrace::now();
+   if ( !pld.m_traceName.isEmpty() )
+      StageTrace::writeSpan( pld.m_traceName, pld.m_traceStart, t );
+   pld.m_traceName = info;
+   pld.m_traceStart = t;
+}
+
 void ProgressDialog::setInformation(const QString& info, double dCurrent, bool bRedrawUpdate )
 {
    if ( m_progressStack.empty() )
       return;
+   if ( StageTrace::isEnabled() )
+      traceInformation( info );
    ProgressLevelData& pld = m_progressStack.back();
    pld.m_dCurrent = dCurrent;
    int level = m_progressStack.size();
@@ -121,6 +139,8 @@ void ProgressDialog::setInformation(const QString& info, bool bRedrawUpdate )
 {
    if ( m_progressStack.empty() )
       return;
+   if ( StageTrace::isEnabled() )
+      traceInformation( info );
    //ProgressLevelData& pld = m_progressStack.back();
    int level = m_progressStack.size();
    if ( level==1 )
@@ -387,3 +407,74 @@ void ProgressProxy::setSubRangeTransformation( double dMin, double dMax )
 }
 
 
+
+static QTime s_traceTimer; // Millisecond resolution. QElapsedTimer needs Qt 4.7.
+static QFile* s_pTraceFile = 0;
+static bool s_bTraceInitialised = false;
+
+bool StageTrace::isEnabled()
+{
+   if ( !s_bTraceInitialised )
+   {
+      s_bTraceInitialised = true;
+      QString fileName = QString::fromLocal8Bit( qgetenv("KDIFF3_TRACE") );
+      if ( !fileName.isEmpty() )
+      {
+         fileName.replace( "%p", QString::number( QCoreApplication::applicationPid() ) );
+         s_pTraceFile = new QFile( fileName );
+         if ( s_pTraceFile->open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+         {
+            // The closing bracket is optional in this format. So the file is complete
+            // after every span, even if kdiff3 exits via exit().
+            s_pTraceFile->write( "[\n" );
+            s_pTraceFile->flush();
+            s_traceTimer.start();
+         }
+         else
+         {
+            delete s_pTraceFile;
+            s_pTraceFile = 0;
+         }
+      }
+   }
+   return s_pTraceFile!=0;
+}
+
+qint64 StageTrace::now()
+{
+   if ( !isEnabled() )
+      return 0;
+   return qint64( s_traceTimer.elapsed() ) * 1000;
+}
+
+void StageTrace::writeSpan( const QString& name, qint64 start, qint64 end )
+{
+   if ( !isEnabled() )
+      return;
+
+   QString escapedName;
+   for( int i=0; i<name.length(); ++i )
+   {
+      QChar c = name[i];
+      if ( c=='"' || c=='\\' )   escapedName += QString("\\") + c;
+      else if ( c.unicode()<0x20 ) escapedName += QString("\\u%1").arg( (int)c.unicode(), 4, 16, QChar('0') );
+      else                        escapedName += c;
+   }
+
+   QString event = QString("{\"name\":\"%1\",\"cat\":\"kdiff3\",\"ph\":\"X\",\"ts\":%2,\"dur\":%3,\"pid\":%4,\"tid\":1},\n")
+      .arg( escapedName ).arg( start ).arg( end-start ).arg( QCoreApplication::applicationPid() );
+   s_pTraceFile->write( event.toUtf8() );
+   s_pTraceFile->flush();
+}
+
+StageTrace::StageTrace( const char* name )
+{
+   m_name = name;
+   m_start = now();
+}
+
+StageTrace::~StageTrace()
+{
+   if ( isEnabled() )
+      writeSpan( QString::fromLatin1( m_name ), m_start, now() );
+}
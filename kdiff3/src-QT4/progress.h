@@ -58,6 +58,7 @@ private:
       {
          m_dCurrent=0; m_maxNofSteps=1; m_dRangeMin=0; m_dRangeMax=1; 
          m_dSubRangeMin = 0; m_dSubRangeMax = 1;
+         m_traceStart = 0;
       }
       double m_dCurrent;
       int    m_maxNofSteps;     // when step() is used.
@@ -65,6 +66,8 @@ private:
       double m_dRangeMin;
       double m_dSubRangeMax;
       double m_dSubRangeMin;
+      QString m_traceName;  // Information shown since m_traceStart (see StageTrace)
+      qint64  m_traceStart;
    };
    QList<ProgressLevelData> m_progressStack;
    
@@ -78,6 +81,7 @@ private:
    QLabel* m_pSlowJobInfo;
    QPushButton* m_pAbortButton;
    void recalc(bool bRedrawUpdate);
+   void traceInformation( const QString& info );
    QTime m_t1;
    QTime m_t2;
    bool m_bWasCancelled;
@@ -116,5 +120,24 @@ private:
 
 extern ProgressDialog* g_pProgressDialog;
 
+// Time spans for finding out which stage is slow.
+// If the environment variable KDIFF3_TRACE names a file, then every information
+// shown in the progress dialog and every StageTrace object in scope adds a span
+// to that file in the Chrome trace event format (see chrome://tracing).
+// A "%p" in the filename is replaced by the process id.
+class StageTrace
+{
+public:
+   StageTrace( const char* name );
+   ~StageTrace();
+
+   static bool isEnabled();
+   static qint64 now(); // microseconds since the start (with millisecond resolution)
+   static void writeSpan( const QString& name, qint64 start, qint64 end );
+private:
+   const char* m_name;
+   qint64 m_start;
+};
+
 #endif
 
@@ -374,6 +374,9 @@ FindDialog::FindDialog(QWidget* pParent)
    m_pSearchInA->setChecked( true );
    ++line;
 
+   m_pRegExp = new QCheckBox(i18n("Regular expression"),this);
+   layout->addWidget( m_pRegExp, line, 1 );
+
    m_pSearchInB = new QCheckBox(i18n("Search B"),this);
    layout->addWidget( m_pSearchInB, line, 0 );
    m_pSearchInB->setChecked( true );
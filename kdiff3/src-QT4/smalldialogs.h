@@ -81,10 +81,7 @@ public:
    QCheckBox* m_pSearchInC;
    QCheckBox* m_pSearchInOutput;
    QCheckBox* m_pCaseSensitive;
-
-   int currentLine;
-   int currentPos;
-   int currentWindow;
+   QCheckBox* m_pRegExp;
 };
 
 
@@ -2,13 +2,17 @@
 
 #include <iostream>
 #include <stdio.h>
+#include <string.h>
 
 #include <QDirIterator>
 #include <QTextCodec>
 #include <QTextStream>
 
+#include "binarydiff.h"
+#include "corpusgenerator.h"
 #include "diff.h"
 #include "gnudiff_diff.h"
+#include "mergeengine.h"
 #include "options.h"
 #include "progress.h"
 
@@ -22,21 +26,25 @@ bool g_bIgnoreWhiteSpace = true;
 bool g_bIgnoreTrivialMatches = true;
 
 
-void determineFileAlignment(SourceData &m_sd1, SourceData &m_sd2, SourceData &m_sd3, Diff3LineList &m_diff3LineList)
+// With bFineDiffs==false only the flags needed for merging are calculated, as for "kdiff3 --auto".
+void determineFileAlignment(SourceData &m_sd1, SourceData &m_sd2, SourceData &m_sd3, Diff3LineList &m_diff3LineList, bool bFineDiffs = true)
 {
+   bool (*pFineDiff)( Diff3LineList&, int, const LineData*, const LineData* ) = bFineDiffs ? fineDiff : fineDiffFlagsOnly;
+
    DiffList m_diffList12;
    DiffList m_diffList23;
    DiffList m_diffList13;
 
    m_diff3LineList.clear();
 
-   // Run the diff.
-   if ( m_sd3.isEmpty() )
+   // Run the diff. (Inputs given via setData() have no file name, so isEmpty() is
+   // true for them. Only an input without lines is missing.)
+   if ( m_sd3.getSizeLines()==0 )
    {
       runDiff( m_sd1.getLineDataForDiff(), m_sd1.getSizeLines(), m_sd2.getLineDataForDiff(), m_sd2.getSizeLines(), m_diffList12,1,2,
                &m_manualDiffHelpList, m_pOptions);
       calcDiff3LineListUsingAB( &m_diffList12, m_diff3LineList );
-      fineDiff( m_diff3LineList, 1, m_sd1.getLineDataForDisplay(), m_sd2.getLineDataForDisplay() );
+      pFineDiff( m_diff3LineList, 1, m_sd1.getLineDataForDisplay(), m_sd2.getLineDataForDisplay() );
    }
    else
    {
@@ -50,18 +58,18 @@ void determineFileAlignment(SourceData &m_sd1, SourceData &m_sd2, SourceData &m_
       calcDiff3LineListUsingAB( &m_diffList12, m_diff3LineList );
       calcDiff3LineListUsingAC( &m_diffList13, m_diff3LineList );
       correctManualDiffAlignment( m_diff3LineList, &m_manualDiffHelpList );
-      calcDiff3LineListTrim( m_diff3LineList, m_sd1.getLineDataForDiff(), m_sd2.getLineDataForDiff(), m_sd3.getLineDataForDiff(), &m_manualDiffHelpList );
+      calcDiff3LineListTrim( m_diff3LineList, m_sd1.getLineDataForDiff(), m_sd2.getLineDataForDiff(), m_sd3.getLineDataForDiff(), &m_manualDiffHelpList, m_pOptions );
 
       if ( m_pOptions->m_bDiff3AlignBC )
       {
          calcDiff3LineListUsingBC( &m_diffList23, m_diff3LineList );
          correctManualDiffAlignment( m_diff3LineList, &m_manualDiffHelpList );
-         calcDiff3LineListTrim( m_diff3LineList, m_sd1.getLineDataForDiff(), m_sd2.getLineDataForDiff(), m_sd3.getLineDataForDiff(), &m_manualDiffHelpList );
+         calcDiff3LineListTrim( m_diff3LineList, m_sd1.getLineDataForDiff(), m_sd2.getLineDataForDiff(), m_sd3.getLineDataForDiff(), &m_manualDiffHelpList, m_pOptions );
       }
 
-      fineDiff( m_diff3LineList, 1, m_sd1.getLineDataForDisplay(), m_sd2.getLineDataForDisplay() );
-      fineDiff( m_diff3LineList, 2, m_sd2.getLineDataForDisplay(), m_sd3.getLineDataForDisplay() );
-      fineDiff( m_diff3LineList, 3, m_sd3.getLineDataForDisplay(), m_sd1.getLineDataForDisplay() );
+      pFineDiff( m_diff3LineList, 1, m_sd1.getLineDataForDisplay(), m_sd2.getLineDataForDisplay() );
+      pFineDiff( m_diff3LineList, 2, m_sd2.getLineDataForDisplay(), m_sd3.getLineDataForDisplay() );
+      pFineDiff( m_diff3LineList, 3, m_sd3.getLineDataForDisplay(), m_sd1.getLineDataForDisplay() );
    }
    calcWhiteDiff3Lines( m_diff3LineList, m_sd1.getLineDataForDiff(), m_sd2.getLineDataForDiff(), m_sd3.getLineDataForDiff() );
 }
@@ -87,21 +95,21 @@ void printDiffList(const Diff3LineList &diff3LineList,
       if(d3l.lineA != -1)
       {
          const LineData *pLineData = &sd1.getLineDataForDiff()[d3l.lineA];
-         lineAText = QString(pLineData->pLine, pLineData->size);
+         lineAText = QString(pLineData->getLine(), pLineData->size());
          lineAText = QString("%1 %2").arg(d3l.lineA, linenumsize).arg(lineAText.left(columnsize - linenumsize - 1));
       }
 
       if(d3l.lineB != -1)
       {
          const LineData *pLineData = &sd2.getLineDataForDiff()[d3l.lineB];
-         lineBText = QString(pLineData->pLine, pLineData->size);
+         lineBText = QString(pLineData->getLine(), pLineData->size());
          lineBText = QString("%1 %2").arg(d3l.lineB, linenumsize).arg(lineBText.left(columnsize - linenumsize - 1));
       }
 
       if(d3l.lineC != -1)
       {
          const LineData *pLineData = &sd3.getLineDataForDiff()[d3l.lineC];
-         lineCText = QString(pLineData->pLine, pLineData->size);
+         lineCText = QString(pLineData->getLine(), pLineData->size());
          lineCText = QString("%1 %2").arg(d3l.lineC, linenumsize).arg(lineCText.left(columnsize - linenumsize - 1));
       }
 
@@ -229,7 +237,242 @@ bool runTest(QString file1, QString file2, QString file3, QString expectedResult
    return equal;
 }
 
-int main()
+// Every line of a source must appear exactly once and in order.
+static bool checkLineOrder( const Diff3LineList& diff3LineList, int selector, int sizeLines, QString& error )
+{
+   int expectedLine = 0;
+   Diff3LineList::const_iterator i;
+   for ( i=diff3LineList.begin(); i!=diff3LineList.end(); ++i )
+   {
+      int line = selector==1 ? i->lineA : selector==2 ? i->lineB : i->lineC;
+      if ( line==-1 )
+         continue;
+      if ( line!=expectedLine )
+      {
+         error = QString("Line %1 of source %2 found where line %3 was expected").arg(line).arg(selector).arg(expectedLine);
+         return false;
+      }
+      ++expectedLine;
+   }
+   if ( expectedLine!=sizeLines )
+   {
+      error = QString("Only %1 of %2 lines of source %3 found").arg(expectedLine).arg(sizeLines).arg(selector);
+      return false;
+   }
+   return true;
+}
+
+// A set equality flag requires both lines and that they are equal (apart from
+// white space) or both white or pure comment.
+static bool checkEqualFlag( bool bEqual, int line1, int line2, const LineData* pld1, const LineData* pld2 )
+{
+   if ( !bEqual )
+      return true;
+   if ( line1==-1 || line2==-1 )
+      return false;
+   const LineData& l1 = pld1[line1];
+   const LineData& l2 = pld2[line2];
+   return equal( l1, l2, false, m_pOptions->m_bIgnoreCase ) ||
+          ( (l1.whiteLine() || l1.isPureComment()) && (l2.whiteLine() || l2.isPureComment()) );
+}
+
+static bool checkEqualFlags( const Diff3LineList& diff3LineList, const SourceData& sd1, const SourceData& sd2, const SourceData& sd3, QString& error )
+{
+   int idx = 0;
+   Diff3LineList::const_iterator i;
+   for ( i=diff3LineList.begin(); i!=diff3LineList.end(); ++i, ++idx )
+   {
+      if ( !checkEqualFlag( i->bAEqB, i->lineA, i->lineB, sd1.getLineDataForDiff(), sd2.getLineDataForDiff() ) ||
+           !checkEqualFlag( i->bBEqC, i->lineB, i->lineC, sd2.getLineDataForDiff(), sd3.getLineDataForDiff() ) ||
+           !checkEqualFlag( i->bAEqC, i->lineA, i->lineC, sd1.getLineDataForDiff(), sd3.getLineDataForDiff() ) )
+      {
+         error = QString("Equality flags don't match the text in aligned line %1 (%2 %3 %4)")
+                    .arg(idx).arg(i->lineA).arg(i->lineB).arg(i->lineC);
+         return false;
+      }
+   }
+   return true;
+}
+
+bool runInvariantTest(const QString& name, const CorpusParameters& param, int maxLength)
+{
+   Options options;
+   Diff3LineList diff3LineList;
+   QTextCodec *p_codec = QTextCodec::codecForName("UTF-8");
+   QTextStream out(stdout);
+
+   options.m_bIgnoreCase = false;
+   options.m_bIgnoreNumbers = false;
+   options.m_bIgnoreComments = false;
+   options.m_commentStyle = eCommentStyleC;
+   options.m_bPreserveCarriageReturn = false;
+   options.m_bTryHard = true;
+   options.m_bDiff3AlignBC = true;
+
+   m_pOptions = &options;
+
+   QString testName = QString("generated %1 (%2 lines)").arg(name).arg(param.nofLines);
+   out << "Running test with " << testName << QString("...%1").arg("", maxLength - testName.length());
+   out.flush();
+
+   QStringList base, contrib1, contrib2;
+   generateTriple( param, base, contrib1, contrib2 );
+
+   SourceData m_sd1, m_sd2, m_sd3;
+   m_sd1.setOptions(&options);
+   m_sd1.setData(base.join("\n") + "\n");
+   m_sd1.readAndPreprocess(p_codec, false);
+
+   m_sd2.setOptions(&options);
+   m_sd2.setData(contrib1.join("\n") + "\n");
+   m_sd2.readAndPreprocess(p_codec, false);
+
+   m_sd3.setOptions(&options);
+   m_sd3.setData(contrib2.join("\n") + "\n");
+   m_sd3.readAndPreprocess(p_codec, false);
+
+   determineFileAlignment(m_sd1, m_sd2, m_sd3, diff3LineList);
+
+   QString error;
+   bool ok = checkLineOrder( diff3LineList, 1, m_sd1.getSizeLines(), error ) &&
+             checkLineOrder( diff3LineList, 2, m_sd2.getSizeLines(), error ) &&
+             checkLineOrder( diff3LineList, 3, m_sd3.getSizeLines(), error ) &&
+             checkEqualFlags( diff3LineList, m_sd1, m_sd2, m_sd3, error );
+
+   if(ok)
+      out << "OK" << endl;
+   else
+      out << "NOK" << endl << error << endl;
+
+   return ok;
+}
+
+// Merges the given texts without fine diffs like "kdiff3 --auto" does. If c is empty
+// then a and b are merged as a two way merge.
+bool runAutoMergeTest(const QString& name, const QString& a, const QString& b, const QString& c,
+                      int expectedConflicts, const QString& expectedResult, int maxLength)
+{
+   Options options;
+   Diff3LineList diff3LineList;
+   Diff3LineVector diff3LineVector;
+   DiffBufferInfo diffBufferInfo;
+   TotalDiffStatus totalDiffStatus;
+   QTextCodec *p_codec = QTextCodec::codecForName("UTF-8");
+   QTextStream out(stdout);
+
+   options.m_bIgnoreCase = false;
+   options.m_bIgnoreNumbers = false;
+   options.m_bIgnoreComments = false;
+   options.m_commentStyle = eCommentStyleC;
+   options.m_bPreserveCarriageReturn = false;
+   options.m_bTryHard = true;
+   options.m_bDiff3AlignBC = true;
+   options.m_whiteSpace2FileMergeDefault = 0;
+   options.m_whiteSpace3FileMergeDefault = 0;
+
+   m_pOptions = &options;
+
+   QString testName = QString("auto merge %1").arg(name);
+   out << "Running test with " << testName << QString("...%1").arg("", maxLength - testName.length());
+   out.flush();
+
+   SourceData m_sd1, m_sd2, m_sd3;
+   m_sd1.setOptions(&options);
+   m_sd1.setData(a);
+   m_sd1.readAndPreprocess(p_codec, false);
+
+   m_sd2.setOptions(&options);
+   m_sd2.setData(b);
+   m_sd2.readAndPreprocess(p_codec, false);
+
+   m_sd3.setOptions(&options);
+   if ( !c.isEmpty() )
+   {
+      m_sd3.setData(c);
+      m_sd3.readAndPreprocess(p_codec, false);
+   }
+
+   determineFileAlignment(m_sd1, m_sd2, m_sd3, diff3LineList, false);
+   diffBufferInfo.init( &diff3LineList, &diff3LineVector,
+      m_sd1.getLineDataForDiff(), m_sd1.getSizeLines(),
+      m_sd2.getLineDataForDiff(), m_sd2.getSizeLines(),
+      m_sd3.getLineDataForDiff(), m_sd3.getSizeLines() );
+   calcDiff3LineVector( diff3LineList, diff3LineVector );
+   calcMergeDetails( diff3LineList, m_sd3.getSizeLines()==0 );
+
+   MergeEngine mergeEngine( &options );
+   mergeEngine.init(
+      m_sd1.getLineDataForDisplay(), m_sd1.getSizeLines(),
+      m_sd2.getLineDataForDisplay(), m_sd2.getSizeLines(),
+      m_sd3.getSizeLines()==0 ? 0 : m_sd3.getLineDataForDisplay(), m_sd3.getSizeLines(),
+      &diff3LineList, &diffBufferInfo, &totalDiffStatus );
+   mergeEngine.merge( true, -1 );
+
+   QString error;
+   int nofConflicts = mergeEngine.getNrOfUnsolvedConflicts();
+   if ( nofConflicts!=expectedConflicts )
+      error = QString("%1 unsolved conflicts, expected %2").arg(nofConflicts).arg(expectedConflicts);
+   else if ( nofConflicts==0 )
+   {
+      QByteArray result;
+      if ( !mergeEngine.getOutputData( result, p_codec, eLineEndStyleUnix ) )
+         error = "Writing the merge result failed";
+      else if ( QString::fromUtf8( result ) != expectedResult )
+         error = QString("Merge result \"%1\", expected \"%2\"").arg(QString::fromUtf8( result )).arg(expectedResult);
+   }
+
+   if ( error.isEmpty() )
+      out << "OK" << endl;
+   else
+      out << "NOK" << endl << error << endl;
+
+   return error.isEmpty();
+}
+
+// The diff list must cover both buffers, its equal ranges must be equal and the
+// number of differing bytes must be as expected.
+bool runBinaryDiffTest(const QString& name, const QByteArray& data1, const QByteArray& data2,
+                       qint64 expectedDiffBytes1, qint64 expectedDiffBytes2, int maxLength)
+{
+   QTextStream out(stdout);
+   QString testName = QString("binary diff %1").arg(name);
+   out << "Running test with " << testName << QString("...%1").arg("", maxLength - testName.length());
+   out.flush();
+
+   BinaryDiffList diffList;
+   calcBinaryDiff( data1.constData(), data1.size(), data2.constData(), data2.size(), diffList );
+
+   QString error;
+   qint64 pos1 = 0;
+   qint64 pos2 = 0;
+   qint64 diffBytes1 = 0;
+   qint64 diffBytes2 = 0;
+   BinaryDiffList::const_iterator i;
+   for( i=diffList.begin(); i!=diffList.end() && error.isEmpty(); ++i )
+   {
+      if ( pos1 + i->nofEquals > data1.size() || pos2 + i->nofEquals > data2.size() ||
+           memcmp( data1.constData()+pos1, data2.constData()+pos2, i->nofEquals )!=0 )
+         error = QString("Range of %1 bytes at %2 and %3 is not equal").arg(i->nofEquals).arg(pos1).arg(pos2);
+      pos1 += i->nofEquals + i->diff1;
+      pos2 += i->nofEquals + i->diff2;
+      diffBytes1 += i->diff1;
+      diffBytes2 += i->diff2;
+   }
+   if ( error.isEmpty() && ( pos1!=data1.size() || pos2!=data2.size() ) )
+      error = QString("The diff covers %1 and %2 bytes instead of %3 and %4").arg(pos1).arg(pos2).arg(data1.size()).arg(data2.size());
+   if ( error.isEmpty() && ( diffBytes1!=expectedDiffBytes1 || diffBytes2!=expectedDiffBytes2 ) )
+      error = QString("%1 and %2 bytes differ, expected %3 and %4").arg(diffBytes1).arg(diffBytes2).arg(expectedDiffBytes1).arg(expectedDiffBytes2);
+
+   if ( error.isEmpty() )
+      out << "OK" << endl;
+   else
+      out << "NOK" << endl << error << endl;
+
+   return error.isEmpty();
+}
+
+// Usage: alignmenttest [number of lines for the generated tests]
+int main(int argc, char* argv[])
 {
    bool allOk = true;
    int maxLength = 0;
@@ -277,5 +520,67 @@ int main()
       }
    }
 
+   maxLength = 60;
+   allOk = runAutoMergeTest("changed in B", "int a = 1;\nint b = 2;\nint c = 3;\n", "int a = 1;\nint b = 20;\nint c = 3;\n",
+                            "int a = 1;\nint b = 2;\nint c = 30;\n", 0, "int a = 1;\nint b = 20;\nint c = 30;\n", maxLength) && allOk;
+   allOk = runAutoMergeTest("white space changed in B", "int a = 1;\nint b = 2;\nint c = 3;\n", "int a = 1;\nint  b = 2;\nint c = 3;\n",
+                            "int a = 1;\nint b = 2;\nint c = 30;\n", 0, "int a = 1;\nint  b = 2;\nint c = 30;\n", maxLength) && allOk;
+   allOk = runAutoMergeTest("changed in B and C", "int a = 1;\nint b = 2;\nint c = 3;\n", "int a = 1;\nint b = 20;\nint c = 3;\n",
+                            "int a = 1;\nint b = 200;\nint c = 3;\n", 1, QString(), maxLength) && allOk;
+   allOk = runAutoMergeTest("two way change", "int a = 1;\nint b = 2;\n", "int a = 1;\nint b = 20;\n",
+                            QString(), 1, QString(), maxLength) && allOk;
+
+   QByteArray randomData( 100000, '\0' );
+   RandomGenerator randomGenerator( 4711 );
+   for ( int i = 0; i < randomData.size(); i++ )
+      randomData[i] = char( randomGenerator.next( 256 ) );
+   QByteArray changedRandomData = randomData;
+   changedRandomData[50000] = char( changedRandomData[50000] ^ 0xff );
+   QByteArray zeros( 1000000, '\0' );
+   QByteArray zerosWithInsert = zeros;
+   zerosWithInsert.insert( 500000, char(0xff) );
+   allOk = runBinaryDiffTest("equal", randomData, randomData, 0, 0, maxLength) && allOk;
+   allOk = runBinaryDiffTest("changed byte", randomData, changedRandomData, 1, 1, maxLength) && allOk;
+   allOk = runBinaryDiffTest("inserted byte", randomData, randomData.left(30000) + "x" + randomData.mid(30000), 0, 1, maxLength) && allOk;
+   allOk = runBinaryDiffTest("repetitive data", zeros, zerosWithInsert, 0, 1, maxLength) && allOk;
+
+   int nofGeneratedLines = argc>1 ? QString(argv[1]).toInt() : 20000;
+   if ( nofGeneratedLines>0 )
+   {
+      CorpusParameters param;
+      param.nofLines = nofGeneratedLines;
+      maxLength = 60;
+      allOk = runInvariantTest("equal", param, maxLength) && allOk;
+
+      CorpusParameters insertDelete = param;
+      insertDelete.insertRate = 50;
+      insertDelete.deleteRate = 50;
+      allOk = runInvariantTest("inserts/deletes", insertDelete, maxLength) && allOk;
+
+      CorpusParameters changes = param;
+      changes.changeRate = 100;
+      allOk = runInvariantTest("changes", changes, maxLength) && allOk;
+
+      CorpusParameters moves = param;
+      moves.changeRate = 10;
+      moves.moveRate = 100;
+      allOk = runInvariantTest("moves", moves, maxLength) && allOk;
+
+      CorpusParameters conflicts = param;
+      conflicts.insertRate = 20;
+      conflicts.deleteRate = 20;
+      conflicts.conflictRate = 50;
+      allOk = runInvariantTest("conflicts", conflicts, maxLength) && allOk;
+
+      CorpusParameters mixed = param;
+      mixed.insertRate = 30;
+      mixed.deleteRate = 30;
+      mixed.changeRate = 30;
+      mixed.conflictRate = 30;
+      mixed.moveRate = 30;
+      mixed.seed = 815;
+      allOk = runInvariantTest("mixed", mixed, maxLength) && allOk;
+   }
+
    return allOk ? 0 : -1;
 }
@@ -0,0 +1,107 @@
+// vim:sw=3:ts=3:expandtab
+
+#include "corpusgenerator.h"
+
+#include <QFile>
+#include <QList>
+
+QString makeLine( RandomGenerator& rng, int length )
+{
+   static const char* words[] = { "int", "if", "return", "value", "m_pBuffer", "(", ")", "{", "}",
+                                  "for", "i++", "=", "==", "+", "size", ";", "// comment", "const", "x" };
+   const int nofWords = sizeof(words)/sizeof(words[0]);
+   QString s( rng.next(4)*3, ' ' );
+   while ( s.length() < length )
+   {
+      s += words[ rng.next(nofWords) ];
+      s += rng.next(3)==0 ? QString::number( rng.next(1000) ) : QString(" ");
+   }
+   return s.left( length );
+}
+
+QStringList makeText( RandomGenerator& rng, int nofLines, int maxLineLength )
+{
+   QStringList lines;
+   for( int i=0; i<nofLines; ++i )
+      lines.push_back( makeLine( rng, rng.next(maxLineLength)+1 ) );
+   return lines;
+}
+
+QStringList editChars( RandomGenerator& rng, const QStringList& base, int percent )
+{
+   QStringList lines = base;
+   for( int i=0; i<lines.size(); ++i )
+   {
+      if ( rng.next(100) < percent && !lines[i].isEmpty() )
+      {
+         for( int j=0; j<5; ++j )
+            lines[i][ rng.next( lines[i].length() ) ] = QChar( 'a' + rng.next(26) );
+      }
+   }
+   return lines;
+}
+
+// Moves moveRate per mille of the blocks to random positions.
+static QStringList moveBlocks( RandomGenerator& rng, const QStringList& lines, int moveRate, int blockSize )
+{
+   if ( moveRate<=0 || blockSize<=0 )
+      return lines;
+
+   QList<QStringList> blocks;
+   for( int i=0; i<lines.size(); i+=blockSize )
+      blocks.push_back( lines.mid( i, blockSize ) );
+   int nofMoves = blocks.size() * moveRate / 1000;
+   for( int i=0; i<nofMoves; ++i )
+      blocks.move( rng.next( blocks.size() ), rng.next( blocks.size() ) );
+
+   QStringList result;
+   for( int i=0; i<blocks.size(); ++i )
+      result += blocks[i];
+   return result;
+}
+
+void generateTriple( const CorpusParameters& param, QStringList& base, QStringList& contrib1, QStringList& contrib2 )
+{
+   RandomGenerator rng( param.seed );
+   base = makeText( rng, param.nofLines, param.maxLineLength );
+   contrib1.clear();
+   contrib2.clear();
+
+   for( int i=0; i<base.size(); ++i )
+   {
+      if ( rng.next(1000) < param.conflictRate )
+      {
+         contrib1.push_back( makeLine( rng, rng.next(param.maxLineLength)+1 ) );
+         contrib2.push_back( makeLine( rng, rng.next(param.maxLineLength)+1 ) );
+         continue;
+      }
+
+      for( int c=0; c<2; ++c )
+      {
+         QStringList& contrib = c==0 ? contrib1 : contrib2;
+         if ( rng.next(1000) < param.insertRate )
+            contrib.push_back( makeLine( rng, rng.next(param.maxLineLength)+1 ) );
+
+         int r = rng.next(1000);
+         if ( r < param.deleteRate )
+            ; // removed
+         else if ( r < param.deleteRate + param.changeRate )
+            contrib.push_back( makeLine( rng, rng.next(param.maxLineLength)+1 ) );
+         else
+            contrib.push_back( base[i] );
+      }
+   }
+
+   contrib1 = moveBlocks( rng, contrib1, param.moveRate, param.moveBlockSize );
+   contrib2 = moveBlocks( rng, contrib2, param.moveRate, param.moveBlockSize );
+}
+
+bool writeLines( const QString& fileName, const QStringList& lines )
+{
+   QFile file( fileName );
+   if ( !file.open( QIODevice::WriteOnly ) )
+      return false;
+   QByteArray data = lines.join("\n").toUtf8();
+   data += '\n';
+   return file.write( data ) == data.size();
+}
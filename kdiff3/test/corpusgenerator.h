@@ -0,0 +1,61 @@
+// vim:sw=3:ts=3:expandtab
+
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <QString>
+#include <QStringList>
+
+// Reproducible on all platforms, unlike rand().
+class RandomGenerator
+{
+public:
+   RandomGenerator( unsigned int seed ) { m_state = seed; }
+   unsigned int next()
+   {
+      m_state = m_state * 1103515245u + 12345u;
+      return (m_state >> 16) & 0x7fff;
+   }
+   int next( int range ) { return range>0 ? int( next() % (unsigned int)range ) : 0; }
+private:
+   unsigned int m_state;
+};
+
+// Describes a generated 3-way input. All rates are per mille of the base lines.
+struct CorpusParameters
+{
+   CorpusParameters()
+   {
+      nofLines = 1000;
+      maxLineLength = 60;
+      insertRate = 0;
+      deleteRate = 0;
+      changeRate = 0;
+      conflictRate = 0;
+      moveRate = 0;
+      moveBlockSize = 20;
+      seed = 4711;
+   }
+   int nofLines;
+   int maxLineLength;
+   int insertRate;    // New line inserted before a base line (per contributor)
+   int deleteRate;    // Base line removed (per contributor)
+   int changeRate;    // Base line replaced (per contributor)
+   int conflictRate;  // Base line replaced differently in both contributors
+   int moveRate;      // Blocks moved to another position (per contributor)
+   int moveBlockSize;
+   unsigned int seed;
+};
+
+QString makeLine( RandomGenerator& rng, int length );
+QStringList makeText( RandomGenerator& rng, int nofLines, int maxLineLength );
+
+// Changes five characters in percent% of the lines, e.g. for long lines with small edits.
+QStringList editChars( RandomGenerator& rng, const QStringList& base, int percent );
+
+// Same parameters always give the same texts.
+void generateTriple( const CorpusParameters& param, QStringList& base, QStringList& contrib1, QStringList& contrib2 );
+
+bool writeLines( const QString& fileName, const QStringList& lines );
+
+#endif
@@ -74,3 +74,13 @@ QDialog *ProgressProxy::getDialog()
   return NULL;
 }
 
+
+StageTrace::StageTrace( const char* name )
+{
+  m_name = name;
+  m_start = 0;
+}
+
+StageTrace::~StageTrace()
+{
+}
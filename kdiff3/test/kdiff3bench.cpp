@@ -0,0 +1,314 @@
+// vim:sw=3:ts=3:expandtab
+
+// Times the stages of the diff core on generated corpora.
+// Usage: kdiff3bench [scale]
+//   scale: Factor for the corpus sizes (default 1.0), e.g. 0.1 for a quick run.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <list>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTextCodec>
+#include <QTextStream>
+#include <QTime>
+
+#include "corpusgenerator.h"
+#include "diff.h"
+#include "gnudiff_diff.h"
+#include "options.h"
+#include "progress.h"
+
+#define i18n(s) s
+
+
+bool g_bIgnoreWhiteSpace = true;
+bool g_bIgnoreTrivialMatches = true;
+
+struct FileTriple
+{
+   QString base;
+   QString contrib1;
+   QString contrib2;
+};
+
+struct Corpus
+{
+   QString name;
+   std::list<FileTriple> triples;
+   qint64 nofLines;
+};
+
+static bool addTriple( Corpus& corpus, const QDir& dir, const QStringList& base, const QStringList& contrib1, const QStringList& contrib2 )
+{
+   QString prefix = dir.filePath( corpus.name + "_" + QString::number( corpus.triples.size() ) );
+   FileTriple ft;
+   ft.base     = prefix + "_base.txt";
+   ft.contrib1 = prefix + "_contrib1.txt";
+   ft.contrib2 = prefix + "_contrib2.txt";
+   if ( !writeLines( ft.base, base ) || !writeLines( ft.contrib1, contrib1 ) || !writeLines( ft.contrib2, contrib2 ) )
+      return false;
+   corpus.triples.push_back( ft );
+   corpus.nofLines += base.size() + contrib1.size() + contrib2.size();
+   return true;
+}
+
+static bool generateCorpus( Corpus& corpus, const QString& name, const QDir& dir, double scale )
+{
+   corpus.name = name;
+   corpus.nofLines = 0;
+   CorpusParameters param;
+   QStringList base, contrib1, contrib2;
+   if ( name=="equal" )
+   {
+      param.nofLines = int(200000*scale);
+      generateTriple( param, base, contrib1, contrib2 );
+      return addTriple( corpus, dir, base, contrib1, contrib2 );
+   }
+   else if ( name=="dense-edits" )
+   {
+      param.nofLines = int(50000*scale);
+      param.insertRate = 100;
+      param.deleteRate = 100;
+      param.changeRate = 100;
+      generateTriple( param, base, contrib1, contrib2 );
+      return addTriple( corpus, dir, base, contrib1, contrib2 );
+   }
+   else if ( name=="moved-blocks" )
+   {
+      param.nofLines = int(100000*scale);
+      param.changeRate = 20;
+      param.moveRate = 250;
+      param.moveBlockSize = 50;
+      generateTriple( param, base, contrib1, contrib2 );
+      return addTriple( corpus, dir, base, contrib1, contrib2 );
+   }
+   else if ( name=="long-lines" )
+   {
+      RandomGenerator rng( param.seed );
+      base = makeText( rng, int(5000*scale), 2000 );
+      return addTriple( corpus, dir, base, editChars( rng, base, 20 ), editChars( rng, base, 20 ) );
+   }
+   else if ( name=="small-files" )
+   {
+      int nofFiles = int(2000*scale);
+      param.nofLines = 50;
+      param.insertRate = 30;
+      param.deleteRate = 30;
+      param.changeRate = 30;
+      for( int i=0; i<nofFiles; ++i )
+      {
+         param.seed = 4711 + i;
+         generateTriple( param, base, contrib1, contrib2 );
+         if ( !addTriple( corpus, dir, base, contrib1, contrib2 ) )
+            return false;
+      }
+      return true;
+   }
+   return false;
+}
+
+// Peak resident memory of the process in KB or -1 if unknown.
+static qint64 getPeakMemoryKB()
+{
+   QFile status( "/proc/self/status" );
+   if ( status.open( QIODevice::ReadOnly ) )
+   {
+      QTextStream t( &status );
+      QString line;
+      while ( !(line = t.readLine()).isNull() )
+      {
+         if ( line.startsWith("VmHWM:") )
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+      }
+   }
+#if defined(_WIN32)
+   return -1;
+#else
+   struct rusage usage;
+   if ( getrusage( RUSAGE_SELF, &usage )!=0 )
+      return -1;
+#ifdef __APPLE__
+   return usage.ru_maxrss / 1024;  // bytes
+#else
+   return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// Restarts the peak memory measurement where the system allows it (Linux only).
+static void resetPeakMemory()
+{
+   QFile clearRefs( "/proc/self/clear_refs" );
+   if ( clearRefs.open( QIODevice::WriteOnly ) )
+      clearRefs.write( "5" );
+}
+
+struct Job
+{
+   SourceData sd1, sd2, sd3;
+   DiffList diffList12, diffList23, diffList13;
+   Diff3LineList diff3LineList;
+};
+
+enum e_Stage { eReadAndPreprocess, eRunDiff, eCalcDiff3LineList, eCalcDiff3LineListTrim, eFineDiff, eCalcWhiteDiff3Lines, eNofStages };
+static const char* s_stageNames[eNofStages] =
+   { "readAndPreprocess", "runDiff", "calcDiff3LineList", "calcDiff3LineListTrim", "fineDiff", "calcWhiteDiff3Lines" };
+
+// Runs each stage for all files of the corpus before the next stage, so that
+// also the many small files give measurable times.
+static void runCorpus( Corpus& corpus, Options* pOptions, QTextStream& out )
+{
+   QTextCodec* pCodec = QTextCodec::codecForName("UTF-8");
+   ManualDiffHelpList manualDiffHelpList;
+   std::list<Job*> jobs; // SourceData can't be copied
+   int elapsed[eNofStages];
+   QTime timer;
+
+   resetPeakMemory();
+
+   std::list<FileTriple>::iterator ti;
+   std::list<Job*>::iterator ji;
+
+   timer.start();
+   for( ti=corpus.triples.begin(); ti!=corpus.triples.end(); ++ti )
+   {
+      jobs.push_back( new Job );
+      Job& job = *jobs.back();
+      job.sd1.setOptions( pOptions );  job.sd1.setFilename( ti->base );      job.sd1.readAndPreprocess( pCodec, false );
+      job.sd2.setOptions( pOptions );  job.sd2.setFilename( ti->contrib1 );  job.sd2.readAndPreprocess( pCodec, false );
+      job.sd3.setOptions( pOptions );  job.sd3.setFilename( ti->contrib2 );  job.sd3.readAndPreprocess( pCodec, false );
+   }
+   elapsed[eReadAndPreprocess] = timer.elapsed();
+
+   timer.start();
+   for( ji=jobs.begin(); ji!=jobs.end(); ++ji )
+   {
+      runDiff( (*ji)->sd1.getLineDataForDiff(), (*ji)->sd1.getSizeLines(), (*ji)->sd2.getLineDataForDiff(), (*ji)->sd2.getSizeLines(), (*ji)->diffList12, 1, 2,
+               &manualDiffHelpList, pOptions );
+      runDiff( (*ji)->sd2.getLineDataForDiff(), (*ji)->sd2.getSizeLines(), (*ji)->sd3.getLineDataForDiff(), (*ji)->sd3.getSizeLines(), (*ji)->diffList23, 2, 3,
+               &manualDiffHelpList, pOptions );
+      runDiff( (*ji)->sd1.getLineDataForDiff(), (*ji)->sd1.getSizeLines(), (*ji)->sd3.getLineDataForDiff(), (*ji)->sd3.getSizeLines(), (*ji)->diffList13, 1, 3,
+               &manualDiffHelpList, pOptions );
+   }
+   elapsed[eRunDiff] = timer.elapsed();
+
+   timer.start();
+   for( ji=jobs.begin(); ji!=jobs.end(); ++ji )
+   {
+      calcDiff3LineListUsingAB( &(*ji)->diffList12, (*ji)->diff3LineList );
+      calcDiff3LineListUsingAC( &(*ji)->diffList13, (*ji)->diff3LineList );
+      correctManualDiffAlignment( (*ji)->diff3LineList, &manualDiffHelpList );
+   }
+   elapsed[eCalcDiff3LineList] = timer.elapsed();
+
+   timer.start();
+   for( ji=jobs.begin(); ji!=jobs.end(); ++ji )
+   {
+      calcDiff3LineListTrim( (*ji)->diff3LineList, (*ji)->sd1.getLineDataForDiff(), (*ji)->sd2.getLineDataForDiff(), (*ji)->sd3.getLineDataForDiff(),
+                             &manualDiffHelpList, pOptions );
+   }
+   elapsed[eCalcDiff3LineListTrim] = timer.elapsed();
+
+   timer.start();
+   for( ji=jobs.begin(); ji!=jobs.end(); ++ji )
+   {
+      fineDiff( (*ji)->diff3LineList, 1, (*ji)->sd1.getLineDataForDisplay(), (*ji)->sd2.getLineDataForDisplay() );
+      fineDiff( (*ji)->diff3LineList, 2, (*ji)->sd2.getLineDataForDisplay(), (*ji)->sd3.getLineDataForDisplay() );
+      fineDiff( (*ji)->diff3LineList, 3, (*ji)->sd3.getLineDataForDisplay(), (*ji)->sd1.getLineDataForDisplay() );
+   }
+   elapsed[eFineDiff] = timer.elapsed();
+
+   timer.start();
+   for( ji=jobs.begin(); ji!=jobs.end(); ++ji )
+   {
+      calcWhiteDiff3Lines( (*ji)->diff3LineList, (*ji)->sd1.getLineDataForDiff(), (*ji)->sd2.getLineDataForDiff(), (*ji)->sd3.getLineDataForDiff() );
+   }
+   elapsed[eCalcWhiteDiff3Lines] = timer.elapsed();
+
+   for( int i=0; i<eNofStages; ++i )
+   {
+      QString linesPerSecond = elapsed[i]>0 ? QString::number( corpus.nofLines*1000/elapsed[i] ) : QString("-");
+      out << QString("%1 %2 %3 %4 %5\n")
+                .arg( corpus.name, -14 )
+                .arg( corpus.nofLines, 9 )
+                .arg( s_stageNames[i], -22 )
+                .arg( elapsed[i], 8 )
+                .arg( linesPerSecond, 12 );
+   }
+   qint64 peakKB = getPeakMemoryKB();
+
+   for( ji=jobs.begin(); ji!=jobs.end(); ++ji )
+      delete *ji;
+   out << QString("%1 peak memory: %2\n\n").arg( corpus.name, -14 )
+                .arg( peakKB>=0 ? QString::number(peakKB) + " KB" : QString("unknown") );
+   out.flush();
+}
+
+int main( int argc, char* argv[] )
+{
+   QCoreApplication app( argc, argv );
+   QTextStream out(stdout);
+
+   double scale = 1.0;
+   if ( argc>1 )
+   {
+      scale = atof( argv[1] );
+      if ( scale<=0 )
+      {
+         out << "Usage: kdiff3bench [scale]" << endl;
+         return -1;
+      }
+   }
+
+   Options options;
+   options.m_bIgnoreCase = false;
+   options.m_bIgnoreNumbers = false;
+   options.m_bIgnoreComments = false;
+   options.m_commentStyle = eCommentStyleC;
+   options.m_bPreserveCarriageReturn = false;
+   options.m_bTryHard = true;
+   options.m_bDiff3AlignBC = false;
+   options.m_pEncodingPP = 0;
+
+   QDir tempDir( QDir::tempPath() );
+   QString dirName = "kdiff3bench-" + QString::number( QCoreApplication::applicationPid() );
+   if ( !tempDir.mkdir( dirName ) || !tempDir.cd( dirName ) )
+   {
+      out << "Can't create directory " << tempDir.filePath( dirName ) << endl;
+      return -1;
+   }
+
+   out << QString("%1 %2 %3 %4 %5\n").arg("corpus",-14).arg("lines",9).arg("stage",-22).arg("ms",8).arg("lines/s",12);
+
+   bool bOk = true;
+   const char* corpusNames[] = { "equal", "dense-edits", "moved-blocks", "long-lines", "small-files" };
+   for( unsigned int i=0; i<sizeof(corpusNames)/sizeof(corpusNames[0]); ++i )
+   {
+      Corpus corpus;
+      if ( generateCorpus( corpus, corpusNames[i], tempDir, scale ) )
+         runCorpus( corpus, &options, out );
+      else
+      {
+         out << "Can't generate corpus " << corpusNames[i] << endl;
+         bOk = false;
+      }
+
+      std::list<FileTriple>::iterator ti;
+      for( ti=corpus.triples.begin(); ti!=corpus.triples.end(); ++ti )
+      {
+         QFile::remove( ti->base );
+         QFile::remove( ti->contrib1 );
+         QFile::remove( ti->contrib2 );
+      }
+   }
+
+   QDir::temp().rmdir( dirName );
+   return bOk ? 0 : -1;
+}
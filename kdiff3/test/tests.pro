@@ -1,16 +1,21 @@
 TEMPLATE = app
 CONFIG  += qt warn_on thread precompile_header debug
 
-HEADERS  = ../src-QT4/kreplacements/kreplacements.h \
+HEADERS  = corpusgenerator.h \
+           ../src-QT4/kreplacements/kreplacements.h \
            ../src-QT4/fileaccess.h \
+           ../src-QT4/mergeengine.h \
            ../src-QT4/progress.h
 SOURCES = alignmenttest.cpp \
+          corpusgenerator.cpp \
           ../src-QT4/common.cpp \
           ../src-QT4/diff.cpp \
+          ../src-QT4/binarydiff.cpp \
           ../src-QT4/fileaccess.cpp \
           ../src-QT4/gnudiff_analyze.cpp \
           ../src-QT4/gnudiff_io.cpp \
           ../src-QT4/gnudiff_xmalloc.cpp \
+          ../src-QT4/mergeengine.cpp \
           ../src-QT4/kreplacements/kreplacements.cpp \
           fakekdiff3_part.cpp \
           fakeprogressproxy.cpp
@@ -27,3 +32,6 @@ check.depends = alignmenttest
 check.commands = ./alignmenttest
 
 
+QMAKE_EXTRA_TARGETS += bench
+
+bench.commands = $(QMAKE) kdiff3bench.pro -o Makefile.bench && $(MAKE) -f Makefile.bench && ./kdiff3bench